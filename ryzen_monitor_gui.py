@@ -7,7 +7,7 @@ Modern GUI interface for monitoring AMD Ryzen CPU statistics
 import sys
 import ctypes
 import os
-from ctypes import Structure, c_int, c_float, c_char, POINTER
+from ctypes import Structure, c_int, c_uint, c_float, c_char, c_ulonglong, c_void_p, POINTER
 from PyQt6.QtWidgets import (QApplication, QMainWindow, QWidget, QVBoxLayout, 
                              QHBoxLayout, QTableWidget, QTableWidgetItem, 
                              QLabel, QGroupBox, QGridLayout, QProgressBar,
@@ -87,11 +87,60 @@ class CalculatedStats(Structure):
     ]
 
 
+class SampleInfo(Structure):
+    _fields_ = [("seq", c_ulonglong), ("timestamp_ns", c_ulonglong)]
+
+
+# Structure-of-arrays buffer, see ryzen_soa_t. Allocated once and refilled in
+# place; memoryview(soa.frequency) or numpy.ctypeslib.as_array(soa.frequency)
+# give copy-free views of the per-core arrays.
+SOA_VERSION = 1
+SOA_MAX_CORES = 32
+
+class SoAData(Structure):
+    _fields_ = [
+        ("version", c_uint), ("size", c_uint), ("core_count", c_int),
+        ("reserved", c_int), ("seq", c_ulonglong), ("timestamp_ns", c_ulonglong),
+        ("frequency", c_float * SOA_MAX_CORES), ("power", c_float * SOA_MAX_CORES),
+        ("voltage", c_float * SOA_MAX_CORES), ("temp", c_float * SOA_MAX_CORES),
+        ("c0", c_float * SOA_MAX_CORES), ("cc1", c_float * SOA_MAX_CORES),
+        ("cc6", c_float * SOA_MAX_CORES), ("disabled", c_int * SOA_MAX_CORES),
+        ("sleeping", c_int * SOA_MAX_CORES),
+        ("constraints", ConstraintsData), ("memory", MemoryData),
+        ("power_data", PowerData), ("graphics", GraphicsData),
+        ("stats", CalculatedStats)
+    ]
+
+
+# Topology rollups, see ryzen_group_t
+GROUP_CCD = 0
+GROUP_CCX = 1
+MAX_GROUPS = 8
+
+class GroupData(Structure):
+    _fields_ = [
+        ("index", c_int), ("ccd", c_int), ("cores", c_int),
+        ("avg_frequency", c_float), ("peak_frequency", c_float),
+        ("avg_temp", c_float), ("peak_temp", c_float), ("power", c_float),
+        ("c0", c_float), ("cc1", c_float), ("cc6", c_float),
+        ("l3_logic_power", c_float), ("l3_vddm_power", c_float)
+    ]
+
+
+# The library samples in the background; the UI only decodes the newest snapshot
+SAMPLER_INTERVAL_MS = 1000
+SAMPLER_DEPTH = 64
+
+
 class RyzenMonitorLib:
     """Wrapper for the Ryzen Monitor shared library"""
     
     def __init__(self):
         self.lib = None
+        self.session = None
+        self.soa = None
+        self.buffers = None
+        self.groups = None
         self.initialized = False
         
     def load(self, lib_path="libryzen_monitor.so"):
@@ -113,6 +162,30 @@ class RyzenMonitorLib:
                 POINTER(CalculatedStats)
             ]
             self.lib.ryzen_read_data.restype = c_int
+            self.lib.ryzen_session_open.restype = c_void_p
+            self.lib.ryzen_session_close.argtypes = [c_void_p]
+            self.lib.ryzen_session_close.restype = None
+            self.lib.ryzen_sampler_start.argtypes = [c_void_p, c_uint, c_uint]
+            self.lib.ryzen_sampler_start.restype = c_int
+            self.lib.ryzen_read_latest.argtypes = [
+                c_void_p,
+                POINTER(CoreData), c_int,
+                POINTER(ConstraintsData),
+                POINTER(MemoryData),
+                POINTER(PowerData),
+                POINTER(GraphicsData),
+                POINTER(CalculatedStats),
+                POINTER(SampleInfo)
+            ]
+            self.lib.ryzen_read_latest.restype = c_int
+            self.lib.ryzen_read_groups.argtypes = [
+                c_void_p, c_int, POINTER(GroupData), c_int, POINTER(SampleInfo)
+            ]
+            self.lib.ryzen_read_groups.restype = c_int
+            self.lib.ryzen_soa_init.argtypes = [POINTER(SoAData)]
+            self.lib.ryzen_soa_init.restype = None
+            self.lib.ryzen_soa_read.argtypes = [c_void_p, POINTER(SoAData)]
+            self.lib.ryzen_soa_read.restype = c_int
             
             return True
         except Exception as e:
@@ -121,13 +194,30 @@ class RyzenMonitorLib:
     
     def init(self):
         """Initialize the library"""
-        if self.lib.ryzen_init() == 0:
-            self.initialized = True
-            return True
-        return False
+        if self.lib.ryzen_init() != 0:
+            return False
+        self.initialized = True
+
+        # Fall back to synchronous reads if the sampler can't be started
+        self.session = self.lib.ryzen_session_open()
+        if self.session and self.lib.ryzen_sampler_start(
+                self.session, SAMPLER_INTERVAL_MS, SAMPLER_DEPTH) != 0:
+            self.lib.ryzen_session_close(self.session)
+            self.session = None
+
+        if self.session:
+            self.soa = SoAData()
+            self.lib.ryzen_soa_init(ctypes.byref(self.soa))
+            if self.soa.size != ctypes.sizeof(SoAData):
+                self.soa = None
+        return True
     
     def cleanup(self):
         """Cleanup"""
+        if self.session:
+            self.lib.ryzen_session_close(self.session)
+            self.session = None
+        self.soa = None
         if self.initialized:
             self.lib.ryzen_cleanup()
             self.initialized = False
@@ -147,26 +237,56 @@ class RyzenMonitorLib:
         if not self.initialized:
             return None, None, None, None, None, None
         
-        cores = (CoreData * max_cores)()
-        constraints = ConstraintsData()
-        memory = MemoryData()
-        power = PowerData()
-        graphics = GraphicsData()
-        stats = CalculatedStats()
-
-        num_cores = self.lib.ryzen_read_data(
-            cores, max_cores,
-            ctypes.byref(constraints),
-            ctypes.byref(memory),
-            ctypes.byref(power),
-            ctypes.byref(graphics),
-            ctypes.byref(stats)
-        )
+        # The library fills the same buffers on every tick
+        if not self.buffers or len(self.buffers[0]) != max_cores:
+            self.buffers = ((CoreData * max_cores)(), ConstraintsData(),
+                            MemoryData(), PowerData(), GraphicsData(),
+                            CalculatedStats())
+        cores, constraints, memory, power, graphics, stats = self.buffers
+
+        if self.session:
+            num_cores = self.lib.ryzen_read_latest(
+                self.session,
+                cores, max_cores,
+                ctypes.byref(constraints),
+                ctypes.byref(memory),
+                ctypes.byref(power),
+                ctypes.byref(graphics),
+                ctypes.byref(stats),
+                None
+            )
+        else:
+            num_cores = self.lib.ryzen_read_data(
+                cores, max_cores,
+                ctypes.byref(constraints),
+                ctypes.byref(memory),
+                ctypes.byref(power),
+                ctypes.byref(graphics),
+                ctypes.byref(stats)
+            )
         
         if num_cores > 0:
             return cores[:num_cores], constraints, memory, power, graphics, stats
         return None, None, None, None, None, None
 
+    def read_groups(self, level=GROUP_CCD):
+        """Per CCD or CCX rollups of the newest sample"""
+        if not self.session:
+            return []
+        if not self.groups:
+            self.groups = (GroupData * MAX_GROUPS)()
+        n = self.lib.ryzen_read_groups(self.session, level, self.groups,
+                                       MAX_GROUPS, None)
+        return self.groups[:n] if n > 0 else []
+
+    def read_soa(self):
+        """Refresh the shared SoA buffer; returns it only if it changed"""
+        if not self.soa:
+            return None
+        if self.lib.ryzen_soa_read(self.session, ctypes.byref(self.soa)) > 0:
+            return self.soa
+        return None
+
 
 class RyzenMonitorGUI(QMainWindow):
     """Main GUI window"""
@@ -174,6 +294,9 @@ class RyzenMonitorGUI(QMainWindow):
     def __init__(self):
         super().__init__()
         self.lib = RyzenMonitorLib()
+        self.cell_items = []
+        self.cell_text = []
+        self.label_text = {}
         self.init_ui()
         
         # Try to load and initialize library
@@ -398,69 +521,121 @@ class RyzenMonitorGUI(QMainWindow):
         self.cores_label.setText(f"Cores: {self.sysdata.enabled_cores_count} / CCDs: {self.sysdata.ccds}")
         self.smu_label.setText(f"SMU: v{self.sysdata.smu_fw_ver.decode('utf-8')}")
     
+    def set_cell(self, row, col, text):
+        """Only touch a table cell whose text changed"""
+        if self.cell_text[row][col] != text:
+            self.cell_text[row][col] = text
+            self.cell_items[row][col].setText(text)
+
+    def set_text(self, label, text):
+        """Only touch a label whose text changed"""
+        if self.label_text.get(id(label)) != text:
+            self.label_text[id(label)] = text
+            label.setText(text)
+
+    def resize_core_table(self, rows):
+        """Create the cell items once; later updates only change their text"""
+        if len(self.cell_items) == rows:
+            return
+        self.core_table.setRowCount(rows)
+        self.cell_items = [[QTableWidgetItem() for _ in range(8)] for _ in range(rows)]
+        self.cell_text = [[None] * 8 for _ in range(rows)]
+        for i in range(rows):
+            for j in range(8):
+                self.core_table.setItem(i, j, self.cell_items[i][j])
+
     def update_data(self):
+        if self.lib.soa:
+            soa = self.lib.read_soa()
+            if soa:
+                self.update_from_soa(soa)
+            return
+
         cores, constraints, memory, power, graphics, stats = self.lib.read_data()
         if not cores: return
 
         # Core Table
-        self.core_table.setRowCount(len(cores))
+        self.resize_core_table(len(cores))
         for i, core in enumerate(cores):
             status = "Disabled" if core.disabled else ("Sleeping" if core.sleeping else f"{core.frequency:.0f}")
-            self.core_table.setItem(i, 0, QTableWidgetItem(f"Core {core.core_num}"))
-            self.core_table.setItem(i, 1, QTableWidgetItem(status))
-            self.core_table.setItem(i, 2, QTableWidgetItem(f"{core.power:.3f}"))
-            self.core_table.setItem(i, 3, QTableWidgetItem(f"{core.voltage:.3f}"))
-            self.core_table.setItem(i, 4, QTableWidgetItem(f"{core.temp:.1f}"))
-            self.core_table.setItem(i, 5, QTableWidgetItem(f"{core.c0:.1f}"))
-            self.core_table.setItem(i, 6, QTableWidgetItem(f"{core.cc1:.1f}"))
-            self.core_table.setItem(i, 7, QTableWidgetItem(f"{core.cc6:.1f}"))
-
+            self.set_cell(i, 0, f"Core {core.core_num}")
+            self.set_cell(i, 1, status)
+            self.set_cell(i, 2, f"{core.power:.3f}")
+            self.set_cell(i, 3, f"{core.voltage:.3f}")
+            self.set_cell(i, 4, f"{core.temp:.1f}")
+            self.set_cell(i, 5, f"{core.c0:.1f}")
+            self.set_cell(i, 6, f"{core.cc1:.1f}")
+            self.set_cell(i, 7, f"{core.cc6:.1f}")
+
+        self.update_summary(constraints, memory, power, graphics, stats)
+
+    def update_from_soa(self, soa):
+        n = soa.core_count
+        freq, pwr, volt, temp = soa.frequency, soa.power, soa.voltage, soa.temp
+        c0, cc1, cc6 = soa.c0, soa.cc1, soa.cc6
+        disabled, sleeping = soa.disabled, soa.sleeping
+
+        self.resize_core_table(n)
+        for i in range(n):
+            status = "Disabled" if disabled[i] else ("Sleeping" if sleeping[i] else f"{freq[i]:.0f}")
+            self.set_cell(i, 0, f"Core {i}")
+            self.set_cell(i, 1, status)
+            self.set_cell(i, 2, f"{pwr[i]:.3f}")
+            self.set_cell(i, 3, f"{volt[i]:.3f}")
+            self.set_cell(i, 4, f"{temp[i]:.1f}")
+            self.set_cell(i, 5, f"{c0[i]:.1f}")
+            self.set_cell(i, 6, f"{cc1[i]:.1f}")
+            self.set_cell(i, 7, f"{cc6[i]:.1f}")
+
+        self.update_summary(soa.constraints, soa.memory, soa.power_data, soa.graphics, soa.stats)
+
+    def update_summary(self, constraints, memory, power, graphics, stats):
         # Calculated Stats
         if stats:
-            self.peak_freq_value.setText(f"{stats.peak_core_frequency:.0f} MHz")
-            self.peak_temp_value.setText(f"{stats.peak_core_temp:.1f} °C")
-            self.peak_volt_value.setText(f"{stats.peak_core_voltage:.3f} V")
-            self.avg_volt_value.setText(f"{stats.avg_core_voltage:.3f} V")
-            self.avg_cc6_value.setText(f"{stats.avg_core_cc6:.1f} %")
-            self.total_core_power_value.setText(f"{stats.total_core_power:.3f} W")
-            self.smu_peak_volt_value.setText(f"{stats.peak_core_voltage_smu:.3f} V")
-            self.pkg_cc6_value.setText(f"{stats.package_cc6:.1f} %" if not stats.package_cc6 != stats.package_cc6 else "--")
+            self.set_text(self.peak_freq_value, f"{stats.peak_core_frequency:.0f} MHz")
+            self.set_text(self.peak_temp_value, f"{stats.peak_core_temp:.1f} °C")
+            self.set_text(self.peak_volt_value, f"{stats.peak_core_voltage:.3f} V")
+            self.set_text(self.avg_volt_value, f"{stats.avg_core_voltage:.3f} V")
+            self.set_text(self.avg_cc6_value, f"{stats.avg_core_cc6:.1f} %")
+            self.set_text(self.total_core_power_value, f"{stats.total_core_power:.3f} W")
+            self.set_text(self.smu_peak_volt_value, f"{stats.peak_core_voltage_smu:.3f} V")
+            self.set_text(self.pkg_cc6_value, f"{stats.package_cc6:.1f} %" if not stats.package_cc6 != stats.package_cc6 else "--")
 
 
         # Constraints
         if constraints:
-            self.peak_temp_con_value.setText(f"{constraints.peak_temp:.1f} °C")
+            self.set_text(self.peak_temp_con_value, f"{constraints.peak_temp:.1f} °C")
             self.ppt_bar.setValue(int(constraints.ppt_value / constraints.ppt_limit * 100) if constraints.ppt_limit > 0 else 0)
-            self.ppt_value.setText(f"{constraints.ppt_value:.1f} / {constraints.ppt_limit:.0f} W")
+            self.set_text(self.ppt_value, f"{constraints.ppt_value:.1f} / {constraints.ppt_limit:.0f} W")
             self.tdc_bar.setValue(int(constraints.tdc_value / constraints.tdc_limit * 100) if constraints.tdc_limit > 0 else 0)
-            self.tdc_value.setText(f"{constraints.tdc_value:.1f} / {constraints.tdc_limit:.0f} A")
+            self.set_text(self.tdc_value, f"{constraints.tdc_value:.1f} / {constraints.tdc_limit:.0f} A")
             self.edc_bar.setValue(int(constraints.edc_value / constraints.edc_limit * 100) if constraints.edc_limit > 0 else 0)
-            self.edc_value.setText(f"{constraints.edc_value:.1f} / {constraints.edc_limit:.0f} A")
+            self.set_text(self.edc_value, f"{constraints.edc_value:.1f} / {constraints.edc_limit:.0f} A")
             self.thm_bar.setValue(int(constraints.thm_value / constraints.thm_limit * 100) if constraints.thm_limit > 0 else 0)
-            self.thm_value.setText(f"{constraints.thm_value:.1f} / {constraints.thm_limit:.0f} C")
+            self.set_text(self.thm_value, f"{constraints.thm_value:.1f} / {constraints.thm_limit:.0f} C")
 
         # Memory
         if memory:
-            self.fclk_value.setText(f"{memory.fclk_freq:.0f} MHz")
-            self.fclk_eff_value.setText(f"{memory.fclk_freq_eff:.0f} MHz")
-            self.uclk_value.setText(f"{memory.uclk_freq:.0f} MHz")
-            self.memclk_value.setText(f"{memory.memclk_freq:.0f} MHz")
-            self.coupled_value.setText("ON" if memory.coupled_mode else "OFF")
+            self.set_text(self.fclk_value, f"{memory.fclk_freq:.0f} MHz")
+            self.set_text(self.fclk_eff_value, f"{memory.fclk_freq_eff:.0f} MHz")
+            self.set_text(self.uclk_value, f"{memory.uclk_freq:.0f} MHz")
+            self.set_text(self.memclk_value, f"{memory.memclk_freq:.0f} MHz")
+            self.set_text(self.coupled_value, "ON" if memory.coupled_mode else "OFF")
             # self.vddm_value.setText(f"{memory.v_vddm:.4f} V")
             # self.vddp_value.setText(f"{memory.v_vddp:.4f} V")
             # self.vddg_value.setText(f"{memory.v_vddg:.4f} V")
         
         # Power
         if power:
-            self.socket_power_value.setText(f"{power.socket_power:.3f} W")
-            self.core_power_value.setText(f"{power.total_core_power:.3f} W")
-            self.soc_power_value.setText(f"{power.vddcr_soc_power:.3f} W")
+            self.set_text(self.socket_power_value, f"{power.socket_power:.3f} W")
+            self.set_text(self.core_power_value, f"{power.total_core_power:.3f} W")
+            self.set_text(self.soc_power_value, f"{power.vddcr_soc_power:.3f} W")
             # self.pkg_power_value.setText(f"{power.package_power:.3f} W")
 
         # Graphics
         if graphics:
-            self.gfx_clk_value.setText(f"{graphics.gfx_freq:.0f} MHz")
-            self.gfx_temp_value.setText(f"{graphics.gfx_temp:.1f} °C")
+            self.set_text(self.gfx_clk_value, f"{graphics.gfx_freq:.0f} MHz")
+            self.set_text(self.gfx_temp_value, f"{graphics.gfx_temp:.1f} °C")
 
     def closeEvent(self, event):
         self.timer.stop()
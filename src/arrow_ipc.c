@@ -0,0 +1,657 @@
+/**
+ * Ryzen SMU Userspace Sensor Monitor
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "arrow_ipc.h"
+
+//File layout: magic, the IPC stream (schema, dictionary batches, record
+//batches, end of stream marker), the footer and its size, magic again.
+//Every stream message is a continuation marker, the size of its flatbuffer
+//metadata, the metadata padded to 8 bytes and the body. All little endian.
+#define ARROW_MAGIC             "ARROW1"
+#define ARROW_CONTINUATION      0xffffffffu
+#define ARROW_ALIGN             8
+
+//Schema.fbs and Message.fbs, format version 1.0 (metadata V5)
+#define ARROW_METADATA_V5       4
+#define ARROW_HEADER_SCHEMA     1
+#define ARROW_HEADER_DICTIONARY 2
+#define ARROW_HEADER_RECORDS    3
+#define ARROW_TYPE_INT          2
+#define ARROW_TYPE_FLOAT        3
+#define ARROW_TYPE_UTF8         5
+#define ARROW_TYPE_BOOL         6
+#define ARROW_TYPE_TIMESTAMP    10
+#define ARROW_TYPE_FIXED_LIST   16
+#define ARROW_PRECISION_SINGLE  1
+#define ARROW_UNIT_NANOSECOND   3
+
+#define FB_MAX_SLOTS            8
+#define ARROW_MAX_DICTS         16
+
+//Flatbuffer builder. Like the reference implementation it fills buf from
+//the end, so children are written before the tables referring to them and
+//all offsets point forward. Objects are identified by their distance from
+//the end of buf.
+typedef struct {
+    unsigned char *buf;
+    size_t cap;
+    size_t head;                //buf[head, cap) is in use
+    size_t minalign;
+    size_t table;               //Start of the table being built
+    size_t slots[FB_MAX_SLOTS]; //Its fields, 0 if not set
+    int num_slots;
+    int error;
+} fbb;
+
+typedef struct {
+    long long length;
+    long long null_count;
+} arrow_node;
+
+typedef struct {
+    long long offset;
+    long long length;
+} arrow_buffer;
+
+typedef struct {
+    long long offset;
+    int meta_length;
+    int pad;
+    long long body_length;
+} arrow_block;
+
+struct arrow_writer {
+    FILE *fd;
+    const arrow_column *cols;
+    int num_cols;
+    unsigned int batch_rows;
+    unsigned int rows;          //Buffered, including the one being written
+    unsigned char **data;       //Per column, batch_rows rows
+    unsigned char *bits;        //Bool columns packed for writing
+    arrow_node *nodes;
+    arrow_buffer *buffers;
+    arrow_block dicts[ARROW_MAX_DICTS];
+    int num_dicts;
+    arrow_block *batches;
+    size_t num_batches;
+    size_t cap_batches;
+    unsigned long long total_rows;
+    long long pos;
+    fbb fb;
+    int error;
+};
+
+static size_t fb_off(fbb *b) {
+    return b->cap - b->head;
+}
+
+static void fb_grow(fbb *b, size_t n) {
+    unsigned char *buf;
+    size_t cap, used;
+
+    if (b->head >= n) return;
+    used = fb_off(b);
+    for (cap = b->cap ? b->cap * 2 : 1024; cap - used < n; cap *= 2);
+    buf = malloc(cap);
+    if (!buf) {
+        //Later pushes that do not fit are dropped, error discards the result
+        b->error = 1;
+        return;
+    }
+    if (used) memcpy(buf + cap - used, b->buf + b->head, used);
+    free(b->buf);
+    b->buf = buf;
+    b->head = cap - used;
+    b->cap = cap;
+}
+
+static void fb_pad(fbb *b, size_t n) {
+    fb_grow(b, n);
+    if (b->head < n) return;
+    b->head -= n;
+    memset(b->buf + b->head, 0, n);
+}
+
+static void fb_push(fbb *b, const void *p, size_t n) {
+    fb_grow(b, n);
+    if (b->head < n) return;
+    b->head -= n;
+    memcpy(b->buf + b->head, p, n);
+}
+
+//Aligns so that after writing extra more bytes, the end is at align
+static void fb_prep(fbb *b, size_t align, size_t extra) {
+    if (align > b->minalign) b->minalign = align;
+    fb_pad(b, (align - ((fb_off(b) + extra) & (align - 1))) & (align - 1));
+}
+
+static void fb_reset(fbb *b) {
+    b->head = b->cap;
+    b->minalign = 1;
+    b->error = 0;
+}
+
+static void fb_scalar(fbb *b, const void *p, size_t size) {
+    fb_prep(b, size, 0);
+    fb_push(b, p, size);
+}
+
+static void fb_uoffset(fbb *b, size_t target) {
+    unsigned int v;
+
+    fb_prep(b, 4, 0);
+    v = fb_off(b) + 4 - target;
+    fb_push(b, &v, 4);
+}
+
+static size_t fb_string(fbb *b, const char *s) {
+    unsigned int len = strlen(s);
+
+    fb_prep(b, 4, len + 1);
+    fb_pad(b, 1);
+    fb_push(b, s, len);
+    fb_push(b, &len, 4);
+    return fb_off(b);
+}
+
+static size_t fb_vec_offsets(fbb *b, const size_t *targets, unsigned int n) {
+    int i;
+
+    fb_prep(b, 4, 4 * n);
+    for (i = (int)n - 1; i >= 0; i--) fb_uoffset(b, targets[i]);
+    fb_push(b, &n, 4);
+    return fb_off(b);
+}
+
+static size_t fb_vec_structs(fbb *b, const void *data, size_t size, unsigned int n) {
+    fb_prep(b, 4, size * n);
+    fb_prep(b, ARROW_ALIGN, size * n);
+    fb_push(b, data, size * n);
+    fb_push(b, &n, 4);
+    return fb_off(b);
+}
+
+static void fb_start(fbb *b) {
+    memset(b->slots, 0, sizeof(b->slots));
+    b->num_slots = 0;
+    b->table = fb_off(b);
+}
+
+static void fb_slot(fbb *b, int slot) {
+    b->slots[slot] = fb_off(b);
+    if (slot >= b->num_slots) b->num_slots = slot + 1;
+}
+
+static void fb_u8(fbb *b, int slot, unsigned char v) {
+    fb_scalar(b, &v, 1);
+    fb_slot(b, slot);
+}
+
+static void fb_i16(fbb *b, int slot, short v) {
+    fb_scalar(b, &v, 2);
+    fb_slot(b, slot);
+}
+
+static void fb_i32(fbb *b, int slot, int v) {
+    fb_scalar(b, &v, 4);
+    fb_slot(b, slot);
+}
+
+static void fb_i64(fbb *b, int slot, long long v) {
+    fb_scalar(b, &v, 8);
+    fb_slot(b, slot);
+}
+
+static void fb_ref(fbb *b, int slot, size_t target) {
+    fb_uoffset(b, target);
+    fb_slot(b, slot);
+}
+
+//Writes the table's soffset and its vtable right in front of it
+static size_t fb_end(fbb *b) {
+    unsigned short v;
+    size_t table, vtable;
+    int i, soffset = 0;
+
+    fb_scalar(b, &soffset, 4);
+    table = fb_off(b);
+    for (i = b->num_slots - 1; i >= 0; i--) {
+        v = b->slots[i] ? table - b->slots[i] : 0;
+        fb_push(b, &v, 2);
+    }
+    v = table - b->table;
+    fb_push(b, &v, 2);
+    v = 4 + 2 * b->num_slots;
+    fb_push(b, &v, 2);
+    vtable = fb_off(b);
+
+    soffset = vtable - table;
+    if (!b->error) memcpy(b->buf + b->cap - table, &soffset, 4);
+    return table;
+}
+
+static size_t fb_empty_table(fbb *b) {
+    fb_start(b);
+    return fb_end(b);
+}
+
+static void fb_finish(fbb *b, size_t root) {
+    fb_prep(b, b->minalign, 4);
+    fb_uoffset(b, root);
+}
+
+static size_t fb_int_type(fbb *b, int bits, int is_signed) {
+    fb_start(b);
+    fb_i32(b, 0, bits);
+    fb_u8(b, 1, is_signed);
+    return fb_end(b);
+}
+
+//Type of the values, for a FixedSizeList those of its child
+static size_t fb_value_type(fbb *b, const arrow_column *c, unsigned char *type) {
+    size_t tz;
+
+    switch (c->type) {
+    case ARROW_TIMESTAMP_NS:
+        *type = ARROW_TYPE_TIMESTAMP;
+        tz = fb_string(b, "UTC");
+        fb_start(b);
+        fb_i16(b, 0, ARROW_UNIT_NANOSECOND);
+        fb_ref(b, 1, tz);
+        return fb_end(b);
+    case ARROW_FLOAT32:
+        *type = ARROW_TYPE_FLOAT;
+        fb_start(b);
+        fb_i16(b, 0, ARROW_PRECISION_SINGLE);
+        return fb_end(b);
+    case ARROW_BOOL:
+        *type = ARROW_TYPE_BOOL;
+        return fb_empty_table(b);
+    case ARROW_DICT_UTF8:
+    default:
+        *type = ARROW_TYPE_UTF8;
+        return fb_empty_table(b);
+    }
+}
+
+static size_t fb_field(fbb *b, const char *name, unsigned char type_type, size_t type,
+                       size_t dictionary, size_t children) {
+    size_t n = fb_string(b, name);
+
+    fb_start(b);
+    fb_ref(b, 0, n);
+    fb_u8(b, 1, 0);
+    fb_u8(b, 2, type_type);
+    fb_ref(b, 3, type);
+    if (dictionary) fb_ref(b, 4, dictionary);
+    fb_ref(b, 5, children);
+    return fb_end(b);
+}
+
+static size_t fb_column(fbb *b, const arrow_column *c, int dict_id) {
+    size_t type, children, dictionary = 0, item, index;
+    unsigned char type_type;
+
+    type = fb_value_type(b, c, &type_type);
+    children = fb_vec_offsets(b, NULL, 0);
+    if (c->type == ARROW_DICT_UTF8) {
+        index = fb_int_type(b, 32, 1);
+        fb_start(b);
+        fb_i64(b, 0, dict_id);
+        fb_ref(b, 1, index);
+        dictionary = fb_end(b);
+    }
+    if (!c->list_size) return fb_field(b, c->name, type_type, type, dictionary, children);
+
+    item = fb_field(b, "item", type_type, type, dictionary, children);
+    children = fb_vec_offsets(b, &item, 1);
+    fb_start(b);
+    fb_i32(b, 0, c->list_size);
+    type = fb_end(b);
+    return fb_field(b, c->name, ARROW_TYPE_FIXED_LIST, type, 0, children);
+}
+
+static size_t fb_schema(arrow_writer *w) {
+    fbb *b = &w->fb;
+    size_t *fields, vec;
+    int i, dict_id = 0;
+
+    fields = malloc(w->num_cols * sizeof(*fields));
+    if (!fields) {
+        b->error = 1;
+        return 0;
+    }
+    for (i = 0; i < w->num_cols; i++) {
+        fields[i] = fb_column(b, &w->cols[i], dict_id);
+        if (w->cols[i].type == ARROW_DICT_UTF8) dict_id++;
+    }
+    vec = fb_vec_offsets(b, fields, w->num_cols);
+    free(fields);
+
+    fb_start(b);
+    fb_i16(b, 0, 0);            //Little endian
+    fb_ref(b, 1, vec);
+    return fb_end(b);
+}
+
+static size_t fb_records(fbb *b, long long length, const arrow_node *nodes, int num_nodes,
+                         const arrow_buffer *buffers, int num_buffers) {
+    size_t n, bufs;
+
+    n = fb_vec_structs(b, nodes, sizeof(*nodes), num_nodes);
+    bufs = fb_vec_structs(b, buffers, sizeof(*buffers), num_buffers);
+    fb_start(b);
+    fb_i64(b, 0, length);
+    fb_ref(b, 1, n);
+    fb_ref(b, 2, bufs);
+    return fb_end(b);
+}
+
+static void fb_message(fbb *b, unsigned char header_type, size_t header, long long body_length) {
+    size_t msg;
+
+    fb_start(b);
+    fb_i16(b, 0, ARROW_METADATA_V5);
+    fb_u8(b, 1, header_type);
+    fb_ref(b, 2, header);
+    fb_i64(b, 3, body_length);
+    msg = fb_end(b);
+    fb_finish(b, msg);
+}
+
+static void file_write(arrow_writer *w, const void *p, size_t n) {
+    if (n && fwrite(p, 1, n, w->fd) != n) w->error = 1;
+    w->pos += n;
+}
+
+static void file_pad(arrow_writer *w) {
+    static const unsigned char zero[ARROW_ALIGN];
+
+    file_write(w, zero, (ARROW_ALIGN - (w->pos & (ARROW_ALIGN - 1))) & (ARROW_ALIGN - 1));
+}
+
+static size_t padded(size_t n) {
+    return (n + ARROW_ALIGN - 1) & ~(size_t)(ARROW_ALIGN - 1);
+}
+
+//Writes the finished message in w->fb; the caller appends the body
+static void message_write(arrow_writer *w, arrow_block *block, long long body_length) {
+    unsigned int prefix[2];
+    size_t len = fb_off(&w->fb);
+
+    if (w->fb.error) w->error = 1;
+    prefix[0] = ARROW_CONTINUATION;
+    prefix[1] = padded(len);
+    block->offset = w->pos;
+    block->meta_length = sizeof(prefix) + padded(len);
+    block->pad = 0;
+    block->body_length = body_length;
+
+    file_write(w, prefix, sizeof(prefix));
+    if (!w->fb.error) file_write(w, w->fb.buf + w->fb.head, len);
+    file_pad(w);
+}
+
+static void dictionary_write(arrow_writer *w, const arrow_column *c, int id) {
+    arrow_node node = {c->dict_size, 0};
+    arrow_buffer buffers[3];
+    int *offsets;
+    size_t data = 0, batch;
+    unsigned int i;
+
+    offsets = malloc((c->dict_size + 1) * sizeof(*offsets));
+    if (!offsets) {
+        w->error = 1;
+        return;
+    }
+    offsets[0] = 0;
+    for (i = 0; i < c->dict_size; i++) {
+        data += strlen(c->dict[i]);
+        offsets[i + 1] = data;
+    }
+
+    buffers[0].offset = 0;
+    buffers[0].length = 0;
+    buffers[1].offset = 0;
+    buffers[1].length = (c->dict_size + 1) * sizeof(*offsets);
+    buffers[2].offset = padded(buffers[1].length);
+    buffers[2].length = data;
+
+    fb_reset(&w->fb);
+    batch = fb_records(&w->fb, c->dict_size, &node, 1, buffers, 3);
+    fb_start(&w->fb);
+    fb_i64(&w->fb, 0, id);
+    fb_ref(&w->fb, 1, batch);
+    fb_message(&w->fb, ARROW_HEADER_DICTIONARY, fb_end(&w->fb),
+               buffers[2].offset + padded(data));
+    message_write(w, &w->dicts[w->num_dicts++], buffers[2].offset + padded(data));
+
+    file_write(w, offsets, buffers[1].length);
+    file_pad(w);
+    for (i = 0; i < c->dict_size; i++) file_write(w, c->dict[i], strlen(c->dict[i]));
+    file_pad(w);
+    free(offsets);
+}
+
+static size_t value_size(const arrow_column *c) {
+    switch (c->type) {
+    case ARROW_TIMESTAMP_NS: return 8;
+    case ARROW_BOOL: return 1;
+    default: return 4;
+    }
+}
+
+static size_t values(const arrow_column *c) {
+    return c->list_size ? c->list_size : 1;
+}
+
+//Bytes of the data buffer of column c holding rows rows
+static size_t data_length(const arrow_column *c, unsigned int rows) {
+    size_t n = (size_t)rows * values(c);
+
+    return c->type == ARROW_BOOL ? (n + 7) / 8 : n * value_size(c);
+}
+
+static void batch_write(arrow_writer *w) {
+    arrow_block *block;
+    size_t body = 0, len;
+    int i, nodes = 0, bufs = 0;
+
+    if (w->num_batches == w->cap_batches) {
+        size_t cap = w->cap_batches ? w->cap_batches * 2 : 64;
+
+        block = realloc(w->batches, cap * sizeof(*block));
+        if (!block) {
+            w->error = 1;
+            return;
+        }
+        w->batches = block;
+        w->cap_batches = cap;
+    }
+
+    //Nodes and buffers in depth first order of the fields, no validity
+    //bitmaps since nothing is null
+    for (i = 0; i < w->num_cols; i++) {
+        const arrow_column *c = &w->cols[i];
+
+        if (c->list_size) {
+            w->nodes[nodes++] = (arrow_node){w->rows, 0};
+            w->buffers[bufs++] = (arrow_buffer){body, 0};
+        }
+        w->nodes[nodes++] = (arrow_node){(long long)w->rows * values(c), 0};
+        w->buffers[bufs++] = (arrow_buffer){body, 0};
+        len = data_length(c, w->rows);
+        w->buffers[bufs++] = (arrow_buffer){body, len};
+        body += padded(len);
+    }
+
+    fb_reset(&w->fb);
+    fb_message(&w->fb, ARROW_HEADER_RECORDS,
+               fb_records(&w->fb, w->rows, w->nodes, nodes, w->buffers, bufs), body);
+    block = &w->batches[w->num_batches++];
+    message_write(w, block, body);
+
+    for (i = 0; i < w->num_cols; i++) {
+        const arrow_column *c = &w->cols[i];
+        const unsigned char *src = w->data[i];
+        size_t j, n = (size_t)w->rows * values(c);
+
+        if (c->type == ARROW_BOOL) {
+            memset(w->bits, 0, data_length(c, w->rows));
+            for (j = 0; j < n; j++)
+                if (src[j]) w->bits[j / 8] |= 1 << (j % 8);
+            src = w->bits;
+        }
+        file_write(w, src, data_length(c, w->rows));
+        file_pad(w);
+    }
+
+    w->total_rows += w->rows;
+    w->rows = 0;
+}
+
+static void writer_free(arrow_writer *w) {
+    int i;
+
+    if (w->data)
+        for (i = 0; i < w->num_cols; i++) free(w->data[i]);
+    free(w->data);
+    free(w->bits);
+    free(w->nodes);
+    free(w->buffers);
+    free(w->batches);
+    free(w->fb.buf);
+    free(w);
+}
+
+arrow_writer *arrow_open(const char *file, const arrow_column *cols, int num_cols,
+                         unsigned int batch_rows) {
+    static const unsigned char magic[ARROW_ALIGN] = ARROW_MAGIC;
+    arrow_writer *w;
+    size_t bits = 0;
+    int i, id = 0;
+
+    if (num_cols < 1 || !batch_rows) return NULL;
+    w = calloc(1, sizeof(*w));
+    if (!w) return NULL;
+    w->cols = cols;
+    w->num_cols = num_cols;
+    w->batch_rows = batch_rows;
+    w->data = calloc(num_cols, sizeof(*w->data));
+    w->nodes = calloc(2 * num_cols, sizeof(*w->nodes));
+    w->buffers = calloc(3 * num_cols, sizeof(*w->buffers));
+    if (!w->data || !w->nodes || !w->buffers) goto fail;
+
+    //All buffering happens here, the steady state does not allocate
+    for (i = 0; i < num_cols; i++) {
+        if (cols[i].type == ARROW_DICT_UTF8 &&
+            (cols[i].list_size || !cols[i].dict_size || id >= ARROW_MAX_DICTS))
+            goto fail;
+        if (cols[i].type == ARROW_DICT_UTF8) id++;
+        if (cols[i].type == ARROW_BOOL && data_length(&cols[i], batch_rows) > bits)
+            bits = data_length(&cols[i], batch_rows);
+        w->data[i] = malloc((size_t)batch_rows * values(&cols[i]) * value_size(&cols[i]));
+        if (!w->data[i]) goto fail;
+    }
+    if (bits && !(w->bits = malloc(bits))) goto fail;
+
+    w->fd = fopen(file, "wb");
+    if (!w->fd) goto fail;
+
+    file_write(w, magic, sizeof(magic));
+    fb_reset(&w->fb);
+    fb_message(&w->fb, ARROW_HEADER_SCHEMA, fb_schema(w), 0);
+    message_write(w, &(arrow_block){0}, 0);
+
+    for (i = 0, id = 0; i < num_cols; i++)
+        if (cols[i].type == ARROW_DICT_UTF8) dictionary_write(w, &cols[i], id++);
+
+    if (w->error) {
+        fclose(w->fd);
+        remove(file);
+        goto fail;
+    }
+    return w;
+
+fail:
+    writer_free(w);
+    return NULL;
+}
+
+void arrow_row(arrow_writer *w) {
+    if (w->rows == w->batch_rows) batch_write(w);
+    w->rows++;
+}
+
+static void *row_values(arrow_writer *w, int col) {
+    const arrow_column *c = &w->cols[col];
+
+    return w->data[col] + (size_t)(w->rows - 1) * values(c) * value_size(c);
+}
+
+long long *arrow_i64(arrow_writer *w, int col) {
+    return row_values(w, col);
+}
+
+int *arrow_i32(arrow_writer *w, int col) {
+    return row_values(w, col);
+}
+
+float *arrow_f32(arrow_writer *w, int col) {
+    return row_values(w, col);
+}
+
+unsigned char *arrow_u8(arrow_writer *w, int col) {
+    return row_values(w, col);
+}
+
+int arrow_close(arrow_writer *w, unsigned long long *rows, unsigned long long *bytes) {
+    static const unsigned int eos[2] = {ARROW_CONTINUATION, 0};
+    static const char magic[] = ARROW_MAGIC;
+    size_t dicts, batches, footer;
+    int len, ret;
+
+    if (w->rows) batch_write(w);
+    file_write(w, eos, sizeof(eos));
+
+    //The footer repeats the schema and indexes every message for random access
+    fb_reset(&w->fb);
+    dicts = fb_vec_structs(&w->fb, w->dicts, sizeof(arrow_block), w->num_dicts);
+    batches = fb_vec_structs(&w->fb, w->batches, sizeof(arrow_block), w->num_batches);
+    footer = fb_schema(w);
+    fb_start(&w->fb);
+    fb_i16(&w->fb, 0, ARROW_METADATA_V5);
+    fb_ref(&w->fb, 1, footer);
+    fb_ref(&w->fb, 2, dicts);
+    fb_ref(&w->fb, 3, batches);
+    fb_finish(&w->fb, fb_end(&w->fb));
+    if (w->fb.error) w->error = 1;
+
+    len = fb_off(&w->fb);
+    if (!w->error) file_write(w, w->fb.buf + w->fb.head, len);
+    file_write(w, &len, sizeof(len));
+    file_write(w, magic, strlen(magic));
+
+    if (rows) *rows = w->total_rows;
+    if (bytes) *bytes = w->pos;
+    ret = fclose(w->fd) || w->error ? -1 : 0;
+    writer_free(w);
+    return ret;
+}
@@ -0,0 +1,65 @@
+/**
+ * Ryzen SMU Userspace Sensor Monitor
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef arrow_ipc_h
+#define arrow_ipc_h
+
+#include <stdio.h>
+
+//Minimal writer for the Arrow IPC file format (Feather v2), without
+//dependencies. Rows are buffered column by column and written as one record
+//batch every batch_rows rows, so memory stays bounded however long the
+//input is. No column has nulls; absent values are NAN.
+//
+//Dictionary columns hold int32 indices into a fixed list of strings that is
+//written once, before the first batch.
+
+typedef enum {
+    ARROW_TIMESTAMP_NS,         //int64 nanoseconds since the epoch, UTC
+    ARROW_FLOAT32,
+    ARROW_BOOL,                 //One byte per value while buffered
+    ARROW_DICT_UTF8,            //int32 index into the column's dictionary
+} arrow_type;
+
+typedef struct {
+    const char *name;
+    arrow_type type;
+    unsigned int list_size;     //0: one value per row, else a FixedSizeList
+    const char *const *dict;    //ARROW_DICT_UTF8 only
+    unsigned int dict_size;
+} arrow_column;
+
+typedef struct arrow_writer arrow_writer;
+
+//Creates the file and writes schema and dictionaries. cols must stay valid
+//until arrow_close(). Returns NULL on failure.
+arrow_writer *arrow_open(const char *file, const arrow_column *cols, int num_cols,
+                         unsigned int batch_rows);
+
+//Starts a row; the accessors below return the storage of column col in it,
+//list_size (at least 1) values large. Rows are complete once the next one
+//starts or the writer is closed, so every column must be written.
+void arrow_row(arrow_writer *w);
+long long *arrow_i64(arrow_writer *w, int col);
+int *arrow_i32(arrow_writer *w, int col);
+float *arrow_f32(arrow_writer *w, int col);
+unsigned char *arrow_u8(arrow_writer *w, int col);
+
+//Writes the pending rows and the footer. Returns 0 if everything was written.
+int arrow_close(arrow_writer *w, unsigned long long *rows, unsigned long long *bytes);
+
+#endif
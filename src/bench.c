@@ -0,0 +1,519 @@
+/**
+ * Ryzen SMU Userspace Sensor Monitor
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#define _GNU_SOURCE
+
+#include <math.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <libsmu.h>
+#include "pm_tables.h"
+#include "pm_layout.h"
+#include "draw.h"
+#include "screen.h"
+#include "ryzen_session.h"
+
+#define BENCH_MIN_RUN_NS    20000000ULL //Calibrate every run to take at least this long
+#define BENCH_RUNS          5           //Report the fastest of this many runs
+#define BENCH_MAX_RESULTS   128
+#define BENCH_TABLE_SIZE    10240
+#define BENCH_SAMPLER_MS    10          //Sampler interval while measuring read_latest
+
+//Every PM table version with a layout, see select_pm_table_version()
+static const unsigned int versions[] = {
+    0x380804, 0x380805, 0x380904, 0x380905, 0x400005, 0x240803, 0x240903,
+};
+
+typedef struct {
+    char name[32];
+    unsigned int version;
+    double ns;
+    double allocs;      //Heap allocations per call
+} bench_result;
+
+typedef struct {
+    unsigned int version;
+    unsigned char table[BENCH_TABLE_SIZE];
+    pm_table pmt;
+    pm_layout layout;
+    system_info sysinfo;
+    struct ryzen_session session;
+    struct ryzen_session generic; //Same, with the generic decoder
+    float values[2][PMT_METRIC_COUNT];
+    smu_obj_t *smu;
+    ryzen_session_t *live;     //Session on the driver, for the library paths
+    unsigned long long iter;
+} bench_ctx;
+
+static bench_result results[BENCH_MAX_RESULTS];
+static int num_results;
+static double last_allocs;
+
+//Counting allocator. Interposes glibc's allocator for the whole process,
+//stdio and the library included, so measure() can tell how many allocations
+//a sample costs once the benchmark is warmed up. The aligned entry points are
+//covered too, since sessions and sampler rings come from them. The sampler
+//thread allocates as well, hence the atomic counter.
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t n, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void *__libc_memalign(size_t alignment, size_t size);
+static _Atomic unsigned long long alloc_count;
+
+static void count_alloc(void) {
+    atomic_fetch_add_explicit(&alloc_count, 1, memory_order_relaxed);
+}
+
+void *malloc(size_t size) {
+    count_alloc();
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t n, size_t size) {
+    count_alloc();
+    return __libc_calloc(n, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+    count_alloc();
+    return __libc_realloc(ptr, size);
+}
+
+void *memalign(size_t alignment, size_t size) {
+    count_alloc();
+    return __libc_memalign(alignment, size);
+}
+
+void *aligned_alloc(size_t alignment, size_t size) {
+    count_alloc();
+    return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void **ptr, size_t alignment, size_t size) {
+    void *p;
+
+    if (!alignment || alignment % sizeof(void*) || (alignment & (alignment - 1)))
+        return EINVAL;
+    count_alloc();
+    p = __libc_memalign(alignment, size);
+    if (!p) return ENOMEM;
+    *ptr = p;
+    return 0;
+}
+
+static unsigned long long now_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+//Runs fn until a run of n calls takes BENCH_MIN_RUN_NS, then keeps the
+//fastest of BENCH_RUNS such runs. Returns ns per call; the allocations per
+//call of those runs are left in last_allocs.
+static double measure(void (*fn)(bench_ctx*), bench_ctx *ctx) {
+    unsigned long long n = 1, i, t, allocs;
+    double best = INFINITY;
+    int run;
+
+    for (;;) {
+        t = now_ns();
+        for (i = 0; i < n; i++) fn(ctx);
+        t = now_ns() - t;
+        if (t >= BENCH_MIN_RUN_NS) break;
+        n *= t ? (BENCH_MIN_RUN_NS / t) + 1 : 10;
+    }
+
+    allocs = atomic_load_explicit(&alloc_count, memory_order_relaxed);
+    for (run = 0; run < BENCH_RUNS; run++) {
+        t = now_ns();
+        for (i = 0; i < n; i++) fn(ctx);
+        t = now_ns() - t;
+        if ((double)t / n < best) best = (double)t / n;
+    }
+    last_allocs = (double)(atomic_load_explicit(&alloc_count, memory_order_relaxed) - allocs) / (n * BENCH_RUNS);
+
+    return best;
+}
+
+static void add_result(const char *name, unsigned int version, double ns) {
+    bench_result *r;
+
+    if (num_results >= BENCH_MAX_RESULTS) return;
+    r = &results[num_results++];
+    snprintf(r->name, sizeof(r->name), "%s", name);
+    r->version = version;
+    r->ns = ns;
+    r->allocs = last_allocs;
+}
+
+//Synthesizes a plausible sample: every field gets a distinct value, and the
+//fields the panels branch on get realistic ones, with half of the cores
+//sleeping so both core table paths are exercised.
+static int synthesize(bench_ctx *c) {
+    float *f = (float*)c->table;
+    int i;
+
+    memset(c->table, 0, sizeof(c->table));
+    if (!select_pm_table_version(c->version, &c->pmt, c->table)) return 0;
+    for (i = 0; i < (int)(c->pmt.min_size / sizeof(float)); i++)
+        f[i] = 1.f + (i % 61) * 0.25f;
+
+#define setf(elem, v) do { if (c->pmt.elem) *c->pmt.elem = (v); } while (0)
+    setf(PPT_LIMIT, 142.f);
+    setf(PPT_VALUE, 96.5f);
+    setf(TDC_LIMIT, 95.f);
+    setf(TDC_VALUE, 61.2f);
+    setf(EDC_LIMIT, 140.f);
+    setf(EDC_VALUE, 120.3f);
+    setf(THM_LIMIT, 90.f);
+    setf(THM_VALUE, 71.4f);
+    setf(FCLK_FREQ, 1800.f);
+    setf(UCLK_FREQ, 1800.f);
+    setf(MEMCLK_FREQ, 1800.f);
+    for (i = 0; i < c->pmt.max_cores; i++) {
+        setf(CORE_FREQEFF[i], 3600.f + 50.f * i);
+        setf(CORE_FREQ[i], 4000.f);
+        setf(CORE_C0[i], i & 1 ? 3.f : 85.f);
+        setf(CORE_CC6[i], i & 1 ? 90.f : 5.f);
+        setf(CORE_TEMP[i], 55.f + i);
+    }
+#undef setf
+
+    return 1;
+}
+
+//Reads a raw dump, as written by the driver's pm_table file
+static int load_dump(bench_ctx *c, const char *file) {
+    size_t n;
+    FILE *fd = fopen(file, "rb");
+
+    if (!fd) return 0;
+    memset(c->table, 0, sizeof(c->table));
+    n = fread(c->table, 1, sizeof(c->table), fd);
+    fclose(fd);
+
+    return select_pm_table_version(c->version, &c->pmt, c->table) && n >= c->pmt.min_size;
+}
+
+static void setup(bench_ctx *c) {
+    int i;
+
+    pm_layout_compile(&c->layout, &c->pmt, c->table);
+
+    memset(&c->sysinfo, 0, sizeof(c->sysinfo));
+    c->sysinfo.available = 1;
+    c->sysinfo.cpu_name = "Benchmark";
+    c->sysinfo.codename = "Fixture";
+    c->sysinfo.smu_fw_ver = "0.0.0";
+    c->sysinfo.cores = c->pmt.max_cores;
+    c->sysinfo.enabled_cores_count = c->pmt.max_cores;
+    c->sysinfo.ccds = c->pmt.max_cores > 8 ? 2 : 1;
+    c->sysinfo.ccxs = c->sysinfo.ccds;
+    c->sysinfo.cores_per_ccx = c->pmt.max_cores / c->sysinfo.ccxs;
+
+    //Enough of a session for ryzen_session_decode(), which only uses the
+    //layout and the topology
+    memset(&c->session, 0, sizeof(c->session));
+    c->session.pmt = c->pmt;
+    c->session.layout = c->layout;
+    c->session.sysinfo = c->sysinfo;
+    c->generic = c->session;
+    ryzen_session_select_decoder(&c->session, 1);
+    ryzen_session_select_decoder(&c->generic, 0);
+
+    //Two samples that differ in every core row, so each frame has changes
+    pm_values_reset(c->values[0]);
+    pm_layout_gather(&c->layout, c->table, c->values[0]);
+    memcpy(c->values[1], c->values[0], sizeof(c->values[1]));
+    for (i = 0; i < c->pmt.max_cores; i++) pmvi(c->values[1], CORE_TEMP, i) += 1.f;
+}
+
+static void bench_map(bench_ctx *c) {
+    pm_table pmt;
+    pm_layout layout;
+
+    select_pm_table_version(c->version, &pmt, c->table);
+    pm_layout_compile(&layout, &pmt, c->table);
+}
+
+static void bench_gather(bench_ctx *c) {
+    pm_layout_gather(&c->layout, c->table, c->values[0]);
+}
+
+static void bench_derive(bench_ctx *c) {
+    core_data_t cores[PMT_MAX_NUM_CORES];
+    constraints_data_t constraints;
+    memory_data_t memory;
+    power_data_t power;
+    graphics_data_t graphics;
+    calculated_stats_t stats;
+
+    ryzen_session_decode(&c->session, c->table, cores, PMT_MAX_NUM_CORES,
+                         &constraints, &memory, &power, &graphics, &stats);
+}
+
+//Same, with the decoder that gathers everything and reads the shape from
+//the mapping
+static void bench_derive_generic(bench_ctx *c) {
+    core_data_t cores[PMT_MAX_NUM_CORES];
+    constraints_data_t constraints;
+    memory_data_t memory;
+    power_data_t power;
+    graphics_data_t graphics;
+    calculated_stats_t stats;
+
+    ryzen_session_decode(&c->generic, c->table, cores, PMT_MAX_NUM_CORES,
+                         &constraints, &memory, &power, &graphics, &stats);
+}
+
+static void bench_render(bench_ctx *c) {
+    screen_begin();
+    draw_screen(&c->pmt, c->values[c->iter++ & 1], &c->sysinfo);
+    screen_present();
+}
+
+static void bench_render_full(bench_ctx *c) {
+    screen_invalidate();
+    bench_render(c);
+}
+
+static void bench_smu_read(bench_ctx *c) {
+    smu_read_pm_table(c->smu, c->table, c->smu->pm_table_size);
+}
+
+//Library paths of a daemon: a synchronous sample, and decoding the newest
+//sampler snapshot
+static void bench_session_sample(bench_ctx *c) {
+    core_data_t cores[PMT_MAX_NUM_CORES];
+    constraints_data_t constraints;
+    memory_data_t memory;
+    power_data_t power;
+    graphics_data_t graphics;
+    calculated_stats_t stats;
+
+    ryzen_session_sample(c->live, cores, PMT_MAX_NUM_CORES, &constraints, &memory, &power,
+                         &graphics, &stats);
+}
+
+static void bench_read_latest(bench_ctx *c) {
+    core_data_t cores[PMT_MAX_NUM_CORES];
+    constraints_data_t constraints;
+    memory_data_t memory;
+    power_data_t power;
+    graphics_data_t graphics;
+    calculated_stats_t stats;
+    ryzen_sample_info_t info;
+
+    ryzen_read_latest(c->live, cores, PMT_MAX_NUM_CORES, &constraints, &memory, &power,
+                      &graphics, &stats, &info);
+}
+
+static void run_fixture(bench_ctx *c) {
+    int out, devnull;
+
+    setup(c);
+    add_result("map", c->version, measure(bench_map, c));
+    add_result("gather", c->version, measure(bench_gather, c));
+    add_result("derive", c->version, measure(bench_derive, c));
+    add_result("derive_generic", c->version, measure(bench_derive_generic, c));
+
+    //Frames go to /dev/null instead of the terminal
+    fflush(stdout);
+    out = dup(STDOUT_FILENO);
+    devnull = open("/dev/null", O_WRONLY);
+    if (out < 0 || devnull < 0) {
+        fprintf(stderr, "Could not redirect the frames to /dev/null.\n");
+        exit(-1);
+    }
+    dup2(devnull, STDOUT_FILENO);
+    close(devnull);
+    add_result("render", c->version, measure(bench_render, c));
+    add_result("render_full", c->version, measure(bench_render_full, c));
+    dup2(out, STDOUT_FILENO);
+    close(out);
+}
+
+static void run_hardware(bench_ctx *c) {
+    static smu_obj_t obj;
+
+    if (smu_init(&obj) != SMU_Return_OK) {
+        fprintf(stderr, "No SMU driver available, skipping smu_read.\n");
+        return;
+    }
+    if (!smu_pm_tables_supported(&obj) || obj.pm_table_size > sizeof(c->table)) {
+        fprintf(stderr, "PM tables are not supported, skipping smu_read.\n");
+        smu_free(&obj);
+        return;
+    }
+
+    c->smu = &obj;
+    add_result("smu_read", obj.pm_table_version, measure(bench_smu_read, c));
+    smu_free(&obj);
+
+    c->live = ryzen_session_open();
+    if (!c->live) {
+        fprintf(stderr, "Could not open a session, skipping session_sample.\n");
+        return;
+    }
+    add_result("session_sample", c->live->smu->pm_table_version, measure(bench_session_sample, c));
+    if (ryzen_sampler_start(c->live, BENCH_SAMPLER_MS, 0) == 0) {
+        ryzen_sampler_wait(c->live, 0, 1000);
+        add_result("read_latest", c->live->smu->pm_table_version, measure(bench_read_latest, c));
+    }
+    ryzen_session_close(c->live);
+    c->live = NULL;
+}
+
+//Compares against a file written with -o. Returns the number of regressions.
+static int compare(const char *file, double tolerance) {
+    char name[32];
+    unsigned int version;
+    double ns, change;
+    int i, regressions = 0;
+    FILE *fd = fopen(file, "r");
+
+    if (!fd) {
+        fprintf(stderr, "Could not read the baseline (\"%s\").\n", file);
+        exit(-1);
+    }
+
+    fprintf(stdout, "\n%-12s %-8s %12s %12s %8s\n", "Benchmark", "Version", "Baseline", "Now", "Change");
+    while (fscanf(fd, "%31s %x %lf", name, &version, &ns) == 3) {
+        for (i = 0; i < num_results; i++)
+            if (results[i].version == version && !strcmp(results[i].name, name)) break;
+        if (i == num_results || ns <= 0) continue;
+
+        change = (results[i].ns - ns) / ns * 100;
+        fprintf(stdout, "%-12s 0x%06x %9.1f ns %9.1f ns %+7.1f%%%s\n", name, version, ns, results[i].ns, change,
+                change > tolerance ? "  REGRESSION" : "");
+        if (change > tolerance) regressions++;
+    }
+    fclose(fd);
+
+    return regressions;
+}
+
+static void show_help(char *program) {
+    fprintf(stdout,
+        "Ryzen Monitor Benchmark\n\n"
+
+        "Usage: %s <option(s)> [<dumpfile>:<version> ...]\n\n"
+
+        "Measures ns per sample for PM table mapping, derivation and rendering on a fixture\n"
+        "for every supported PM table version, and for reading the PM table when the driver\n"
+        "is loaded. Fixtures are synthesized unless a raw dump is given for a version.\n\n"
+
+        "Options:\n"
+            "\t-h            - Show this help screen.\n"
+            "\t-o<file>      - Write the results, to be used as a baseline later.\n"
+            "\t-b<file>      - Compare against a baseline and fail on regressions.\n"
+            "\t-t<percent>   - Slowdown that counts as a regression. Defaults to 10.\n"
+            "\t-x            - Skip reading the PM table from the driver.\n"
+            "\t-a            - Fail if any benchmark allocates memory once warmed up.\n",
+        program
+    );
+}
+
+int main(int argc, char **argv) {
+    static bench_ctx ctx;
+    const char *baseline = NULL, *output = NULL;
+    double tolerance = 10;
+    int c, i, j, hardware = 1, no_allocs = 0, allocating = 0;
+    FILE *fd;
+
+    while ((c = getopt(argc, argv, "o:b:t:xah")) != -1) {
+        switch (c) {
+            case 'o':
+                output = optarg;
+                break;
+            case 'b':
+                baseline = optarg;
+                break;
+            case 't':
+                tolerance = atof(optarg);
+                break;
+            case 'x':
+                hardware = 0;
+                break;
+            case 'a':
+                no_allocs = 1;
+                break;
+            case 'h':
+                show_help(argv[0]);
+                exit(0);
+            default:
+                exit(0);
+        }
+    }
+
+    for (i = 0; i < (int)(sizeof(versions) / sizeof(versions[0])); i++) {
+        const char *dump = NULL;
+
+        ctx.version = versions[i];
+        for (j = optind; j < argc; j++) {
+            char *sep = strrchr(argv[j], ':');
+            if (sep && strtoul(sep + 1, NULL, 16) == ctx.version) {
+                *sep = 0;
+                dump = argv[j];
+            }
+        }
+
+        if (dump ? !load_dump(&ctx, dump) : !synthesize(&ctx)) {
+            fprintf(stderr, "Could not set up the fixture for PM table version 0x%x.\n", ctx.version);
+            exit(-1);
+        }
+        run_fixture(&ctx);
+    }
+    if (hardware) run_hardware(&ctx);
+
+    fprintf(stdout, "%-14s %-8s %12s %12s\n", "Benchmark", "Version", "ns/sample", "allocs/sample");
+    for (i = 0; i < num_results; i++) {
+        fprintf(stdout, "%-14s 0x%06x %12.1f %12.3g\n", results[i].name, results[i].version, results[i].ns,
+                results[i].allocs);
+        if (results[i].allocs > 0) allocating++;
+    }
+
+    if (output) {
+        fd = fopen(output, "w");
+        if (!fd) {
+            fprintf(stderr, "Could not write the results (\"%s\").\n", output);
+            exit(-1);
+        }
+        for (i = 0; i < num_results; i++)
+            fprintf(fd, "%s 0x%06x %.1f\n", results[i].name, results[i].version, results[i].ns);
+        fclose(fd);
+    }
+
+    if (baseline && compare(baseline, tolerance)) {
+        fprintf(stderr, "Performance regressed by more than %.f%%.\n", tolerance);
+        exit(1);
+    }
+    if (no_allocs && allocating) {
+        fprintf(stderr, "%d benchmarks allocate memory per sample.\n", allocating);
+        exit(1);
+    }
+
+    return 0;
+}
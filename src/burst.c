@@ -0,0 +1,163 @@
+/**
+ * Ryzen SMU Userspace Sensor Monitor
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#define _GNU_SOURCE
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "burst.h"
+#include "recorder.h"
+
+#define NSEC_PER_SEC 1000000000ULL
+
+static unsigned long long clock_ns(clockid_t clock) {
+    struct timespec ts;
+
+    clock_gettime(clock, &ts);
+    return (unsigned long long)ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+static void add_ns(struct timespec *ts, unsigned long long ns) {
+    ns += ts->tv_nsec;
+    ts->tv_sec += ns / NSEC_PER_SEC;
+    ts->tv_nsec = ns % NSEC_PER_SEC;
+}
+
+static int write_arena(smu_obj_t *obj, const burst_options *opt, const unsigned char *tables,
+                       const unsigned long long *ts, const unsigned char *ok, size_t table_size) {
+    rec_header hdr;
+    recorder rec;
+    unsigned int i;
+    int ret = 0;
+
+    rec_header_fill(&hdr, obj, opt->sysinfo);
+    if (recorder_open(&rec, opt->outfile, &hdr, opt->compress)) {
+        fprintf(stderr, "Could not open \"%s\" for writing.\n", opt->outfile);
+        return -1;
+    }
+
+    for (i = 0; i < opt->count && !ret; i++) {
+        if (ok[i])
+            ret = recorder_append(&rec, ts[i], tables + i * table_size);
+    }
+
+    if (recorder_close(&rec) || ret) {
+        fprintf(stderr, "Could not write to \"%s\".\n", opt->outfile);
+        return -1;
+    }
+
+    fprintf(stderr, "Wrote %llu frames, %llu bytes to \"%s\".\n", rec.frames, rec.bytes, opt->outfile);
+    return 0;
+}
+
+static void print_report(const unsigned char *tables, const unsigned long long *ts, const unsigned char *ok,
+                         unsigned int count, size_t table_size, unsigned int interval_us, unsigned int missed) {
+    unsigned int i, good = 0, failed = 0, duplicates = 0, intervals = 0, last = 0;
+    double mean = 0, m2 = 0, min_iv = INFINITY, max_iv = 0, span_s;
+
+    //Welford over the intervals between successful reads
+    for (i = 0; i < count; i++) {
+        if (!ok[i]) {
+            failed++;
+            continue;
+        }
+        if (good) {
+            double iv = (ts[i] - ts[last]) / 1000.0;
+            double delta = iv - mean;
+
+            intervals++;
+            mean += delta / intervals;
+            m2 += delta * (iv - mean);
+            if (iv < min_iv) min_iv = iv;
+            if (iv > max_iv) max_iv = iv;
+
+            if (!memcmp(tables + i * table_size, tables + last * table_size, table_size))
+                duplicates++;
+        }
+        last = i;
+        good++;
+    }
+
+    fprintf(stderr, "Burst: %u reads, %u failed, %u missed deadlines.\n", count, failed, missed);
+    if (intervals < 1) return;
+
+    for (i = 0; !ok[i]; i++);
+    span_s = (ts[last] - ts[i]) / 1e9;
+
+    fprintf(stderr, "Duration: %.6f s, achieved rate: %.1f reads/s", span_s, intervals / span_s);
+    if (interval_us) fprintf(stderr, " (requested %.1f)", 1e6 / interval_us);
+    fprintf(stderr, ".\n");
+    fprintf(stderr, "Interval: mean %.3f us, stddev %.3f us, min %.3f us, max %.3f us.\n",
+            mean, intervals > 1 ? sqrt(m2 / (intervals - 1)) : 0., min_iv, max_iv);
+    fprintf(stderr, "Duplicate tables: %u, unique tables: %u (%.1f/s).\n",
+            duplicates, good - duplicates, (good - duplicates - 1) / span_s);
+}
+
+int run_burst(smu_obj_t *obj, const burst_options *opt) {
+    size_t table_size = obj->pm_table_size;
+    unsigned long long *ts, interval_ns = (unsigned long long)opt->interval_us * 1000;
+    unsigned char *tables, *ok;
+    unsigned int i, missed = 0;
+    struct timespec deadline, now;
+    int ret = 0;
+
+    if (!opt->count) return 0;
+
+    tables = malloc(table_size * opt->count);
+    ts = calloc(opt->count, sizeof(*ts));
+    ok = calloc(opt->count, sizeof(*ok));
+    if (!tables || !ts || !ok) {
+        fprintf(stderr, "Could not allocate memory for %u PM Tables.\n", opt->count);
+        free(tables); free(ts); free(ok);
+        return -1;
+    }
+    //Fault the arena in now rather than during the burst
+    memset(tables, 0, table_size * opt->count);
+
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    for (i = 0; i < opt->count; i++) {
+        if (interval_ns) {
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL);
+            add_ns(&deadline, interval_ns);
+
+            //Running late: skip the ticks we can't make anymore
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            while (deadline.tv_sec < now.tv_sec ||
+                   (deadline.tv_sec == now.tv_sec && deadline.tv_nsec < now.tv_nsec)) {
+                add_ns(&deadline, interval_ns);
+                missed++;
+            }
+        }
+
+        ok[i] = smu_read_pm_table(obj, tables + i * table_size, table_size) == SMU_Return_OK;
+        ts[i] = clock_ns(CLOCK_MONOTONIC_RAW);
+    }
+
+    print_report(tables, ts, ok, opt->count, table_size, opt->interval_us, missed);
+
+    if (opt->outfile)
+        ret = write_arena(obj, opt, tables, ts, ok, table_size);
+
+    free(tables);
+    free(ts);
+    free(ok);
+    return ret;
+}
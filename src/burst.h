@@ -0,0 +1,40 @@
+/**
+ * Ryzen SMU Userspace Sensor Monitor
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef burst_h
+#define burst_h
+
+#include <libsmu.h>
+#include "readinfo.h"
+
+typedef struct {
+    unsigned int count;         //Number of PM Table reads
+    unsigned int interval_us;   //Period between reads, 0 reads back to back
+    const char *outfile;        //Optional, written once the burst is over
+    int compress;               //XOR-compress the frames of outfile
+    const system_info *sysinfo; //Topology recorded in the header of outfile
+} burst_options;
+
+//Reads the PM Table count times into a preallocated arena at absolute
+//CLOCK_MONOTONIC deadlines, tagging every read with CLOCK_MONOTONIC_RAW.
+//Prints achieved rate, interval jitter, missed deadlines, failed reads and
+//duplicate tables (the SMU had not refreshed yet) to stderr afterwards.
+//The output file is a recording (see recorder.h) of the successful reads.
+//Returns 0 on success.
+int run_burst(smu_obj_t *obj, const burst_options *opt);
+
+#endif
@@ -0,0 +1,346 @@
+/**
+ * Ryzen SMU Userspace Sensor Monitor
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <math.h>
+#include <pthread.h>
+#include <string.h>
+#include "pm_layout.h"
+#include "core_calc.h"
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#define CORE_CALC_SSE2
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CORE_CALC_AVX2
+#endif
+#endif
+
+#define N PMT_MAX_NUM_CORES
+
+typedef void (*core_calc_fn)(const float *values, unsigned int enabled, float average_voltage,
+                             core_calc_result *res);
+
+//Bit i set = core i contributes to peaks and totals
+static unsigned int enabled_mask(int num_cores, unsigned int disable_map) {
+    unsigned int all = num_cores >= N ? (1u << N) - 1 : (1u << num_cores) - 1;
+    return all & ~disable_map;
+}
+
+//Reduction of one lane into the totals. Also used to fold the SIMD lanes, so
+//all implementations share the "peak < value" semantics, which skips NANs.
+static inline void fold_peak(float *peak, float value) {
+    if (*peak < value) *peak = value;
+}
+
+static void core_calc_scalar(const float *values, unsigned int enabled, float average_voltage,
+                             core_calc_result *res) {
+    core_calc_quad *q;
+    float freq, sleep;
+    int i;
+
+    for (i = 0; i < N; i++) {
+        freq = pmvi(values, CORE_FREQEFF, i) * 1000.f;
+        sleep = pmvi(values, CORE_CC6, i) / 100.f;
+        res->frequency[i] = freq;
+        res->voltage[i] = ((1.0 - sleep) * average_voltage) + (0.2 * sleep);
+
+        if (!((enabled >> i) & 1)) continue;
+        q = &res->quad[i / CORE_CALC_QUAD];
+        q->cores++;
+        fold_peak(&q->peak_frequency, freq);
+        fold_peak(&q->peak_temp, pmvi(values, CORE_TEMP, i));
+        q->total_frequency += freq;
+        q->total_temp += pmvi(values, CORE_TEMP, i);
+        q->total_power += pmvi(values, CORE_POWER, i);
+        q->total_c0 += pmvi(values, CORE_C0, i);
+        q->total_cc1 += pmvi(values, CORE_CC1, i);
+        q->total_cc6 += pmvi(values, CORE_CC6, i);
+
+        fold_peak(&res->peak_frequency, freq);
+        fold_peak(&res->peak_temp, pmvi(values, CORE_TEMP, i));
+        fold_peak(&res->peak_voltage, res->voltage[i]);
+        res->total_voltage += res->voltage[i];
+        res->total_power += pmvi(values, CORE_POWER, i);
+        res->total_c0 += pmvi(values, CORE_C0, i);
+        res->total_cc6 += pmvi(values, CORE_CC6, i);
+    }
+}
+
+#ifdef CORE_CALC_SSE2
+//Lane masks for 4 consecutive cores starting at core i
+static inline __m128 sse_lane_mask(unsigned int enabled, int i) {
+    return _mm_castsi128_ps(_mm_set_epi32(
+        -((enabled >> (i+3)) & 1), -((enabled >> (i+2)) & 1),
+        -((enabled >> (i+1)) & 1), -((enabled >> i) & 1)));
+}
+
+//peak = (peak < value) ? value : peak, for enabled lanes only
+static inline __m128 sse_peak(__m128 peak, __m128 value, __m128 mask) {
+    __m128 m = _mm_and_ps(_mm_cmplt_ps(peak, value), mask);
+    return _mm_or_ps(_mm_and_ps(m, value), _mm_andnot_ps(m, peak));
+}
+
+static inline float sse_sum(__m128 v) {
+    v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+    return _mm_cvtss_f32(_mm_add_ss(v, _mm_shuffle_ps(v, v, 1)));
+}
+
+//Peak of the enabled lanes, with the semantics of fold_peak() from 0
+static inline float sse_fold_peak(__m128 value, __m128 mask) {
+    const __m128 all = _mm_castsi128_ps(_mm_set1_epi32(-1));
+    __m128 p = sse_peak(_mm_setzero_ps(), value, mask);
+
+    p = sse_peak(p, _mm_movehl_ps(p, p), all);
+    return _mm_cvtss_f32(sse_peak(p, _mm_shuffle_ps(p, p, 1), all));
+}
+
+//Reduces the 4 lanes of the quad starting at core i. Also used by AVX2 on
+//each half of its vectors.
+static inline void sse_fold_quad(core_calc_result *res, unsigned int enabled, int i, __m128 mask,
+                                 __m128 freq, __m128 temp, __m128 power, __m128 c0,
+                                 __m128 cc1, __m128 cc6) {
+    core_calc_quad *q = &res->quad[i / CORE_CALC_QUAD];
+
+    q->cores = __builtin_popcount((enabled >> i) & 0xf);
+    q->peak_frequency = sse_fold_peak(freq, mask);
+    q->peak_temp = sse_fold_peak(temp, mask);
+    q->total_frequency = sse_sum(_mm_and_ps(freq, mask));
+    q->total_temp = sse_sum(_mm_and_ps(temp, mask));
+    q->total_power = sse_sum(_mm_and_ps(power, mask));
+    q->total_c0 = sse_sum(_mm_and_ps(c0, mask));
+    q->total_cc1 = sse_sum(_mm_and_ps(cc1, mask));
+    q->total_cc6 = sse_sum(_mm_and_ps(cc6, mask));
+}
+
+static void core_calc_sse2(const float *values, unsigned int enabled, float average_voltage,
+                           core_calc_result *res) {
+    const __m128 k1000 = _mm_set1_ps(1000.f), k100 = _mm_set1_ps(100.f);
+    const __m128d one = _mm_set1_pd(1.0), k02 = _mm_set1_pd(0.2), avg = _mm_set1_pd(average_voltage);
+    __m128 peak_freq = _mm_setzero_ps(), peak_temp = _mm_setzero_ps(), peak_volt = _mm_setzero_ps();
+    __m128 sum_volt = _mm_setzero_ps(), sum_power = _mm_setzero_ps(), sum_c0 = _mm_setzero_ps(),
+           sum_cc6 = _mm_setzero_ps();
+    __m128 mask, freq, cc6, sleep, volt, temp, power, c0;
+    __m128d lo, hi;
+    float lanes[7][4];
+    int i, j;
+
+    for (i = 0; i < N; i += 4) {
+        mask  = sse_lane_mask(enabled, i);
+        freq  = _mm_mul_ps(_mm_loadu_ps(&pmvi(values, CORE_FREQEFF, i)), k1000);
+        cc6   = _mm_loadu_ps(&pmvi(values, CORE_CC6, i));
+        temp  = _mm_loadu_ps(&pmvi(values, CORE_TEMP, i));
+        sleep = _mm_div_ps(cc6, k100);
+
+        //The voltage is computed in double precision, like the scalar code
+        lo = _mm_cvtps_pd(sleep);
+        hi = _mm_cvtps_pd(_mm_movehl_ps(sleep, sleep));
+        lo = _mm_add_pd(_mm_mul_pd(_mm_sub_pd(one, lo), avg), _mm_mul_pd(k02, lo));
+        hi = _mm_add_pd(_mm_mul_pd(_mm_sub_pd(one, hi), avg), _mm_mul_pd(k02, hi));
+        volt = _mm_movelh_ps(_mm_cvtpd_ps(lo), _mm_cvtpd_ps(hi));
+
+        _mm_storeu_ps(&res->frequency[i], freq);
+        _mm_storeu_ps(&res->voltage[i], volt);
+
+        peak_freq = sse_peak(peak_freq, freq, mask);
+        peak_temp = sse_peak(peak_temp, temp, mask);
+        peak_volt = sse_peak(peak_volt, volt, mask);
+        sum_volt  = _mm_add_ps(sum_volt, _mm_and_ps(volt, mask));
+        power     = _mm_loadu_ps(&pmvi(values, CORE_POWER, i));
+        c0        = _mm_loadu_ps(&pmvi(values, CORE_C0, i));
+        sum_power = _mm_add_ps(sum_power, _mm_and_ps(power, mask));
+        sum_c0    = _mm_add_ps(sum_c0, _mm_and_ps(c0, mask));
+        sum_cc6   = _mm_add_ps(sum_cc6, _mm_and_ps(cc6, mask));
+
+        sse_fold_quad(res, enabled, i, mask, freq, temp, power, c0,
+                      _mm_loadu_ps(&pmvi(values, CORE_CC1, i)), cc6);
+    }
+
+    _mm_storeu_ps(lanes[0], peak_freq);
+    _mm_storeu_ps(lanes[1], peak_temp);
+    _mm_storeu_ps(lanes[2], peak_volt);
+    _mm_storeu_ps(lanes[3], sum_volt);
+    _mm_storeu_ps(lanes[4], sum_power);
+    _mm_storeu_ps(lanes[5], sum_c0);
+    _mm_storeu_ps(lanes[6], sum_cc6);
+    for (j = 0; j < 4; j++) {
+        fold_peak(&res->peak_frequency, lanes[0][j]);
+        fold_peak(&res->peak_temp, lanes[1][j]);
+        fold_peak(&res->peak_voltage, lanes[2][j]);
+        res->total_voltage += lanes[3][j];
+        res->total_power += lanes[4][j];
+        res->total_c0 += lanes[5][j];
+        res->total_cc6 += lanes[6][j];
+    }
+}
+#endif
+
+#ifdef CORE_CALC_AVX2
+__attribute__((target("avx2")))
+static inline __m256 avx2_lane_mask(unsigned int enabled, int i) {
+    const __m256i bits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+    __m256i m = _mm256_and_si256(_mm256_set1_epi32(enabled >> i), bits);
+    return _mm256_castsi256_ps(_mm256_cmpeq_epi32(m, bits));
+}
+
+__attribute__((target("avx2")))
+static inline __m256 avx2_peak(__m256 peak, __m256 value, __m256 mask) {
+    __m256 m = _mm256_and_ps(_mm256_cmp_ps(peak, value, _CMP_LT_OQ), mask);
+    return _mm256_blendv_ps(peak, value, m);
+}
+
+__attribute__((target("avx2")))
+static void core_calc_avx2(const float *values, unsigned int enabled, float average_voltage,
+                           core_calc_result *res) {
+    const __m256 k1000 = _mm256_set1_ps(1000.f), k100 = _mm256_set1_ps(100.f);
+    const __m256d one = _mm256_set1_pd(1.0), k02 = _mm256_set1_pd(0.2), avg = _mm256_set1_pd(average_voltage);
+    __m256 peak_freq = _mm256_setzero_ps(), peak_temp = _mm256_setzero_ps(), peak_volt = _mm256_setzero_ps();
+    __m256 sum_volt = _mm256_setzero_ps(), sum_power = _mm256_setzero_ps(), sum_c0 = _mm256_setzero_ps(),
+           sum_cc6 = _mm256_setzero_ps();
+    __m256 mask, freq, cc6, sleep, volt, temp, power, c0, cc1;
+    __m256d lo, hi;
+    float lanes[7][8];
+    int i, j;
+
+    for (i = 0; i < N; i += 8) {
+        mask  = avx2_lane_mask(enabled, i);
+        freq  = _mm256_mul_ps(_mm256_loadu_ps(&pmvi(values, CORE_FREQEFF, i)), k1000);
+        cc6   = _mm256_loadu_ps(&pmvi(values, CORE_CC6, i));
+        temp  = _mm256_loadu_ps(&pmvi(values, CORE_TEMP, i));
+        sleep = _mm256_div_ps(cc6, k100);
+
+        //The voltage is computed in double precision, like the scalar code.
+        //Multiply and add are kept separate on purpose: no FMA contraction.
+        lo = _mm256_cvtps_pd(_mm256_castps256_ps128(sleep));
+        hi = _mm256_cvtps_pd(_mm256_extractf128_ps(sleep, 1));
+        lo = _mm256_add_pd(_mm256_mul_pd(_mm256_sub_pd(one, lo), avg), _mm256_mul_pd(k02, lo));
+        hi = _mm256_add_pd(_mm256_mul_pd(_mm256_sub_pd(one, hi), avg), _mm256_mul_pd(k02, hi));
+        volt = _mm256_set_m128(_mm256_cvtpd_ps(hi), _mm256_cvtpd_ps(lo));
+
+        _mm256_storeu_ps(&res->frequency[i], freq);
+        _mm256_storeu_ps(&res->voltage[i], volt);
+
+        peak_freq = avx2_peak(peak_freq, freq, mask);
+        peak_temp = avx2_peak(peak_temp, temp, mask);
+        peak_volt = avx2_peak(peak_volt, volt, mask);
+        sum_volt  = _mm256_add_ps(sum_volt, _mm256_and_ps(volt, mask));
+        power     = _mm256_loadu_ps(&pmvi(values, CORE_POWER, i));
+        c0        = _mm256_loadu_ps(&pmvi(values, CORE_C0, i));
+        cc1       = _mm256_loadu_ps(&pmvi(values, CORE_CC1, i));
+        sum_power = _mm256_add_ps(sum_power, _mm256_and_ps(power, mask));
+        sum_c0    = _mm256_add_ps(sum_c0, _mm256_and_ps(c0, mask));
+        sum_cc6   = _mm256_add_ps(sum_cc6, _mm256_and_ps(cc6, mask));
+
+        sse_fold_quad(res, enabled, i, _mm256_castps256_ps128(mask),
+                      _mm256_castps256_ps128(freq), _mm256_castps256_ps128(temp),
+                      _mm256_castps256_ps128(power), _mm256_castps256_ps128(c0),
+                      _mm256_castps256_ps128(cc1), _mm256_castps256_ps128(cc6));
+        sse_fold_quad(res, enabled, i + 4, _mm256_extractf128_ps(mask, 1),
+                      _mm256_extractf128_ps(freq, 1), _mm256_extractf128_ps(temp, 1),
+                      _mm256_extractf128_ps(power, 1), _mm256_extractf128_ps(c0, 1),
+                      _mm256_extractf128_ps(cc1, 1), _mm256_extractf128_ps(cc6, 1));
+    }
+
+    _mm256_storeu_ps(lanes[0], peak_freq);
+    _mm256_storeu_ps(lanes[1], peak_temp);
+    _mm256_storeu_ps(lanes[2], peak_volt);
+    _mm256_storeu_ps(lanes[3], sum_volt);
+    _mm256_storeu_ps(lanes[4], sum_power);
+    _mm256_storeu_ps(lanes[5], sum_c0);
+    _mm256_storeu_ps(lanes[6], sum_cc6);
+    for (j = 0; j < 8; j++) {
+        fold_peak(&res->peak_frequency, lanes[0][j]);
+        fold_peak(&res->peak_temp, lanes[1][j]);
+        fold_peak(&res->peak_voltage, lanes[2][j]);
+        res->total_voltage += lanes[3][j];
+        res->total_power += lanes[4][j];
+        res->total_c0 += lanes[5][j];
+        res->total_cc6 += lanes[6][j];
+    }
+}
+#endif
+
+static core_calc_fn impl_fn;
+static const char *impl_name;
+static pthread_once_t impl_once = PTHREAD_ONCE_INIT;
+
+static void select_impl(void) {
+#ifdef CORE_CALC_AVX2
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        impl_name = "avx2";
+        impl_fn = core_calc_avx2;
+        return;
+    }
+#endif
+#ifdef CORE_CALC_SSE2
+    impl_name = "sse2";
+    impl_fn = core_calc_sse2;
+#else
+    impl_name = "scalar";
+    impl_fn = core_calc_scalar;
+#endif
+}
+
+const char* core_calc_impl(void) {
+    pthread_once(&impl_once, select_impl);
+    return impl_name;
+}
+
+//Call before other threads use core_calc(), the switch is not synchronized
+int core_calc_force_impl(const char *name) {
+    pthread_once(&impl_once, select_impl);
+    if (!strcmp(name, "scalar")) {
+        impl_name = "scalar";
+        impl_fn = core_calc_scalar;
+        return 1;
+    }
+#ifdef CORE_CALC_SSE2
+    if (!strcmp(name, "sse2")) {
+        impl_name = "sse2";
+        impl_fn = core_calc_sse2;
+        return 1;
+    }
+#endif
+#ifdef CORE_CALC_AVX2
+    __builtin_cpu_init();
+    if (!strcmp(name, "avx2") && __builtin_cpu_supports("avx2")) {
+        impl_name = "avx2";
+        impl_fn = core_calc_avx2;
+        return 1;
+    }
+#endif
+    return 0;
+}
+
+void core_calc(const float *values, int num_cores, unsigned int disable_map,
+               int has_pc6, core_calc_result *res) {
+    float package_sleep_time;
+
+    //Safe to call from any number of threads
+    pthread_once(&impl_once, select_impl);
+
+    memset(res, 0, sizeof(core_calc_result));
+    if (has_pc6) {
+        package_sleep_time = pmv(values, PC6) / 100.f;
+        res->average_voltage = (pmv(values, CPU_TELEMETRY_VOLTAGE) - (0.2 * package_sleep_time)) / (1.0 - package_sleep_time);
+    }
+    else {
+        res->average_voltage = pmv(values, CPU_TELEMETRY_VOLTAGE);
+    }
+
+    impl_fn(values, enabled_mask(num_cores, disable_map), res->average_voltage, res);
+}
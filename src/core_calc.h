@@ -0,0 +1,72 @@
+/**
+ * Ryzen SMU Userspace Sensor Monitor
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef core_calc_h
+#define core_calc_h
+
+#include "pm_tables.h"
+
+//Core slots per quad. CCXs and CCDs span whole quads: 4 slots per Zen2 CCX,
+//8 per CCD and Zen3 CCX.
+#define CORE_CALC_QUAD      4
+#define CORE_CALC_QUADS     (PMT_MAX_NUM_CORES / CORE_CALC_QUAD)
+
+//Reductions over the enabled cores of one quad, for topology rollups.
+typedef struct {
+    int cores;                          //Enabled cores
+    float peak_frequency;
+    float peak_temp;
+    float total_frequency;
+    float total_temp;
+    float total_power;
+    float total_c0;
+    float total_cc1;
+    float total_cc6;
+} core_calc_quad;
+
+//Per-core values derived from the CORE_* fields of a dense metric array
+//(see pm_layout.h) plus the package wide and per quad reductions over
+//enabled cores.
+typedef struct {
+    float frequency[PMT_MAX_NUM_CORES]; //Effective frequency in MHz
+    float voltage[PMT_MAX_NUM_CORES];   //CC6 weighted core voltage
+    float average_voltage;              //Package voltage corrected for PC6
+    float peak_frequency;
+    float peak_temp;
+    float peak_voltage;
+    float total_voltage;
+    float total_power;
+    float total_c0;
+    float total_cc6;
+    core_calc_quad quad[CORE_CALC_QUADS];
+} core_calc_result;
+
+//Runs the per-core derivation over all PMT_MAX_NUM_CORES lanes at once.
+//Lanes at or above num_cores and lanes set in disable_map do not contribute
+//to the peaks and totals. has_pc6 selects whether the package voltage is
+//corrected for the time the package spent in PC6.
+//Uses AVX2 or SSE2 when available, plain C otherwise.
+void core_calc(const float *values, int num_cores, unsigned int disable_map,
+               int has_pc6, core_calc_result *res);
+
+//Name of the implementation core_calc() dispatches to.
+const char* core_calc_impl(void);
+
+//Forces "scalar", "sse2" or "avx2". Returns 0 if not available on this CPU.
+int core_calc_force_impl(const char *name);
+
+#endif
@@ -0,0 +1,352 @@
+/**
+ * Ryzen SMU Userspace Sensor Monitor
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdarg.h>
+
+#include "draw.h"
+#include "pm_layout.h"
+#include "core_calc.h"
+#include "screen.h"
+
+int show_disabled_cores = 0;
+
+void print_line(const char* label, const char* value_format, ...) {
+    char buffer[1024];
+    va_list list;
+
+    va_start(list, value_format);
+    vsnprintf(buffer, sizeof(buffer), value_format, list);
+    va_end(list);
+
+    screen_printf("│ %45s │ %46s │\n", label, buffer);
+}
+
+//Helper to access the PM Table elements. If an element doesn't exist in the
+//current PM Table version, it's pointer is set to 0. This helper returns
+//NAN for not available fields.
+#define pmta(elem) ((pmt->elem)?(*pmt->elem):NAN)
+//Same, but with 0 as return. For summations that should not fail if one value is not present.
+#define pmta0(elem) ((pmt->elem)?(*pmt->elem):0)
+
+void draw_screen(pm_table *pmt, const float *values, system_info *sysinfo) {
+    //general
+    int i, j;
+    //core block
+    float core_voltage, core_frequency, core_power, core_temp, core_c0, core_cc1, core_cc6;
+    core_calc_result cr;
+    int core_disabled, core_number;
+    //constraints block
+    float edc_value;
+    //power block
+    float l3_logic_power, l3_vddm_power;
+    char strbuf[100];
+
+    if (pmt->experimental) {
+        screen_printf("Warning: Support for this PM table version is expermiental. Can't trust anything.\n");
+    }
+
+    if (sysinfo->available) {
+        screen_printf("╭───────────────────────────────────────────────┬────────────────────────────────────────────────╮\n");
+        print_line("CPU Model", sysinfo->cpu_name);
+        print_line("Processor Code Name", sysinfo->codename);
+        print_line("Cores", "%d", sysinfo->cores);
+        print_line("Core CCDs", "%d", sysinfo->ccds);
+        if (pmt->zen_version!=3) {
+            print_line("Core CCXs", "%d", sysinfo->ccxs);
+            print_line("Cores Per CCX", "%d", sysinfo->cores_per_ccx);
+        }
+        else
+            print_line("Cores Per CCD", "%d", sysinfo->cores_per_ccx); //Zen3 does not have CCXs anymore
+        print_line("SMU FW Version", "v%s", sysinfo->smu_fw_ver);
+        print_line("MP1 IF Version", "v%d", sysinfo->if_ver);
+        screen_printf("╰───────────────────────────────────────────────┴────────────────────────────────────────────────╯\n");
+    }
+
+
+    core_number = 0;
+    core_calc(values, pmt->max_cores, sysinfo->core_disable_map, pmt->PC6 != NULL, &cr);
+
+    screen_printf("╭─────────┬────────────┬──────────┬─────────┬──────────┬─────────────┬─────────────┬─────────────╮\n");
+    for (i = 0; i < pmt->max_cores; i++) {
+        core_disabled = (sysinfo->core_disable_map >> i)&0x01;
+        core_frequency = cr.frequency[i];
+        // Rumours say this is how AMD calculates core voltage.
+        // The true core voltage would be CORE_VOLTAGE[i].
+        core_voltage = cr.voltage[i];
+        core_power = pmvi(values, CORE_POWER, i);
+        core_temp = pmvi(values, CORE_TEMP, i);
+        core_c0 = pmvi(values, CORE_C0, i);
+        core_cc1 = pmvi(values, CORE_CC1, i);
+        core_cc6 = pmvi(values, CORE_CC6, i);
+
+        if (core_disabled) {
+            if (show_disabled_cores)
+                    screen_printf(
+                        "│ %*s %d │   Disabled | %6.3f W | %5.3f V | %6.2f C | C0: %5.1f %% | C1: %5.1f %% | C6: %5.1f %% │\n",
+                    (core_number<10)+4, "Core", core_number, //Print "Core" and its number but right-justified
+                        core_power, core_voltage, core_temp, core_c0, core_cc1, core_cc6);
+        }
+        else if (core_c0 >= 6.f) {
+            // AMD denotes a sleeping core as having spent less than 6% of the time in C0.
+            // Source: Ryzen Master
+                screen_printf(
+                    "│ %*s %d │   %4.f MHz | %6.3f W | %5.3f V | %6.2f C | C0: %5.1f %% | C1: %5.1f %% | C6: %5.1f %% │\n",
+                (core_number<10)+4, "Core", core_number, //Print "Core" and its number but right-justified
+                core_frequency, core_power, core_voltage, core_temp, core_c0, core_cc1, core_cc6);
+            }
+            else {
+                screen_printf(
+                    "│ %*s %d │   Sleeping | %6.3f W | %5.3f V | %6.2f C | C0: %5.1f %% | C1: %5.1f %% | C6: %5.1f %% │\n",
+                (core_number<10)+4, "Core", core_number, //Print "Core" and its number but right-justified
+                    core_power, core_voltage, core_temp, core_c0, core_cc1, core_cc6);
+        }
+
+        //Don't confuse people by numbering cores that are disabled and hence not shown on 6 | 12 core CPUs
+        //(which actually have 8 | 16 cores)
+        if (show_disabled_cores || !core_disabled) core_number++;
+    }
+
+    screen_printf("╰─────────┴────────────┴──────────┴─────────┴──────────┴─────────────┴─────────────┴─────────────╯\n");
+
+    screen_printf("╭── Core Statistics (Calculated) ───────────────┬────────────────────────────────────────────────╮\n");
+    print_line("Highest Effective Core Frequency", "%8.0f MHz", cr.peak_frequency);
+    print_line("Highest Core Temperature", "%8.2f C", cr.peak_temp);
+    print_line("Highest Core Voltage", "%8.3f V", cr.peak_voltage);
+    print_line("Average Core Voltage", "%5.3f V", cr.total_voltage/sysinfo->enabled_cores_count);
+    print_line("Average Core CC6", "%6.2f %%", cr.total_cc6/sysinfo->enabled_cores_count);
+    print_line("Total Core Power Sum", "%7.3f W", cr.total_power);
+
+    screen_printf("├── Reported by SMU ────────────────────────────┼────────────────────────────────────────────────┤\n");
+    //print_line("Package Power", "%8.3f W", pmta(SOCKET_POWER)); //Is listed below in power section
+    print_line("Peak Core Voltage", "%5.3f V", pmta(CPU_TELEMETRY_VOLTAGE));
+    if(pmt->PC6) print_line("Package CC6", "%6.2f %%", pmta(PC6));
+    screen_printf("╰───────────────────────────────────────────────┴────────────────────────────────────────────────╯\n");
+
+    screen_printf("╭── Electrical & Thermal Constraints ───────────┬────────────────────────────────────────────────╮\n");
+    edc_value = pmta(EDC_VALUE) * (cr.total_c0 / sysinfo->cores / 100);
+    if (edc_value < pmta(TDC_VALUE)) edc_value = pmta(TDC_VALUE);
+
+    print_line("Peak Temperature", "%8.2f C", pmta(PEAK_TEMP));
+    if(pmt->SOC_TEMP) print_line("SoC Temperature", "%8.2f C", pmta(SOC_TEMP));
+    if(pmt->GFX_TEMP) print_line("GFX Temperature", "%8.2f C", pmta(GFX_TEMP));
+    //print_line("Core Power", "%8.4f W", pmta(VDDCR_CPU_POWER));
+
+    print_line("Voltage from Core VRM", "%7.3f V | %7.3f V | %8.2f %%", pmta(VID_VALUE), pmta(VID_LIMIT), (pmta(VID_VALUE) / pmta(VID_LIMIT) * 100));
+    //if(pmt->STAPM_VALUE) print_line("STAPM", "%7.3f   | %7.f   | %8.2f %%", pmta(STAPM_VALUE), pmta(STAPM_LIMIT), (pmta(STAPM_VALUE) / pmta(STAPM_LIMIT) * 100));
+    print_line("PPT", "%7.3f W | %7.f W | %8.2f %%", pmta(PPT_VALUE), pmta(PPT_LIMIT), (pmta(PPT_VALUE) / pmta(PPT_LIMIT) * 100));
+    if(pmt->PPT_VALUE_APU) print_line("PPT APU", "%7.3f W | %7.f W | %8.2f %%", pmta(PPT_VALUE_APU), pmta(PPT_LIMIT_APU), (pmta(PPT_VALUE_APU) / pmta(PPT_LIMIT_APU) * 100));
+    print_line("TDC Value", "%7.3f A | %7.f A | %8.2f %%", pmta(TDC_VALUE), pmta(TDC_LIMIT), (pmta(TDC_VALUE) / pmta(TDC_LIMIT) * 100));
+    if(pmt->TDC_ACTUAL) print_line("TDC Actual", "%7.3f A | %7.f A | %8.2f %%", pmta(TDC_ACTUAL), pmta(TDC_LIMIT), (pmta(TDC_ACTUAL) / pmta(TDC_LIMIT) * 100));
+    if(pmt->TDC_VALUE_SOC) print_line("TDC Value, SoC only", "%7.3f A | %7.f A | %8.2f %%", pmta(TDC_VALUE_SOC), pmta(TDC_LIMIT_SOC), (pmta(TDC_VALUE_SOC) / pmta(TDC_LIMIT_SOC) * 100));
+    print_line("EDC", "%7.3f A | %7.f A | %8.2f %%", edc_value, pmta(EDC_LIMIT), (edc_value / pmta(EDC_LIMIT) * 100));
+    if(pmt->EDC_VALUE_SOC) print_line("EDC, SoC only", "%7.3f A | %7.f A | %8.2f %%", pmta(EDC_VALUE_SOC), pmta(EDC_LIMIT_SOC), (pmta(EDC_VALUE_SOC) / pmta(EDC_LIMIT_SOC) * 100));
+    print_line("THM", "%7.2f C | %7.f C | %8.2f %%", pmta(THM_VALUE), pmta(THM_LIMIT), (pmta(THM_VALUE) / pmta(THM_LIMIT) * 100));
+    if(pmt->THM_VALUE_SOC) print_line("THM SoC", "%7.2f C | %7.f C | %8.2f %%", pmta(THM_VALUE_SOC), pmta(THM_LIMIT_SOC), (pmta(THM_VALUE_SOC) / pmta(THM_LIMIT_SOC) * 100));
+    if(pmt->THM_VALUE_GFX) print_line("THM GFX", "%7.2f C | %7.f C | %8.2f %%", pmta(THM_VALUE_GFX), pmta(THM_LIMIT_GFX), (pmta(THM_VALUE_GFX) / pmta(THM_LIMIT_GFX) * 100));
+    //if(pmt->STT_LIMIT_APU) print_line("STT APU", "%7.2f   | %7.f   | %8.2f %%", pmta(STT_VALUE_APU), pmta(STT_LIMIT_APU), (pmta(STT_VALUE_APU) / pmta(STT_LIMIT_APU) * 100)); //Always zero
+    //if(pmt->STT_LIMIT_DGPU) print_line("STT DGPU", "%7.2f   | %7.f   | %8.2f %%", pmta(STT_VALUE_DGPU), pmta(STT_LIMIT_DGPU), (pmta(STT_VALUE_DGPU) / pmta(STT_LIMIT_DGPU) * 100)); //Always zero
+    print_line("FIT", "%7.f   | %7.f   | %8.2f %%", pmta(FIT_VALUE), pmta(FIT_LIMIT), (pmta(FIT_VALUE) / pmta(FIT_LIMIT)) * 100.f);
+    screen_printf("╰───────────────────────────────────────────────┴────────────────────────────────────────────────╯\n");
+
+    screen_printf("╭── Memory Interface ───────────────────────────┬────────────────────────────────────────────────╮\n");
+    print_line("Coupled Mode", "%8s", pmta(UCLK_FREQ) == pmta(MEMCLK_FREQ) ? "ON" : "OFF");
+    print_line("Fabric Clock (Average)", "%5.f MHz", pmta(FCLK_FREQ_EFF));
+    print_line("Fabric Clock", "%5.f MHz", pmta(FCLK_FREQ));
+    print_line("Uncore Clock", "%5.f MHz", pmta(UCLK_FREQ));
+    print_line("Memory Clock", "%5.f MHz", pmta(MEMCLK_FREQ));
+    //print_line("VDDCR_Mem", "%7.3f W", pmta(VDDIO_MEM_POWER)); //Is listed below in power section
+    //print_line("VDDCR_SoC", "%7.3f V", pmta(SOC_SET_VOLTAGE)); //Might be the default voltage, not the actually set one
+    print_line("cLDO_VDDM", "%7.4f V", pmta(V_VDDM));
+    print_line("cLDO_VDDP", "%7.4f V", pmta(V_VDDP));
+    if(pmt->V_VDDG)     print_line("cLDO_VDDG", "%7.4f V", pmta(V_VDDG));
+    if(pmt->V_VDDG_IOD) print_line("cLDO_VDDG_IOD", "%7.4f V", pmta(V_VDDG_IOD));
+    if(pmt->V_VDDG_CCD) print_line("cLDO_VDDG_CCD", "%7.4f V", pmta(V_VDDG_CCD));
+    screen_printf("╰───────────────────────────────────────────────┴────────────────────────────────────────────────╯\n");
+
+    if(pmt->has_graphics){
+    screen_printf("╭── Graphics Subsystem──────────────────────────┬────────────────────────────────────────────────╮\n");
+    print_line("GFX Voltage | ROC Power", "%7.4f V | %8.3f W", pmta(GFX_VOLTAGE), pmta(ROC_POWER));
+    print_line("GFX Temperature", "%8.2f C", pmta(GFX_TEMP));
+    print_line("GFX Clock Real | Effective", "%5.f MHz | %6.f MHz", pmta(GFX_FREQ), pmta(GFX_FREQEFF));
+    print_line("GFX Busy", "%8.2f %%", pmta(GFX_BUSY) * 100.f);
+    print_line("GFX EDC Limit | Residency", "%7.3f A | %8.2f %%", pmta(GFX_EDC_LIM), pmta(GFX_EDC_RESIDENCY) * 100.f);
+    print_line("Display Count | FPS", "%2.f | %8.2f  ", pmta(DISPLAY_COUNT), pmta(FPS));
+    print_line("DGPU Power | Freq Target | Busy", "%7.3f W | %5.f MHz | %8.2f %%", pmta(DGPU_POWER), pmta(DGPU_FREQ_TARGET), pmta(DGPU_GFX_BUSY) * 100.f);
+    screen_printf("╰───────────────────────────────────────────────┴────────────────────────────────────────────────╯\n");
+    }
+
+    screen_printf("╭── Power Consumption ──────────────────────────┬────────────────────────────────────────────────╮\n");
+    //These powers are drawn via VDDCR_SOC and VDDCR_CPU and thus are pulled from the CPU power connector of the mainboard
+    print_line("Total Core Power Sum", "%7.3f W", cr.total_power);
+    //print_line("VDDCR_CPU Power", "%7.3f W", pmta(VDDCR_CPU_POWER)); //This value doesn't correlate with what the cores
+                                                                        //report, nor with what is actually consumed. but is
+                                                                        //the value HWiNFO shows.
+    print_line("VDDCR_SOC Power", "%7.3f W", pmta(VDDCR_SOC_POWER));
+    if(pmt->IO_VDDCR_SOC_POWER) print_line("IO VDDCR_SOC Power", "%7.3f W", pmta(IO_VDDCR_SOC_POWER));
+    if(pmt->GMI2_VDDG_POWER) print_line("GMI2_VDDG Power", "%7.3f W", pmta(GMI2_VDDG_POWER));
+    if(pmt->ROC_POWER) print_line("ROC Power", "%7.3f W", pmta(ROC_POWER));
+
+    //L3 caches (2 per CCD on Zen2, 1 per CCD on Zen3)
+    l3_logic_power=0;
+    l3_vddm_power=0;
+    for (i=0; i<pmt->max_l3; i++) {
+        l3_logic_power += pmta0(L3_LOGIC_POWER[i]);
+        l3_vddm_power += pmta0(L3_VDDM_POWER[i]);
+    }
+    if (pmt->max_l3 == 1) {
+        print_line("L3 Logic Power", "%7.3f W", pmta(L3_LOGIC_POWER[0]));
+        print_line("L3 VDDM Power", "%7.3f W", pmta(L3_VDDM_POWER[0]));
+    } else {
+        for (i=0; i<pmt->max_l3; i+=2) {
+            // + sign if needed and first value
+            j = snprintf(strbuf, sizeof(strbuf), "%s%7.3f W", (i?"+ ":""), pmta(L3_LOGIC_POWER[i]));
+            // second value if it exists
+            if (pmt->max_l3-i > 1) j += snprintf(strbuf+j, sizeof(strbuf)-j, " + %7.3f W", pmta(L3_LOGIC_POWER[i+1]));
+            // end of string (sum or nothing)
+            if (pmt->max_l3-i > 2) j += snprintf(strbuf+j, sizeof(strbuf)-j, "            ");
+            else j += snprintf(strbuf+j, sizeof(strbuf)-j, " = %7.3f W", l3_logic_power);
+            // print
+            print_line((i?"":"L3 Logic Power"), "%s", strbuf);
+        }
+        for (i=0; i<pmt->max_l3; i+=2) {
+            // + sign if needed and first value
+            j = snprintf(strbuf, sizeof(strbuf), "%s%7.3f W", (i?"+ ":""), pmta(L3_VDDM_POWER[i]));
+            // second value if it exists
+            if (pmt->max_l3-i > 1) j += snprintf(strbuf+j, sizeof(strbuf)-j, " + %7.3f W", pmta(L3_VDDM_POWER[i+1]));
+            // end of string (sum or nothing)
+            if (pmt->max_l3-i > 2) j += snprintf(strbuf+j, sizeof(strbuf)-j, "            ");
+            else j += snprintf(strbuf+j, sizeof(strbuf)-j, " = %7.3f W", l3_vddm_power);
+            // print
+            print_line((i?"":"L3 VDDM Power"), "%s", strbuf);
+        }
+    }
+
+    //These powers are supplied by other power lines to the CPU and are drawn from the 24 pin ATX connector on most boards
+    print_line("","");
+    print_line("VDDIO_MEM Power", "%7.3f W", pmta(VDDIO_MEM_POWER));
+    print_line("IOD_VDDIO_MEM Power", "%7.3f W", pmta(IOD_VDDIO_MEM_POWER));
+    if(pmt->DDR_VDDP_POWER) print_line("DDR_VDDP Power", "%7.3f W", pmta(DDR_VDDP_POWER));
+    if(pmt->DDR_PHY_POWER) print_line("DDR Phy Power", "%7.3f W", pmta(DDR_PHY_POWER));
+    print_line("VDD18 Power", "%7.3f W", pmta(VDD18_POWER)); //Same as pmta(IO_VDD18_POWER)
+    if(pmt->IO_DISPLAY_POWER) print_line("CPU Display IO Power", "%7.3f W", pmta(IO_DISPLAY_POWER));
+    if(pmt->IO_USB_POWER) print_line("CPU USB IO Power", "%7.3f W", pmta(IO_USB_POWER));
+
+    if(!pmt->powersum_unclear) {
+    //The sum is the thermal output of the whole package. Yes, this is higher than PPT and SOCKET_POWER.
+    //Confirmed by measuring the actual current draw on the mainboard.
+    print_line("","");
+    print_line("Calculated Thermal Output", "%7.3f W", cr.total_power + pmta0(VDDCR_SOC_POWER) + pmta0(GMI2_VDDG_POWER) 
+            + l3_logic_power + l3_vddm_power
+            + pmta0(VDDIO_MEM_POWER) + pmta0(IOD_VDDIO_MEM_POWER) + pmta0(DDR_VDDP_POWER) + pmta0(VDD18_POWER));
+    }
+
+    screen_printf("├── Additional Reports ─────────────────────────┼────────────────────────────────────────────────┤\n");
+    //print_line("ROC_POWER", "%7.4f",pmta(ROC_POWER));
+    print_line("SoC Power (SVI2)", "%8.3f V | %7.3f A | %8.3f W", pmta(SOC_TELEMETRY_VOLTAGE), pmta(SOC_TELEMETRY_CURRENT), pmta(SOC_TELEMETRY_POWER));
+    print_line("Core Power (SVI2)", "%8.3f V | %7.3f A | %8.3f W", pmta(CPU_TELEMETRY_VOLTAGE), pmta(CPU_TELEMETRY_CURRENT), pmta(CPU_TELEMETRY_POWER));
+    print_line("Core Power (SMU)", "%7.3f W", pmta(VDDCR_CPU_POWER));
+    print_line("Socket Power (SMU)", "%7.3f W", pmta(SOCKET_POWER));
+    if (pmt->PACKAGE_POWER) print_line("Package Power (SMU)", "%7.3f W", pmta(PACKAGE_POWER));
+    screen_printf("╰───────────────────────────────────────────────┴────────────────────────────────────────────────╯\n");
+}
+
+//Feeds one sample to the limiter engine and shows which limit holds the
+//clocks back, plus the share of the time every limit was binding or reached.
+void draw_limiters(throttle_state *limiters, pm_table *pmt, const float *values, system_info *sysinfo,
+                   unsigned long long timestamp_ns) {
+    const ryzen_throttle_stats_t *st = &limiters->stats;
+    core_calc_result cr;
+    double total, core_ns, mhz;
+    int i, b;
+
+    core_calc(values, pmt->max_cores, sysinfo->core_disable_map, pmt->PC6 != NULL, &cr);
+    throttle_update(limiters, values, &cr, pmt->max_cores, sysinfo->core_disable_map, sysinfo->cores, timestamp_ns);
+    total = st->total_ns ? st->total_ns : NAN;
+
+    screen_printf("╭── Limiters ───────────────────────────────────┬────────────────────────────────────────────────╮\n");
+    print_line("Binding Now", "%s", throttle_name(st->binding));
+    print_line("Limit", "%9s | %8s | %8s | %9s", "Now", "Binding", "Reached", "Avg Clock");
+    for (i = 0; i < RYZEN_LIMIT_COUNT; i++) {
+        if (i != RYZEN_LIMIT_NONE && isnan(st->utilization[i])) continue;
+
+        //Effective clock of the enabled cores while this limit was binding
+        core_ns = mhz = 0;
+        for (b = 0; b < RYZEN_FREQ_BINS; b++) {
+            core_ns += st->freq_ns[i][b];
+            mhz += st->freq_ns[i][b] * ((b + 0.5) * RYZEN_FREQ_BIN_MHZ);
+        }
+        mhz = core_ns ? mhz / core_ns : NAN;
+
+        if (i == RYZEN_LIMIT_NONE)
+            print_line("Unconstrained", "%9s | %6.2f %% | %8s | %5.f MHz", "", st->binding_ns[i] / total * 100, "", mhz);
+        else
+            print_line(throttle_name(i), "%7.2f %% | %6.2f %% | %6.2f %% | %5.f MHz", st->utilization[i] * 100,
+                st->binding_ns[i] / total * 100, st->active_ns[i] / total * 100, mhz);
+    }
+    screen_printf("╰───────────────────────────────────────────────┴────────────────────────────────────────────────╯\n");
+}
+
+//Upper end of the histogram bucket holding the q quantile, in us
+static double stat_quantile(const unsigned long long *hist, unsigned long long total, double q) {
+    unsigned long long sum = 0;
+    int i;
+
+    for (i = 0; i < SMU_STAT_BUCKETS - 1; i++) {
+        sum += hist[i];
+        if (sum >= q * total) break;
+    }
+
+    return (double)(1ULL << i);
+}
+
+void draw_smu_stats(smu_obj_t *obj, unsigned long long decode_ns) {
+    static const char *names[SMU_MUTEX_COUNT] = {
+        [SMU_MUTEX_SMN] = "SMN",
+        [SMU_MUTEX_CMD] = "Command",
+        [SMU_MUTEX_PM]  = "PM Table",
+    };
+    static const int order[SMU_MUTEX_COUNT] = { SMU_MUTEX_PM, SMU_MUTEX_SMN, SMU_MUTEX_CMD };
+    smu_stats_t st;
+    char strbuf[100];
+    int i, j, k;
+
+    screen_printf("╭── SMU Access ─────────────────────────────────┬────────────────────────────────────────────────╮\n");
+    print_line("Access", "%8s | %6s | %9s | %9s", "Calls", "Errors", "Avg Wait", "Avg I/O");
+    for (k = 0; k < SMU_MUTEX_COUNT; k++) {
+        i = order[k];
+        if (smu_get_stats(obj, i, &st, 0) != SMU_Return_OK || !st.calls) continue;
+
+        print_line(names[i], "%8llu | %6llu | %6.1f us | %6.1f us", st.calls, st.errors,
+            st.lock_wait_ns / 1e3 / st.calls, st.io_ns / 1e3 / st.calls);
+        print_line("p99 Wait | p99 I/O | Max I/O", "< %6.f us | < %6.f us | %6.1f us",
+            stat_quantile(st.lock_hist, st.calls, 0.99), stat_quantile(st.io_hist, st.calls, 0.99),
+            st.max_io_ns / 1e3);
+
+        if (!st.errors) continue;
+        strbuf[0] = 0;
+        for (j = 0; j < SMU_STAT_ERROR_CODES; j++) {
+            if (!st.error_codes[j]) continue;
+            snprintf(strbuf + strlen(strbuf), sizeof(strbuf) - strlen(strbuf), "%s%s: %llu",
+                strbuf[0] ? ", " : "", smu_return_to_str(SMU_Return_Failed - j), st.error_codes[j]);
+        }
+        print_line("Errors", "%.46s", strbuf);
+    }
+    print_line("Decode and Draw", "%6.1f us", decode_ns / 1e3);
+    screen_printf("╰───────────────────────────────────────────────┴────────────────────────────────────────────────╯\n");
+}
@@ -0,0 +1,47 @@
+/**
+ * Ryzen SMU Userspace Sensor Monitor
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef draw_h
+#define draw_h
+
+#include "pm_tables.h"
+#include "readinfo.h"
+#include "throttle.h"
+
+//Monitor panels. They only collect text through screen_printf(), so the
+//caller decides whether a frame goes to the terminal, to stdout or, for the
+//benchmark, nowhere.
+
+//Also list the disabled cores in the core table
+extern int show_disabled_cores;
+
+//Prints one "label | value" row of a panel.
+void print_line(const char* label, const char* value_format, ...);
+
+//Draws the system, core, constraint, memory, graphics and power panels of
+//one sample. values is the dense metric array gathered from pmt.
+void draw_screen(pm_table *pmt, const float *values, system_info *sysinfo);
+
+//Feeds the sample to the limiter engine and draws the limiter panel.
+void draw_limiters(throttle_state *limiters, pm_table *pmt, const float *values, system_info *sysinfo,
+                   unsigned long long timestamp_ns);
+
+//Draws the SMU access counters of obj, see smu_get_stats(), next to the
+//time decode_ns the monitor spent decoding and drawing the sample.
+void draw_smu_stats(smu_obj_t *obj, unsigned long long decode_ns);
+
+#endif
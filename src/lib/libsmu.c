@@ -17,27 +17,35 @@
  **/
 
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <unistd.h>
 #include <stdlib.h>
 #include <fcntl.h>
+#include <glob.h>
+#include <time.h>
 
 #include "libsmu.h"
 
-#define DRIVER_CLASS_PATH               "/sys/kernel/ryzen_smu_drv/"
+#define DRIVER_SYSFS_ROOT               "/sys/kernel/"
+#define DRIVER_CLASS_PATH               DRIVER_SYSFS_ROOT "ryzen_smu_drv/"
 
-#define DRIVER_VERSION_PATH             DRIVER_CLASS_PATH "drv_version"
-#define VERSION_PATH                    DRIVER_CLASS_PATH "version"
-#define IF_VERSION_PATH                 DRIVER_CLASS_PATH "mp1_if_version"
-#define CODENAME_PATH                   DRIVER_CLASS_PATH "codename"
+/* Further instances, one per socket or node, are numbered after the first. */
+#define DRIVER_NODE_PATTERN             DRIVER_SYSFS_ROOT "ryzen_smu_drv*/"
 
-#define SMN_PATH                        DRIVER_CLASS_PATH "smn"
-#define SMU_ARG_PATH                    DRIVER_CLASS_PATH "smu_args"
-#define RSMU_CMD_PATH                   DRIVER_CLASS_PATH "rsmu_cmd"
-#define MP1_SMU_CMD_PATH                DRIVER_CLASS_PATH "mp1_smu_cmd"
+/* File names relative to the driver directory of an instance. */
+#define DRIVER_VERSION_PATH             "drv_version"
+#define VERSION_PATH                    "version"
+#define IF_VERSION_PATH                 "mp1_if_version"
+#define CODENAME_PATH                   "codename"
 
-#define PM_VERSION_PATH                 DRIVER_CLASS_PATH "pm_table_version"
-#define PM_SIZE_PATH                    DRIVER_CLASS_PATH "pm_table_size"
-#define PM_PATH                         DRIVER_CLASS_PATH "pm_table"
+#define SMN_PATH                        "smn"
+#define SMU_ARG_PATH                    "smu_args"
+#define RSMU_CMD_PATH                   "rsmu_cmd"
+#define MP1_SMU_CMD_PATH                "mp1_smu_cmd"
+
+#define PM_VERSION_PATH                 "pm_table_version"
+#define PM_SIZE_PATH                    "pm_table_size"
+#define PM_PATH                         "pm_table"
 
 /* Maximum driver version length defined as "255.255.255\n" */
 #define LIBSMU_MAX_DRIVER_VERSION_LEN   12
@@ -45,6 +53,9 @@
 /* Maximum is defined as: "255.255.255.255\n" */
 #define LIBSMU_MAX_SMU_VERSION_LEN      16
 
+/* Copies of a mapped PM table retried before giving up, see copy_pm_table_map() */
+#define PM_TABLE_COPY_RETRIES           8
+
 int try_open_path(const char* pathname, int mode, int* fd) {
     int ret = 1;
 
@@ -57,6 +68,14 @@ int try_open_path(const char* pathname, int mode, int* fd) {
     return ret;
 }
 
+/* Opens a file of the driver instance obj was initialized for. */
+static int try_open_node(smu_obj_t* obj, const char* name, int mode, int* fd) {
+    char pathname[SMU_MAX_PATH_LEN + 32];
+
+    snprintf(pathname, sizeof(pathname), "%s%s", obj->path, name);
+    return try_open_path(pathname, mode, fd);
+}
+
 smu_return_val smu_init_parse(smu_obj_t* obj) {
     int ver_maj, ver_min, ver_rev, ver_alt, len, i, c;
     char rd_buf[1024];
@@ -65,7 +84,7 @@ smu_return_val smu_init_parse(smu_obj_t* obj) {
     memset(rd_buf, 0, sizeof(rd_buf));
 
     // Verify the driver version is expected.
-    if (!try_open_path(DRIVER_VERSION_PATH, O_RDONLY, &tmp_fd))
+    if (!try_open_node(obj, DRIVER_VERSION_PATH, O_RDONLY, &tmp_fd))
         return SMU_Return_DriverNotPresent;
 
     ret = read(tmp_fd, rd_buf, LIBSMU_MAX_DRIVER_VERSION_LEN);
@@ -87,7 +106,7 @@ smu_return_val smu_init_parse(smu_obj_t* obj) {
     obj->driver_version = ver_maj << 16 | ver_min << 8 | ver_rev;
 
     // The version of the SMU **MUST** be present.
-    if (!try_open_path(VERSION_PATH, O_RDONLY, &tmp_fd))
+    if (!try_open_node(obj, VERSION_PATH, O_RDONLY, &tmp_fd))
         return SMU_Return_DriverNotPresent;
 
     ret = read(tmp_fd, rd_buf, LIBSMU_MAX_SMU_VERSION_LEN);
@@ -120,7 +139,7 @@ smu_return_val smu_init_parse(smu_obj_t* obj) {
         return SMU_Return_RWError;
 
     // Codename must also be present.
-    if (!try_open_path(CODENAME_PATH, O_RDONLY, &tmp_fd))
+    if (!try_open_node(obj, CODENAME_PATH, O_RDONLY, &tmp_fd))
         return SMU_Return_DriverNotPresent;
 
     ret = read(tmp_fd, rd_buf, 3);
@@ -136,7 +155,7 @@ smu_return_val smu_init_parse(smu_obj_t* obj) {
         return SMU_Return_Unsupported;
 
     // MP1 version must also be present.
-    if (!try_open_path(IF_VERSION_PATH, O_RDONLY, &tmp_fd))
+    if (!try_open_node(obj, IF_VERSION_PATH, O_RDONLY, &tmp_fd))
         return SMU_Return_DriverNotPresent;
 
     // This only specifies an enumeration for the IF version.
@@ -151,7 +170,7 @@ smu_return_val smu_init_parse(smu_obj_t* obj) {
         return SMU_Return_RWError;
 
     // This file doesn't need to exist if PM Tables aren't supported.
-    if (!try_open_path(PM_VERSION_PATH, O_RDONLY, &tmp_fd))
+    if (!try_open_node(obj, PM_VERSION_PATH, O_RDONLY, &tmp_fd))
         return SMU_Return_OK;
     
     ret = read(tmp_fd, &obj->pm_table_version, sizeof(obj->pm_table_version));
@@ -161,7 +180,7 @@ smu_return_val smu_init_parse(smu_obj_t* obj) {
         return SMU_Return_RWError;
 
     // If the PM table contains a version, a size file MUST exist.
-    if (!try_open_path(PM_SIZE_PATH, O_RDONLY, &tmp_fd))
+    if (!try_open_node(obj, PM_SIZE_PATH, O_RDONLY, &tmp_fd))
         return SMU_Return_RWError;
     
     ret = read(tmp_fd, &obj->pm_table_size, sizeof(obj->pm_table_size));
@@ -174,26 +193,38 @@ smu_return_val smu_init_parse(smu_obj_t* obj) {
 }
 
 int smu_init(smu_obj_t* obj) {
+    return smu_init_path(obj, DRIVER_CLASS_PATH);
+}
+
+int smu_init_path(smu_obj_t* obj, const char* path) {
+    size_t len;
     int i, ret;
 
     memset(obj, 0, sizeof(*obj));
 
+    len = strlen(path);
+    if (!len || len + 2 > sizeof(obj->path))
+        return SMU_Return_InvalidArgument;
+    memcpy(obj->path, path, len + 1);
+    if (obj->path[len - 1] != '/')
+        strcat(obj->path, "/");
+
     // Parse constants: SMU Version, Processor Codename, PM Table Size/Version
     ret = smu_init_parse(obj);
     if (ret != SMU_Return_OK)
         return ret;
 
     // The driver must provide access to these files.
-    if (!try_open_path(SMN_PATH, O_RDWR, &obj->fd_smn) ||
-        !try_open_path(MP1_SMU_CMD_PATH, O_RDWR, &obj->fd_mp1_smu_cmd) ||
-        !try_open_path(SMU_ARG_PATH, O_RDWR, &obj->fd_smu_args))
+    if (!try_open_node(obj, SMN_PATH, O_RDWR, &obj->fd_smn) ||
+        !try_open_node(obj, MP1_SMU_CMD_PATH, O_RDWR, &obj->fd_mp1_smu_cmd) ||
+        !try_open_node(obj, SMU_ARG_PATH, O_RDWR, &obj->fd_smu_args))
         return SMU_Return_RWError;
 
     // RSMU is optionally supported for some codenames.
-    if (try_open_path(RSMU_CMD_PATH, O_RDWR, &obj->fd_rsmu_cmd)) {
+    if (try_open_node(obj, RSMU_CMD_PATH, O_RDWR, &obj->fd_rsmu_cmd)) {
         // This file may optionally exist only if PM tables are supported AND RSMU as well.
         if (smu_pm_tables_supported(obj) &&
-            !try_open_path(PM_PATH, O_RDONLY, &obj->fd_pm_table))
+            !try_open_node(obj, PM_PATH, O_RDONLY, &obj->fd_pm_table))
             return SMU_Return_RWError;
     }
 
@@ -205,9 +236,42 @@ int smu_init(smu_obj_t* obj) {
     return SMU_Return_OK;
 }
 
+int smu_enumerate(char paths[][SMU_MAX_PATH_LEN], int max_paths) {
+    glob_t nodes;
+    size_t i;
+    int count = 0;
+    int fd;
+
+    if (glob(DRIVER_NODE_PATTERN, GLOB_MARK, NULL, &nodes))
+        return 0;
+
+    // Sorted by glob(), so the instance smu_init() opens comes first.
+    for (i = 0; i < nodes.gl_pathc; i++) {
+        char version[SMU_MAX_PATH_LEN + 32];
+
+        if (strlen(nodes.gl_pathv[i]) >= SMU_MAX_PATH_LEN)
+            continue;
+
+        // Skip anything that merely matches the name
+        snprintf(version, sizeof(version), "%s%s", nodes.gl_pathv[i], VERSION_PATH);
+        if (!try_open_path(version, O_RDONLY, &fd))
+            continue;
+        close(fd);
+
+        if (count < max_paths)
+            strcpy(paths[count], nodes.gl_pathv[i]);
+        count++;
+    }
+
+    globfree(&nodes);
+    return count;
+}
+
 void smu_free(smu_obj_t* obj) {
     int i;
 
+    smu_unmap_pm_table(obj);
+
     if (obj->fd_smn)
         close(obj->fd_smn);
 
@@ -230,7 +294,7 @@ void smu_free(smu_obj_t* obj) {
 }
 
 const char* smu_get_fw_version(smu_obj_t* obj) {
-    static char fw[32] = { 0 };
+    char* fw = obj->fw_version;
 
     if (!obj->init)
         return "Uninitialized";
@@ -248,119 +312,327 @@ const char* smu_get_fw_version(smu_obj_t* obj) {
     return fw;
 }
 
-unsigned int smu_read_smn_addr(smu_obj_t* obj, unsigned int address, unsigned int* result) {
-    unsigned int ret;
+static unsigned long long stat_clock(void) {
+    struct timespec ts;
 
-    pthread_mutex_lock(&obj->lock[SMU_MUTEX_SMN]);
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
 
-    lseek(obj->fd_smn, 0, SEEK_SET);
-    ret = write(obj->fd_smn, &address, sizeof(address));
+static int stat_bucket(unsigned long long ns) {
+    int i = 0;
 
-    if (ret != sizeof(address))
-        goto BREAK_OUT;
+    for (ns /= 1000; ns && i < SMU_STAT_BUCKETS - 1; ns >>= 1)
+        i++;
 
-    lseek(obj->fd_smn, 0, SEEK_SET);
-    ret = read(obj->fd_smn, result, sizeof(*result));
+    return i;
+}
+
+// Takes the lock and returns when it was acquired; *start gets when the wait began.
+static unsigned long long stat_lock(smu_obj_t* obj, enum SMU_MUTEX_LOCK lock, unsigned long long* start) {
+    *start = stat_clock();
+    pthread_mutex_lock(&obj->lock[lock]);
+    return stat_clock();
+}
+
+// Accounts the call and releases the lock.
+static void stat_unlock(smu_obj_t* obj, enum SMU_MUTEX_LOCK lock, unsigned int ret,
+    unsigned long long start, unsigned long long locked) {
+    smu_stats_t* st = &obj->stats[lock];
+    unsigned long long io = stat_clock() - locked;
+
+    st->calls++;
+    if (ret != SMU_Return_OK) {
+        st->errors++;
+        if (ret >= SMU_Return_DriverVersion && ret <= SMU_Return_Failed)
+            st->error_codes[SMU_STAT_ERROR_INDEX(ret)]++;
+    }
+    st->lock_wait_ns += locked - start;
+    st->io_ns += io;
+    if (io > st->max_io_ns)
+        st->max_io_ns = io;
+    st->io_hist[stat_bucket(io)]++;
+    st->lock_hist[stat_bucket(locked - start)]++;
+
+    pthread_mutex_unlock(&obj->lock[lock]);
+}
+
+smu_return_val smu_get_stats(smu_obj_t* obj, enum SMU_MUTEX_LOCK lock, smu_stats_t* out, int reset) {
+    if (lock < 0 || lock >= SMU_MUTEX_COUNT || !out)
+        return SMU_Return_InvalidArgument;
+
+    pthread_mutex_lock(&obj->lock[lock]);
+    *out = obj->stats[lock];
+    if (reset)
+        memset(&obj->stats[lock], 0, sizeof(obj->stats[lock]));
+    pthread_mutex_unlock(&obj->lock[lock]);
+
+    return SMU_Return_OK;
+}
+
+unsigned int smu_read_smn_addr(smu_obj_t* obj, unsigned int address, unsigned int* result) {
+    return smu_read_smn_batch(obj, &address, result, 1);
+}
+
+smu_return_val smu_read_smn_batch(smu_obj_t* obj, const unsigned int* addrs, unsigned int* out, size_t n) {
+    smu_return_val ret = SMU_Return_OK;
+    unsigned long long start, locked;
+    size_t i;
 
-BREAK_OUT:
-    pthread_mutex_unlock(&obj->lock[SMU_MUTEX_SMN]);
+    locked = stat_lock(obj, SMU_MUTEX_SMN, &start);
 
-    return ret == sizeof(unsigned int) ? SMU_Return_OK : SMU_Return_RWError;
+    // The smn file interprets each write as one request, so a request can't be
+    // merged into a single vectored write. Positional I/O at least saves both lseek() calls.
+    for (i = 0; i < n; i++) {
+        if (pwrite(obj->fd_smn, &addrs[i], sizeof(addrs[i]), 0) != sizeof(addrs[i]) ||
+            pread(obj->fd_smn, &out[i], sizeof(out[i]), 0) != sizeof(out[i])) {
+            ret = SMU_Return_RWError;
+            break;
+        }
+    }
+
+    stat_unlock(obj, SMU_MUTEX_SMN, ret, start, locked);
+
+    return ret;
 }
 
 smu_return_val smu_write_smn_addr(smu_obj_t* obj, unsigned int address, unsigned int value) {
     unsigned int buffer[2], ret;
+    unsigned long long start, locked;
 
     buffer[0] = address;
     buffer[1] = value;
 
-    pthread_mutex_lock(&obj->lock[SMU_MUTEX_SMN]);
+    locked = stat_lock(obj, SMU_MUTEX_SMN, &start);
 
     lseek(obj->fd_smn, 0, SEEK_SET);
-    ret = write(obj->fd_smn, buffer, sizeof(buffer));
+    ret = write(obj->fd_smn, buffer, sizeof(buffer)) == sizeof(buffer) ? SMU_Return_OK : SMU_Return_RWError;
 
-    pthread_mutex_unlock(&obj->lock[SMU_MUTEX_SMN]);
+    stat_unlock(obj, SMU_MUTEX_SMN, ret, start, locked);
 
-    return ret == sizeof(buffer) ? SMU_Return_OK : SMU_Return_RWError;
+    return ret;
 }
 
-smu_return_val smu_send_command(smu_obj_t* obj, unsigned int op, smu_arg_t args,
-    enum smu_mailbox mailbox) {
-    unsigned int ret, status, fd_smu_cmd;
-
+static int command_fd(smu_obj_t* obj, enum smu_mailbox mailbox) {
     switch (mailbox) {
         case TYPE_RSMU:
-            fd_smu_cmd = obj->fd_rsmu_cmd;
-            break;
+            return obj->fd_rsmu_cmd;
         case TYPE_MP1:
-            fd_smu_cmd = obj->fd_mp1_smu_cmd;
-            break;
+            return obj->fd_mp1_smu_cmd;
         default:
-            return SMU_Return_Unsupported;
+            return 0;
     }
+}
 
-    // Check if fd is valid
-    if (!fd_smu_cmd)
-        return SMU_Return_Unsupported;
-
-    pthread_mutex_lock(&obj->lock[SMU_MUTEX_CMD]);
+// Must be called with SMU_MUTEX_CMD held. Returns args in args.
+static unsigned int send_command_locked(smu_obj_t* obj, int fd_smu_cmd, unsigned int op, smu_arg_t* args) {
+    unsigned int ret, status;
 
     lseek(obj->fd_smu_args, 0, SEEK_SET);
-    ret = write(obj->fd_smu_args, args.args, sizeof(args));
+    ret = write(obj->fd_smu_args, args->args, sizeof(args->args));
 
-    if (ret != sizeof(args)) {
-        ret = SMU_Return_RWError;
-        goto BREAK_OUT;
-    }
+    if (ret != sizeof(args->args))
+        return SMU_Return_RWError;
 
     lseek(fd_smu_cmd, 0, SEEK_SET);
     ret = write(fd_smu_cmd, &op, sizeof(op));
 
-    if (ret != sizeof(op)) {
-        ret = SMU_Return_RWError;
-        goto BREAK_OUT;
-    }
+    if (ret != sizeof(op))
+        return SMU_Return_RWError;
 
     lseek(fd_smu_cmd, 0, SEEK_SET);
     ret = read(fd_smu_cmd, &status, sizeof(status));
 
     if (ret != sizeof(status))
-        ret = SMU_Return_RWError;
-    else
-        ret = status;
+        return SMU_Return_RWError;
 
-    if (ret == SMU_Return_OK) {
+    if (status == SMU_Return_OK) {
         lseek(obj->fd_smu_args, 0, SEEK_SET);
-        ret = read(obj->fd_smu_args, args.args, sizeof(args.args));
+        ret = read(obj->fd_smu_args, args->args, sizeof(args->args));
 
-        if (ret != sizeof(args.args))
-            ret = SMU_Return_RWError;
+        if (ret != sizeof(args->args))
+            return SMU_Return_RWError;
     }
 
-BREAK_OUT:
-    pthread_mutex_unlock(&obj->lock[SMU_MUTEX_CMD]);
+    return status;
+}
+
+smu_return_val smu_send_command(smu_obj_t* obj, unsigned int op, smu_arg_t args,
+    enum smu_mailbox mailbox) {
+    unsigned int ret;
+    unsigned long long start, locked;
+    int fd_smu_cmd;
+
+    fd_smu_cmd = command_fd(obj, mailbox);
+
+    // Check if fd is valid
+    if (!fd_smu_cmd)
+        return SMU_Return_Unsupported;
+
+    locked = stat_lock(obj, SMU_MUTEX_CMD, &start);
+    ret = send_command_locked(obj, fd_smu_cmd, op, &args);
+    stat_unlock(obj, SMU_MUTEX_CMD, ret, start, locked);
 
     return ret;
 }
 
-smu_return_val smu_read_pm_table(smu_obj_t* obj, unsigned char* dst, size_t dst_len) {
+smu_return_val smu_send_command_batch(smu_obj_t* obj, smu_command_t* cmds, size_t n) {
+    unsigned long long start, locked;
+    smu_return_val ret = SMU_Return_OK;
+    size_t i;
+    int fd_smu_cmd;
+
+    if (!n)
+        return SMU_Return_OK;
+
+    locked = stat_lock(obj, SMU_MUTEX_CMD, &start);
+
+    for (i = 0; i < n; i++) {
+        fd_smu_cmd = command_fd(obj, cmds[i].mailbox);
+
+        if (fd_smu_cmd)
+            cmds[i].ret = send_command_locked(obj, fd_smu_cmd, cmds[i].op, &cmds[i].args);
+        else
+            cmds[i].ret = SMU_Return_Unsupported;
+
+        if (cmds[i].ret != SMU_Return_OK)
+            ret = cmds[i].ret;
+    }
+
+    // Counted as one call, like smu_read_smn_batch()
+    stat_unlock(obj, SMU_MUTEX_CMD, ret, start, locked);
+
+    return ret;
+}
+
+// Must be called with SMU_MUTEX_PM held. The driver rewrites the mapping whenever
+// it transfers a new table and exposes no generation count, so a copy is only
+// kept if the mapping still matches it afterwards. Any transfer that overlapped
+// the copy shows up as a difference, and the copy is taken again.
+static smu_return_val copy_pm_table_map(smu_obj_t* obj, unsigned char* dst) {
+    int i;
+
+    for (i = 0; i < PM_TABLE_COPY_RETRIES; i++) {
+        memcpy(dst, obj->pm_table_map, obj->pm_table_size);
+        // The mapping changes behind the compiler's back
+        __asm__ __volatile__("" ::: "memory");
+        if (!memcmp(dst, obj->pm_table_map, obj->pm_table_size))
+            return SMU_Return_OK;
+    }
+
+    return SMU_Return_RWError;
+}
+
+// Must be called with SMU_MUTEX_PM held. Reads a consistent PM table into dst.
+// Every read() makes the driver transfer a new table. A mapped table only counts
+// as a new generation once its contents changed, which costs another pass over
+// the table and is only checked for callers that asked for the generation.
+static smu_return_val fetch_pm_table(smu_obj_t* obj, unsigned char* dst, int want_seq) {
     int ret;
 
+    if (obj->pm_table_map) {
+        if (copy_pm_table_map(obj, dst) != SMU_Return_OK)
+            return SMU_Return_RWError;
+
+        if (!want_seq || !memcmp(dst, obj->pm_table_last, obj->pm_table_size))
+            return SMU_Return_OK;
+
+        memcpy(obj->pm_table_last, dst, obj->pm_table_size);
+    }
+    else {
+        lseek(obj->fd_pm_table, 0, SEEK_SET);
+        ret = read(obj->fd_pm_table, dst, obj->pm_table_size);
+
+        if (ret != obj->pm_table_size)
+            return SMU_Return_RWError;
+    }
+
+    obj->pm_table_seq++;
+
+    return SMU_Return_OK;
+}
+
+smu_return_val smu_read_pm_table(smu_obj_t* obj, unsigned char* dst, size_t dst_len) {
+    unsigned long long start, locked;
+    smu_return_val ret;
+
     if (dst_len != obj->pm_table_size)
         return SMU_Return_InsufficientSize;
 
+    locked = stat_lock(obj, SMU_MUTEX_PM, &start);
+
+    ret = fetch_pm_table(obj, dst, 0);
+
+    stat_unlock(obj, SMU_MUTEX_PM, ret, start, locked);
+
+    return ret;
+}
+
+smu_return_val smu_map_pm_table(smu_obj_t* obj) {
+    unsigned char* last;
+    void* map;
+
+    if (!obj->init || !obj->fd_pm_table)
+        return SMU_Return_Unsupported;
+
+    if (obj->pm_table_map)
+        return SMU_Return_OK;
+
+    last = calloc(1, obj->pm_table_size);
+    if (!last)
+        return SMU_Return_MappedError;
+
+    map = mmap(NULL, obj->pm_table_size, PROT_READ, MAP_SHARED, obj->fd_pm_table, 0);
+    if (map == MAP_FAILED) {
+        free(last);
+        return SMU_Return_MappedError;
+    }
+
     pthread_mutex_lock(&obj->lock[SMU_MUTEX_PM]);
+    obj->pm_table_map = map;
+    obj->pm_table_last = last;
+    pthread_mutex_unlock(&obj->lock[SMU_MUTEX_PM]);
 
-    lseek(obj->fd_pm_table, 0, SEEK_SET);
-    ret = read(obj->fd_pm_table, dst, obj->pm_table_size);
+    return SMU_Return_OK;
+}
 
-    if (ret != obj->pm_table_size)
-        ret = SMU_Return_RWError;
-    else
-        ret = SMU_Return_OK;
+void smu_unmap_pm_table(smu_obj_t* obj) {
+    unsigned char* map;
+    unsigned char* last;
+
+    if (!obj->pm_table_map)
+        return;
 
+    pthread_mutex_lock(&obj->lock[SMU_MUTEX_PM]);
+    map = obj->pm_table_map;
+    last = obj->pm_table_last;
+    obj->pm_table_map = NULL;
+    obj->pm_table_last = NULL;
     pthread_mutex_unlock(&obj->lock[SMU_MUTEX_PM]);
 
+    munmap(map, obj->pm_table_size);
+    free(last);
+}
+
+smu_return_val smu_read_pm_table_snapshot(smu_obj_t* obj, unsigned char* dst, size_t dst_len,
+    const unsigned char** table, unsigned int* seq) {
+    unsigned long long start, locked;
+    smu_return_val ret;
+
+    if (dst_len != obj->pm_table_size)
+        return SMU_Return_InsufficientSize;
+
+    locked = stat_lock(obj, SMU_MUTEX_PM, &start);
+
+    ret = fetch_pm_table(obj, dst, seq != NULL);
+    if (ret == SMU_Return_OK) {
+        *table = dst;
+        if (seq)
+            *seq = obj->pm_table_seq;
+    }
+
+    stat_unlock(obj, SMU_MUTEX_PM, ret, start, locked);
+
     return ret;
 }
 
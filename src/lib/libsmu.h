@@ -31,6 +31,9 @@ static char kernel_driver_supported_versions[KERNEL_DRIVER_SUPP_VERS_COUNT][10]
     "0.1.2"
 };
 
+/* Maximum length of the sysfs directory of a driver instance. */
+#define SMU_MAX_PATH_LEN 128
+
 /**
  * SMU Mailbox Target
  */
@@ -122,6 +125,26 @@ enum SMU_MUTEX_LOCK {
     SMU_MUTEX_COUNT
 };
 
+/**
+ * Access statistics, kept per lock: SMU_MUTEX_SMN counts SMN reads and writes,
+ *  SMU_MUTEX_CMD SMU commands and SMU_MUTEX_PM PM table reads and snapshots.
+ *  Only calls that reached the driver are counted.
+ */
+#define SMU_STAT_BUCKETS        24      /* Bucket 0 is < 1 us, bucket i < 2^i us, the last is open */
+#define SMU_STAT_ERROR_CODES    12      /* SMU_Return_Failed down to SMU_Return_DriverVersion */
+#define SMU_STAT_ERROR_INDEX(val) (SMU_Return_Failed - (val))
+
+typedef struct {
+    unsigned long long          calls;
+    unsigned long long          errors;         /* Calls not returning SMU_Return_OK */
+    unsigned long long          error_codes[SMU_STAT_ERROR_CODES];
+    unsigned long long          lock_wait_ns;   /* Waiting for the lock */
+    unsigned long long          io_ns;          /* Holding it, i.e. in the driver */
+    unsigned long long          max_io_ns;
+    unsigned long long          io_hist[SMU_STAT_BUCKETS];
+    unsigned long long          lock_hist[SMU_STAT_BUCKETS];
+} smu_stats_t;
+
 typedef struct {
     /* Accessible To Users */
     int                         init;
@@ -134,13 +157,21 @@ typedef struct {
     int                         pm_table_version;
 
     /* Internal Library Use Only */
+    char                        path[SMU_MAX_PATH_LEN];
+    char                        fw_version[32];
     int                         fd_smn;
     int                         fd_rsmu_cmd;
     int                         fd_mp1_smu_cmd;
     int                         fd_smu_args;
     int                         fd_pm_table;
 
+    /* Mapped PM table reads, see smu_map_pm_table() */
+    unsigned char*              pm_table_map;
+    unsigned char*              pm_table_last;  /* Newest copy of the mapping, for the generation */
+    unsigned int                pm_table_seq;
+
     pthread_mutex_t             lock[SMU_MUTEX_COUNT];
+    smu_stats_t                 stats[SMU_MUTEX_COUNT]; /* Guarded by the lock they describe */
 } smu_obj_t;
 
 typedef union {
@@ -165,6 +196,17 @@ typedef union {
     float                       args_f[6];
 } smu_arg_t;
 
+/**
+ * One SMU command of a batch. ret receives its result and args the
+ *  arguments returned by the SMU.
+ */
+typedef struct {
+    unsigned int                op;
+    enum smu_mailbox            mailbox;
+    smu_arg_t                   args;
+    smu_return_val              ret;
+} smu_command_t;
+
 /**
  * Initializes or frees the userspace library for use.
  * Upon successful initialization, users are allowed to access
@@ -176,6 +218,21 @@ typedef union {
 int smu_init(smu_obj_t* obj);
 void smu_free(smu_obj_t* obj);
 
+/**
+ * Same as smu_init() for the driver instance in the sysfs directory path,
+ *  one of those returned by smu_enumerate(). Objects of different instances
+ *  are independent and can be used from different threads concurrently.
+ */
+int smu_init_path(smu_obj_t* obj, const char* path);
+
+/**
+ * Lists the sysfs directories of all driver instances, e.g. one per socket,
+ *  the default instance smu_init() uses first.
+ *
+ * Returns the number of instances, which may exceed max_paths.
+ */
+int smu_enumerate(char paths[][SMU_MAX_PATH_LEN], int max_paths);
+
 /**
  * Returns the string representation of the SMU FW version.
  */
@@ -187,6 +244,14 @@ const char* smu_get_fw_version(smu_obj_t* obj);
 unsigned int smu_read_smn_addr(smu_obj_t* obj, unsigned int address, unsigned int* result);
 smu_return_val smu_write_smn_addr(smu_obj_t* obj, unsigned int address, unsigned int value);
 
+/**
+ * Reads n 32 bit words from the SMN addresses in addrs into out.
+ * The SMN lock is taken only once for the whole batch.
+ *
+ * Returns SMU_Return_OK if all words were read.
+ */
+smu_return_val smu_read_smn_batch(smu_obj_t* obj, const unsigned int* addrs, unsigned int* out, size_t n);
+
 /**
  * Sends a command to the SMU.
  * Arguments are sent in the args buffer and are also returned in it.
@@ -196,6 +261,14 @@ smu_return_val smu_write_smn_addr(smu_obj_t* obj, unsigned int address, unsigned
 smu_return_val smu_send_command(smu_obj_t* obj, unsigned int op, smu_arg_t args,
     enum smu_mailbox mailbox);
 
+/**
+ * Sends n commands to the SMU, taking the command lock only once for the
+ *  whole batch. Every command gets its own result in ret.
+ *
+ * Returns SMU_Return_OK if all commands succeeded, else the last failure.
+ */
+smu_return_val smu_send_command_batch(smu_obj_t* obj, smu_command_t* cmds, size_t n);
+
 /**
  * Reads the PM table into the destination buffer.
  * 
@@ -203,6 +276,44 @@ smu_return_val smu_send_command(smu_obj_t* obj, unsigned int op, smu_arg_t args,
  */
 smu_return_val smu_read_pm_table(smu_obj_t* obj, unsigned char* dst, size_t dst_len);
 
+/**
+ * Optional mapped reads. Maps the PM table exposed by the driver read-only
+ *  into the address space of the process. Requires a driver that supports
+ *  mmap() on the pm_table file and keeps the mapped table current.
+ * While mapped, smu_read_pm_table() copies from the mapping instead of going
+ *  through lseek() and read() on the sysfs file. This saves two syscalls per
+ *  sample, not the copy: the driver may rewrite the
+ *  mapping at any time, so every copy is compared against the mapping after
+ *  it was taken and retried if a transfer overlapped it. The driver exposes no
+ *  generation count, so a transfer it leaves half done for longer than a copy
+ *  takes cannot be told apart from a finished one.
+ *
+ * Returns SMU_Return_OK on success. On failure the read() path stays active.
+ */
+smu_return_val smu_map_pm_table(smu_obj_t* obj);
+void smu_unmap_pm_table(smu_obj_t* obj);
+
+/**
+ * Reads a consistent snapshot of the PM table into dst and points *table to it.
+ * seq (optional) receives the generation of the table: it increases with every
+ *  read() from the driver, each of which transfers a new table, and in mapped
+ *  mode whenever the mapped table changed since the previous snapshot that
+ *  asked for seq. Pass NULL to skip that comparison.
+ *
+ * Returns SMU_Return_OK on success, SMU_Return_RWError if the mapped table kept
+ *  changing during every attempt to copy it.
+ */
+smu_return_val smu_read_pm_table_snapshot(smu_obj_t* obj, unsigned char* dst, size_t dst_len,
+    const unsigned char** table, unsigned int* seq);
+
+/**
+ * Copies the access statistics of one lock (SMU_MUTEX_*) and optionally
+ *  clears them. Counting costs three clock reads per call.
+ *
+ * Returns SMU_Return_OK, or SMU_Return_InvalidArgument for an invalid lock.
+ */
+smu_return_val smu_get_stats(smu_obj_t* obj, enum SMU_MUTEX_LOCK lock, smu_stats_t* out, int reset);
+
 /** HELPER METHODS **/
 
 /**
@@ -0,0 +1,169 @@
+/**
+ * Ryzen SMU Userspace Sensor Monitor
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pm_layout.h"
+
+typedef struct {
+    const char *name;
+    unsigned short metric;
+    unsigned short count;
+} pm_field;
+
+#define PMT_FIELD_S(name)      { #name, PMT_ID_##name, 1 },
+#define PMT_FIELD_A(name, n)   { #name, PMT_ID_##name, n },
+
+static const pm_field pm_fields[] = {
+    PMT_FIELDS(PMT_FIELD_S, PMT_FIELD_A)
+};
+
+#define PM_NUM_FIELDS (sizeof(pm_fields)/sizeof(pm_fields[0]))
+
+int pm_layout_compile(pm_layout *layout, const pm_table *pmt, const void *base_addr) {
+    const unsigned char *base = base_addr;
+    pm_desc *d = 0;
+    unsigned int offset;
+    int i;
+
+    memset(layout, 0, sizeof(pm_layout));
+    layout->version = pmt->version;
+    layout->min_size = pmt->min_size;
+
+    for (i = 0; i < PMT_METRIC_COUNT; i++) {
+        if (!pmt->metric[i]) continue;
+        offset = (const unsigned char*)pmt->metric[i] - base;
+
+        //Extend the current run if this field directly follows it
+        if (d && d->metric + d->count == i && d->offset + d->count*4 == offset) {
+            d->count++;
+            continue;
+        }
+
+        if (layout->num_desc >= PMT_MAX_NUM_DESC) return 0;
+        d = &layout->desc[layout->num_desc++];
+        d->metric = i;
+        d->count = 1;
+        d->offset = offset;
+    }
+
+    return 1;
+}
+
+int pm_layout_filter(pm_layout *dst, const pm_layout *src, const unsigned char *keep) {
+    const pm_desc *d;
+    pm_desc *out = 0;
+    unsigned int i, j, gap, out_run = 0;
+
+    memset(dst, 0, sizeof(pm_layout));
+    dst->version = src->version;
+    dst->min_size = src->min_size;
+
+    for (i = 0; i < src->num_desc; i++) {
+        d = &src->desc[i];
+        for (j = 0; j < d->count; j++) {
+            if (!keep[d->metric + j]) continue;
+
+            //Copying a few unwanted fields is cheaper than starting a new run.
+            //Only within a source run, fields between two runs may be absent.
+            gap = out ? d->metric + j - (out->metric + out->count) : 0;
+            if (out && out_run == i && gap <= PMT_FILTER_MAX_GAP) {
+                out->count += gap + 1;
+                continue;
+            }
+
+            if (dst->num_desc >= PMT_MAX_NUM_DESC) return 0;
+            out = &dst->desc[dst->num_desc++];
+            out->metric = d->metric + j;
+            out->count = 1;
+            out->offset = d->offset + j*4;
+            out_run = i;
+        }
+    }
+
+    return 1;
+}
+
+void pm_layout_apply(const pm_layout *layout, pm_table *pmt, void *base_addr) {
+    const pm_desc *d;
+    unsigned int i, j;
+
+    for (i = 0; i < layout->num_desc; i++) {
+        d = &layout->desc[i];
+        for (j = 0; j < d->count; j++)
+            pmt->metric[d->metric + j] = (float*)((unsigned char*)base_addr + d->offset + j*4);
+    }
+}
+
+void pm_values_reset(float *values) {
+    int i;
+
+    for (i = 0; i < PMT_METRIC_COUNT; i++)
+        values[i] = NAN;
+}
+
+void pm_layout_gather(const pm_layout *layout, const void *pm_buf, float *values) {
+    const unsigned char *src = pm_buf;
+    const pm_desc *d = layout->desc, *end = layout->desc + layout->num_desc;
+
+    for (; d < end; d++)
+        memcpy(values + d->metric, src + d->offset, d->count * sizeof(float));
+}
+
+static const pm_field* find_field(int metric) {
+    unsigned int lo = 0, hi = PM_NUM_FIELDS, mid;
+
+    if (metric < 0 || metric >= PMT_METRIC_COUNT) return 0;
+
+    //Fields are sorted by metric id
+    while (hi - lo > 1) {
+        mid = (lo + hi) / 2;
+        if (pm_fields[mid].metric <= metric) lo = mid;
+        else hi = mid;
+    }
+    return &pm_fields[lo];
+}
+
+const char* pm_metric_name(int metric, int *index) {
+    const pm_field *f = find_field(metric);
+
+    if (!f) return 0;
+    if (index) *index = metric - f->metric;
+    return f->name;
+}
+
+int pm_metric_lookup(const char *name) {
+    const char *bracket = strchr(name, '[');
+    size_t len = bracket ? (size_t)(bracket - name) : strlen(name);
+    unsigned int i;
+    char *end;
+    long index = 0;
+
+    if (bracket) {
+        index = strtol(bracket + 1, &end, 10);
+        if (end == bracket + 1 || *end != ']' || end[1]) return -1;
+    }
+
+    for (i = 0; i < PM_NUM_FIELDS; i++) {
+        if (strlen(pm_fields[i].name) != len || strncmp(pm_fields[i].name, name, len)) continue;
+        if (index < 0 || index >= pm_fields[i].count) return -1;
+        if (!bracket && pm_fields[i].count > 1) return -1;
+        return pm_fields[i].metric + index;
+    }
+    return -1;
+}
@@ -0,0 +1,83 @@
+/**
+ * Ryzen SMU Userspace Sensor Monitor
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef pm_layout_h
+#define pm_layout_h
+
+#include "pm_tables.h"
+
+//Upper bound for the number of descriptors of a single layout. The known
+//tables need between 40 and 120.
+#define PMT_MAX_NUM_DESC    256
+
+//Longest run of unwanted metrics pm_layout_filter() copies along
+#define PMT_FILTER_MAX_GAP  4
+
+//A run of consecutive metric ids that are stored back to back in the PM table.
+typedef struct {
+    unsigned short metric;  //First metric id (PMT_ID_*)
+    unsigned short count;   //Number of metrics in this run
+    unsigned int offset;    //Byte offset of the first metric in the PM table
+} pm_desc;
+
+//Compact form of a PM table layout. Instead of one pointer per field it holds
+//only the runs of fields present in the table, so extracting a sample is a
+//short loop of memcpys into a dense array of PMT_METRIC_COUNT floats.
+typedef struct {
+    unsigned int version;
+    unsigned int min_size;
+    unsigned int num_desc;
+    pm_desc desc[PMT_MAX_NUM_DESC];
+} pm_layout;
+
+//Builds the descriptors from a pointer mapping set up by select_pm_table_version().
+//Returns 0 if the mapping does not fit into PMT_MAX_NUM_DESC descriptors.
+int pm_layout_compile(pm_layout *layout, const pm_table *pmt, const void *base_addr);
+
+//Builds a layout that gathers only the metrics set in keep[PMT_METRIC_COUNT].
+//Runs stay joined across up to PMT_FILTER_MAX_GAP unwanted metrics, which are
+//then gathered as well. Returns 0 if the result does not fit.
+int pm_layout_filter(pm_layout *dst, const pm_layout *src, const unsigned char *keep);
+
+//Reverse of pm_layout_compile(): points the fields of pmt into base_addr.
+//Allows new table versions to be defined as descriptor data.
+void pm_layout_apply(const pm_layout *layout, pm_table *pmt, void *base_addr);
+
+//Sets all values to NAN. Fields absent in a layout are never written by
+//pm_layout_gather(), so this only needs to be done once per dense array.
+void pm_values_reset(float *values);
+
+//Copies all fields of the layout from the raw PM table into the dense array
+//values[PMT_METRIC_COUNT], indexed by metric id.
+void pm_layout_gather(const pm_layout *layout, const void *pm_buf, float *values);
+
+//Name of the field a metric id belongs to and the index within that field
+//(0 for single values). Returns 0 for invalid ids.
+const char* pm_metric_name(int metric, int *index);
+
+//Looks up a metric by name, e.g. "PPT_VALUE" or "CORE_TEMP[3]".
+//Returns the metric id or -1 if the name is unknown.
+int pm_metric_lookup(const char *name);
+
+//Access helpers for dense arrays. Absent fields read as NAN.
+#define pmv(values, elem)       ((values)[PMT_ID_##elem])
+#define pmvi(values, elem, i)   ((values)[PMT_ID_##elem + (i)])
+//Same, but with 0 for absent fields. For summations.
+#define pmv0(values, elem)      (isnan(pmv(values, elem)) ? 0 : pmv(values, elem))
+#define pmvi0(values, elem, i)  (isnan(pmvi(values, elem, i)) ? 0 : pmvi(values, elem, i))
+
+#endif
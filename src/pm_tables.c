@@ -21,6 +21,8 @@
  * This file contains the mapping of every known PM Table version
  **/
 
+#include <math.h>
+#include <string.h>
 #include "pm_tables.h"
 
 //Calculate memory address of element
@@ -1516,3 +1518,57 @@ void pm_table_0x240803(pm_table *pmt, void* base_addr) {
     pmt->min_size = 505*4; //(Highest element we access + 1)*4.
                            //Needed to avoid illegal memory access
 }
+
+int select_pm_table_version(unsigned int version, pm_table *pmt, unsigned char *pm_buf) {
+    //Initialize pmt to 0. This also sets all pointers to 0, which signifies non-existiting fields.
+    //Access via pmta(...) will check if pointer is 0 before trying to access the value.
+    memset(pmt, 0, sizeof(pm_table));
+
+     //Select matching PM Table
+    switch(version) {
+        case 0x380904: pm_table_0x380904(pmt, pm_buf); break; //Ryzen 5600X
+        case 0x380905: pm_table_0x380905(pmt, pm_buf); break; //Ryzen 5600X
+        case 0x380804: pm_table_0x380804(pmt, pm_buf); break; //Ryzen 5900X / 5950X
+        case 0x380805: pm_table_0x380805(pmt, pm_buf); break; //Ryzen 5900X / 5950X
+        case 0x400005: pm_table_0x400005(pmt, pm_buf); break; //Ryzen 5700G
+        case 0x240903: pm_table_0x240903(pmt, pm_buf); break; //Ryzen 3700X / 3800X
+        case 0x240803: pm_table_0x240803(pmt, pm_buf); break; //Ryzen 3950X
+        default:
+            return 0;
+    }
+
+    //Avoid access bejond bounds of the defined arrays.
+    if (pmt->max_l3 > PMT_MAX_NUM_L3) pmt->max_l3 = PMT_MAX_NUM_L3;
+    if (pmt->max_cores > PMT_MAX_NUM_CORES) pmt->max_cores = PMT_MAX_NUM_CORES;
+
+    //APML_POWER is probably identical to PACKAGE_POWER
+    if (pmt->PACKAGE_POWER == NULL) pmt->PACKAGE_POWER = pmt->APML_POWER;
+
+    if (pmt->VDD18_POWER == NULL) pmt->VDD18_POWER = pmt->IO_VDD18_POWER;
+
+    return 1;
+}
+
+#define pmta(elem) ((pmt->elem)?(*pmt->elem):NAN)
+
+unsigned int disabled_cores_0x400005(pm_table *pmt) {
+    int i;
+    unsigned int map = 0;
+    float power, voltage, fit, iddmax, freq, freqeff, c0, cc1, irm;
+    for (i = 0; i < 8; i++) {
+        power = pmta(CORE_POWER[i]);
+        voltage = pmta(CORE_VOLTAGE[i]);
+        fit = pmta(CORE_FIT[i]);
+        iddmax = pmta(CORE_IDDMAX[i]);
+        freq = pmta(CORE_FREQ[i]);
+        freqeff = pmta(CORE_FREQEFF[i]);
+        c0 = pmta(CORE_C0[i]);
+        cc1 = pmta(CORE_CC1[i]);
+        irm = pmta(CORE_IRM[i]);
+
+        //A fused-off core reports all zeros
+        if (power == 0 && voltage == 0 && fit == 0 && iddmax == 0 && freq == 0 && freqeff == 0 && c0 == 0 && cc1 == 0 && irm == 0 )
+            map |= 1 << i;
+    }
+    return map;
+}
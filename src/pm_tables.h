@@ -24,6 +24,354 @@
 #define PMT_MAX_NUM_CORES   16
 #define PMT_MAX_NUM_CLKS    8
 
+//Every field a PM table can contain. S(name) is a single value, A(name, n) an
+//array of n values. The pm_table struct, the metric ids (PMT_ID_*) and the
+//metric names are all generated from this list. Order matters: metric ids are
+//assigned in the order of appearance.
+#define PMT_FIELDS(S, A)                            \
+    S(STAPM_LIMIT)                                  \
+    S(STAPM_VALUE)                                  \
+    S(PPT_LIMIT)                                    \
+    S(PPT_VALUE)                                    \
+    S(PPT_LIMIT_FAST)                               \
+    S(PPT_VALUE_FAST)                               \
+    S(PPT_LIMIT_APU)                                \
+    S(PPT_VALUE_APU)                                \
+    S(TDC_LIMIT)                                    \
+    S(TDC_VALUE)                                    \
+    S(TDC_LIMIT_SOC)                                \
+    S(TDC_VALUE_SOC)                                \
+    S(THM_LIMIT)                                    \
+    S(THM_VALUE)                                    \
+    S(THM_LIMIT_SOC)                                \
+    S(THM_VALUE_SOC)                                \
+    S(THM_LIMIT_GFX)                                \
+    S(THM_VALUE_GFX)                                \
+    S(STT_LIMIT_APU)                                \
+    S(STT_VALUE_APU)                                \
+    S(STT_LIMIT_DGPU)                               \
+    S(STT_VALUE_DGPU)                               \
+    S(FIT_LIMIT)                                    \
+    S(FIT_VALUE)                                    \
+    S(EDC_LIMIT)                                    \
+    S(EDC_VALUE)                                    \
+    S(EDC_LIMIT_SOC)                                \
+    S(EDC_VALUE_SOC)                                \
+    S(VID_LIMIT)                                    \
+    S(VID_VALUE)                                    \
+    S(PSI0_LIMIT_VDD)                               \
+    S(PSI0_RESIDENCY_VDD)                           \
+    S(PSI0_LIMIT_SOC)                               \
+    S(PSI0_RESIDENCY_SOC)                           \
+    S(PPT_WC)                                       \
+    S(PPT_ACTUAL)                                   \
+    S(TDC_WC)                                       \
+    S(TDC_ACTUAL)                                   \
+    S(THM_WC)                                       \
+    S(THM_ACTUAL)                                   \
+    S(FIT_WC)                                       \
+    S(FIT_ACTUAL)                                   \
+    S(EDC_WC)                                       \
+    S(EDC_ACTUAL)                                   \
+    S(VID_WC)                                       \
+    S(VID_ACTUAL)                                   \
+    S(VDDCR_CPU_POWER)                              \
+    S(VDDCR_SOC_POWER)                              \
+    S(VDDIO_MEM_POWER)                              \
+    S(VDD18_POWER)                                  \
+    S(ROC_POWER)                                    \
+    S(SOCKET_POWER)                                 \
+    S(CCLK_GLOBAL_FREQ)                             \
+    S(GLOB_FREQUENCY)                               \
+    S(STAPM_FREQUENCY)                              \
+    S(PPT_FREQUENCY)                                \
+    S(PPT_FREQUENCY_FAST)                           \
+    S(PPT_FREQUENCY_APU)                            \
+    S(TDC_FREQUENCY)                                \
+    S(THM_FREQUENCY)                                \
+    S(HTFMAX_FREQUENCY)                             \
+    S(PROCHOT_FREQUENCY)                            \
+    S(VOLTAGE_FREQUENCY)                            \
+    S(CCA_FREQUENCY)                                \
+    S(FIT_VOLTAGE)                                  \
+    S(FIT_PRE_VOLTAGE)                              \
+    S(LATCHUP_VOLTAGE)                              \
+    S(CPU_SET_VOLTAGE)                              \
+    S(CPU_TELEMETRY_VOLTAGE)                        \
+    S(CPU_TELEMETRY_VOLTAGE2)                       \
+    S(CPU_TELEMETRY_CURRENT)                        \
+    S(CPU_TELEMETRY_POWER)                          \
+    S(SOC_SET_VOLTAGE)                              \
+    S(SOC_TELEMETRY_VOLTAGE)                        \
+    S(SOC_TELEMETRY_CURRENT)                        \
+    S(SOC_TELEMETRY_POWER)                          \
+    S(FCLK_FREQ)                                    \
+    S(FCLK_FREQ_EFF)                                \
+    S(UCLK_FREQ)                                    \
+    S(UCLK_FREQ_EFF)                                \
+    S(MEMCLK_FREQ)                                  \
+    S(MEMCLK_FREQ_EFF)                              \
+    S(FCLK_DRAM_SETPOINT)                           \
+    S(FCLK_DRAM_BUSY)                               \
+    S(FCLK_GMI_SETPOINT)                            \
+    S(FCLK_GMI_BUSY)                                \
+    S(FCLK_IOHC_SETPOINT)                           \
+    S(FCLK_IOHC_BUSY)                               \
+    S(FCLK_MEM_LATENCY_SETPOINT)                    \
+    S(FCLK_MEM_LATENCY)                             \
+    S(FCLK_CCLK_SETPOINT)                           \
+    S(FCLK_CCLK_FREQ)                               \
+    S(FCLK_XGMI_SETPOINT)                           \
+    S(FCLK_XGMI_BUSY)                               \
+    S(FCLK_GFX_SETPOINT)                            \
+    S(FCLK_GFX_BUSY)                                \
+    S(CCM_READS)                                    \
+    S(CCM_WRITES)                                   \
+    S(IOMS)                                         \
+    S(XGMI)                                         \
+    S(CS_UMC_READS)                                 \
+    S(CS_UMC_WRITES)                                \
+    A(FCLK_RESIDENCY, 4)                            \
+    A(FCLK_FREQ_TABLE, 4)                           \
+    A(UCLK_FREQ_TABLE, 4)                           \
+    A(MEMCLK_FREQ_TABLE, 4)                         \
+    A(FCLK_VOLTAGE, 4)                              \
+    A(LCLK_SETPOINT, 4)                             \
+    A(LCLK_BUSY, 4)                                 \
+    A(LCLK_FREQ, 4)                                 \
+    A(LCLK_FREQ_EFF, 4)                             \
+    A(LCLK_MAX_DPM, 4)                              \
+    A(LCLK_MIN_DPM, 4)                              \
+    A(SOCCLK_FREQ_EFF, 4)                           \
+    A(SHUBCLK_FREQ_EFF, 4)                          \
+    S(XGMI_SETPOINT)                                \
+    S(XGMI_BUSY)                                    \
+    S(XGMI_LANE_WIDTH)                              \
+    S(XGMI_DATA_RATE)                               \
+    S(SOC_POWER)                                    \
+    S(SOC_TEMP)                                     \
+    S(DDR_VDDP_POWER)                               \
+    S(DDR_VDDIO_MEM_POWER)                          \
+    S(GMI2_VDDG_POWER)                              \
+    S(IO_VDDCR_SOC_POWER)                           \
+    S(IOD_VDDIO_MEM_POWER)                          \
+    S(IO_VDD18_POWER)                               \
+    S(TDP)                                          \
+    S(DETERMINISM)                                  \
+    S(V_VDDM)                                       \
+    S(V_VDDP)                                       \
+    S(V_VDDG)                                       \
+    S(V_VDDG_IOD)                                   \
+    S(V_VDDG_CCD)                                   \
+    S(PEAK_TEMP)                                    \
+    S(PEAK_VOLTAGE)                                 \
+    S(PEAK_CCLK_FREQ)                               \
+    S(unk_power)                                    \
+    S(AVG_CORE_COUNT)                               \
+    S(CCLK_LIMIT)                                   \
+    S(MAX_SOC_VOLTAGE)                              \
+    S(DVO_VOLTAGE)                                  \
+    S(APML_POWER)                                   \
+    S(CPU_DC_BTC)                                   \
+    S(SOC_DC_BTC)                                   \
+    S(DC_BTC)                                       \
+    S(PACKAGE_POWER)                                \
+    S(CSTATE_BOOST)                                 \
+    S(PROCHOT)                                      \
+    S(PC6)                                          \
+    S(SELF_REFRESH)                                 \
+    S(PWM)                                          \
+    S(SOCCLK)                                       \
+    S(SHUBCLK)                                      \
+    S(SMNCLK)                                       \
+    S(SMNCLK_EFF)                                   \
+    S(MP0CLK)                                       \
+    S(MP0CLK_EFF)                                   \
+    S(MP1CLK)                                       \
+    S(MP1CLK_EFF)                                   \
+    S(MP2CLK)                                       \
+    S(MP2CLK_EFF)                                   \
+    S(MP5CLK)                                       \
+    S(TWIXCLK)                                      \
+    S(WAFLCLK)                                      \
+    S(DPM_BUSY)                                     \
+    S(MP1_BUSY)                                     \
+    S(DPM_Skipped)                                  \
+    S(CORE_SETPOINT)                                \
+    S(CORE_BUSY)                                    \
+    A(CORE_POWER, PMT_MAX_NUM_CORES)                \
+    A(CORE_VOLTAGE, PMT_MAX_NUM_CORES)              \
+    A(CORE_TEMP, PMT_MAX_NUM_CORES)                 \
+    A(CORE_FIT, PMT_MAX_NUM_CORES)                  \
+    A(CORE_IDDMAX, PMT_MAX_NUM_CORES)               \
+    A(CORE_FREQ, PMT_MAX_NUM_CORES)                 \
+    A(CORE_FREQEFF, PMT_MAX_NUM_CORES)              \
+    A(CORE_C0, PMT_MAX_NUM_CORES)                   \
+    A(CORE_CC1, PMT_MAX_NUM_CORES)                  \
+    A(CORE_CC6, PMT_MAX_NUM_CORES)                  \
+    A(CORE_CKS_FDD, PMT_MAX_NUM_CORES)              \
+    A(CORE_CI_FDD, PMT_MAX_NUM_CORES)               \
+    A(CORE_IRM, PMT_MAX_NUM_CORES)                  \
+    A(CORE_PSTATE, PMT_MAX_NUM_CORES)               \
+    A(CORE_FREQ_LIM_MAX, PMT_MAX_NUM_CORES)         \
+    A(CORE_FREQ_LIM_MIN, PMT_MAX_NUM_CORES)         \
+    A(CORE_CPPC_MAX, PMT_MAX_NUM_CORES)             \
+    A(CORE_CPPC_MIN, PMT_MAX_NUM_CORES)             \
+    A(CORE_CPPC_EPP, PMT_MAX_NUM_CORES)             \
+    A(CORE_unk, PMT_MAX_NUM_CORES)                  \
+    A(CORE_SC_LIMIT, PMT_MAX_NUM_CORES)             \
+    A(CORE_SC_CAC, PMT_MAX_NUM_CORES)               \
+    A(CORE_SC_RESIDENCY, PMT_MAX_NUM_CORES)         \
+    A(CORE_UOPS_CLK, PMT_MAX_NUM_CORES)             \
+    A(CORE_UOPS, PMT_MAX_NUM_CORES)                 \
+    A(CORE_MEM_LATECY, PMT_MAX_NUM_CORES)           \
+    A(L3_LOGIC_POWER, PMT_MAX_NUM_L3)               \
+    A(L3_VDDM_POWER, PMT_MAX_NUM_L3)                \
+    A(L3_TEMP, PMT_MAX_NUM_L3)                      \
+    A(L3_FIT, PMT_MAX_NUM_L3)                       \
+    A(L3_IDDMAX, PMT_MAX_NUM_L3)                    \
+    A(L3_FREQ, PMT_MAX_NUM_L3)                      \
+    A(L3_FREQ_EFF, PMT_MAX_NUM_L3)                  \
+    A(L3_CKS_FDD, PMT_MAX_NUM_L3)                   \
+    A(L3_CCA_THRESHOLD, PMT_MAX_NUM_L3)             \
+    A(L3_CCA_CAC, PMT_MAX_NUM_L3)                   \
+    A(L3_CCA_ACTIVATION, PMT_MAX_NUM_L3)            \
+    A(L3_EDC_LIMIT, PMT_MAX_NUM_L3)                 \
+    A(L3_EDC_CAC, PMT_MAX_NUM_L3)                   \
+    A(L3_EDC_RESIDENCY, PMT_MAX_NUM_L3)             \
+    A(L3_FLL_BTC, PMT_MAX_NUM_L3)                   \
+                                                    \
+    /* MP5_BUSY seems to be always at the end of the table */\
+    /* It can be an array from 1 up to 4 values */  \
+    /* What is currently assigned to MP5_BUSY seems to be called DPM_Skipped */\
+    A(MP5_BUSY, PMT_MAX_NUM_L3)                     \
+                                                    \
+    S(GFX_GLOB_FREQUENCY)                           \
+    S(GFX_STAPM_FREQUENCY)                          \
+    S(GFX_PPT_FREQUENCY_FAST)                       \
+    S(GFX_PPT_FREQUENCY)                            \
+    S(GFX_PPT_FREQUENCY_APU)                        \
+    S(GFX_TDC_FREQUENCY)                            \
+    S(GFX_THM_FREQUENCY)                            \
+    S(GFX_HTFMAX_FREQUENCY)                         \
+    S(GFX_PROCHOT_FREQUENCY)                        \
+    S(GFX_VOLTAGE_FREQUENCY)                        \
+    S(GFX_CCA_FREQUENCY)                            \
+    S(GFX_DEM_FREQUENCY)                            \
+    S(GFX_VOLTAGE)                                  \
+    S(GFX_TEMP)                                     \
+    S(GFX_IDDMAX)                                   \
+    S(GFX_FREQ)                                     \
+    S(GFX_FREQEFF)                                  \
+    S(GFX_SETPOINT)                                 \
+    S(GFX_BUSY)                                     \
+    S(GFX_CGPG)                                     \
+    S(GFX_EDC_LIM)                                  \
+    S(GFX_EDC_RESIDENCY)                            \
+    S(GFX_DEM_RESIDENCY)                            \
+                                                    \
+    S(DF_BUSY)                                      \
+    S(IOHC_BUSY)                                    \
+    S(MMHUB_BUSY)                                   \
+    S(ATHUB_BUSY)                                   \
+    S(OSSSYS_BUSY)                                  \
+    S(HDP_BUSY)                                     \
+    S(SDMA_BUSY)                                    \
+    S(SHUB_BUSY)                                    \
+    S(BIF_BUSY)                                     \
+    S(ACP_BUSY)                                     \
+    S(SST0_BUSY)                                    \
+    S(SST1_BUSY)                                    \
+    S(USB0_BUSY)                                    \
+    S(USB1_BUSY)                                    \
+    S(GCM_64B_READS)                                \
+    S(GCM_64B_WRITES)                               \
+    S(GCM_32B_READS_WRITES)                         \
+    S(MMHUB_READS)                                  \
+    S(MMHUB_WRITES)                                 \
+    S(DCE_READS)                                    \
+    S(IO_READS_WRITES)                              \
+    S(MAX_DRAM_BANDWIDTH)                           \
+    S(VCN_BUSY)                                     \
+    S(VCN_DECODE)                                   \
+    S(VCN_ENCODE_GEN)                               \
+    S(VCN_ENCODE_LOW)                               \
+    S(VCN_ENCODE_REAL)                              \
+    S(VCN_PG)                                       \
+    S(VCN_JPEG)                                     \
+                                                    \
+    S(VCLK_FREQ)                                    \
+    S(VCLK_FREQ_EFF)                                \
+    S(DCLK_FREQ)                                    \
+    S(DCLK_FREQ_EFF)                                \
+    S(DCF_FREQ)                                     \
+    S(DCF_FREQ_EFF)                                 \
+    A(VCLK_STATE, PMT_MAX_NUM_CLKS)                 \
+    A(DCLK_STATE, PMT_MAX_NUM_CLKS)                 \
+    A(SOCCLK_STATE, PMT_MAX_NUM_CLKS)               \
+    A(LCLK_STATE, PMT_MAX_NUM_CLKS)                 \
+    A(SHUB_STATE, PMT_MAX_NUM_CLKS)                 \
+    A(MP0_STATE, PMT_MAX_NUM_CLKS)                  \
+    A(DCFCLK_STATE, PMT_MAX_NUM_CLKS)               \
+    A(VCN_STATE_RESIDENCY, PMT_MAX_NUM_CLKS)        \
+    A(SOCCLK_STATE_RESIDENCY, PMT_MAX_NUM_CLKS)     \
+    A(LCLK_STATE_RESIDENCY, PMT_MAX_NUM_CLKS)       \
+    A(SHUB_STATE_RESIDENCY, PMT_MAX_NUM_CLKS)       \
+    A(MP0CLK_STATE_RESIDENCY, PMT_MAX_NUM_CLKS)     \
+    A(DCFCLK_STATE_RESIDENCY, PMT_MAX_NUM_CLKS)     \
+    A(VDDCR_SOC_VOLTAGE, PMT_MAX_NUM_CLKS)          \
+    S(CPUOFF)                                       \
+    S(CPUOFF_CNT)                                   \
+    S(GFXOFF)                                       \
+    S(GFXOFF_CNT)                                   \
+    S(VDDOFF)                                       \
+    S(VDDOFF_CNT)                                   \
+    S(ULV)                                          \
+    S(ULV_CNT)                                      \
+    S(ULV_VOLTAGE)                                  \
+    S(S0i2)                                         \
+    S(S0i2_CNT)                                     \
+    S(WHISPER)                                      \
+    S(WHISPER_CNT)                                  \
+    S(SELFREFRESH0)                                 \
+    S(SELFREFRESH1)                                 \
+    S(PLL_POWERDOWN_0)                              \
+    S(PLL_POWERDOWN_1)                              \
+    S(PLL_POWERDOWN_2)                              \
+    S(PLL_POWERDOWN_3)                              \
+    S(PLL_POWERDOWN_4)                              \
+                                                    \
+    S(DGPU_POWER)                                   \
+    S(DGPU_GFX_BUSY)                                \
+    S(DGPU_FREQ_TARGET)                             \
+    S(DISPLAY_COUNT)                                \
+    S(FPS)                                          \
+                                                    \
+    S(IO_DISPLAY_POWER)                             \
+    S(IO_USB_POWER)                                 \
+    S(DDR_PHY_POWER)                                \
+    S(MAX_CORE_VOLTAGE)                             \
+                                                    \
+    S(StapmTimeConstant)                            \
+    S(SlowPPTTimeConstant)                          \
+    S(ACLK)                                         \
+    S(DISPCLK)                                      \
+    S(DPREFCLK)                                     \
+    S(DPPCLK)                                       \
+    S(SMU_BUSY)                                     \
+    S(SMU_SKIP_COUNTER)
+
+#define PMT_DECLARE_S(name)    float *name;
+#define PMT_DECLARE_A(name, n) float *name[n];
+#define PMT_ENUM_S(name)       PMT_ID_##name,
+#define PMT_ENUM_A(name, n)    PMT_ID_##name, PMT_ID_##name##_LAST = PMT_ID_##name + (n) - 1,
+
+//Metric ids. Array fields occupy n consecutive ids, e.g. PMT_ID_CORE_TEMP + 3.
+enum {
+    PMT_FIELDS(PMT_ENUM_S, PMT_ENUM_A)
+    PMT_METRIC_COUNT
+};
+
 typedef struct {
     unsigned int version;  //PM table version
     int max_cores;         //Number of cores supported by the PM table
@@ -34,337 +382,12 @@ typedef struct {
     int powersum_unclear;  //1 = No idea how to calculate the total power
     int has_graphics;      //1 = Has internal graphics
 
-    float *STAPM_LIMIT;
-    float *STAPM_VALUE;
-    float *PPT_LIMIT;
-    float *PPT_VALUE;
-    float *PPT_LIMIT_FAST;
-    float *PPT_VALUE_FAST;
-    float *PPT_LIMIT_APU;
-    float *PPT_VALUE_APU;
-    float *TDC_LIMIT;
-    float *TDC_VALUE;
-    float *TDC_LIMIT_SOC;
-    float *TDC_VALUE_SOC;
-    float *THM_LIMIT;
-    float *THM_VALUE;
-    float *THM_LIMIT_SOC;
-    float *THM_VALUE_SOC;
-    float *THM_LIMIT_GFX;
-    float *THM_VALUE_GFX;
-    float *STT_LIMIT_APU;
-    float *STT_VALUE_APU;
-    float *STT_LIMIT_DGPU;
-    float *STT_VALUE_DGPU;
-    float *FIT_LIMIT;
-    float *FIT_VALUE;
-    float *EDC_LIMIT;
-    float *EDC_VALUE;
-    float *EDC_LIMIT_SOC;
-    float *EDC_VALUE_SOC;
-    float *VID_LIMIT;
-    float *VID_VALUE;
-    float *PSI0_LIMIT_VDD;
-    float *PSI0_RESIDENCY_VDD;
-    float *PSI0_LIMIT_SOC;
-    float *PSI0_RESIDENCY_SOC;
-    float *PPT_WC;
-    float *PPT_ACTUAL;
-    float *TDC_WC;
-    float *TDC_ACTUAL;
-    float *THM_WC;
-    float *THM_ACTUAL;
-    float *FIT_WC;
-    float *FIT_ACTUAL;
-    float *EDC_WC;
-    float *EDC_ACTUAL;
-    float *VID_WC;
-    float *VID_ACTUAL;
-    float *VDDCR_CPU_POWER;
-    float *VDDCR_SOC_POWER;
-    float *VDDIO_MEM_POWER;
-    float *VDD18_POWER;
-    float *ROC_POWER;
-    float *SOCKET_POWER;
-    float *CCLK_GLOBAL_FREQ;
-    float *GLOB_FREQUENCY;
-    float *STAPM_FREQUENCY;
-    float *PPT_FREQUENCY;
-    float *PPT_FREQUENCY_FAST;
-    float *PPT_FREQUENCY_APU;
-    float *TDC_FREQUENCY;
-    float *THM_FREQUENCY;
-    float *HTFMAX_FREQUENCY;
-    float *PROCHOT_FREQUENCY;
-    float *VOLTAGE_FREQUENCY;
-    float *CCA_FREQUENCY;
-    float *FIT_VOLTAGE;
-    float *FIT_PRE_VOLTAGE;
-    float *LATCHUP_VOLTAGE;
-    float *CPU_SET_VOLTAGE;
-    float *CPU_TELEMETRY_VOLTAGE;
-    float *CPU_TELEMETRY_VOLTAGE2; 
-    float *CPU_TELEMETRY_CURRENT;
-    float *CPU_TELEMETRY_POWER;
-    float *SOC_SET_VOLTAGE;
-    float *SOC_TELEMETRY_VOLTAGE;
-    float *SOC_TELEMETRY_CURRENT;
-    float *SOC_TELEMETRY_POWER;
-    float *FCLK_FREQ;
-    float *FCLK_FREQ_EFF;
-    float *UCLK_FREQ;
-    float *UCLK_FREQ_EFF;
-    float *MEMCLK_FREQ;
-    float *MEMCLK_FREQ_EFF;
-    float *FCLK_DRAM_SETPOINT;
-    float *FCLK_DRAM_BUSY;
-    float *FCLK_GMI_SETPOINT;
-    float *FCLK_GMI_BUSY;
-    float *FCLK_IOHC_SETPOINT;
-    float *FCLK_IOHC_BUSY;
-    float *FCLK_MEM_LATENCY_SETPOINT;
-    float *FCLK_MEM_LATENCY;
-    float *FCLK_CCLK_SETPOINT;
-    float *FCLK_CCLK_FREQ;
-    float *FCLK_XGMI_SETPOINT;
-    float *FCLK_XGMI_BUSY;
-    float *FCLK_GFX_SETPOINT;
-    float *FCLK_GFX_BUSY;
-    float *CCM_READS;
-    float *CCM_WRITES;
-    float *IOMS;
-    float *XGMI;
-    float *CS_UMC_READS;
-    float *CS_UMC_WRITES;
-    float *FCLK_RESIDENCY[4];
-    float *FCLK_FREQ_TABLE[4];
-    float *UCLK_FREQ_TABLE[4];
-    float *MEMCLK_FREQ_TABLE[4];
-    float *FCLK_VOLTAGE[4];
-    float *LCLK_SETPOINT[4];
-    float *LCLK_BUSY[4];
-    float *LCLK_FREQ[4];
-    float *LCLK_FREQ_EFF[4];
-    float *LCLK_MAX_DPM[4];
-    float *LCLK_MIN_DPM[4];
-    float *SOCCLK_FREQ_EFF[4];
-    float *SHUBCLK_FREQ_EFF[4];
-    float *XGMI_SETPOINT;
-    float *XGMI_BUSY;
-    float *XGMI_LANE_WIDTH;
-    float *XGMI_DATA_RATE;
-    float *SOC_POWER;
-    float *SOC_TEMP;
-    float *DDR_VDDP_POWER;
-    float *DDR_VDDIO_MEM_POWER;
-    float *GMI2_VDDG_POWER;
-    float *IO_VDDCR_SOC_POWER;
-    float *IOD_VDDIO_MEM_POWER;
-    float *IO_VDD18_POWER; 
-    float *TDP;
-    float *DETERMINISM;
-    float *V_VDDM;
-    float *V_VDDP;
-    float *V_VDDG;
-    float *V_VDDG_IOD;
-    float *V_VDDG_CCD;
-    float *PEAK_TEMP;
-    float *PEAK_VOLTAGE;
-    float *PEAK_CCLK_FREQ;
-    float *unk_power;
-    float *AVG_CORE_COUNT;
-    float *CCLK_LIMIT;
-    float *MAX_SOC_VOLTAGE;
-    float *DVO_VOLTAGE;
-    float *APML_POWER;
-    float *CPU_DC_BTC;
-    float *SOC_DC_BTC;
-    float *DC_BTC;
-    float *PACKAGE_POWER;
-    float *CSTATE_BOOST;
-    float *PROCHOT;
-    float *PC6;
-    float *SELF_REFRESH;
-    float *PWM;
-    float *SOCCLK;
-    float *SHUBCLK;
-    float *SMNCLK;
-    float *SMNCLK_EFF;
-    float *MP0CLK;
-    float *MP0CLK_EFF;
-    float *MP1CLK;
-    float *MP1CLK_EFF;
-    float *MP2CLK;
-    float *MP2CLK_EFF;
-    float *MP5CLK;
-    float *TWIXCLK;
-    float *WAFLCLK;
-    float *DPM_BUSY;
-    float *MP1_BUSY;
-    float *DPM_Skipped;
-    float *CORE_SETPOINT;
-    float *CORE_BUSY;
-    float *CORE_POWER[PMT_MAX_NUM_CORES];
-    float *CORE_VOLTAGE[PMT_MAX_NUM_CORES];
-    float *CORE_TEMP[PMT_MAX_NUM_CORES];
-    float *CORE_FIT[PMT_MAX_NUM_CORES];
-    float *CORE_IDDMAX[PMT_MAX_NUM_CORES];
-    float *CORE_FREQ[PMT_MAX_NUM_CORES];
-    float *CORE_FREQEFF[PMT_MAX_NUM_CORES];
-    float *CORE_C0[PMT_MAX_NUM_CORES];
-    float *CORE_CC1[PMT_MAX_NUM_CORES];
-    float *CORE_CC6[PMT_MAX_NUM_CORES];
-    float *CORE_CKS_FDD[PMT_MAX_NUM_CORES];
-    float *CORE_CI_FDD[PMT_MAX_NUM_CORES];
-    float *CORE_IRM[PMT_MAX_NUM_CORES];
-    float *CORE_PSTATE[PMT_MAX_NUM_CORES];
-    float *CORE_FREQ_LIM_MAX[PMT_MAX_NUM_CORES];
-    float *CORE_FREQ_LIM_MIN[PMT_MAX_NUM_CORES];
-    float *CORE_CPPC_MAX[PMT_MAX_NUM_CORES];
-    float *CORE_CPPC_MIN[PMT_MAX_NUM_CORES];
-    float *CORE_CPPC_EPP[PMT_MAX_NUM_CORES];
-    float *CORE_unk[PMT_MAX_NUM_CORES];
-    float *CORE_SC_LIMIT[PMT_MAX_NUM_CORES];
-    float *CORE_SC_CAC[PMT_MAX_NUM_CORES];
-    float *CORE_SC_RESIDENCY[PMT_MAX_NUM_CORES];
-    float *CORE_UOPS_CLK[PMT_MAX_NUM_CORES];
-    float *CORE_UOPS[PMT_MAX_NUM_CORES];
-    float *CORE_MEM_LATECY[PMT_MAX_NUM_CORES];
-    float *L3_LOGIC_POWER[PMT_MAX_NUM_L3];
-    float *L3_VDDM_POWER[PMT_MAX_NUM_L3];
-    float *L3_TEMP[PMT_MAX_NUM_L3];
-    float *L3_FIT[PMT_MAX_NUM_L3];
-    float *L3_IDDMAX[PMT_MAX_NUM_L3];
-    float *L3_FREQ[PMT_MAX_NUM_L3];
-    float *L3_FREQ_EFF[PMT_MAX_NUM_L3];
-    float *L3_CKS_FDD[PMT_MAX_NUM_L3];
-    float *L3_CCA_THRESHOLD[PMT_MAX_NUM_L3];
-    float *L3_CCA_CAC[PMT_MAX_NUM_L3];
-    float *L3_CCA_ACTIVATION[PMT_MAX_NUM_L3];
-    float *L3_EDC_LIMIT[PMT_MAX_NUM_L3];
-    float *L3_EDC_CAC[PMT_MAX_NUM_L3];
-    float *L3_EDC_RESIDENCY[PMT_MAX_NUM_L3];
-    float *L3_FLL_BTC[PMT_MAX_NUM_L3];
-  
-    // MP5_BUSY seems to be always at the end of the table
-    // It can be an array from 1 up to 4 values
-    // What is currently assigned to MP5_BUSY seems to be called DPM_Skipped
-    float *MP5_BUSY[PMT_MAX_NUM_L3];
-
-    float *GFX_GLOB_FREQUENCY;
-    float *GFX_STAPM_FREQUENCY;
-    float *GFX_PPT_FREQUENCY_FAST;
-    float *GFX_PPT_FREQUENCY;
-    float *GFX_PPT_FREQUENCY_APU;
-    float *GFX_TDC_FREQUENCY;
-    float *GFX_THM_FREQUENCY;
-    float *GFX_HTFMAX_FREQUENCY;
-    float *GFX_PROCHOT_FREQUENCY;
-    float *GFX_VOLTAGE_FREQUENCY;
-    float *GFX_CCA_FREQUENCY;
-    float *GFX_DEM_FREQUENCY;
-    float *GFX_VOLTAGE;
-    float *GFX_TEMP;
-    float *GFX_IDDMAX;
-    float *GFX_FREQ;
-    float *GFX_FREQEFF;
-    float *GFX_SETPOINT;
-    float *GFX_BUSY;
-    float *GFX_CGPG;
-    float *GFX_EDC_LIM;
-    float *GFX_EDC_RESIDENCY;
-    float *GFX_DEM_RESIDENCY;
-
-    float *DF_BUSY;
-    float *IOHC_BUSY;
-    float *MMHUB_BUSY;
-    float *ATHUB_BUSY;
-    float *OSSSYS_BUSY;
-    float *HDP_BUSY;
-    float *SDMA_BUSY;
-    float *SHUB_BUSY;
-    float *BIF_BUSY;
-    float *ACP_BUSY;
-    float *SST0_BUSY;
-    float *SST1_BUSY;
-    float *USB0_BUSY;
-    float *USB1_BUSY;
-    float *GCM_64B_READS;
-    float *GCM_64B_WRITES;
-    float *GCM_32B_READS_WRITES;
-    float *MMHUB_READS;
-    float *MMHUB_WRITES;
-    float *DCE_READS;
-    float *IO_READS_WRITES;
-    float *MAX_DRAM_BANDWIDTH;
-    float *VCN_BUSY;
-    float *VCN_DECODE;
-    float *VCN_ENCODE_GEN;
-    float *VCN_ENCODE_LOW;
-    float *VCN_ENCODE_REAL;
-    float *VCN_PG;
-    float *VCN_JPEG;
-
-    float *VCLK_FREQ;
-    float *VCLK_FREQ_EFF;
-    float *DCLK_FREQ;
-    float *DCLK_FREQ_EFF;
-    float *DCF_FREQ;
-    float *DCF_FREQ_EFF;
-    float *VCLK_STATE[PMT_MAX_NUM_CLKS];
-    float *DCLK_STATE[PMT_MAX_NUM_CLKS];
-    float *SOCCLK_STATE[PMT_MAX_NUM_CLKS];
-    float *LCLK_STATE[PMT_MAX_NUM_CLKS];
-    float *SHUB_STATE[PMT_MAX_NUM_CLKS];
-    float *MP0_STATE[PMT_MAX_NUM_CLKS];
-    float *DCFCLK_STATE[PMT_MAX_NUM_CLKS];
-    float *VCN_STATE_RESIDENCY[PMT_MAX_NUM_CLKS];
-    float *SOCCLK_STATE_RESIDENCY[PMT_MAX_NUM_CLKS];
-    float *LCLK_STATE_RESIDENCY[PMT_MAX_NUM_CLKS];
-    float *SHUB_STATE_RESIDENCY[PMT_MAX_NUM_CLKS];
-    float *MP0CLK_STATE_RESIDENCY[PMT_MAX_NUM_CLKS];
-    float *DCFCLK_STATE_RESIDENCY[PMT_MAX_NUM_CLKS];
-    float *VDDCR_SOC_VOLTAGE[PMT_MAX_NUM_CLKS];
-    float *CPUOFF;
-    float *CPUOFF_CNT;
-    float *GFXOFF;
-    float *GFXOFF_CNT;
-    float *VDDOFF;
-    float *VDDOFF_CNT;
-    float *ULV;
-    float *ULV_CNT;
-    float *ULV_VOLTAGE;
-    float *S0i2;
-    float *S0i2_CNT;
-    float *WHISPER;
-    float *WHISPER_CNT;
-    float *SELFREFRESH0;
-    float *SELFREFRESH1;
-    float *PLL_POWERDOWN_0;
-    float *PLL_POWERDOWN_1;
-    float *PLL_POWERDOWN_2;
-    float *PLL_POWERDOWN_3;
-    float *PLL_POWERDOWN_4;
-
-    float *DGPU_POWER;
-    float *DGPU_GFX_BUSY;
-    float *DGPU_FREQ_TARGET;
-    float *DISPLAY_COUNT;
-    float *FPS;
-
-    float *IO_DISPLAY_POWER;
-    float *IO_USB_POWER;
-    float *DDR_PHY_POWER;
-    float *MAX_CORE_VOLTAGE;
-
-    float *StapmTimeConstant;
-    float *SlowPPTTimeConstant;
-    float *ACLK;
-    float *DISPCLK;
-    float *DPREFCLK;
-    float *DPPCLK;
-    float *SMU_BUSY;
-    float *SMU_SKIP_COUNTER;
+    union {
+        struct {
+            PMT_FIELDS(PMT_DECLARE_S, PMT_DECLARE_A)
+        };
+        float *metric[PMT_METRIC_COUNT]; //All fields above, indexed by metric id
+    };
 } pm_table;
 
 void pm_table_0x380904(pm_table *pmt, void* base_addr); //5900X: Zen3, 16 cores, version 4
@@ -375,4 +398,12 @@ void pm_table_0x400005(pm_table *pmt, void* base_addr); //5700G: Zen3,  8 cores,
 void pm_table_0x240903(pm_table *pmt, void* base_addr); //3700X: Zen2,  8 cores, version 3
 void pm_table_0x240803(pm_table *pmt, void* base_addr); //3950X: Zen2, 16 cores, version 3
 
+//Maps pmt onto pm_buf using the layout of the given PM table version.
+//Returns 0 if the version is not supported.
+int select_pm_table_version(unsigned int version, pm_table *pmt, unsigned char *pm_buf);
+
+//Cezanne does not expose its core fuses via SMN. Derive the disabled core map
+//from a freshly read PM table instead: fused-off cores report all zeros.
+unsigned int disabled_cores_0x400005(pm_table *pmt);
+
 #endif
@@ -0,0 +1,143 @@
+/**
+ * Ryzen SMU Userspace Sensor Monitor
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <cpuid.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "pm_tables.h"
+#include "profile.h"
+
+#define PROFILE_MAGIC   0x50444d52  //"RMDP"
+#define PROFILE_FORMAT  1
+
+typedef struct {
+    unsigned int magic;
+    unsigned int format;
+
+    //Key, also part of the file name
+    char path[SMU_MAX_PATH_LEN];
+    unsigned int cpu_signature;
+    unsigned int smu_version;
+    unsigned int driver_version;
+    unsigned int pm_table_version;
+
+    char cpu_name[64];
+    unsigned int cores;
+    unsigned int ccds;
+    unsigned int ccxs;
+    unsigned int cores_per_ccx;
+    unsigned int core_disable_map;
+    unsigned int core_disable_map_pmt;
+    unsigned int enabled_cores_count;
+} profile_file;
+
+static void profile_key(smu_obj_t *obj, unsigned int pm_table_version, profile_file *p) {
+    unsigned int eax = 0, ebx, ecx, edx;
+
+    memset(p, 0, sizeof(*p));
+    p->magic = PROFILE_MAGIC;
+    p->format = PROFILE_FORMAT;
+    snprintf(p->path, sizeof(p->path), "%s", obj->path);
+    __get_cpuid(0x00000001, &eax, &ebx, &ecx, &edx);
+    p->cpu_signature = eax;
+    p->smu_version = obj->smu_version;
+    p->driver_version = obj->driver_version;
+    p->pm_table_version = pm_table_version;
+}
+
+//<instance>-<cpuid>-<smu fw>-<driver>-<pm table>, e.g. ryzen_smu_drv-00a20f10-...
+static void profile_path(const profile_file *p, char *out, size_t size) {
+    char instance[SMU_MAX_PATH_LEN], *name;
+    size_t len;
+
+    snprintf(instance, sizeof(instance), "%s", p->path);
+    len = strlen(instance);
+    while (len && instance[len - 1] == '/') instance[--len] = 0;
+    name = strrchr(instance, '/');
+    name = name ? name + 1 : instance;
+
+    snprintf(out, size, PROFILE_DIR "/%s-%08x-%08x-%08x-%06x", name, p->cpu_signature,
+             p->smu_version, p->driver_version, p->pm_table_version);
+}
+
+int profile_load(smu_obj_t *obj, unsigned int pm_table_version, system_info *sysinfo,
+                 char *cpu_name, size_t size) {
+    profile_file key, p;
+    char path[SMU_MAX_PATH_LEN + 64];
+    ssize_t n;
+    int fd;
+
+    profile_key(obj, pm_table_version, &key);
+    profile_path(&key, path, sizeof(path));
+
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return 0;
+    n = read(fd, &p, sizeof(p));
+    close(fd);
+
+    //Everything up to the cached data has to match, then the data has to be sane
+    if (n != sizeof(p) || memcmp(&p, &key, offsetof(profile_file, cpu_name)) ||
+        memchr(p.cpu_name, 0, sizeof(p.cpu_name)) == NULL ||
+        p.enabled_cores_count > PMT_MAX_NUM_CORES || p.cores > 2 * PMT_MAX_NUM_CORES)
+        return 0;
+
+    snprintf(cpu_name, size, "%s", p.cpu_name);
+    sysinfo->cpu_name = cpu_name;
+    sysinfo->cores = p.cores;
+    sysinfo->ccds = p.ccds;
+    sysinfo->ccxs = p.ccxs;
+    sysinfo->cores_per_ccx = p.cores_per_ccx;
+    sysinfo->core_disable_map = p.core_disable_map;
+    sysinfo->core_disable_map_pmt = p.core_disable_map_pmt;
+    sysinfo->enabled_cores_count = p.enabled_cores_count;
+    sysinfo->available = 1;
+
+    return 1;
+}
+
+void profile_save(smu_obj_t *obj, unsigned int pm_table_version, const system_info *sysinfo) {
+    profile_file p;
+    char path[SMU_MAX_PATH_LEN + 64], tmp[SMU_MAX_PATH_LEN + 96];
+    int fd, ok;
+
+    profile_key(obj, pm_table_version, &p);
+    snprintf(p.cpu_name, sizeof(p.cpu_name), "%s", sysinfo->cpu_name ? sysinfo->cpu_name : "");
+    p.cores = sysinfo->cores;
+    p.ccds = sysinfo->ccds;
+    p.ccxs = sysinfo->ccxs;
+    p.cores_per_ccx = sysinfo->cores_per_ccx;
+    p.core_disable_map = sysinfo->core_disable_map;
+    p.core_disable_map_pmt = sysinfo->core_disable_map_pmt;
+    p.enabled_cores_count = sysinfo->enabled_cores_count;
+
+    profile_path(&p, path, sizeof(path));
+    snprintf(tmp, sizeof(tmp), "%s.%d", path, (int)getpid());
+
+    mkdir(PROFILE_DIR, 0755);
+    fd = open(tmp, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if (fd < 0) return;
+    ok = write(fd, &p, sizeof(p)) == sizeof(p);
+    close(fd);
+
+    //Readers see either no profile or a complete one
+    if (!ok || rename(tmp, path))
+        unlink(tmp);
+}
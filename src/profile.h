@@ -0,0 +1,45 @@
+/**
+ * Ryzen SMU Userspace Sensor Monitor
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef profile_h
+#define profile_h
+
+#include <stddef.h>
+#include "lib/libsmu.h"
+#include "readinfo.h"
+
+//Cached device profiles live on the tmpfs under /run, so they are dropped on
+//every reboot: BIOS changes that disable cores or CCDs need one, and
+//firmware or driver updates change the key.
+#define PROFILE_DIR     "/run/ryzen_monitor"
+
+//Device profile: the processor name and the topology get_processor_topology()
+//resolved for a driver instance, including Cezanne's core disable map from
+//the PM table. Keyed by the driver instance, the CPUID signature, the SMU
+//firmware, the driver version and the PM table version the topology was
+//resolved for.
+
+//Fills the topology of sysinfo and the processor name from the cached
+//profile. Returns 1 on success, 0 if there is no matching profile.
+int profile_load(smu_obj_t *obj, unsigned int pm_table_version, system_info *sysinfo,
+                 char *cpu_name, size_t size);
+
+//Caches the topology of sysinfo for later starts. Best effort, e.g. it
+//silently does nothing without write access to PROFILE_DIR.
+void profile_save(smu_obj_t *obj, unsigned int pm_table_version, const system_info *sysinfo);
+
+#endif
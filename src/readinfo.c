@@ -26,10 +26,23 @@
 #include "lib/libsmu.h"
 #include "readinfo.h"
 
-extern smu_obj_t obj;
+//DRAM timing registers used by print_memory_timings(). All of them are read in one batch.
+static const unsigned int timing_regs[] = {
+    0x50050, 0x50058, 0x500D0, 0x500D4, 0x50200, 0x50204, 0x50208, 0x5020C, 0x50210,
+    0x50214, 0x50218, 0x50220, 0x50224, 0x50228, 0x50254, 0x50260, 0x50264,
+};
+#define NUM_TIMING_REGS (sizeof(timing_regs)/sizeof(timing_regs[0]))
+
+static unsigned int timing_reg(const unsigned int *values, unsigned int offs) {
+    unsigned int i;
+
+    for (i = 0; i < NUM_TIMING_REGS; i++)
+        if (timing_regs[i] == offs) return values[i];
+    return 0;
+}
 
-#define READ_SMN_V1(offs) { if (smu_read_smn_addr(&obj, offs + offset, &value1) != SMU_Return_OK) goto _READ_ERROR; }
-#define READ_SMN_V2(offs) { if (smu_read_smn_addr(&obj, offs + offset, &value2) != SMU_Return_OK) goto _READ_ERROR; }
+#define READ_SMN_V1(offs) { value1 = timing_reg(values, offs); }
+#define READ_SMN_V2(offs) { value2 = timing_reg(values, offs); }
 
 void append_u32_to_str(char* buffer, unsigned int val) {
     buffer[0] = val & 0xff;
@@ -39,9 +52,15 @@ void append_u32_to_str(char* buffer, unsigned int val) {
 }
 
 const char* get_processor_name() {
+    static char buffer[50];
+
+    return get_processor_name_r(buffer, sizeof(buffer));
+}
+
+const char* get_processor_name_r(char *out, size_t size) {
     unsigned int eax, ebx, ecx, edx;
     int i;
-    static char buffer[50] = { 0 }, *p;
+    char buffer[50] = { 0 }, *p;
 
     i=0;
     __get_cpuid(0x80000002, &eax, &ebx, &ecx, &edx);
@@ -68,7 +87,8 @@ const char* get_processor_name() {
     while(isspace(p[i]) && i>=0) p[i--]=0;
     while(*p && isspace(*p)) p++;
 
-    return p;
+    snprintf(out, size, "%s", p);
+    return out;
 }
 
 unsigned int count_set_bits(unsigned int v) {
@@ -82,10 +102,11 @@ unsigned int count_set_bits(unsigned int v) {
     return result;
 }
 
-void get_processor_topology(system_info *sysinfo, unsigned int zen_version) {
+int get_processor_topology(smu_obj_t *obj, system_info *sysinfo, unsigned int zen_version) {
     unsigned int ccds_present, ccds_down, ccd_enable_map, ccd_disable_map,
-        core_disable_map_addr, core_disable_map_tmp, logical_cores, threads_per_core,
-        fam, model, fuse1, fuse2, offs, eax, ebx, ecx, edx;
+        core_disable_map_addr, logical_cores, threads_per_core,
+        fam, model, fuse1, fuse2, offs, eax, ebx, ecx, edx, n;
+    unsigned int addrs[2], values[2];
 
     __get_cpuid(0x00000001, &eax, &ebx, &ecx, &edx);
     fam = ((eax & 0xf00) >> 8) + ((eax & 0xff00000) >> 20);
@@ -109,32 +130,27 @@ void get_processor_topology(system_info *sysinfo, unsigned int zen_version) {
         fuse2 += 0x40;
     }
 
-    if (smu_read_smn_addr(&obj, fuse1, &ccds_present) != SMU_Return_OK ||
-        smu_read_smn_addr(&obj, fuse2, &ccds_down) != SMU_Return_OK) {
-        perror("Failed to read CCD fuses");
-        exit(-1);
-    }
+    addrs[0] = fuse1;
+    addrs[1] = fuse2;
+    if (smu_read_smn_batch(obj, addrs, values, 2) != SMU_Return_OK)
+        return -1; //CCD fuses
+    ccds_present = values[0];
+    ccds_down = values[1];
 
     ccd_enable_map = (ccds_present >> 22) & 0xff;
     ccd_disable_map = ((ccds_present >> 30) & 0x3) | ((ccds_down & 0x3f) << 2);
 
     core_disable_map_addr = (0x30081800 + offs);
-    sysinfo->core_disable_map = 0;
-    if (ccd_enable_map & 0x01) {
-        if (smu_read_smn_addr(&obj, core_disable_map_addr, &core_disable_map_tmp) != SMU_Return_OK) {
-            perror("Failed to read disabled core fuse");
-            exit(-1);
-        }
-        sysinfo->core_disable_map |= core_disable_map_tmp & 0xff;
-    }
-    if (ccd_enable_map & 0x02) {
-        if (smu_read_smn_addr(&obj, core_disable_map_addr|0x2000000, &core_disable_map_tmp) != SMU_Return_OK) {
-            perror("Failed to read disabled core fuse");
-            exit(-1);
-        }
-        sysinfo->core_disable_map |= (core_disable_map_tmp & 0xff)<<8;
-    }
+    n = 0;
+    if (ccd_enable_map & 0x01) addrs[n++] = core_disable_map_addr;
+    if (ccd_enable_map & 0x02) addrs[n++] = core_disable_map_addr|0x2000000;
+    if (smu_read_smn_batch(obj, addrs, values, n) != SMU_Return_OK)
+        return -2; //Disabled core fuses
 
+    sysinfo->core_disable_map = 0;
+    n = 0;
+    if (ccd_enable_map & 0x01) sysinfo->core_disable_map |= values[n++] & 0xff;
+    if (ccd_enable_map & 0x02) sysinfo->core_disable_map |= (values[n++] & 0xff)<<8;
 
     if (!threads_per_core)
         sysinfo->cores = logical_cores;
@@ -168,15 +184,22 @@ void get_processor_topology(system_info *sysinfo, unsigned int zen_version) {
             break;
     }
     sysinfo->available=1;
+    return 0;
 }
 
-void print_memory_timings() {
+void print_memory_timings(smu_obj_t *obj) {
     const char* bool_str[2] = { "Disabled", "Enabled" };
-    unsigned int value1, value2, offset;
+    unsigned int value1, value2, offset, i;
+    unsigned int addrs[NUM_TIMING_REGS], values[NUM_TIMING_REGS];
 
-    READ_SMN_V1(0x50200);
+    //Timings are read from the second channel if the first one is not populated
+    if (smu_read_smn_addr(obj, 0x50200, &value1) != SMU_Return_OK) goto _READ_ERROR;
     offset = value1 == 0x300 ? 0x100000 : 0;
 
+    for (i = 0; i < NUM_TIMING_REGS; i++)
+        addrs[i] = timing_regs[i] + offset;
+    if (smu_read_smn_batch(obj, addrs, values, NUM_TIMING_REGS) != SMU_Return_OK) goto _READ_ERROR;
+
     READ_SMN_V1(0x50050); READ_SMN_V2(0x50058);
     fprintf(stdout, "BankGroupSwap: %s\n",
         bool_str[!(value1 == value2 && value1 == 0x87654321)]);
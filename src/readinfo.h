@@ -20,6 +20,8 @@
 #ifndef READINFO_H
 #define READINFO_H
 
+#include "lib/libsmu.h"
+
 typedef struct {
     char available;
     const char *cpu_name;
@@ -35,10 +37,14 @@ typedef struct {
     unsigned int enabled_cores_count;
 } system_info;
 
-void print_memory_timings();
-void get_processor_topology(system_info *sysinfo, unsigned int zen_version);
+//Both read the SMN address space of the given driver instance
+void print_memory_timings(smu_obj_t *obj);
+//Returns 0 on success, -1 if the CCD fuses and -2 if the core fuses could not be read
+int get_processor_topology(smu_obj_t *obj, system_info *sysinfo, unsigned int zen_version);
 unsigned int count_set_bits(unsigned int v);
 const char* get_processor_name();
+//Reentrant variant, writes into out and returns it
+const char* get_processor_name_r(char *out, size_t size);
 void append_u32_to_str(char* buffer, unsigned int val);
 
 #endif
@@ -0,0 +1,308 @@
+/**
+ * Ryzen SMU Userspace Sensor Monitor
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "recorder.h"
+
+#define REC_STDIO_BUFFER    (1 << 20)
+#define REC_MAX_RUN         0xFFFF
+
+static unsigned long long clock_ns(clockid_t clock) {
+    struct timespec ts;
+
+    clock_gettime(clock, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+void rec_header_fill(rec_header *hdr, smu_obj_t *obj, const system_info *sysinfo) {
+    memset(hdr, 0, sizeof(*hdr));
+
+    memcpy(hdr->magic, REC_MAGIC, sizeof(hdr->magic));
+    hdr->format_version = REC_FORMAT_VERSION;
+    hdr->header_size = sizeof(*hdr);
+    hdr->pm_table_version = obj->pm_table_version;
+    hdr->pm_table_size = obj->pm_table_size;
+    hdr->keyframe_interval = REC_KEYFRAME_INTERVAL;
+
+    hdr->cores = sysinfo->cores;
+    hdr->ccds = sysinfo->ccds;
+    hdr->ccxs = sysinfo->ccxs;
+    hdr->cores_per_ccx = sysinfo->cores_per_ccx;
+    hdr->core_disable_map = sysinfo->core_disable_map;
+    hdr->enabled_cores_count = sysinfo->enabled_cores_count;
+    hdr->if_ver = sysinfo->if_ver;
+
+    if (sysinfo->codename) strncpy(hdr->codename, sysinfo->codename, sizeof(hdr->codename) - 1);
+    if (sysinfo->smu_fw_ver) strncpy(hdr->smu_fw_ver, sysinfo->smu_fw_ver, sizeof(hdr->smu_fw_ver) - 1);
+    if (sysinfo->cpu_name) strncpy(hdr->cpu_name, sysinfo->cpu_name, sizeof(hdr->cpu_name) - 1);
+}
+
+int recorder_open(recorder *rec, const char *file, rec_header *hdr, int compress) {
+    memset(rec, 0, sizeof(*rec));
+
+    //XOR frames work on whole words
+    if (hdr->pm_table_size % 4)
+        compress = 0;
+
+    hdr->flags = compress ? REC_FLAG_XOR : 0;
+    if (!hdr->keyframe_interval)
+        hdr->keyframe_interval = REC_KEYFRAME_INTERVAL;
+    hdr->start_realtime_ns = clock_ns(CLOCK_REALTIME);
+    hdr->start_timestamp_ns = clock_ns(CLOCK_MONOTONIC_RAW);
+
+    rec->table_size = hdr->pm_table_size;
+    rec->flags = hdr->flags;
+    rec->keyframe_interval = hdr->keyframe_interval;
+
+    if (compress) {
+        //The encoder gives up before exceeding the size of a raw frame
+        rec->prev = calloc(rec->table_size, 1);
+        rec->scratch = malloc(rec->table_size);
+        if (!rec->prev || !rec->scratch)
+            goto _ERROR;
+    }
+
+    rec->fd = fopen(file, "wb");
+    if (!rec->fd)
+        goto _ERROR;
+    setvbuf(rec->fd, NULL, _IOFBF, REC_STDIO_BUFFER);
+
+    if (fwrite(hdr, sizeof(*hdr), 1, rec->fd) != 1)
+        goto _ERROR;
+    rec->bytes = sizeof(*hdr);
+
+    return 0;
+
+_ERROR:
+    if (rec->fd) fclose(rec->fd);
+    free(rec->prev);
+    free(rec->scratch);
+    memset(rec, 0, sizeof(*rec));
+    return -1;
+}
+
+//Encodes table ^ prev as runs. Returns the payload size, or -1 if the payload
+//would not be smaller than a raw frame. An unchanged table encodes to nothing.
+static int xor_encode(const unsigned int *table, const unsigned int *prev,
+                      unsigned int words, unsigned char *out, unsigned int limit) {
+    unsigned int i = 0, len = 0;
+
+    while (i < words) {
+        unsigned int skip = 0, lit = 0;
+        unsigned short run[2];
+
+        while (i + skip < words && skip < REC_MAX_RUN && table[i + skip] == prev[i + skip])
+            skip++;
+        i += skip;
+        if (i == words)
+            break;
+        while (i + lit < words && lit < REC_MAX_RUN && table[i + lit] != prev[i + lit])
+            lit++;
+
+        if (len + sizeof(run) + lit * 4 >= limit)
+            return -1;
+
+        run[0] = skip;
+        run[1] = lit;
+        memcpy(out + len, run, sizeof(run));
+        len += sizeof(run);
+        for (unsigned int j = 0; j < lit; j++, len += 4) {
+            unsigned int x = table[i + j] ^ prev[i + j];
+            memcpy(out + len, &x, 4);
+        }
+        i += lit;
+    }
+
+    return len;
+}
+
+int recorder_append(recorder *rec, unsigned long long timestamp_ns, const unsigned char *table) {
+    rec_frame frame = { timestamp_ns, REC_FRAME_RAW, rec->table_size };
+    const unsigned char *payload = table;
+
+    if (!rec->fd)
+        return -1;
+
+    if ((rec->flags & REC_FLAG_XOR) && rec->frames && rec->since_keyframe < rec->keyframe_interval) {
+        int len = xor_encode((const unsigned int*)table, (const unsigned int*)rec->prev,
+                             rec->table_size / 4, rec->scratch, rec->table_size);
+        if (len >= 0) {
+            frame.flags = REC_FRAME_XOR;
+            frame.length = len;
+            payload = rec->scratch;
+        }
+    }
+
+    if (fwrite(&frame, sizeof(frame), 1, rec->fd) != 1 ||
+        (frame.length && fwrite(payload, frame.length, 1, rec->fd) != 1))
+        return -1;
+
+    if (rec->flags & REC_FLAG_XOR)
+        memcpy(rec->prev, table, rec->table_size);
+
+    rec->since_keyframe = frame.flags == REC_FRAME_RAW ? 1 : rec->since_keyframe + 1;
+    rec->frames++;
+    rec->bytes += sizeof(frame) + frame.length;
+    return 0;
+}
+
+int rec_frame_encode(unsigned long long timestamp_ns, const unsigned char *table,
+                     const unsigned char *prev, unsigned int table_size,
+                     unsigned char *out, unsigned int limit) {
+    rec_frame frame = { timestamp_ns, REC_FRAME_RAW, table_size };
+    int len = -1;
+
+    if (limit < sizeof(frame))
+        return -1;
+
+    if (prev && !(table_size % 4))
+        len = xor_encode((const unsigned int*)table, (const unsigned int*)prev, table_size / 4,
+                         out + sizeof(frame), limit - sizeof(frame) < table_size ?
+                         limit - sizeof(frame) : table_size);
+    if (len >= 0) {
+        frame.flags = REC_FRAME_XOR;
+        frame.length = len;
+    }
+    else {
+        if (table_size > limit - sizeof(frame))
+            return -1;
+        memcpy(out + sizeof(frame), table, table_size);
+    }
+
+    memcpy(out, &frame, sizeof(frame));
+    return sizeof(frame) + frame.length;
+}
+
+int recorder_close(recorder *rec) {
+    int ret = 0;
+
+    if (rec->fd && fclose(rec->fd))
+        ret = -1;
+    free(rec->prev);
+    free(rec->scratch);
+    rec->fd = NULL;
+    rec->prev = rec->scratch = NULL;
+    return ret;
+}
+
+int rec_reader_init(rec_reader *rd, const unsigned char *base, size_t size) {
+    memset(rd, 0, sizeof(*rd));
+    return rec_reader_reuse(rd, base, size);
+}
+
+int rec_reader_reuse(rec_reader *rd, const unsigned char *base, size_t size) {
+    rd->base = NULL;
+    rd->cur = NULL;
+
+    if (size < sizeof(rd->hdr))
+        return -1;
+    memcpy(&rd->hdr, base, sizeof(rd->hdr));
+
+    if (memcmp(rd->hdr.magic, REC_MAGIC, sizeof(rd->hdr.magic)) ||
+        rd->hdr.format_version != REC_FORMAT_VERSION ||
+        rd->hdr.header_size < sizeof(rd->hdr) || rd->hdr.header_size > size ||
+        !rd->hdr.pm_table_size || rd->hdr.pm_table_size > REC_MAX_TABLE_SIZE ||
+        rd->hdr.pm_table_size % 4)
+        return -1;
+
+    if (rd->table_cap < rd->hdr.pm_table_size) {
+        free(rd->table);
+        rd->table_cap = 0;
+        rd->table = calloc(rd->hdr.pm_table_size, 1);
+        if (!rd->table)
+            return -1;
+        rd->table_cap = rd->hdr.pm_table_size;
+    }
+
+    rd->base = base;
+    rd->size = size;
+    rd->pos = rd->hdr.header_size;
+    return 0;
+}
+
+int rec_reader_seek(rec_reader *rd, size_t pos) {
+    if (pos < rd->hdr.header_size || pos > rd->size)
+        return -1;
+
+    rd->pos = pos;
+    rd->cur = NULL;
+    return 0;
+}
+
+int rec_reader_next(rec_reader *rd, unsigned long long *timestamp_ns, const unsigned char **table) {
+    rec_frame frame;
+    const unsigned char *payload;
+    unsigned int words = rd->hdr.pm_table_size / 4, i = 0;
+    size_t len;
+
+    if (rd->pos + sizeof(frame) > rd->size)
+        return 0;
+    memcpy(&frame, rd->base + rd->pos, sizeof(frame));
+    if (frame.length > rd->size - rd->pos - sizeof(frame))
+        return 0; //Truncated by an interrupted recording
+
+    payload = rd->base + rd->pos + sizeof(frame);
+    rd->pos += sizeof(frame) + frame.length;
+    *timestamp_ns = frame.timestamp_ns;
+
+    if (frame.flags == REC_FRAME_RAW) {
+        if (frame.length != rd->hdr.pm_table_size)
+            return -1;
+        //No copy; the next XOR frame uses the trace itself as reference
+        rd->cur = *table = payload;
+        return 1;
+    }
+
+    if (frame.flags != REC_FRAME_XOR || !rd->cur)
+        return -1;
+
+    if (rd->cur != rd->table)
+        memcpy(rd->table, rd->cur, rd->hdr.pm_table_size);
+
+    for (len = 0; len + 4 <= frame.length;) {
+        unsigned short run[2];
+
+        memcpy(run, payload + len, sizeof(run));
+        len += sizeof(run);
+        i += run[0];
+        if (i + run[1] > words || len + run[1] * 4 > frame.length)
+            return -1;
+
+        for (unsigned int j = 0; j < run[1]; j++, i++, len += 4) {
+            unsigned int x, v;
+
+            memcpy(&x, payload + len, 4);
+            memcpy(&v, rd->table + i * 4, 4);
+            v ^= x;
+            memcpy(rd->table + i * 4, &v, 4);
+        }
+    }
+
+    rd->cur = *table = rd->table;
+    return 1;
+}
+
+void rec_reader_free(rec_reader *rd) {
+    free(rd->table);
+    rd->table = NULL;
+    rd->table_cap = 0;
+}
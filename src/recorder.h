@@ -0,0 +1,133 @@
+/**
+ * Ryzen SMU Userspace Sensor Monitor
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef recorder_h
+#define recorder_h
+
+#include <stdio.h>
+#include <stddef.h>
+#include "lib/libsmu.h"
+#include "readinfo.h"
+
+//Trace file layout (all values little endian):
+//  rec_header, then frames of rec_frame followed by `length` payload bytes.
+//A raw frame carries the PM Table as is. An XOR frame carries the table
+//XORed with the previous frame, as runs of 32 bit words: a u16 count of
+//unchanged words, a u16 count of literal words, then the literal words.
+//Every stream starts with a raw frame and repeats one every
+//keyframe_interval frames, so readers can start decoding at any raw frame.
+
+#define REC_MAGIC               "RZMTRACE"
+#define REC_FORMAT_VERSION      1
+#define REC_KEYFRAME_INTERVAL   128
+#define REC_MAX_TABLE_SIZE      65536   //Readers reject larger PM tables
+
+#define REC_FLAG_XOR            0x1     //Header: stream may contain XOR frames
+
+#define REC_FRAME_RAW           0x0
+#define REC_FRAME_XOR           0x1
+
+typedef struct {
+    char magic[8];
+    unsigned int format_version;
+    unsigned int header_size;
+    unsigned int pm_table_version;
+    unsigned int pm_table_size;
+    unsigned int flags;
+    unsigned int keyframe_interval;
+    unsigned int cores;
+    unsigned int ccds;
+    unsigned int ccxs;
+    unsigned int cores_per_ccx;
+    unsigned int core_disable_map;
+    unsigned int enabled_cores_count;
+    unsigned int if_ver;
+    unsigned int reserved;
+    unsigned long long start_realtime_ns;   //CLOCK_REALTIME when recording started
+    unsigned long long start_timestamp_ns;  //CLOCK_MONOTONIC_RAW at the same moment
+    char codename[32];
+    char smu_fw_ver[32];
+    char cpu_name[128];
+} rec_header;
+
+typedef struct {
+    unsigned long long timestamp_ns;        //CLOCK_MONOTONIC_RAW
+    unsigned int flags;                     //REC_FRAME_*
+    unsigned int length;                    //Payload bytes following this struct
+} rec_frame;
+
+typedef struct {
+    FILE *fd;
+    unsigned int table_size;
+    unsigned int flags;
+    unsigned int keyframe_interval;
+    unsigned int since_keyframe;
+    unsigned char *prev;        //Previous table, XOR reference
+    unsigned char *scratch;     //Encoded payload
+    unsigned long long frames;
+    unsigned long long bytes;
+} recorder;
+
+typedef struct {
+    const unsigned char *base;  //Whole trace, usually mmapped
+    size_t size;
+    size_t pos;
+    rec_header hdr;
+    unsigned char *table;       //Decoded table of the last XOR frame
+    unsigned int table_cap;     //Allocated size of table
+    const unsigned char *cur;   //Current table, in the trace or in table
+} rec_reader;
+
+//Fills a header from the driver state and an already resolved topology.
+void rec_header_fill(rec_header *hdr, smu_obj_t *obj, const system_info *sysinfo);
+
+//Creates the trace and writes the header. compress enables XOR frames.
+//Returns 0 on success.
+int recorder_open(recorder *rec, const char *file, rec_header *hdr, int compress);
+
+//Appends one table of hdr->pm_table_size bytes. Returns 0 on success.
+int recorder_append(recorder *rec, unsigned long long timestamp_ns, const unsigned char *table);
+
+//Flushes and closes the trace. Returns 0 if everything was written.
+int recorder_close(recorder *rec);
+
+//Encodes one frame, rec_frame and payload, into out for traces assembled in
+//memory. An XOR frame against prev if prev is not NULL and that is smaller,
+//a raw frame otherwise. Returns the bytes written or -1 if they exceed limit.
+int rec_frame_encode(unsigned long long timestamp_ns, const unsigned char *table,
+                     const unsigned char *prev, unsigned int table_size,
+                     unsigned char *out, unsigned int limit);
+
+//Validates the header of a trace held in memory. Returns 0 on success.
+int rec_reader_init(rec_reader *rd, const unsigned char *base, size_t size);
+
+//Same as rec_reader_init(), but keeps the table buffer of the previous
+//trace if it is large enough. For readers going through many small traces.
+int rec_reader_reuse(rec_reader *rd, const unsigned char *base, size_t size);
+
+//Continues decoding at byte offset pos, which must hold a raw frame.
+//Returns 0 on success.
+int rec_reader_seek(rec_reader *rd, size_t pos);
+
+//Decodes the next frame. *table points to the reader's table buffer for XOR
+//frames and directly into the trace for raw frames. Returns 1 for a frame,
+//0 at the end of the trace and -1 for a corrupt frame.
+int rec_reader_next(rec_reader *rd, unsigned long long *timestamp_ns, const unsigned char **table);
+
+void rec_reader_free(rec_reader *rd);
+
+#endif
@@ -0,0 +1,332 @@
+/**
+ * Ryzen SMU Userspace Sensor Monitor
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#define _GNU_SOURCE
+
+#include <math.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "replay.h"
+#include "recorder.h"
+#include "pm_layout.h"
+
+//State shared by all chunks. Read-only while the threads run.
+typedef struct {
+    const unsigned char *base;
+    size_t size;
+    pm_layout layout;
+    unsigned int num_metrics;
+    unsigned short metrics[PMT_METRIC_COUNT];   //Ids present in the layout
+    const float *min;                           //Pass 2 input, per metric
+    const float *width;                         //Pass 2 bin width, per metric
+} replay_ctx;
+
+typedef struct {
+    const replay_ctx *ctx;
+    size_t begin, end;          //Byte range, begins with a raw frame
+    int pass;
+    int corrupt;
+    unsigned long long frames;
+    unsigned long long first_ts, last_ts;
+    unsigned long long *count;  //Per metric index, not per metric id
+    double *sum;
+    float *min, *max;
+    unsigned int *hist;         //num_metrics * REPLAY_HIST_BINS
+} replay_chunk;
+
+static void *replay_chunk_main(void *arg) {
+    replay_chunk *ch = arg;
+    const replay_ctx *ctx = ch->ctx;
+    float values[PMT_METRIC_COUNT];
+    const unsigned char *table;
+    unsigned long long ts;
+    unsigned int i;
+    rec_reader rd;
+    int ret = 0;
+
+    if (rec_reader_init(&rd, ctx->base, ctx->size) || rec_reader_seek(&rd, ch->begin)) {
+        ch->corrupt = 1;
+        return NULL;
+    }
+    pm_values_reset(values);
+
+    while (rd.pos < ch->end && (ret = rec_reader_next(&rd, &ts, &table)) == 1) {
+        pm_layout_gather(&ctx->layout, table, values);
+
+        if (ch->pass == 1) {
+            if (!ch->frames) ch->first_ts = ts;
+            ch->last_ts = ts;
+            ch->frames++;
+
+            for (i = 0; i < ctx->num_metrics; i++) {
+                float v = values[ctx->metrics[i]];
+
+                if (isnan(v)) continue;
+                if (!ch->count[i] || v < ch->min[i]) ch->min[i] = v;
+                if (!ch->count[i] || v > ch->max[i]) ch->max[i] = v;
+                ch->sum[i] += v;
+                ch->count[i]++;
+            }
+        }
+        else {
+            for (i = 0; i < ctx->num_metrics; i++) {
+                float v = values[ctx->metrics[i]];
+                int bin;
+
+                if (isnan(v)) continue;
+                bin = ctx->width[i] > 0 ? (int)((v - ctx->min[i]) / ctx->width[i]) : 0;
+                if (bin < 0) bin = 0;
+                if (bin >= REPLAY_HIST_BINS) bin = REPLAY_HIST_BINS - 1;
+                ch->hist[i * REPLAY_HIST_BINS + bin]++;
+            }
+        }
+    }
+    if (ret < 0)
+        ch->corrupt = 1;
+
+    rec_reader_free(&rd);
+    return NULL;
+}
+
+static void run_pass(replay_chunk *chunks, unsigned int num_chunks, int pass) {
+    pthread_t *threads = calloc(num_chunks, sizeof(*threads));
+    unsigned char *started = calloc(num_chunks, 1);
+    unsigned int i;
+
+    for (i = 0; i < num_chunks; i++) {
+        chunks[i].pass = pass;
+        if (threads && started)
+            started[i] = pthread_create(&threads[i], NULL, replay_chunk_main, &chunks[i]) == 0;
+        //Fall back to running the chunk on this thread
+        if (!started || !started[i])
+            replay_chunk_main(&chunks[i]);
+    }
+    for (i = 0; started && i < num_chunks; i++) {
+        if (started[i]) pthread_join(threads[i], NULL);
+    }
+    free(threads);
+    free(started);
+}
+
+//Offsets of all raw frames. Only the frame headers are touched.
+static size_t *index_keyframes(const unsigned char *base, size_t size, size_t pos,
+                               unsigned int table_size, size_t *num) {
+    size_t *keys = NULL, n = 0, cap = 0;
+    rec_frame frame;
+
+    while (pos + sizeof(frame) <= size) {
+        memcpy(&frame, base + pos, sizeof(frame));
+        if (frame.length > size - pos - sizeof(frame))
+            break;
+
+        if (frame.flags == REC_FRAME_RAW && frame.length == table_size) {
+            if (n == cap) {
+                size_t *tmp = realloc(keys, (cap = cap ? cap * 2 : 1024) * sizeof(*keys));
+                if (!tmp) break;
+                keys = tmp;
+            }
+            keys[n++] = pos;
+        }
+        pos += sizeof(frame) + frame.length;
+    }
+
+    *num = n;
+    return keys;
+}
+
+static float percentile(const unsigned int *hist, unsigned long long count, float min, float width, double q) {
+    unsigned long long target = (unsigned long long)ceil(q * count), cum = 0;
+    unsigned int bin;
+
+    if (!target) target = 1;
+    for (bin = 0; bin < REPLAY_HIST_BINS; bin++) {
+        if (cum + hist[bin] >= target)
+            return min + width * (bin + (double)(target - cum) / hist[bin]);
+        cum += hist[bin];
+    }
+    return min + width * REPLAY_HIST_BINS;
+}
+
+int replay_analyze(const char *file, unsigned int version, unsigned int threads, replay_result *res) {
+    replay_ctx ctx;
+    replay_chunk *chunks = NULL;
+    rec_reader rd;
+    pm_table pmt;
+    struct stat st;
+    unsigned char *base;
+    size_t *keys = NULL, num_keys, i, k;
+    unsigned int c, m, num_chunks;
+    float *min = NULL, *width = NULL;
+    int fd, ret = -1;
+
+    memset(res, 0, sizeof(*res));
+    memset(&ctx, 0, sizeof(ctx));
+
+    fd = open(file, O_RDONLY);
+    if (fd < 0) return -1;
+    if (fstat(fd, &st) || !st.st_size) {
+        close(fd);
+        return -1;
+    }
+    base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) return -1;
+    madvise(base, st.st_size, MADV_SEQUENTIAL);
+
+    if (rec_reader_init(&rd, base, st.st_size))
+        goto _DONE;
+    rec_reader_free(&rd);
+
+    //The mapping is resolved once against the first raw frame; every other
+    //frame reuses the compiled layout at its own address
+    res->pm_table_version = version ? version : rd.hdr.pm_table_version;
+    keys = index_keyframes(base, st.st_size, rd.hdr.header_size, rd.hdr.pm_table_size, &num_keys);
+    if (!num_keys ||
+        !select_pm_table_version(res->pm_table_version, &pmt, base + keys[0] + sizeof(rec_frame)) ||
+        rd.hdr.pm_table_size < pmt.min_size ||
+        !pm_layout_compile(&ctx.layout, &pmt, base + keys[0] + sizeof(rec_frame)))
+        goto _DONE;
+
+    ctx.base = base;
+    ctx.size = st.st_size;
+    for (i = 0; i < ctx.layout.num_desc; i++) {
+        for (c = 0; c < ctx.layout.desc[i].count; c++)
+            ctx.metrics[ctx.num_metrics++] = ctx.layout.desc[i].metric + c;
+    }
+
+    if (!threads) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? cpus : 1;
+    }
+    num_chunks = threads < num_keys ? threads : num_keys;
+    res->threads = threads;
+    res->chunks = num_chunks;
+
+    chunks = calloc(num_chunks, sizeof(*chunks));
+    min = calloc(ctx.num_metrics, sizeof(*min));
+    width = calloc(ctx.num_metrics, sizeof(*width));
+    if (!chunks || !min || !width) goto _DONE;
+
+    //Equal byte ranges, moved forward to the next raw frame
+    for (c = 0, k = 0; c < num_chunks; c++) {
+        size_t target = keys[0] + (st.st_size - keys[0]) / num_chunks * c;
+
+        while (k < num_keys - 1 && keys[k] < target) k++;
+        chunks[c].ctx = &ctx;
+        chunks[c].begin = c ? (keys[k] > chunks[c - 1].begin ? keys[k] : st.st_size) : keys[0];
+        if (c) chunks[c - 1].end = chunks[c].begin;
+        chunks[c].count = calloc(ctx.num_metrics, sizeof(*chunks[c].count));
+        chunks[c].sum = calloc(ctx.num_metrics, sizeof(*chunks[c].sum));
+        chunks[c].min = calloc(ctx.num_metrics, sizeof(*chunks[c].min));
+        chunks[c].max = calloc(ctx.num_metrics, sizeof(*chunks[c].max));
+        chunks[c].hist = calloc((size_t)ctx.num_metrics * REPLAY_HIST_BINS, sizeof(*chunks[c].hist));
+        if (!chunks[c].count || !chunks[c].sum || !chunks[c].min || !chunks[c].max || !chunks[c].hist)
+            goto _DONE;
+    }
+    chunks[num_chunks - 1].end = st.st_size;
+
+    run_pass(chunks, num_chunks, 1);
+
+    for (m = 0; m < ctx.num_metrics; m++) {
+        replay_stat *s = &res->stat[ctx.metrics[m]];
+        double sum = 0;
+
+        for (c = 0; c < num_chunks; c++) {
+            if (!chunks[c].count[m]) continue;
+            if (!s->count || chunks[c].min[m] < s->min) s->min = chunks[c].min[m];
+            if (!s->count || chunks[c].max[m] > s->max) s->max = chunks[c].max[m];
+            s->count += chunks[c].count[m];
+            sum += chunks[c].sum[m];
+        }
+        if (s->count) s->mean = sum / s->count;
+        min[m] = s->min;
+        width[m] = (s->max - s->min) / REPLAY_HIST_BINS;
+    }
+    for (c = 0; c < num_chunks; c++) {
+        if (chunks[c].frames && !res->frames) res->first_timestamp_ns = chunks[c].first_ts;
+        if (chunks[c].frames) res->last_timestamp_ns = chunks[c].last_ts;
+        res->frames += chunks[c].frames;
+        res->corrupt |= chunks[c].corrupt;
+    }
+
+    ctx.min = min;
+    ctx.width = width;
+    run_pass(chunks, num_chunks, 2);
+
+    for (m = 0; m < ctx.num_metrics; m++) {
+        replay_stat *s = &res->stat[ctx.metrics[m]];
+
+        if (!s->count) continue;
+        //Chunk 0 accumulates the merged histogram
+        for (c = 1; c < num_chunks; c++) {
+            for (i = 0; i < REPLAY_HIST_BINS; i++)
+                chunks[0].hist[m * REPLAY_HIST_BINS + i] += chunks[c].hist[m * REPLAY_HIST_BINS + i];
+        }
+        s->p50 = percentile(&chunks[0].hist[m * REPLAY_HIST_BINS], s->count, min[m], width[m], 0.50);
+        s->p90 = percentile(&chunks[0].hist[m * REPLAY_HIST_BINS], s->count, min[m], width[m], 0.90);
+        s->p99 = percentile(&chunks[0].hist[m * REPLAY_HIST_BINS], s->count, min[m], width[m], 0.99);
+    }
+    ret = 0;
+
+_DONE:
+    for (c = 0; chunks && c < num_chunks; c++) {
+        free(chunks[c].count);
+        free(chunks[c].sum);
+        free(chunks[c].min);
+        free(chunks[c].max);
+        free(chunks[c].hist);
+    }
+    free(chunks);
+    free(min);
+    free(width);
+    free(keys);
+    munmap(base, st.st_size);
+    return ret;
+}
+
+void replay_print(const replay_result *res) {
+    char name[64];
+    int id, index, next;
+
+    fprintf(stdout, "PM Table version 0x%x: %llu frames over %.3f s, %u chunks on %u threads.\n",
+            res->pm_table_version, res->frames,
+            (res->last_timestamp_ns - res->first_timestamp_ns) / 1e9, res->chunks, res->threads);
+    fprintf(stdout, "%-32s %10s %12s %12s %12s %12s %12s %12s\n",
+            "Metric", "Samples", "Min", "Mean", "Max", "P50", "P90", "P99");
+
+    for (id = 0; id < PMT_METRIC_COUNT; id++) {
+        const replay_stat *s = &res->stat[id];
+        const char *field;
+
+        if (!s->count) continue;
+        field = pm_metric_name(id, &index);
+        if (index || (id + 1 < PMT_METRIC_COUNT && pm_metric_name(id + 1, &next) == field))
+            snprintf(name, sizeof(name), "%s[%d]", field, index);
+        else
+            snprintf(name, sizeof(name), "%s", field);
+
+        fprintf(stdout, "%-32s %10llu %12.4f %12.4f %12.4f %12.4f %12.4f %12.4f\n",
+                name, s->count, s->min, s->mean, s->max, s->p50, s->p90, s->p99);
+    }
+}
@@ -0,0 +1,59 @@
+/**
+ * Ryzen SMU Userspace Sensor Monitor
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef replay_h
+#define replay_h
+
+#include "pm_tables.h"
+
+//Percentiles are interpolated within fixed-width bins between min and max,
+//so their error is at most (max - min) / REPLAY_HIST_BINS.
+#define REPLAY_HIST_BINS    1024
+
+typedef struct {
+    unsigned long long count;   //Frames in which the metric was not NAN
+    float min;
+    float max;
+    double mean;
+    float p50;
+    float p90;
+    float p99;
+} replay_stat;
+
+typedef struct {
+    unsigned int pm_table_version;
+    unsigned long long frames;
+    unsigned long long first_timestamp_ns;
+    unsigned long long last_timestamp_ns;
+    unsigned int threads;
+    unsigned int chunks;
+    int corrupt;                //A chunk stopped at a corrupt frame
+    replay_stat stat[PMT_METRIC_COUNT];
+} replay_result;
+
+//Aggregates every metric over all frames of a recording. The trace is
+//mmapped and split at raw frames into chunks that are decoded by up to
+//threads threads (0: one per online CPU); raw frames are gathered in place.
+//Two passes: min/max/mean first, then histograms for the percentiles.
+//version overrides the PM Table version of the header if not 0.
+//Returns 0 on success.
+int replay_analyze(const char *file, unsigned int version, unsigned int threads, replay_result *res);
+
+//Prints the statistics of all metrics that were present at least once.
+void replay_print(const replay_result *res);
+
+#endif
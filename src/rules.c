@@ -0,0 +1,250 @@
+/**
+ * Ryzen SMU Userspace Sensor Monitor
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <ctype.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pm_layout.h"
+#include "rules.h"
+
+typedef struct {
+    int metric;                 //First element if star
+    int count;                  //Elements [*] expands to, 1 otherwise
+    int star;
+    char name[64];              //As written, for messages
+} operand;
+
+static const struct {
+    const char *token;
+    unsigned char op;
+} ops[] = {
+    //Two character operators first
+    { ">=", RULE_GE }, { "<=", RULE_LE }, { "==", RULE_EQ }, { "!=", RULE_NE },
+    { ">", RULE_GT }, { "<", RULE_LT },
+};
+
+static const char* skip_space(const char *p) {
+    while (isspace((unsigned char)*p)) p++;
+    return p;
+}
+
+void rules_init(rule_set *rules) {
+    memset(rules, 0, sizeof(*rules));
+}
+
+//NAME, NAME[index] or NAME[*]. Returns the end of the operand or NULL.
+static const char* parse_operand(const char *p, operand *o, char *err, size_t err_len) {
+    char lookup[80];
+    const char *field;
+    size_t len = 0;
+    int index;
+
+    p = skip_space(p);
+    while (isalnum((unsigned char)p[len]) || p[len] == '_') len++;
+    if (!len || len >= sizeof(o->name) - 10) {
+        snprintf(err, err_len, "expected a metric at \"%s\"", p);
+        return NULL;
+    }
+    memcpy(o->name, p, len);
+    o->name[len] = 0;
+    p += len;
+    o->star = 0;
+    o->count = 1;
+
+    if (*p == '[' && p[1] == '*' && p[2] == ']') {
+        snprintf(lookup, sizeof(lookup), "%s[0]", o->name);
+        strcat(o->name, "[*]");
+        o->star = 1;
+        p += 3;
+    }
+    else if (*p == '[') {
+        const char *end = strchr(p, ']');
+
+        if (!end || end - p > 8) {
+            snprintf(err, err_len, "expected an index or * in \"%s\"", o->name);
+            return NULL;
+        }
+        strncat(o->name, p, end - p + 1);
+        snprintf(lookup, sizeof(lookup), "%s", o->name);
+        p = end + 1;
+    }
+    else snprintf(lookup, sizeof(lookup), "%s", o->name);
+
+    o->metric = pm_metric_lookup(lookup);
+    if (o->metric < 0) {
+        snprintf(err, err_len, "unknown metric \"%s\"", o->name);
+        return NULL;
+    }
+    if (o->star) {
+        field = pm_metric_name(o->metric, NULL);
+        while (pm_metric_name(o->metric + o->count, &index) == field && index == o->count)
+            o->count++;
+    }
+    return p;
+}
+
+//Disabled cores report stale values, e.g. a CC6 residency stuck at 100
+static int core_disabled(const operand *o, int element, unsigned int core_disable_map) {
+    return o->star && o->count == PMT_MAX_NUM_CORES && !strncmp(o->name, "CORE_", 5) &&
+           ((core_disable_map >> element) & 1);
+}
+
+int rules_add(rule_set *rules, const char *text, const pm_table *pmt,
+              unsigned int core_disable_map, char *err, size_t err_len) {
+    operand a, b;
+    const char *p;
+    char *end;
+    double hold = 0;
+    float threshold;
+    unsigned char op = 0;
+    unsigned int i;
+    int k, n, added = 0, has_b = 0;
+
+    if (rules->num_rules >= RULES_MAX_RULES) {
+        snprintf(err, err_len, "more than %d rules", RULES_MAX_RULES);
+        return -1;
+    }
+
+    if (!(p = parse_operand(text, &a, err, err_len))) return -1;
+    p = skip_space(p);
+    if (*p == '/') {
+        if (!(p = parse_operand(p + 1, &b, err, err_len))) return -1;
+        p = skip_space(p);
+        has_b = 1;
+    }
+
+    for (i = 0; i < sizeof(ops) / sizeof(ops[0]); i++)
+        if (!strncmp(p, ops[i].token, strlen(ops[i].token))) break;
+    if (i == sizeof(ops) / sizeof(ops[0])) {
+        snprintf(err, err_len, "expected >, >=, <, <=, == or != at \"%s\"", p);
+        return -1;
+    }
+    op = ops[i].op;
+    p += strlen(ops[i].token);
+
+    threshold = strtof(p, &end);
+    if (end == p) {
+        snprintf(err, err_len, "expected a number at \"%s\"", skip_space(p));
+        return -1;
+    }
+    p = skip_space(end);
+
+    //for <n>[ms|s|m]
+    if (!strncmp(p, "for", 3) && isspace((unsigned char)p[3])) {
+        p = skip_space(p + 3);
+        hold = strtod(p, &end);
+        if (end == p || hold < 0) {
+            snprintf(err, err_len, "expected a duration at \"%s\"", p);
+            return -1;
+        }
+        p = end;
+        if (!strncmp(p, "ms", 2)) { hold /= 1000; p += 2; }
+        else if (*p == 's') p++;
+        else if (*p == 'm') { hold *= 60; p++; }
+        p = skip_space(p);
+    }
+    if (*p) {
+        snprintf(err, err_len, "unexpected \"%s\"", p);
+        return -1;
+    }
+
+    if (has_b && a.star && b.star && a.count != b.count) {
+        snprintf(err, err_len, "%s and %s differ in length", a.name, b.name);
+        return -1;
+    }
+    n = a.star ? a.count : has_b && b.star ? b.count : 1;
+
+    //One comparison per element the PM table actually has
+    for (k = 0; k < n; k++) {
+        rule_cond *c;
+        int m = a.metric + (a.star ? k : 0);
+        int d = has_b ? b.metric + (b.star ? k : 0) : -1;
+
+        if (!pmt->metric[m] || (d >= 0 && !pmt->metric[d])) continue;
+        if (core_disabled(&a, k, core_disable_map) || (has_b && core_disabled(&b, k, core_disable_map)))
+            continue;
+        if (rules->num_conds >= RULES_MAX_CONDS) {
+            snprintf(err, err_len, "more than %d comparisons", RULES_MAX_CONDS);
+            return -1;
+        }
+
+        c = &rules->conds[rules->num_conds++];
+        memset(c, 0, sizeof(*c));
+        c->metric = m;
+        c->divisor = d;
+        c->op = op;
+        c->rule = rules->num_rules;
+        c->element = n > 1 ? k : -1;
+        c->threshold = threshold;
+        c->hold_ns = hold * 1e9;
+        rules->keep[m] = 1;
+        if (d >= 0) rules->keep[d] = 1;
+        added++;
+    }
+    if (!added) {
+        snprintf(err, err_len, "PM Table version 0x%x has no %s%s%s", pmt->version, a.name,
+                 has_b ? " or " : "", has_b ? b.name : "");
+        return -1;
+    }
+
+    rules->text[rules->num_rules++] = text;
+    return 0;
+}
+
+int rules_eval(rule_set *rules, const float *values, unsigned long long timestamp_ns,
+               rule_event event, void *user) {
+    int i, hit, events = 0;
+
+    for (i = 0; i < rules->num_conds; i++) {
+        rule_cond *c = &rules->conds[i];
+        float v = values[c->metric];
+
+        //A zero or absent divisor is no ratio at all and never matches
+        if (c->divisor >= 0) {
+            float d = values[c->divisor];
+
+            v = d != 0 && isfinite(d) ? v / d : NAN;
+        }
+        switch (c->op) {
+            case RULE_GT: hit = v > c->threshold; break;
+            case RULE_GE: hit = v >= c->threshold; break;
+            case RULE_LT: hit = v < c->threshold; break;
+            case RULE_LE: hit = v <= c->threshold; break;
+            case RULE_EQ: hit = v == c->threshold; break;
+            default:      hit = !isnan(v) && v != c->threshold; break;
+        }
+
+        if (!hit) {
+            c->since_ns = 0;
+            if (c->active) {
+                c->active = 0;
+                event(user, rules, c, v, timestamp_ns);
+                events++;
+            }
+            continue;
+        }
+        if (!c->since_ns) c->since_ns = timestamp_ns;
+        if (!c->active && timestamp_ns - c->since_ns >= c->hold_ns) {
+            c->active = 1;
+            event(user, rules, c, v, timestamp_ns);
+            events++;
+        }
+    }
+    return events;
+}
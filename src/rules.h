@@ -0,0 +1,82 @@
+/**
+ * Ryzen SMU Userspace Sensor Monitor
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef rules_h
+#define rules_h
+
+#include <stddef.h>
+#include "pm_tables.h"
+
+//Threshold rules on the dense metric array, e.g.
+//  THM_VALUE > 90
+//  PPT_VALUE / PPT_LIMIT > 0.98 for 5s
+//  CORE_CC6[*] > 99 for 30s
+//A rule is one metric, or the ratio of two, compared against a constant. It
+//matches once the comparison held on every sample for the given time. [*]
+//expands to every element the PM table has, skipping disabled cores, so
+//each element is tracked on its own. Metrics are NAN when absent and never
+//match, and neither does a ratio whose divisor is zero or absent.
+
+#define RULES_MAX_RULES     64
+#define RULES_MAX_CONDS     512     //Comparisons after expanding [*]
+
+enum {
+    RULE_GT,
+    RULE_GE,
+    RULE_LT,
+    RULE_LE,
+    RULE_EQ,
+    RULE_NE,
+};
+
+//One compiled comparison. Evaluating it reads at most two floats.
+typedef struct {
+    unsigned short metric;
+    short divisor;                  //Metric id, -1 for none
+    unsigned char op;               //RULE_*
+    unsigned char active;           //Matched and not cleared since
+    unsigned short rule;            //Index of its source text
+    short element;                  //Index [*] expanded to, -1 if none
+    float threshold;
+    unsigned long long hold_ns;
+    unsigned long long since_ns;    //Start of the current streak, 0 if none
+} rule_cond;
+
+typedef struct {
+    rule_cond conds[RULES_MAX_CONDS];
+    int num_conds;
+    const char *text[RULES_MAX_RULES];
+    int num_rules;
+    unsigned char keep[PMT_METRIC_COUNT];   //Metrics any rule reads
+} rule_set;
+
+//Called when a comparison starts matching (active 1) and when it stops
+typedef void (*rule_event)(void *user, const rule_set *rules, const rule_cond *cond,
+                           float value, unsigned long long timestamp_ns);
+
+void rules_init(rule_set *rules);
+
+//Compiles text against the fields of pmt. text must stay valid while the
+//rules are used. Returns 0, or -1 with the reason in err.
+int rules_add(rule_set *rules, const char *text, const pm_table *pmt,
+              unsigned int core_disable_map, char *err, size_t err_len);
+
+//Evaluates every rule on one sample. Returns the number of events.
+int rules_eval(rule_set *rules, const float *values, unsigned long long timestamp_ns,
+               rule_event event, void *user);
+
+#endif
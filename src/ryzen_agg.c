@@ -0,0 +1,311 @@
+/**
+ * Ryzen Monitor Library
+ * Rolling aggregation windows: constant-memory summaries of the decoded
+ * samples over the last 1, 10 and 60 seconds.
+ */
+
+#define _GNU_SOURCE
+
+#include "ryzen_session.h"
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Every window is a ring of buckets and slides in steps of one bucket. A
+// bucket keeps count, Welford mean/M2, min/max and a histogram, all of which
+// merge exactly, so a window is the merge of its buckets.
+#define AGG_BUCKETS 10
+#define AGG_BINS 256
+#define AGG_BATCH 64
+
+// Per-core series take PMT_MAX_NUM_CORES lanes, the others one
+#define AGG_LANES (2 * PMT_MAX_NUM_CORES + RYZEN_SERIES_COUNT - 2)
+
+typedef struct {
+  unsigned long long epoch; // Timestamp / bucket width + 1, 0 if empty
+  unsigned int count;
+  float min;
+  float max;
+  double mean;
+  double m2;
+  uint32_t hist[AGG_BINS]; // A merged lane sees every core of every host
+} agg_bucket;
+
+struct ryzen_agg {
+  ryzen_session_t *session;    // NULL for ryzen_agg_create_merged()
+  int merged;                  // All cores share the lane of core 0
+  unsigned long long last_ns;  // Newest sample added; windows end here
+  unsigned long long since_ns; // Newest sampler snapshot consumed
+  unsigned char *tables;
+  ryzen_sample_info_t infos[AGG_BATCH];
+  // AGG_LANES lanes, RYZEN_SERIES_COUNT if merged
+  agg_bucket bucket[][RYZEN_WINDOW_COUNT][AGG_BUCKETS];
+};
+
+static const unsigned long long window_ns[RYZEN_WINDOW_COUNT] = {
+    1000000000ULL, 10000000000ULL, 60000000000ULL};
+
+// Histogram range per series. Values outside are counted in the edge bins;
+// min and max stay exact. Resolution is range / AGG_BINS.
+static const float series_range[RYZEN_SERIES_COUNT][2] = {
+    [RYZEN_SERIES_CORE_FREQUENCY] = {0, 8192},
+    [RYZEN_SERIES_CORE_TEMP] = {0, 128},
+    [RYZEN_SERIES_PPT] = {0, 512},
+    [RYZEN_SERIES_EDC] = {0, 512},
+    [RYZEN_SERIES_SOCKET_POWER] = {0, 512},
+};
+
+static int per_core(int series) {
+  return series == RYZEN_SERIES_CORE_FREQUENCY ||
+         series == RYZEN_SERIES_CORE_TEMP;
+}
+
+static int lane_of(const ryzen_agg_t *a, int series, int core) {
+  if (a->merged)
+    return series;
+  if (series == RYZEN_SERIES_CORE_FREQUENCY)
+    return core;
+  if (series == RYZEN_SERIES_CORE_TEMP)
+    return PMT_MAX_NUM_CORES + core;
+  return 2 * PMT_MAX_NUM_CORES + series - 2;
+}
+
+static void bucket_add(agg_bucket *b, int series, float v) {
+  const float *range = series_range[series];
+  int bin = (int)((v - range[0]) * AGG_BINS / (range[1] - range[0]));
+  double delta;
+
+  if (!b->count || v < b->min)
+    b->min = v;
+  if (!b->count || v > b->max)
+    b->max = v;
+
+  b->count++;
+  delta = v - b->mean;
+  b->mean += delta / b->count;
+  b->m2 += delta * (v - b->mean);
+
+  bin = bin < 0 ? 0 : bin >= AGG_BINS ? AGG_BINS - 1 : bin;
+  b->hist[bin]++;
+}
+
+static void lane_add(ryzen_agg_t *a, int series, int core,
+                     unsigned long long ts, float v) {
+  int lane = lane_of(a, series, core);
+
+  if (isnan(v) || isinf(v))
+    return;
+
+  for (int w = 0; w < RYZEN_WINDOW_COUNT; w++) {
+    unsigned long long epoch = ts / (window_ns[w] / AGG_BUCKETS) + 1;
+    agg_bucket *b = &a->bucket[lane][w][epoch % AGG_BUCKETS];
+
+    // Late samples for a bucket that has already been reused are dropped
+    if (b->epoch > epoch)
+      continue;
+    if (b->epoch != epoch) {
+      memset(b, 0, sizeof(*b));
+      b->epoch = epoch;
+    }
+    bucket_add(b, series, v);
+  }
+}
+
+ryzen_agg_t *ryzen_agg_create(ryzen_session_t *s) {
+  ryzen_agg_t *a;
+
+  if (!s)
+    return NULL;
+
+  a = calloc(1, sizeof(*a) + AGG_LANES * sizeof(a->bucket[0]));
+  if (!a)
+    return NULL;
+
+  a->tables = malloc((size_t)AGG_BATCH * s->smu->pm_table_size);
+  if (!a->tables) {
+    free(a);
+    return NULL;
+  }
+
+  a->session = s;
+  return a;
+}
+
+ryzen_agg_t *ryzen_agg_create_merged(void) {
+  ryzen_agg_t *a;
+
+  a = calloc(1, sizeof(*a) + RYZEN_SERIES_COUNT * sizeof(a->bucket[0]));
+  if (a)
+    a->merged = 1;
+  return a;
+}
+
+void ryzen_agg_free(ryzen_agg_t *a) {
+  if (!a)
+    return;
+
+  free(a->tables);
+  free(a);
+}
+
+int ryzen_agg_add(ryzen_agg_t *a, unsigned long long timestamp_ns,
+                  const core_data_t *cores, int num_cores,
+                  const constraints_data_t *constraints,
+                  const power_data_t *power) {
+  if (!a || (!cores && num_cores) || !constraints || !power)
+    return -1;
+
+  if (num_cores > PMT_MAX_NUM_CORES)
+    num_cores = PMT_MAX_NUM_CORES;
+
+  for (int i = 0; i < num_cores; i++) {
+    if (cores[i].disabled)
+      continue;
+    lane_add(a, RYZEN_SERIES_CORE_FREQUENCY, i, timestamp_ns, cores[i].frequency);
+    lane_add(a, RYZEN_SERIES_CORE_TEMP, i, timestamp_ns, cores[i].temp);
+  }
+  lane_add(a, RYZEN_SERIES_PPT, 0, timestamp_ns, constraints->ppt_value);
+  lane_add(a, RYZEN_SERIES_EDC, 0, timestamp_ns, constraints->edc_value);
+  lane_add(a, RYZEN_SERIES_SOCKET_POWER, 0, timestamp_ns, power->socket_power);
+
+  if (timestamp_ns > a->last_ns)
+    a->last_ns = timestamp_ns;
+  return 0;
+}
+
+static int agg_add_table(ryzen_agg_t *a, const unsigned char *table,
+                         unsigned long long timestamp_ns) {
+  core_data_t cores[PMT_MAX_NUM_CORES];
+  constraints_data_t constraints;
+  memory_data_t memory;
+  power_data_t power;
+  graphics_data_t graphics;
+  calculated_stats_t stats;
+  int n;
+
+  n = ryzen_session_decode(a->session, table, cores, PMT_MAX_NUM_CORES,
+                           &constraints, &memory, &power, &graphics, &stats);
+  if (n < 0)
+    return -1;
+
+  return ryzen_agg_add(a, timestamp_ns, cores, n, &constraints, &power);
+}
+
+int ryzen_agg_update(ryzen_agg_t *a) {
+  ryzen_session_t *s;
+  struct timespec ts;
+  int total = 0, n;
+
+  if (!a || !a->session)
+    return -1;
+
+  s = a->session;
+  if (!s->sampler) {
+    if (smu_read_pm_table(s->smu, s->pm_buf, s->smu->pm_table_size) !=
+        SMU_Return_OK)
+      return -1;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return agg_add_table(a, s->pm_buf,
+                         (unsigned long long)ts.tv_sec * 1000000000ULL +
+                             ts.tv_nsec) ? -1 : 1;
+  }
+
+  // Every snapshot since the last call, not just the newest, so the windows
+  // see the full sampler rate however rarely they are updated
+  do {
+    n = ryzen_read_range(s, a->since_ns, a->tables,
+                         (size_t)AGG_BATCH * s->smu->pm_table_size, a->infos,
+                         AGG_BATCH);
+    for (int i = 0; i < n; i++) {
+      agg_add_table(a, a->tables + (size_t)i * s->smu->pm_table_size,
+                    a->infos[i].timestamp_ns);
+      a->since_ns = a->infos[i].timestamp_ns;
+    }
+    total += n > 0 ? n : 0;
+  } while (n == AGG_BATCH);
+
+  return total;
+}
+
+// Interpolated within the bin, clamped to the exact extremes
+static float hist_quantile(const unsigned long long *hist,
+                           unsigned long long total, double q,
+                           const float *range, float min, float max) {
+  unsigned long long target = (unsigned long long)ceil(q * total), sum = 0;
+  float v;
+  int j;
+
+  if (!target)
+    target = 1;
+  for (j = 0; j < AGG_BINS - 1 && sum + hist[j] < target; j++)
+    sum += hist[j];
+
+  v = range[0] + (range[1] - range[0]) *
+                     (j + (hist[j] ? (double)(target - sum) / hist[j] : 0)) /
+                     AGG_BINS;
+  return v < min ? min : v > max ? max : v;
+}
+
+int ryzen_agg_stat(ryzen_agg_t *a, int window, int series, int core,
+                   ryzen_window_stat_t *stat) {
+  unsigned long long hist[AGG_BINS];
+  unsigned long long cur, count = 0;
+  const agg_bucket *buckets;
+  const float *range;
+  double mean = 0, m2 = 0;
+  float min = NAN, max = NAN;
+
+  if (!a || !stat || window < 0 || window >= RYZEN_WINDOW_COUNT || series < 0 ||
+      series >= RYZEN_SERIES_COUNT)
+    return -1;
+  if (per_core(series) && !a->merged ? core < 0 || core >= PMT_MAX_NUM_CORES
+                                     : core != 0)
+    return -1;
+
+  memset(stat, 0, sizeof(*stat));
+  memset(hist, 0, sizeof(hist));
+  buckets = a->bucket[lane_of(a, series, core)][window];
+  cur = a->last_ns / (window_ns[window] / AGG_BUCKETS) + 1;
+
+  for (int i = 0; i < AGG_BUCKETS; i++) {
+    const agg_bucket *b = &buckets[i];
+    double delta;
+
+    if (!b->count || b->epoch > cur || b->epoch + AGG_BUCKETS <= cur)
+      continue;
+
+    // Chan et al. pairwise merge
+    delta = b->mean - mean;
+    mean += delta * b->count / (count + b->count);
+    m2 += b->m2 + delta * delta * count * b->count / (count + b->count);
+    count += b->count;
+
+    if (isnan(min) || b->min < min)
+      min = b->min;
+    if (isnan(max) || b->max > max)
+      max = b->max;
+    for (int j = 0; j < AGG_BINS; j++)
+      hist[j] += b->hist[j];
+  }
+
+  stat->count = count;
+  if (!count) {
+    stat->min = stat->max = stat->mean = stat->stddev = NAN;
+    stat->p50 = stat->p90 = stat->p99 = NAN;
+    return 0;
+  }
+
+  stat->min = min;
+  stat->max = max;
+  stat->mean = mean;
+  stat->stddev = count > 1 ? sqrt(m2 / (count - 1)) : 0;
+
+  range = series_range[series];
+  stat->p50 = hist_quantile(hist, count, 0.50, range, min, max);
+  stat->p90 = hist_quantile(hist, count, 0.90, range, min, max);
+  stat->p99 = hist_quantile(hist, count, 0.99, range, min, max);
+
+  return 0;
+}
@@ -0,0 +1,611 @@
+/**
+ * Ryzen SMU Userspace Sensor Monitor
+ * Columnar export: converts traces, or samples taken right now, into an
+ * Arrow IPC file with one column per decoded metric.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#define _GNU_SOURCE
+
+#include <math.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "arrow_ipc.h"
+#include "recorder.h"
+#include "ryzen_session.h"
+
+#define PROGRAM_VERSION "1.0.6"
+
+#define ARROW_BATCH_ROWS    4096        //Rows per record batch
+#define ARROW_LIVE_BATCH    64          //Samples per ryzen_read_range()
+
+//Everything ryzen_session_decode() fills besides the cores
+typedef struct {
+    constraints_data_t constraints;
+    memory_data_t memory;
+    power_data_t power;
+    graphics_data_t graphics;
+    calculated_stats_t stats;
+} sample_data;
+
+typedef struct {
+    const char *name;
+    size_t offset;
+    int is_int;                 //int, written as bool
+} metric;
+
+#define METRIC(type, field) { #field, offsetof(type, field), 0 }
+#define METRIC_INT(type, field) { #field, offsetof(type, field), 1 }
+
+static const metric core_metrics[] = {
+    METRIC(core_data_t, frequency),
+    METRIC(core_data_t, power),
+    METRIC(core_data_t, voltage),
+    METRIC(core_data_t, temp),
+    METRIC(core_data_t, c0),
+    METRIC(core_data_t, cc1),
+    METRIC(core_data_t, cc6),
+    METRIC_INT(core_data_t, disabled),
+    METRIC_INT(core_data_t, sleeping),
+};
+
+static const metric constraints_metrics[] = {
+    METRIC(constraints_data_t, peak_temp),
+    METRIC(constraints_data_t, soc_temp),
+    METRIC(constraints_data_t, gfx_temp),
+    METRIC(constraints_data_t, vid_value),
+    METRIC(constraints_data_t, vid_limit),
+    METRIC(constraints_data_t, ppt_value),
+    METRIC(constraints_data_t, ppt_limit),
+    METRIC(constraints_data_t, ppt_apu_value),
+    METRIC(constraints_data_t, ppt_apu_limit),
+    METRIC(constraints_data_t, tdc_value),
+    METRIC(constraints_data_t, tdc_limit),
+    METRIC(constraints_data_t, tdc_actual),
+    METRIC(constraints_data_t, tdc_soc_value),
+    METRIC(constraints_data_t, tdc_soc_limit),
+    METRIC(constraints_data_t, edc_value),
+    METRIC(constraints_data_t, edc_limit),
+    METRIC(constraints_data_t, edc_soc_value),
+    METRIC(constraints_data_t, edc_soc_limit),
+    METRIC(constraints_data_t, thm_value),
+    METRIC(constraints_data_t, thm_limit),
+    METRIC(constraints_data_t, thm_soc_value),
+    METRIC(constraints_data_t, thm_soc_limit),
+    METRIC(constraints_data_t, thm_gfx_value),
+    METRIC(constraints_data_t, thm_gfx_limit),
+    METRIC(constraints_data_t, fit_value),
+    METRIC(constraints_data_t, fit_limit),
+};
+
+static const metric memory_metrics[] = {
+    METRIC(memory_data_t, fclk_freq),
+    METRIC(memory_data_t, fclk_freq_eff),
+    METRIC(memory_data_t, uclk_freq),
+    METRIC(memory_data_t, memclk_freq),
+    METRIC(memory_data_t, v_vddm),
+    METRIC(memory_data_t, v_vddp),
+    METRIC(memory_data_t, v_vddg),
+    METRIC(memory_data_t, v_vddg_iod),
+    METRIC(memory_data_t, v_vddg_ccd),
+    METRIC_INT(memory_data_t, coupled_mode),
+};
+
+static const metric power_metrics[] = {
+    METRIC(power_data_t, total_core_power),
+    METRIC(power_data_t, vddcr_soc_power),
+    METRIC(power_data_t, io_vddcr_soc_power),
+    METRIC(power_data_t, gmi2_vddg_power),
+    METRIC(power_data_t, roc_power),
+    METRIC(power_data_t, l3_logic_power),
+    METRIC(power_data_t, l3_vddm_power),
+    METRIC(power_data_t, vddio_mem_power),
+    METRIC(power_data_t, iod_vddio_mem_power),
+    METRIC(power_data_t, ddr_vddp_power),
+    METRIC(power_data_t, ddr_phy_power),
+    METRIC(power_data_t, vdd18_power),
+    METRIC(power_data_t, io_display_power),
+    METRIC(power_data_t, io_usb_power),
+    METRIC(power_data_t, socket_power),
+    METRIC(power_data_t, package_power),
+    METRIC(power_data_t, vddcr_cpu_power),
+    METRIC(power_data_t, soc_telemetry_voltage),
+    METRIC(power_data_t, soc_telemetry_current),
+    METRIC(power_data_t, soc_telemetry_power),
+    METRIC(power_data_t, cpu_telemetry_voltage),
+    METRIC(power_data_t, cpu_telemetry_current),
+    METRIC(power_data_t, cpu_telemetry_power),
+};
+
+static const metric graphics_metrics[] = {
+    METRIC(graphics_data_t, gfx_voltage),
+    METRIC(graphics_data_t, roc_power),
+    METRIC(graphics_data_t, gfx_temp),
+    METRIC(graphics_data_t, gfx_freq),
+    METRIC(graphics_data_t, gfx_freq_eff),
+    METRIC(graphics_data_t, gfx_busy),
+    METRIC(graphics_data_t, gfx_edc_lim),
+    METRIC(graphics_data_t, gfx_edc_residency),
+    METRIC(graphics_data_t, display_count),
+    METRIC(graphics_data_t, fps),
+    METRIC(graphics_data_t, dgpu_power),
+    METRIC(graphics_data_t, dgpu_freq_target),
+    METRIC(graphics_data_t, dgpu_gfx_busy),
+};
+
+static const metric stats_metrics[] = {
+    METRIC(calculated_stats_t, peak_core_frequency),
+    METRIC(calculated_stats_t, peak_core_temp),
+    METRIC(calculated_stats_t, peak_core_voltage),
+    METRIC(calculated_stats_t, avg_core_voltage),
+    METRIC(calculated_stats_t, avg_core_cc6),
+    METRIC(calculated_stats_t, total_core_power),
+    METRIC(calculated_stats_t, peak_core_voltage_smu),
+    METRIC(calculated_stats_t, package_cc6),
+};
+
+#define GROUP(prefix, member, metrics) \
+    { prefix, offsetof(sample_data, member), metrics, sizeof(metrics) / sizeof(metrics[0]) }
+
+//Column names are the prefix and the field. Per-core metrics come first,
+//each as one FixedSizeList of the widest PM table among the inputs.
+static const struct {
+    const char *prefix;
+    size_t offset;              //In sample_data, unused for the cores
+    const metric *metrics;
+    int count;
+} groups[] = {
+    { "core_", 0, core_metrics, sizeof(core_metrics) / sizeof(core_metrics[0]) },
+    GROUP("constraints_", constraints, constraints_metrics),
+    GROUP("memory_", memory, memory_metrics),
+    GROUP("power_", power, power_metrics),
+    GROUP("graphics_", graphics, graphics_metrics),
+    GROUP("stats_", stats, stats_metrics),
+};
+
+#define NUM_GROUPS (sizeof(groups) / sizeof(groups[0]))
+
+enum {
+    COL_TIMESTAMP,
+    COL_HOST,
+    COL_CPU,
+    COL_VERSION,
+    COL_METRICS,
+};
+
+//Values of the dictionary columns, each string once
+typedef struct {
+    const char **values;
+    unsigned int count;
+} dictionary;
+
+//One trace, decoded like the collector decodes pushed ones, or the session
+typedef struct {
+    const char *path;
+    unsigned char *map;
+    size_t size;
+    rec_header hdr;
+    unsigned char *base;        //Only used as the base of the mapping
+    struct ryzen_session offline;
+    ryzen_session_t *session;
+    int host, cpu, version;     //Dictionary indexes
+} input;
+
+static unsigned int batch_rows = ARROW_BATCH_ROWS;
+static unsigned int interval_ms = 1000;
+static unsigned int duration_s = 0;
+static const char *host_name = NULL;
+static volatile sig_atomic_t running = 1;
+
+static arrow_column *columns;
+static int num_columns;
+static dictionary dicts[COL_METRICS];
+static int cores_width;
+
+static unsigned long long clock_ns(clockid_t clock) {
+    struct timespec ts;
+
+    clock_gettime(clock, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int dict_add(dictionary *d, const char *value) {
+    const char **values;
+    unsigned int i;
+
+    for (i = 0; i < d->count; i++)
+        if (!strcmp(d->values[i], value)) return i;
+    values = realloc(d->values, (d->count + 1) * sizeof(*values));
+    if (!values || !(values[d->count] = strdup(value))) {
+        fprintf(stderr, "Could not allocate the dictionaries.\n");
+        exit(-1);
+    }
+    d->values = values;
+    return d->count++;
+}
+
+static void input_names(input *in, const char *host, const char *cpu, unsigned int version) {
+    char buf[16];
+
+    snprintf(buf, sizeof(buf), "0x%06x", version);
+    in->host = dict_add(&dicts[COL_HOST], host);
+    in->cpu = dict_add(&dicts[COL_CPU], cpu);
+    in->version = dict_add(&dicts[COL_VERSION], buf);
+}
+
+//Maps the trace and sets up a decoder from its header alone, no SMU needed
+static int trace_open(input *in, const char *path) {
+    system_info *si = &in->offline.sysinfo;
+    struct ryzen_session *s = &in->offline;
+    rec_reader rd;
+    struct stat st;
+    char host[256], *dot;
+    const char *name;
+    int fd;
+
+    memset(in, 0, sizeof(*in));
+    in->path = path;
+    fd = open(path, O_RDONLY);
+    if (fd < 0 || fstat(fd, &st) || !st.st_size) {
+        fprintf(stderr, "Could not open trace %s: %s\n", path, strerror(errno));
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    in->map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (in->map == MAP_FAILED) {
+        fprintf(stderr, "Could not map trace %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    in->size = st.st_size;
+    madvise(in->map, in->size, MADV_SEQUENTIAL);
+
+    memset(&rd, 0, sizeof(rd));
+    if (rec_reader_init(&rd, in->map, in->size)) {
+        fprintf(stderr, "%s is not a trace.\n", path);
+        return -1;
+    }
+    in->hdr = rd.hdr;
+    rec_reader_free(&rd);
+    in->hdr.codename[sizeof(in->hdr.codename) - 1] = 0;
+    in->hdr.smu_fw_ver[sizeof(in->hdr.smu_fw_ver) - 1] = 0;
+    in->hdr.cpu_name[sizeof(in->hdr.cpu_name) - 1] = 0;
+
+    in->base = calloc(in->hdr.pm_table_size, 1);
+    if (!in->base || !select_pm_table_version(in->hdr.pm_table_version, &s->pmt, in->base) ||
+        in->hdr.pm_table_size < s->pmt.min_size ||
+        !pm_layout_compile(&s->layout, &s->pmt, in->base)) {
+        fprintf(stderr, "%s: PM Table version 0x%x is not supported.\n", path,
+                in->hdr.pm_table_version);
+        return -1;
+    }
+    ryzen_session_select_decoder(s, 1);
+
+    si->available = 1;
+    si->cpu_name = in->hdr.cpu_name;
+    si->codename = in->hdr.codename;
+    si->smu_fw_ver = in->hdr.smu_fw_ver;
+    si->if_ver = in->hdr.if_ver;
+    si->cores = in->hdr.cores;
+    si->ccds = in->hdr.ccds;
+    si->ccxs = in->hdr.ccxs;
+    si->cores_per_ccx = in->hdr.cores_per_ccx;
+    si->core_disable_map = in->hdr.core_disable_map;
+    si->enabled_cores_count = in->hdr.enabled_cores_count;
+    in->session = s;
+
+    //Host defaults to the file name without directory and extension
+    name = strrchr(path, '/') ? strrchr(path, '/') + 1 : path;
+    snprintf(host, sizeof(host), "%s", name);
+    if ((dot = strrchr(host, '.')) && dot != host) *dot = 0;
+    input_names(in, host_name ? host_name : host, in->hdr.cpu_name, in->hdr.pm_table_version);
+    return 0;
+}
+
+static void trace_close(input *in) {
+    if (in->map && in->map != MAP_FAILED) munmap(in->map, in->size);
+    free(in->base);
+}
+
+static void columns_build(void) {
+    char name[128];
+    unsigned int g;
+    int i, n = COL_METRICS;
+
+    for (g = 0; g < NUM_GROUPS; g++) n += groups[g].count;
+    columns = calloc(n, sizeof(*columns));
+    if (!columns) {
+        fprintf(stderr, "Could not allocate the columns.\n");
+        exit(-1);
+    }
+
+    columns[COL_TIMESTAMP] = (arrow_column){ "timestamp", ARROW_TIMESTAMP_NS };
+    columns[COL_HOST] = (arrow_column){ "host", ARROW_DICT_UTF8 };
+    columns[COL_CPU] = (arrow_column){ "cpu", ARROW_DICT_UTF8 };
+    columns[COL_VERSION] = (arrow_column){ "pm_table_version", ARROW_DICT_UTF8 };
+    for (i = COL_HOST; i <= COL_VERSION; i++) {
+        columns[i].dict = dicts[i].values;
+        columns[i].dict_size = dicts[i].count;
+    }
+
+    num_columns = COL_METRICS;
+    for (g = 0; g < NUM_GROUPS; g++) {
+        for (i = 0; i < groups[g].count; i++) {
+            arrow_column *c = &columns[num_columns++];
+
+            snprintf(name, sizeof(name), "%s%s", groups[g].prefix, groups[g].metrics[i].name);
+            c->name = strdup(name);
+            c->type = groups[g].metrics[i].is_int ? ARROW_BOOL : ARROW_FLOAT32;
+            c->list_size = g == 0 ? cores_width : 0;
+            if (!c->name) {
+                fprintf(stderr, "Could not allocate the columns.\n");
+                exit(-1);
+            }
+        }
+    }
+}
+
+static void row_write(arrow_writer *w, const input *in, unsigned long long realtime_ns,
+                      const core_data_t *cores, int n, const sample_data *data) {
+    const unsigned char *src;
+    unsigned int g;
+    int col = COL_METRICS, i, j;
+
+    arrow_row(w);
+    *arrow_i64(w, COL_TIMESTAMP) = realtime_ns;
+    *arrow_i32(w, COL_HOST) = in->host;
+    *arrow_i32(w, COL_CPU) = in->cpu;
+    *arrow_i32(w, COL_VERSION) = in->version;
+
+    //Slots beyond a narrower PM table read as disabled and NAN
+    for (i = 0; i < groups[0].count; i++, col++) {
+        const metric *m = &groups[0].metrics[i];
+
+        if (m->is_int) {
+            unsigned char *v = arrow_u8(w, col);
+
+            for (j = 0; j < cores_width; j++)
+                v[j] = j < n ? *(const int*)((const unsigned char*)&cores[j] + m->offset) != 0
+                             : m->offset == offsetof(core_data_t, disabled);
+        } else {
+            float *v = arrow_f32(w, col);
+
+            for (j = 0; j < cores_width; j++)
+                v[j] = j < n ? *(const float*)((const unsigned char*)&cores[j] + m->offset) : NAN;
+        }
+    }
+
+    for (g = 1; g < NUM_GROUPS; g++) {
+        src = (const unsigned char*)data + groups[g].offset;
+        for (i = 0; i < groups[g].count; i++, col++) {
+            const metric *m = &groups[g].metrics[i];
+
+            if (m->is_int)
+                *arrow_u8(w, col) = *(const int*)(src + m->offset) != 0;
+            else
+                *arrow_f32(w, col) = *(const float*)(src + m->offset);
+        }
+    }
+}
+
+static int decode(const input *in, const unsigned char *table, core_data_t *cores,
+                  sample_data *data) {
+    return ryzen_session_decode(in->session, table, cores, PMT_MAX_NUM_CORES, &data->constraints,
+                                &data->memory, &data->power, &data->graphics, &data->stats);
+}
+
+static int trace_convert(arrow_writer *w, const input *in) {
+    core_data_t cores[PMT_MAX_NUM_CORES];
+    sample_data data;
+    const unsigned char *table;
+    unsigned long long ts;
+    rec_reader rd;
+    int n, ret = 0;
+
+    memset(&rd, 0, sizeof(rd));
+    if (rec_reader_init(&rd, in->map, in->size)) return -1;
+    while (running && (ret = rec_reader_next(&rd, &ts, &table)) == 1) {
+        n = decode(in, table, cores, &data);
+        if (n < 0) continue;
+        //Onto CLOCK_REALTIME, the one clock all hosts share
+        row_write(w, in, ts + in->hdr.start_realtime_ns - in->hdr.start_timestamp_ns,
+                  cores, n, &data);
+    }
+    rec_reader_free(&rd);
+    if (ret < 0) fprintf(stderr, "%s: corrupt frame, the rest of the trace is skipped.\n", in->path);
+    return 0;
+}
+
+static int live_convert(arrow_writer *w, const input *in) {
+    static ryzen_sample_info_t infos[ARROW_LIVE_BATCH];
+    core_data_t cores[PMT_MAX_NUM_CORES];
+    sample_data data;
+    unsigned long long seq = 0, since = 0, offset, end;
+    size_t size = ryzen_table_size(in->session);
+    unsigned char *tables;
+    int i, n, k;
+
+    tables = malloc(size * ARROW_LIVE_BATCH);
+    if (!tables) return -1;
+
+    //Sampler timestamps are CLOCK_MONOTONIC
+    offset = clock_ns(CLOCK_REALTIME) - clock_ns(CLOCK_MONOTONIC);
+    end = duration_s ? clock_ns(CLOCK_MONOTONIC) + duration_s * 1000000000ULL : 0;
+    while (running && (!end || clock_ns(CLOCK_MONOTONIC) < end)) {
+        seq = ryzen_sampler_wait(in->session, seq, interval_ms + 1000);
+        if (!seq) continue;
+
+        //Drains everything since the last read, so slow writes lose nothing
+        //while the ring still holds it
+        do {
+            n = ryzen_read_range(in->session, since, tables, size * ARROW_LIVE_BATCH, infos,
+                                 ARROW_LIVE_BATCH);
+            for (i = 0; i < n; i++) {
+                since = infos[i].timestamp_ns;
+                k = decode(in, tables + i * size, cores, &data);
+                if (k >= 0) row_write(w, in, since + offset, cores, k, &data);
+            }
+        } while (n == ARROW_LIVE_BATCH);
+    }
+    free(tables);
+    return 0;
+}
+
+static void signal_interrupt(int sig) {
+    (void)sig;
+    running = 0;
+}
+
+static void show_help(char *program) {
+    fprintf(stdout,
+        "Ryzen Monitor Arrow Export " PROGRAM_VERSION "\n\n"
+
+        "Usage: %s <option(s)> [<trace>...]\n\n"
+
+        "Converts traces recorded with ryzen_monitor -r into one Arrow IPC file (Feather v2)\n"
+        "with a column per decoded metric. Per-core metrics are fixed size lists, host, CPU\n"
+        "and PM table version are dictionary encoded. With -l it samples this machine instead.\n\n"
+
+        "Options:\n"
+            "\t-h            - Show this help screen.\n"
+            "\t-o<file>      - File to write. Required.\n"
+            "\t-n<host>      - Host name of all rows. Defaults to the trace file name or,\n"
+            "\t                with -l, the name of this machine.\n"
+            "\t-b<rows>      - Rows per record batch, bounds the memory used. Defaults to %u.\n"
+            "\t-l            - Sample the SMU of this machine instead of reading traces.\n"
+            "\t-i<msecs>     - Sampling interval of -l in milliseconds. Defaults to 1000.\n"
+            "\t-d<secs>      - Stop -l after this many seconds. Defaults to SIGINT or SIGTERM.\n",
+        program, ARROW_BATCH_ROWS
+    );
+}
+
+int main(int argc, char **argv) {
+    struct sigaction sa;
+    arrow_writer *w;
+    const char *out = NULL;
+    unsigned long long rows, bytes;
+    input *inputs;
+    int live = 0, num_inputs, c, i;
+
+    while ((c = getopt(argc, argv, "o:n:b:li:d:h")) != -1) {
+        switch (c) {
+            case 'o':
+                out = optarg;
+                break;
+            case 'n':
+                host_name = optarg;
+                break;
+            case 'b':
+                batch_rows = atoi(optarg);
+                break;
+            case 'l':
+                live = 1;
+                break;
+            case 'i':
+                interval_ms = atoi(optarg);
+                break;
+            case 'd':
+                duration_s = atoi(optarg);
+                break;
+            case 'h':
+                show_help(argv[0]);
+                exit(0);
+            default:
+                exit(0);
+        }
+    }
+    if (!out || !batch_rows || !interval_ms || (live ? optind != argc : optind == argc)) {
+        fprintf(stderr, "Need -o and either traces or -l. See -h.\n");
+        exit(-1);
+    }
+
+    num_inputs = live ? 1 : argc - optind;
+    inputs = calloc(num_inputs, sizeof(*inputs));
+    if (!inputs) {
+        fprintf(stderr, "Could not allocate the inputs.\n");
+        exit(-1);
+    }
+
+    //Dictionaries and the list width have to be known before the schema
+    if (live) {
+        char host[256] = "";
+
+        if (getuid() != 0 && geteuid() != 0) {
+            fprintf(stderr, "Program must be run as root.\n");
+            exit(-1);
+        }
+        inputs[0].session = ryzen_session_open();
+        if (!inputs[0].session) {
+            fprintf(stderr, "Could not open the SMU or this PM Table version is not supported.\n");
+            exit(-1);
+        }
+        ryzen_enable_mapped_reads();
+        if (!host_name && gethostname(host, sizeof(host) - 1)) strcpy(host, "localhost");
+        input_names(&inputs[0], host_name ? host_name : host,
+                    inputs[0].session->sysinfo.cpu_name ? inputs[0].session->sysinfo.cpu_name : "",
+                    inputs[0].session->pmt.version);
+        cores_width = inputs[0].session->pmt.max_cores;
+    } else {
+        for (i = 0; i < num_inputs; i++) {
+            if (trace_open(&inputs[i], argv[optind + i])) exit(-1);
+            if (cores_width < inputs[i].offline.pmt.max_cores)
+                cores_width = inputs[i].offline.pmt.max_cores;
+        }
+    }
+
+    columns_build();
+    w = arrow_open(out, columns, num_columns, batch_rows);
+    if (!w) {
+        fprintf(stderr, "Could not create %s: %s\n", out, strerror(errno));
+        exit(-1);
+    }
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = signal_interrupt;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    if (live) {
+        if (ryzen_sampler_start(inputs[0].session, interval_ms, 0)) {
+            fprintf(stderr, "Could not start sampling.\n");
+            exit(-1);
+        }
+        fprintf(stderr, "Writing samples to %s, stop with Ctrl+C\n", out);
+        live_convert(w, &inputs[0]);
+    } else {
+        for (i = 0; i < num_inputs && running; i++) {
+            trace_convert(w, &inputs[i]);
+            trace_close(&inputs[i]);
+        }
+    }
+
+    if (arrow_close(w, &rows, &bytes)) {
+        fprintf(stderr, "Could not write %s.\n", out);
+        exit(-1);
+    }
+    fprintf(stderr, "Wrote %llu rows, %llu bytes, to %s\n", rows, bytes, out);
+
+    if (live) ryzen_session_close(inputs[0].session);
+    return 0;
+}
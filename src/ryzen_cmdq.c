@@ -0,0 +1,217 @@
+/**
+ * Ryzen Monitor Library
+ * Asynchronous SMU commands: a worker thread per session sends queued
+ * mailbox commands in batches and signals completions through an eventfd.
+ */
+
+#define _GNU_SOURCE
+
+#include "ryzen_session.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+// Commands sent under one hold of the command lock. Bounds how long a
+// synchronous smu_send_command() elsewhere waits behind the queue.
+#define CMDQ_MAX_BATCH 16
+
+typedef struct {
+  ryzen_cmd_cb cb;
+  void *user;
+} cmdq_slot;
+
+// Commands move through one ring: [head, run) have completed and wait for
+// ryzen_cmd_dispatch(), [run, tail) wait for the worker. All three count up
+// forever; slot i lives at i % depth.
+struct ryzen_cmdq {
+  pthread_t thread;
+  pthread_mutex_t lock; // Guards stop and the ring indexes
+  pthread_cond_t cond;
+  int stop;
+  int fd; // eventfd, readable while completions are pending
+
+  smu_obj_t *smu;
+  unsigned int depth;
+  unsigned long long head;
+  unsigned long long run;
+  unsigned long long tail;
+  smu_command_t *cmds; // Contiguous, so the worker sends slices in place
+  cmdq_slot *slots;
+};
+
+static void *cmdq_main(void *arg) {
+  ryzen_cmdq *q = arg;
+
+  for (;;) {
+    unsigned long long run, end;
+
+    pthread_mutex_lock(&q->lock);
+    while (!q->stop && q->run == q->tail)
+      pthread_cond_wait(&q->cond, &q->lock);
+    // Commands queued before ryzen_cmd_stop() still run
+    if (q->run == q->tail) {
+      pthread_mutex_unlock(&q->lock);
+      break;
+    }
+    run = q->run;
+    end = q->tail;
+    pthread_mutex_unlock(&q->lock);
+
+    // Slots of [run, end) belong to the worker until run is advanced
+    while (run < end) {
+      unsigned int i = run % q->depth;
+      unsigned long long n = end - run;
+
+      if (n > q->depth - i)
+        n = q->depth - i;
+      if (n > CMDQ_MAX_BATCH)
+        n = CMDQ_MAX_BATCH;
+      smu_send_command_batch(q->smu, q->cmds + i, n);
+      run += n;
+
+      pthread_mutex_lock(&q->lock);
+      q->run = run;
+      pthread_mutex_unlock(&q->lock);
+      eventfd_write(q->fd, 1);
+    }
+  }
+  return NULL;
+}
+
+static void cmdq_free(ryzen_cmdq *q) {
+  if (q->fd >= 0)
+    close(q->fd);
+  free(q->cmds);
+  free(q->slots);
+  free(q);
+}
+
+int ryzen_cmd_start(ryzen_session_t *s, unsigned int depth) {
+  ryzen_cmdq *q;
+
+  if (!s || s->cmdq)
+    return -1;
+
+  q = calloc(1, sizeof(*q));
+  if (!q)
+    return -1;
+
+  q->smu = s->smu;
+  q->depth = depth ? depth : RYZEN_CMD_DEFAULT_DEPTH;
+  q->fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  q->cmds = calloc(q->depth, sizeof(*q->cmds));
+  q->slots = calloc(q->depth, sizeof(*q->slots));
+  if (q->fd < 0 || !q->cmds || !q->slots) {
+    cmdq_free(q);
+    return -1;
+  }
+
+  pthread_mutex_init(&q->lock, NULL);
+  pthread_cond_init(&q->cond, NULL);
+  if (pthread_create(&q->thread, NULL, cmdq_main, q) != 0) {
+    pthread_cond_destroy(&q->cond);
+    pthread_mutex_destroy(&q->lock);
+    cmdq_free(q);
+    return -1;
+  }
+
+  s->cmdq = q;
+  return 0;
+}
+
+void ryzen_cmd_stop(ryzen_session_t *s) {
+  ryzen_cmdq *q;
+
+  if (!s || !s->cmdq)
+    return;
+
+  q = s->cmdq;
+  pthread_mutex_lock(&q->lock);
+  q->stop = 1;
+  pthread_cond_signal(&q->cond);
+  pthread_mutex_unlock(&q->lock);
+  pthread_join(q->thread, NULL);
+
+  s->cmdq = NULL;
+  pthread_cond_destroy(&q->cond);
+  pthread_mutex_destroy(&q->lock);
+  cmdq_free(q);
+}
+
+int ryzen_cmd_fd(ryzen_session_t *s) {
+  if (!s || !s->cmdq)
+    return -1;
+  return s->cmdq->fd;
+}
+
+unsigned long long ryzen_cmd_submit(ryzen_session_t *s, int mailbox,
+                                    unsigned int op, const unsigned int *args,
+                                    ryzen_cmd_cb cb, void *user) {
+  ryzen_cmdq *q;
+  smu_command_t *cmd;
+  unsigned long long ticket;
+  unsigned int i;
+
+  if (!s || !s->cmdq ||
+      (mailbox != RYZEN_MAILBOX_RSMU && mailbox != RYZEN_MAILBOX_MP1))
+    return 0;
+
+  q = s->cmdq;
+  pthread_mutex_lock(&q->lock);
+  if (q->stop || q->tail - q->head >= q->depth) {
+    pthread_mutex_unlock(&q->lock);
+    return 0;
+  }
+
+  i = q->tail % q->depth;
+  cmd = &q->cmds[i];
+  cmd->op = op;
+  cmd->mailbox = mailbox == RYZEN_MAILBOX_MP1 ? TYPE_MP1 : TYPE_RSMU;
+  if (args)
+    memcpy(cmd->args.args, args, sizeof(cmd->args.args));
+  else
+    memset(&cmd->args, 0, sizeof(cmd->args));
+  cmd->ret = 0;
+  q->slots[i].cb = cb;
+  q->slots[i].user = user;
+
+  ticket = ++q->tail;
+  pthread_cond_signal(&q->cond);
+  pthread_mutex_unlock(&q->lock);
+  return ticket;
+}
+
+int ryzen_cmd_dispatch(ryzen_session_t *s) {
+  ryzen_cmdq *q;
+  unsigned long long head, run;
+  eventfd_t count;
+
+  if (!s || !s->cmdq)
+    return -1;
+
+  q = s->cmdq;
+  // Clear readiness first, so a completion from now on makes it readable
+  // again. Fails with EAGAIN if nothing was signalled since the last call.
+  eventfd_read(q->fd, &count);
+
+  pthread_mutex_lock(&q->lock);
+  head = q->head;
+  run = q->run;
+  pthread_mutex_unlock(&q->lock);
+
+  // Completed slots stay untouched until head moves past them
+  for (unsigned long long n = head; n < run; n++) {
+    unsigned int i = n % q->depth;
+
+    if (q->slots[i].cb)
+      q->slots[i].cb(q->slots[i].user, n + 1, q->cmds[i].ret,
+                     q->cmds[i].args.args);
+  }
+
+  pthread_mutex_lock(&q->lock);
+  q->head = run;
+  pthread_mutex_unlock(&q->lock);
+  return (int)(run - head);
+}
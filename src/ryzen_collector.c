@@ -0,0 +1,439 @@
+/**
+ * Ryzen SMU Userspace Sensor Monitor
+ * Fleet collector: receives the datagrams of ryzen_push_start() from many
+ * hosts and keeps per-host and fleet-wide aggregation windows.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#define _GNU_SOURCE
+
+#include <math.h>
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "recorder.h"
+#include "ryzen_push.h"
+#include "ryzen_session.h"
+
+#define PROGRAM_VERSION "1.0.6"
+
+#define COLLECTOR_MAX_LAYOUTS   16          //Distinct PM table versions
+#define COLLECTOR_RECV_BATCH    64          //Datagrams per recvmmsg()
+#define COLLECTOR_RCVBUF        (16 << 20)  //Absorbs bursts while reporting
+
+//One decoder per PM table version, shared by all hosts that send it. The
+//topology of the host being decoded is swapped into the session.
+typedef struct {
+    unsigned int version;
+    unsigned char *base;        //Only used as the base of the mapping
+    struct ryzen_session session;
+} layout_ctx;
+
+typedef struct {
+    char name[sizeof(((ryzen_push_header*)0)->host)];
+    layout_ctx *layout;
+    rec_header hdr;             //Of the newest datagram, holds the strings
+    system_info sysinfo;
+    unsigned long long seq;     //Newest datagram
+    unsigned long long datagrams;
+    unsigned long long samples;
+    unsigned long long lost;
+    unsigned long long corrupt;
+    unsigned long long last_ns; //Newest sample, collector's CLOCK_MONOTONIC
+    ryzen_agg_t *agg;
+} host_ctx;
+
+static unsigned short port = RYZEN_PUSH_DEFAULT_PORT;
+static const char *bind_addr = "0.0.0.0";
+static unsigned int max_hosts = 1024;
+static unsigned int report_ms = 1000;
+static int window = RYZEN_WINDOW_10S;
+static int quiet = 0;
+static volatile sig_atomic_t running = 1;
+
+static layout_ctx layouts[COLLECTOR_MAX_LAYOUTS];
+static unsigned int num_layouts;
+static host_ctx *hosts;
+static unsigned int num_hosts;
+static unsigned int *host_index;    //Open addressing, index + 1, 0 if free
+static unsigned int index_mask;
+static ryzen_agg_t *fleet;
+static rec_reader reader;
+
+//Totals since the last report
+static unsigned long long rx_datagrams, rx_samples, rx_bad, rx_lost, rx_dropped;
+
+static unsigned long long clock_ns(clockid_t clock) {
+    struct timespec ts;
+
+    clock_gettime(clock, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static layout_ctx *layout_get(unsigned int version) {
+    //Never accessed, only sized for select_pm_table_version() to find min_size
+    static unsigned char probe[REC_MAX_TABLE_SIZE];
+    layout_ctx *l;
+    unsigned int i;
+
+    for (i = 0; i < num_layouts; i++)
+        if (layouts[i].version == version) return &layouts[i];
+    if (num_layouts >= COLLECTOR_MAX_LAYOUTS) return NULL;
+
+    l = &layouts[num_layouts];
+    memset(l, 0, sizeof(*l));
+    if (!select_pm_table_version(version, &l->session.pmt, probe)) return NULL;
+    l->base = calloc(l->session.pmt.min_size, 1);
+    if (!l->base || !select_pm_table_version(version, &l->session.pmt, l->base) ||
+        !pm_layout_compile(&l->session.layout, &l->session.pmt, l->base)) {
+        free(l->base);
+        return NULL;
+    }
+    l->version = version;
+    ryzen_session_select_decoder(&l->session, 1);
+
+    num_layouts++;
+    return l;
+}
+
+//FNV-1a
+static unsigned int host_hash(const char *name) {
+    unsigned int h = 2166136261u;
+
+    while (*name) h = (h ^ (unsigned char)*name++) * 16777619u;
+    return h;
+}
+
+static host_ctx *host_get(const char *name) {
+    unsigned int i = host_hash(name) & index_mask;
+    host_ctx *h;
+
+    for (; host_index[i]; i = (i + 1) & index_mask) {
+        h = &hosts[host_index[i] - 1];
+        if (!strcmp(h->name, name)) return h;
+    }
+
+    //First datagram of a new host, the only allocation on the way in
+    if (num_hosts >= max_hosts) return NULL;
+    h = &hosts[num_hosts];
+    memset(h, 0, sizeof(*h));
+    h->agg = ryzen_agg_create_merged();
+    if (!h->agg) return NULL;
+    snprintf(h->name, sizeof(h->name), "%s", name);
+
+    host_index[i] = ++num_hosts;
+    return h;
+}
+
+//Takes topology and layout from the trace header of every datagram, so a
+//host that restarted with a new BIOS is picked up
+static int host_bind(host_ctx *h, const rec_header *hdr) {
+    system_info *si = &h->sysinfo;
+
+    if (!h->layout || h->layout->version != hdr->pm_table_version ||
+        h->hdr.pm_table_size != hdr->pm_table_size) {
+        h->layout = layout_get(hdr->pm_table_version);
+        if (!h->layout || hdr->pm_table_size < h->layout->session.pmt.min_size) {
+            h->layout = NULL;
+            return -1;
+        }
+    }
+
+    h->hdr = *hdr;
+    h->hdr.codename[sizeof(h->hdr.codename) - 1] = 0;
+    h->hdr.smu_fw_ver[sizeof(h->hdr.smu_fw_ver) - 1] = 0;
+    h->hdr.cpu_name[sizeof(h->hdr.cpu_name) - 1] = 0;
+
+    memset(si, 0, sizeof(*si));
+    si->available = 1;
+    si->cpu_name = h->hdr.cpu_name;
+    si->codename = h->hdr.codename;
+    si->smu_fw_ver = h->hdr.smu_fw_ver;
+    si->if_ver = hdr->if_ver;
+    si->cores = hdr->cores;
+    si->ccds = hdr->ccds;
+    si->ccxs = hdr->ccxs;
+    si->cores_per_ccx = hdr->cores_per_ccx;
+    si->core_disable_map = hdr->core_disable_map;
+    si->enabled_cores_count = hdr->enabled_cores_count;
+    return 0;
+}
+
+//rx_ns is the collector's CLOCK_MONOTONIC when the datagram arrived
+static void ingest(const unsigned char *buf, size_t len, unsigned long long rx_ns) {
+    core_data_t cores[PMT_MAX_NUM_CORES];
+    constraints_data_t constraints;
+    memory_data_t memory;
+    power_data_t power;
+    graphics_data_t graphics;
+    calculated_stats_t stats;
+    ryzen_push_header ph;
+    struct ryzen_session *s;
+    const unsigned char *table;
+    unsigned long long ts, t;
+    long long age;
+    host_ctx *h;
+    int n, ret;
+
+    rx_datagrams++;
+    if (len < sizeof(ph)) {
+        rx_bad++;
+        return;
+    }
+    memcpy(&ph, buf, sizeof(ph));
+    ph.host[sizeof(ph.host) - 1] = 0;
+    if (memcmp(ph.magic, RYZEN_PUSH_MAGIC, sizeof(ph.magic)) || ph.abi != RYZEN_PUSH_ABI ||
+        ph.header_size < sizeof(ph) || ph.header_size > len ||
+        rec_reader_reuse(&reader, buf + ph.header_size, len - ph.header_size)) {
+        rx_bad++;
+        return;
+    }
+
+    h = host_get(ph.host);
+    if (!h) {
+        rx_dropped++;
+        return;
+    }
+    if (host_bind(h, &reader.hdr)) {
+        rx_bad++;
+        return;
+    }
+
+    //Reordered datagrams are still counted, only forward gaps are losses
+    if (h->seq && ph.seq > h->seq + 1) {
+        h->lost += ph.seq - h->seq - 1;
+        rx_lost += ph.seq - h->seq - 1;
+    }
+    if (ph.seq > h->seq) h->seq = ph.seq;
+    h->datagrams++;
+
+    s = &h->layout->session;
+    s->sysinfo = h->sysinfo;
+    while ((ret = rec_reader_next(&reader, &ts, &table)) == 1) {
+        n = ryzen_session_decode(s, table, cores, PMT_MAX_NUM_CORES, &constraints, &memory,
+                                 &power, &graphics, &stats);
+        if (n < 0) continue;
+
+        //Onto the collector's clock by the sample's age when it was sent, so
+        //a host whose clock is off cannot move the fleet window
+        age = (long long)(reader.hdr.start_timestamp_ns - ts);
+        t = rx_ns - (age > 0 ? (unsigned long long)age : 0);
+        ryzen_agg_add(h->agg, t, cores, n, &constraints, &power);
+        ryzen_agg_add(fleet, t, cores, n, &constraints, &power);
+        if (t > h->last_ns) h->last_ns = t;
+        h->samples++;
+        rx_samples++;
+    }
+    if (ret < 0) h->corrupt++;
+}
+
+static void print_stats(ryzen_agg_t *agg) {
+    ryzen_window_stat_t ppt, socket, freq, temp;
+
+    ryzen_agg_stat(agg, window, RYZEN_SERIES_PPT, 0, &ppt);
+    ryzen_agg_stat(agg, window, RYZEN_SERIES_SOCKET_POWER, 0, &socket);
+    ryzen_agg_stat(agg, window, RYZEN_SERIES_CORE_FREQUENCY, 0, &freq);
+    ryzen_agg_stat(agg, window, RYZEN_SERIES_CORE_TEMP, 0, &temp);
+
+    fprintf(stdout, " %8.2f %8.2f %8.2f %8.2f %8.0f %8.0f %8.2f\n",
+            ppt.mean, ppt.max, socket.mean, socket.p99, freq.p50, freq.max, temp.max);
+}
+
+static void report(double seconds) {
+    unsigned long long now = clock_ns(CLOCK_MONOTONIC);
+    static const unsigned long long window_ns[RYZEN_WINDOW_COUNT] = {
+        1000000000ULL, 10000000000ULL, 60000000000ULL};
+    unsigned int i, live = 0;
+    host_ctx *h;
+
+    for (i = 0; i < num_hosts; i++)
+        if (hosts[i].last_ns && (long long)(now - hosts[i].last_ns) < (long long)window_ns[window])
+            live++;
+
+    fprintf(stdout, "\n%.0f datagrams/s, %.0f samples/s, %llu lost, %llu bad, %llu dropped, %u/%u hosts live\n",
+            rx_datagrams / seconds, rx_samples / seconds, rx_lost, rx_bad, rx_dropped, live, num_hosts);
+    fprintf(stdout, "%-32s %8s %10s %6s %6s %8s %8s %8s %8s %8s %8s %8s\n", "Host", "Version",
+            "Samples", "Lost", "Age s", "PPT", "PPT max", "Socket", "Sock p99", "MHz p50",
+            "MHz max", "Temp max");
+
+    if (!quiet) {
+        for (i = 0; i < num_hosts; i++) {
+            h = &hosts[i];
+            fprintf(stdout, "%-32s %8x %10llu %6llu %6.1f", h->name,
+                    h->layout ? h->layout->version : 0, h->samples, h->lost,
+                    h->last_ns ? (double)(long long)(now - h->last_ns) / 1e9 : NAN);
+            print_stats(h->agg);
+        }
+    }
+    fprintf(stdout, "%-32s %8s %10s %6s %6s", "fleet", "", "", "", "");
+    print_stats(fleet);
+    fflush(stdout);
+
+    rx_datagrams = rx_samples = rx_lost = rx_bad = rx_dropped = 0;
+}
+
+static void signal_interrupt(int sig) {
+    (void)sig;
+    running = 0;
+}
+
+static void show_help(char *program) {
+    fprintf(stdout,
+        "Ryzen Monitor Collector " PROGRAM_VERSION "\n\n"
+
+        "Usage: %s <option(s)>\n\n"
+
+        "Receives the samples that ryzen_monitor_exporter -f pushes from every host and reports\n"
+        "per-host and fleet-wide statistics over a rolling window.\n\n"
+
+        "Options:\n"
+            "\t-h            - Show this help screen.\n"
+            "\t-p<port>      - UDP port to receive on. Defaults to %u.\n"
+            "\t-l<address>   - Address to listen on. Defaults to 0.0.0.0.\n"
+            "\t-n<hosts>     - Most hosts to keep track of. Defaults to 1024.\n"
+            "\t-i<msecs>     - Report interval in milliseconds. Defaults to 1000.\n"
+            "\t-w<secs>      - Window of the statistics: 1, 10 or 60 seconds. Defaults to 10.\n"
+            "\t-q            - Only report the fleet, not every host.\n",
+        program, RYZEN_PUSH_DEFAULT_PORT
+    );
+}
+
+int main(int argc, char **argv) {
+    static struct mmsghdr msgs[COLLECTOR_RECV_BATCH];
+    static struct iovec iov[COLLECTOR_RECV_BATCH];
+    struct sockaddr_in addr;
+    struct sigaction sa;
+    struct pollfd pfd;
+    unsigned long long next_report, last_report;
+    unsigned char *buffers;
+    unsigned int size;
+    int c, i, n, sock, rcvbuf = COLLECTOR_RCVBUF;
+
+    while ((c = getopt(argc, argv, "p:l:n:i:w:qh")) != -1) {
+        switch (c) {
+            case 'p':
+                port = atoi(optarg);
+                break;
+            case 'l':
+                bind_addr = optarg;
+                break;
+            case 'n':
+                max_hosts = atoi(optarg);
+                break;
+            case 'i':
+                report_ms = atoi(optarg);
+                break;
+            case 'w':
+                switch (atoi(optarg)) {
+                    case 1: window = RYZEN_WINDOW_1S; break;
+                    case 10: window = RYZEN_WINDOW_10S; break;
+                    case 60: window = RYZEN_WINDOW_60S; break;
+                    default:
+                        fprintf(stderr, "Window must be 1, 10 or 60 seconds.\n");
+                        exit(-1);
+                }
+                break;
+            case 'q':
+                quiet = 1;
+                break;
+            case 'h':
+                show_help(argv[0]);
+                exit(0);
+            default:
+                exit(0);
+        }
+    }
+    if (!max_hosts || !report_ms) {
+        fprintf(stderr, "Need at least one host and a report interval.\n");
+        exit(-1);
+    }
+
+    //Everything the hot path needs is allocated up front
+    for (size = 1; size < 2 * max_hosts; size <<= 1);
+    index_mask = size - 1;
+    hosts = calloc(max_hosts, sizeof(*hosts));
+    host_index = calloc(size, sizeof(*host_index));
+    buffers = malloc((size_t)COLLECTOR_RECV_BATCH * RYZEN_PUSH_MAX_PACKET);
+    fleet = ryzen_agg_create_merged();
+    //The largest table a trace may declare, so ingest() never reallocates it
+    reader.table = calloc(REC_MAX_TABLE_SIZE, 1);
+    reader.table_cap = REC_MAX_TABLE_SIZE;
+    if (!hosts || !host_index || !buffers || !fleet || !reader.table) {
+        fprintf(stderr, "Could not allocate the host table.\n");
+        exit(-1);
+    }
+    for (i = 0; i < COLLECTOR_RECV_BATCH; i++) {
+        iov[i].iov_base = buffers + (size_t)i * RYZEN_PUSH_MAX_PACKET;
+        iov[i].iov_len = RYZEN_PUSH_MAX_PACKET;
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    if (inet_pton(AF_INET, bind_addr, &addr.sin_addr) != 1) {
+        fprintf(stderr, "Invalid listen address \"%s\".\n", bind_addr);
+        exit(-1);
+    }
+    sock = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    if (sock < 0 || bind(sock, (struct sockaddr*)&addr, sizeof(addr))) {
+        fprintf(stderr, "Could not listen on %s:%u: %s\n", bind_addr, port, strerror(errno));
+        exit(-1);
+    }
+    setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = signal_interrupt;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    fprintf(stderr, "Collecting on udp://%s:%u\n", bind_addr, port);
+    pfd.fd = sock;
+    pfd.events = POLLIN;
+    last_report = clock_ns(CLOCK_MONOTONIC);
+    next_report = last_report + report_ms * 1000000ULL;
+
+    while (running) {
+        unsigned long long now = clock_ns(CLOCK_MONOTONIC);
+
+        if (now >= next_report) {
+            report((now - last_report) / 1e9);
+            last_report = now;
+            next_report = now + report_ms * 1000000ULL;
+        }
+        if (poll(&pfd, 1, (next_report - now) / 1000000 + 1) <= 0) continue;
+
+        //Drain the socket before the next report
+        while ((n = recvmmsg(sock, msgs, COLLECTOR_RECV_BATCH, 0, NULL)) > 0) {
+            now = clock_ns(CLOCK_MONOTONIC);
+            for (i = 0; i < n; i++)
+                ingest(iov[i].iov_base, msgs[i].msg_len, now);
+            if (n < COLLECTOR_RECV_BATCH) break;
+        }
+    }
+
+    close(sock);
+    return 0;
+}
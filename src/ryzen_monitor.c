@@ -30,428 +30,476 @@
 #include <signal.h>
 #include <unistd.h>
 #include <string.h>
+#include <time.h>
+#include <spawn.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 
 #include <libsmu.h>
 #include "readinfo.h"
 #include "pm_tables.h"
+#include "pm_layout.h"
+#include "core_calc.h"
+#include "throttle.h"
+#include "rules.h"
+#include "burst.h"
+#include "recorder.h"
+#include "replay.h"
+#include "screen.h"
+#include "draw.h"
+#include "profile.h"
+#include "ryzen_shm.h"
 
 #define PROGRAM_VERSION "1.0.6"
 
 smu_obj_t obj;
-static int update_time_s = 1;
-static int show_disabled_cores = 0;
+static double update_time_s = 1;
+static int mapped_reads = 0;
+static char *record_file = NULL;
+static int record_xor = 0;
+static throttle_state *limiters = NULL;
+static int access_stats = 0;
+static int probe = 0;
+static const char *rule_texts[RULES_MAX_RULES];
+static int num_rule_texts = 0;
+static const char *hook = NULL;
+static int headless = 0;
+
+//Selects the PM Table, compiles its layout and resolves the CPU topology.
+//Exits if the PM Table can't be used.
+static unsigned char* setup_pm_table(unsigned int force, pm_table *pmt, pm_layout *layout, system_info *sysinfo) {
+    static char cpu_name[64];
+    unsigned char *pm_buf;
 
-void print_line(const char* label, const char* value_format, ...) {
-    static char buffer[1024];
-    va_list list;
+    if (!smu_pm_tables_supported(&obj)) {
+        fprintf(stderr, "PM Tables are not supported on this platform.\n");
+        exit(0);
+    }
 
-    va_start(list, value_format);
-    vsnprintf(buffer, sizeof(buffer), value_format, list);
-    va_end(list);
+    pm_buf = calloc(obj.pm_table_size, sizeof(unsigned char));
+    if (!pm_buf) {
+        fprintf(stderr, "Could not allocate memory for the PM Table.\n");
+        exit(0);
+    }
 
-    fprintf(stdout, "│ %45s │ %46s │\n", label, buffer);
-}
+    if (force) {
+        fprintf(stderr, "Forcing to use PM Table version 0x%x. System reports version 0x%x.\n", force, obj.pm_table_version);
+    }
 
-//Helper to access the PM Table elements. If an element doesn't exist in the
-//current PM Table version, it's pointer is set to 0. This helper returns
-//NAN for not available fields.
-#define pmta(elem) ((pmt->elem)?(*pmt->elem):NAN)
-//Same, but with 0 as return. For summations that should not fail if one value is not present.
-#define pmta0(elem) ((pmt->elem)?(*pmt->elem):0)
-
-void draw_screen(pm_table *pmt, system_info *sysinfo) {
-    //general
-    int i, j;
-    //core block
-    float core_voltage, core_frequency, package_sleep_time, core_sleep_time, average_voltage;
-    float peak_core_frequency, peak_core_temp, peak_core_voltage;
-    float total_core_voltage, total_core_power, total_usage, total_core_CC6;
-    int core_disabled, core_number;
-    //constraints block
-    float edc_value;
-    //power block
-    float l3_logic_power, l3_vddm_power;
-    char strbuf[100];
-
-    if (pmt->experimental) {
-        fprintf(stdout, "Warning: Support for this PM table version is expermiental. Can't trust anything.\n");
-    }
-
-    if (sysinfo->available) {
-        fprintf(stdout, "╭───────────────────────────────────────────────┬────────────────────────────────────────────────╮\n");
-        print_line("CPU Model", sysinfo->cpu_name);
-        print_line("Processor Code Name", sysinfo->codename);
-        print_line("Cores", "%d", sysinfo->cores);
-        print_line("Core CCDs", "%d", sysinfo->ccds);
-        if (pmt->zen_version!=3) {
-            print_line("Core CCXs", "%d", sysinfo->ccxs);
-            print_line("Cores Per CCX", "%d", sysinfo->cores_per_ccx);
-        }
-        else
-            print_line("Cores Per CCD", "%d", sysinfo->cores_per_ccx); //Zen3 does not have CCXs anymore
-        print_line("SMU FW Version", "v%s", sysinfo->smu_fw_ver);
-        print_line("MP1 IF Version", "v%d", sysinfo->if_ver);
-        fprintf(stdout, "╰───────────────────────────────────────────────┴────────────────────────────────────────────────╯\n");
+    //Select matching PM Table
+    if(!select_pm_table_version(force?force:obj.pm_table_version, pmt, pm_buf)) {
+        fprintf(stderr, "This PM Table version (0x%x) is currently not supported.\n", force?force:obj.pm_table_version);
+        fprintf(stderr, "Processor name: %s\n", get_processor_name());
+        fprintf(stderr, "SMU FW version: %s\n", smu_get_fw_version(&obj));
+        exit(0);
     }
+    //Prevent illegal memory access
+    if (obj.pm_table_size < pmt->min_size) {
+        fprintf(stderr, "Selected PM Table is larger than the PM Table returned by the SMU.\n");
+        exit(0);
+    }
+    pm_layout_compile(layout, pmt, pm_buf);
+    //Maximum core count. Just to be safe. Will be overwritten by get_processor_topology(...).
+    sysinfo->enabled_cores_count = pmt->max_cores;
 
+    sysinfo->codename    = smu_codename_to_str(&obj);
+    sysinfo->smu_fw_ver  = smu_get_fw_version(&obj);
 
-    peak_core_frequency = peak_core_temp = peak_core_voltage = 0;
-    total_core_voltage = total_core_power = total_usage = total_core_CC6 = 0;
-    core_number = 0;
+    //Later starts skip the discovery below
+    if (probe || !profile_load(&obj, force?force:obj.pm_table_version, sysinfo, cpu_name, sizeof(cpu_name))) {
+        sysinfo->cpu_name = get_processor_name();
 
-    if(pmt->PC6)
-    {
-        package_sleep_time = pmta(PC6) / 100.f;
-        average_voltage = (pmta(CPU_TELEMETRY_VOLTAGE) - (0.2 * package_sleep_time)) / (1.0 - package_sleep_time);
-    }
-    else
-    {
-        average_voltage = pmta(CPU_TELEMETRY_VOLTAGE);
-    }
-
-    fprintf(stdout, "╭─────────┬────────────┬──────────┬─────────┬──────────┬─────────────┬─────────────┬─────────────╮\n");
-    for (i = 0; i < pmt->max_cores; i++) {
-        core_disabled = (sysinfo->core_disable_map >> i)&0x01;
-        core_frequency = pmta(CORE_FREQEFF[i]) * 1000.f;
-
-        core_voltage = pmta(CORE_VOLTAGE[i]); // True core voltage
-        // Rumours say this is how AMD calculates core voltage
-        //if (pmta(CORE_FREQ[i]) != 0.f) {
-            core_sleep_time = pmta(CORE_CC6[i]) / 100.f;
-            core_voltage = ((1.0 - core_sleep_time) * average_voltage) + (0.2 * core_sleep_time);
-        //}
-
-        if (core_disabled) {
-            if (show_disabled_cores)
-                    fprintf(stdout,
-                        "│ %*s %d │   Disabled | %6.3f W | %5.3f V | %6.2f C | C0: %5.1f %% | C1: %5.1f %% | C6: %5.1f %% │\n",
-                    (core_number<10)+4, "Core", core_number, //Print "Core" and its number but right-justified
-                        pmta(CORE_POWER[i]), core_voltage, pmta(CORE_TEMP[i]),
-                        pmta(CORE_C0[i]), pmta(CORE_CC1[i]), pmta(CORE_CC6[i]));
-        }
-        else if (pmta(CORE_C0[i]) >= 6.f) {
-            // AMD denotes a sleeping core as having spent less than 6% of the time in C0.
-            // Source: Ryzen Master
-                fprintf(stdout,
-                    "│ %*s %d │   %4.f MHz | %6.3f W | %5.3f V | %6.2f C | C0: %5.1f %% | C1: %5.1f %% | C6: %5.1f %% │\n",
-                (core_number<10)+4, "Core", core_number, //Print "Core" and its number but right-justified
-                core_frequency, pmta(CORE_POWER[i]), core_voltage, pmta(CORE_TEMP[i]),
-                    pmta(CORE_C0[i]), pmta(CORE_CC1[i]), pmta(CORE_CC6[i]));
+        //PMT hack for Cezanne's core_disabled_map 
+        if (obj.pm_table_version == 0x400005) {
+            if (smu_read_pm_table(&obj, pm_buf, obj.pm_table_size) == SMU_Return_OK) {
+                sysinfo->core_disable_map_pmt = disabled_cores_0x400005(pmt);
             }
-            else {
-                fprintf(stdout,
-                    "│ %*s %d │   Sleeping | %6.3f W | %5.3f V | %6.2f C | C0: %5.1f %% | C1: %5.1f %% | C6: %5.1f %% │\n",
-                (core_number<10)+4, "Core", core_number, //Print "Core" and its number but right-justified
-                    pmta(CORE_POWER[i]), core_voltage, pmta(CORE_TEMP[i]),
-                    pmta(CORE_C0[i]), pmta(CORE_CC1[i]), pmta(CORE_CC6[i]));
         }
 
-        //Don't confuse people by numbering cores that are disabled and hence not shown on 6 | 12 core CPUs
-        //(which actually have 8 | 16 cores)
-        if (show_disabled_cores || !core_disabled) core_number++;
-
-        //Statistics
-        if (!core_disabled) {
-            if (peak_core_frequency < core_frequency) peak_core_frequency = core_frequency;
-            if (peak_core_temp < pmta(CORE_TEMP[i])) peak_core_temp = pmta(CORE_TEMP[i]);
-            if (peak_core_voltage < core_voltage) peak_core_voltage = core_voltage;
-            total_core_voltage += core_voltage;
-            total_core_power += pmta(CORE_POWER[i]);
-            total_usage += pmta(CORE_C0[i]);
-            total_core_CC6 += pmta(CORE_CC6[i]);
+        if (get_processor_topology(&obj, sysinfo, pmt->zen_version)) {
+            fprintf(stderr, "Failed to read the CPU topology fuses.\n");
+            exit(-1);
         }
+        profile_save(&obj, force?force:obj.pm_table_version, sysinfo);
     }
 
-    fprintf(stdout, "╰─────────┴────────────┴──────────┴─────────┴──────────┴─────────────┴─────────────┴─────────────╯\n");
-
-    fprintf(stdout, "╭── Core Statistics (Calculated) ───────────────┬────────────────────────────────────────────────╮\n");
-    print_line("Highest Effective Core Frequency", "%8.0f MHz", peak_core_frequency);
-    print_line("Highest Core Temperature", "%8.2f C", peak_core_temp);
-    print_line("Highest Core Voltage", "%8.3f V", peak_core_voltage);
-    print_line("Average Core Voltage", "%5.3f V", total_core_voltage/sysinfo->enabled_cores_count);
-    print_line("Average Core CC6", "%6.2f %%", total_core_CC6/sysinfo->enabled_cores_count);
-    print_line("Total Core Power Sum", "%7.3f W", total_core_power);
-
-    fprintf(stdout, "├── Reported by SMU ────────────────────────────┼────────────────────────────────────────────────┤\n");
-    //print_line("Package Power", "%8.3f W", pmta(SOCKET_POWER)); //Is listed below in power section
-    print_line("Peak Core Voltage", "%5.3f V", pmta(CPU_TELEMETRY_VOLTAGE));
-    if(pmt->PC6) print_line("Package CC6", "%6.2f %%", pmta(PC6));
-    fprintf(stdout, "╰───────────────────────────────────────────────┴────────────────────────────────────────────────╯\n");
-
-    fprintf(stdout, "╭── Electrical & Thermal Constraints ───────────┬────────────────────────────────────────────────╮\n");
-    edc_value = pmta(EDC_VALUE) * (total_usage / sysinfo->cores / 100);
-    if (edc_value < pmta(TDC_VALUE)) edc_value = pmta(TDC_VALUE);
-
-    print_line("Peak Temperature", "%8.2f C", pmta(PEAK_TEMP));
-    if(pmt->SOC_TEMP) print_line("SoC Temperature", "%8.2f C", pmta(SOC_TEMP));
-    if(pmt->GFX_TEMP) print_line("GFX Temperature", "%8.2f C", pmta(GFX_TEMP));
-    //print_line("Core Power", "%8.4f W", pmta(VDDCR_CPU_POWER));
-
-    print_line("Voltage from Core VRM", "%7.3f V | %7.3f V | %8.2f %%", pmta(VID_VALUE), pmta(VID_LIMIT), (pmta(VID_VALUE) / pmta(VID_LIMIT) * 100));
-    //if(pmt->STAPM_VALUE) print_line("STAPM", "%7.3f   | %7.f   | %8.2f %%", pmta(STAPM_VALUE), pmta(STAPM_LIMIT), (pmta(STAPM_VALUE) / pmta(STAPM_LIMIT) * 100));
-    print_line("PPT", "%7.3f W | %7.f W | %8.2f %%", pmta(PPT_VALUE), pmta(PPT_LIMIT), (pmta(PPT_VALUE) / pmta(PPT_LIMIT) * 100));
-    if(pmt->PPT_VALUE_APU) print_line("PPT APU", "%7.3f W | %7.f W | %8.2f %%", pmta(PPT_VALUE_APU), pmta(PPT_LIMIT_APU), (pmta(PPT_VALUE_APU) / pmta(PPT_LIMIT_APU) * 100));
-    print_line("TDC Value", "%7.3f A | %7.f A | %8.2f %%", pmta(TDC_VALUE), pmta(TDC_LIMIT), (pmta(TDC_VALUE) / pmta(TDC_LIMIT) * 100));
-    if(pmt->TDC_ACTUAL) print_line("TDC Actual", "%7.3f A | %7.f A | %8.2f %%", pmta(TDC_ACTUAL), pmta(TDC_LIMIT), (pmta(TDC_ACTUAL) / pmta(TDC_LIMIT) * 100));
-    if(pmt->TDC_VALUE_SOC) print_line("TDC Value, SoC only", "%7.3f A | %7.f A | %8.2f %%", pmta(TDC_VALUE_SOC), pmta(TDC_LIMIT_SOC), (pmta(TDC_VALUE_SOC) / pmta(TDC_LIMIT_SOC) * 100));
-    print_line("EDC", "%7.3f A | %7.f A | %8.2f %%", edc_value, pmta(EDC_LIMIT), (edc_value / pmta(EDC_LIMIT) * 100));
-    if(pmt->EDC_VALUE_SOC) print_line("EDC, SoC only", "%7.3f A | %7.f A | %8.2f %%", pmta(EDC_VALUE_SOC), pmta(EDC_LIMIT_SOC), (pmta(EDC_VALUE_SOC) / pmta(EDC_LIMIT_SOC) * 100));
-    print_line("THM", "%7.2f C | %7.f C | %8.2f %%", pmta(THM_VALUE), pmta(THM_LIMIT), (pmta(THM_VALUE) / pmta(THM_LIMIT) * 100));
-    if(pmt->THM_VALUE_SOC) print_line("THM SoC", "%7.2f C | %7.f C | %8.2f %%", pmta(THM_VALUE_SOC), pmta(THM_LIMIT_SOC), (pmta(THM_VALUE_SOC) / pmta(THM_LIMIT_SOC) * 100));
-    if(pmt->THM_VALUE_GFX) print_line("THM GFX", "%7.2f C | %7.f C | %8.2f %%", pmta(THM_VALUE_GFX), pmta(THM_LIMIT_GFX), (pmta(THM_VALUE_GFX) / pmta(THM_LIMIT_GFX) * 100));
-    //if(pmt->STT_LIMIT_APU) print_line("STT APU", "%7.2f   | %7.f   | %8.2f %%", pmta(STT_VALUE_APU), pmta(STT_LIMIT_APU), (pmta(STT_VALUE_APU) / pmta(STT_LIMIT_APU) * 100)); //Always zero
-    //if(pmt->STT_LIMIT_DGPU) print_line("STT DGPU", "%7.2f   | %7.f   | %8.2f %%", pmta(STT_VALUE_DGPU), pmta(STT_LIMIT_DGPU), (pmta(STT_VALUE_DGPU) / pmta(STT_LIMIT_DGPU) * 100)); //Always zero
-    print_line("FIT", "%7.f   | %7.f   | %8.2f %%", pmta(FIT_VALUE), pmta(FIT_LIMIT), (pmta(FIT_VALUE) / pmta(FIT_LIMIT)) * 100.f);
-    fprintf(stdout, "╰───────────────────────────────────────────────┴────────────────────────────────────────────────╯\n");
-
-    fprintf(stdout, "╭── Memory Interface ───────────────────────────┬────────────────────────────────────────────────╮\n");
-    print_line("Coupled Mode", "%8s", pmta(UCLK_FREQ) == pmta(MEMCLK_FREQ) ? "ON" : "OFF");
-    print_line("Fabric Clock (Average)", "%5.f MHz", pmta(FCLK_FREQ_EFF));
-    print_line("Fabric Clock", "%5.f MHz", pmta(FCLK_FREQ));
-    print_line("Uncore Clock", "%5.f MHz", pmta(UCLK_FREQ));
-    print_line("Memory Clock", "%5.f MHz", pmta(MEMCLK_FREQ));
-    //print_line("VDDCR_Mem", "%7.3f W", pmta(VDDIO_MEM_POWER)); //Is listed below in power section
-    //print_line("VDDCR_SoC", "%7.3f V", pmta(SOC_SET_VOLTAGE)); //Might be the default voltage, not the actually set one
-    print_line("cLDO_VDDM", "%7.4f V", pmta(V_VDDM));
-    print_line("cLDO_VDDP", "%7.4f V", pmta(V_VDDP));
-    if(pmt->V_VDDG)     print_line("cLDO_VDDG", "%7.4f V", pmta(V_VDDG));
-    if(pmt->V_VDDG_IOD) print_line("cLDO_VDDG_IOD", "%7.4f V", pmta(V_VDDG_IOD));
-    if(pmt->V_VDDG_CCD) print_line("cLDO_VDDG_CCD", "%7.4f V", pmta(V_VDDG_CCD));
-    fprintf(stdout, "╰───────────────────────────────────────────────┴────────────────────────────────────────────────╯\n");
-
-    if(pmt->has_graphics){
-    fprintf(stdout, "╭── Graphics Subsystem──────────────────────────┬────────────────────────────────────────────────╮\n");
-    print_line("GFX Voltage | ROC Power", "%7.4f V | %8.3f W", pmta(GFX_VOLTAGE), pmta(ROC_POWER));
-    print_line("GFX Temperature", "%8.2f C", pmta(GFX_TEMP));
-    print_line("GFX Clock Real | Effective", "%5.f MHz | %6.f MHz", pmta(GFX_FREQ), pmta(GFX_FREQEFF));
-    print_line("GFX Busy", "%8.2f %%", pmta(GFX_BUSY) * 100.f);
-    print_line("GFX EDC Limit | Residency", "%7.3f A | %8.2f %%", pmta(GFX_EDC_LIM), pmta(GFX_EDC_RESIDENCY) * 100.f);
-    print_line("Display Count | FPS", "%2.f | %8.2f  ", pmta(DISPLAY_COUNT), pmta(FPS));
-    print_line("DGPU Power | Freq Target | Busy", "%7.3f W | %5.f MHz | %8.2f %%", pmta(DGPU_POWER), pmta(DGPU_FREQ_TARGET), pmta(DGPU_GFX_BUSY) * 100.f);
-    fprintf(stdout, "╰───────────────────────────────────────────────┴────────────────────────────────────────────────╯\n");
-    }
-
-    fprintf(stdout, "╭── Power Consumption ──────────────────────────┬────────────────────────────────────────────────╮\n");
-    //These powers are drawn via VDDCR_SOC and VDDCR_CPU and thus are pulled from the CPU power connector of the mainboard
-    print_line("Total Core Power Sum", "%7.3f W", total_core_power);
-    //print_line("VDDCR_CPU Power", "%7.3f W", pmta(VDDCR_CPU_POWER)); //This value doesn't correlate with what the cores
-                                                                        //report, nor with what is actually consumed. but is
-                                                                        //the value HWiNFO shows.
-    print_line("VDDCR_SOC Power", "%7.3f W", pmta(VDDCR_SOC_POWER));
-    if(pmt->IO_VDDCR_SOC_POWER) print_line("IO VDDCR_SOC Power", "%7.3f W", pmta(IO_VDDCR_SOC_POWER));
-    if(pmt->GMI2_VDDG_POWER) print_line("GMI2_VDDG Power", "%7.3f W", pmta(GMI2_VDDG_POWER));
-    if(pmt->ROC_POWER) print_line("ROC Power", "%7.3f W", pmta(ROC_POWER));
-
-    //L3 caches (2 per CCD on Zen2, 1 per CCD on Zen3)
-    l3_logic_power=0;
-    l3_vddm_power=0;
-    for (i=0; i<pmt->max_l3; i++) {
-        l3_logic_power += pmta0(L3_LOGIC_POWER[i]);
-        l3_vddm_power += pmta0(L3_VDDM_POWER[i]);
-    }
-    if (pmt->max_l3 == 1) {
-        print_line("L3 Logic Power", "%7.3f W", pmta(L3_LOGIC_POWER[0]));
-        print_line("L3 VDDM Power", "%7.3f W", pmta(L3_VDDM_POWER[0]));
-    } else {
-        for (i=0; i<pmt->max_l3; i+=2) {
-            // + sign if needed and first value
-            j = snprintf(strbuf, sizeof(strbuf), "%s%7.3f W", (i?"+ ":""), pmta(L3_LOGIC_POWER[i]));
-            // second value if it exists
-            if (pmt->max_l3-i > 1) j += snprintf(strbuf+j, sizeof(strbuf)-j, " + %7.3f W", pmta(L3_LOGIC_POWER[i+1]));
-            // end of string (sum or nothing)
-            if (pmt->max_l3-i > 2) j += snprintf(strbuf+j, sizeof(strbuf)-j, "            ");
-            else j += snprintf(strbuf+j, sizeof(strbuf)-j, " = %7.3f W", l3_logic_power);
-            // print
-            print_line((i?"":"L3 Logic Power"), "%s", strbuf);
-        }
-        for (i=0; i<pmt->max_l3; i+=2) {
-            // + sign if needed and first value
-            j = snprintf(strbuf, sizeof(strbuf), "%s%7.3f W", (i?"+ ":""), pmta(L3_VDDM_POWER[i]));
-            // second value if it exists
-            if (pmt->max_l3-i > 1) j += snprintf(strbuf+j, sizeof(strbuf)-j, " + %7.3f W", pmta(L3_VDDM_POWER[i+1]));
-            // end of string (sum or nothing)
-            if (pmt->max_l3-i > 2) j += snprintf(strbuf+j, sizeof(strbuf)-j, "            ");
-            else j += snprintf(strbuf+j, sizeof(strbuf)-j, " = %7.3f W", l3_vddm_power);
-            // print
-            print_line((i?"":"L3 VDDM Power"), "%s", strbuf);
-        }
+    switch (obj.smu_if_version) {
+        case IF_VERSION_9:  sysinfo->if_ver =  9; break;
+        case IF_VERSION_10: sysinfo->if_ver = 10; break;
+        case IF_VERSION_11: sysinfo->if_ver = 11; break;
+        case IF_VERSION_12: sysinfo->if_ver = 12; break;
+        case IF_VERSION_13: sysinfo->if_ver = 13; break;
+        default:            sysinfo->if_ver =  0; break;
     }
 
-    //These powers are supplied by other power lines to the CPU and are drawn from the 24 pin ATX connector on most boards
-    print_line("","");
-    print_line("VDDIO_MEM Power", "%7.3f W", pmta(VDDIO_MEM_POWER));
-    print_line("IOD_VDDIO_MEM Power", "%7.3f W", pmta(IOD_VDDIO_MEM_POWER));
-    if(pmt->DDR_VDDP_POWER) print_line("DDR_VDDP Power", "%7.3f W", pmta(DDR_VDDP_POWER));
-    if(pmt->DDR_PHY_POWER) print_line("DDR Phy Power", "%7.3f W", pmta(DDR_PHY_POWER));
-    print_line("VDD18 Power", "%7.3f W", pmta(VDD18_POWER)); //Same as pmta(IO_VDD18_POWER)
-    if(pmt->IO_DISPLAY_POWER) print_line("CPU Display IO Power", "%7.3f W", pmta(IO_DISPLAY_POWER));
-    if(pmt->IO_USB_POWER) print_line("CPU USB IO Power", "%7.3f W", pmta(IO_USB_POWER));
-
-    if(!pmt->powersum_unclear) {
-    //The sum is the thermal output of the whole package. Yes, this is higher than PPT and SOCKET_POWER.
-    //Confirmed by measuring the actual current draw on the mainboard.
-    print_line("","");
-    print_line("Calculated Thermal Output", "%7.3f W", total_core_power + pmta0(VDDCR_SOC_POWER) + pmta0(GMI2_VDDG_POWER) 
-            + l3_logic_power + l3_vddm_power
-            + pmta0(VDDIO_MEM_POWER) + pmta0(IOD_VDDIO_MEM_POWER) + pmta0(DDR_VDDP_POWER) + pmta0(VDD18_POWER));
-    }
-
-    fprintf(stdout, "├── Additional Reports ─────────────────────────┼────────────────────────────────────────────────┤\n");
-    //print_line("ROC_POWER", "%7.4f",pmta(ROC_POWER));
-    print_line("SoC Power (SVI2)", "%8.3f V | %7.3f A | %8.3f W", pmta(SOC_TELEMETRY_VOLTAGE), pmta(SOC_TELEMETRY_CURRENT), pmta(SOC_TELEMETRY_POWER));
-    print_line("Core Power (SVI2)", "%8.3f V | %7.3f A | %8.3f W", pmta(CPU_TELEMETRY_VOLTAGE), pmta(CPU_TELEMETRY_CURRENT), pmta(CPU_TELEMETRY_POWER));
-    print_line("Core Power (SMU)", "%7.3f W", pmta(VDDCR_CPU_POWER));
-    print_line("Socket Power (SMU)", "%7.3f W", pmta(SOCKET_POWER));
-    if (pmt->PACKAGE_POWER) print_line("Package Power (SMU)", "%7.3f W", pmta(PACKAGE_POWER));
-    fprintf(stdout, "╰───────────────────────────────────────────────┴────────────────────────────────────────────────╯\n");
+    return pm_buf;
 }
 
-int select_pm_table_version(unsigned int version, pm_table *pmt, unsigned char *pm_buf) {
-    //Initialize pmt to 0. This also sets all pointers to 0, which signifies non-existiting fields.
-    //Access via pmta(...) will check if pointer is 0 before trying to access the value.
-    memset(pmt, 0, sizeof(pm_table));
-
-     //Select matching PM Table
-    switch(version) {
-        case 0x380904: pm_table_0x380904(pmt, pm_buf); break; //Ryzen 5600X
-        case 0x380905: pm_table_0x380905(pmt, pm_buf); break; //Ryzen 5600X
-        case 0x380804: pm_table_0x380804(pmt, pm_buf); break; //Ryzen 5900X / 5950X
-        case 0x380805: pm_table_0x380805(pmt, pm_buf); break; //Ryzen 5900X / 5950X
-        case 0x400005: pm_table_0x400005(pmt, pm_buf); break; //Ryzen 5700G
-        case 0x240903: pm_table_0x240903(pmt, pm_buf); break; //Ryzen 3700X / 3800X
-        case 0x240803: pm_table_0x240803(pmt, pm_buf); break; //Ryzen 3950X
-        default:
-            return 0;
+//Absolute deadlines, so drawing the screen doesn't make updates drift
+static void next_deadline(struct timespec *deadline) {
+    deadline->tv_sec += (time_t)update_time_s;
+    deadline->tv_nsec += (long)((update_time_s - (time_t)update_time_s) * 1e9);
+    if (deadline->tv_nsec >= 1000000000L) {
+        deadline->tv_sec++;
+        deadline->tv_nsec -= 1000000000L;
     }
+}
 
-    //Avoid access bejond bounds of the defined arrays.
-    if (pmt->max_l3 > PMT_MAX_NUM_L3) pmt->max_l3 = PMT_MAX_NUM_L3;
-    if (pmt->max_cores > PMT_MAX_NUM_CORES) pmt->max_cores = PMT_MAX_NUM_CORES;
-
-    //APML_POWER is probably identical to PACKAGE_POWER
-    if (pmt->PACKAGE_POWER == NULL) pmt->PACKAGE_POWER = pmt->APML_POWER;
+void start_pm_monitor(unsigned int force) {
+    unsigned char *pm_buf;
+    pm_table pmt;
+    pm_layout layout;
+    float values[PMT_METRIC_COUNT];
+    system_info sysinfo = {0};
+    struct timespec deadline, now, decode_start, decoded;
+    rec_header hdr;
+    recorder rec;
+
+    pm_buf = setup_pm_table(force, &pmt, &layout, &sysinfo);
+    pm_values_reset(values);
+
+    if (record_file) {
+        rec_header_fill(&hdr, &obj, &sysinfo);
+        if (recorder_open(&rec, record_file, &hdr, record_xor)) {
+            fprintf(stderr, "Could not create the recording \"%s\".\n", record_file);
+            exit(0);
+        }
+    }
 
-    if (pmt->VDD18_POWER == NULL) pmt->VDD18_POWER = pmt->IO_VDD18_POWER;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    while(1) {
+        next_deadline(&deadline);
 
-    return 1;
-}
+        if (smu_read_pm_table(&obj, pm_buf, obj.pm_table_size) != SMU_Return_OK) {
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL);
+            continue;
+        }
+        clock_gettime(CLOCK_MONOTONIC_RAW, &decode_start);
+        pm_layout_gather(&layout, pm_buf, values);
+
+        clock_gettime(CLOCK_MONOTONIC_RAW, &now);
+
+        //Only the cells that changed since the last update are sent
+        screen_begin();
+        draw_screen(&pmt, values, &sysinfo);
+        if (limiters) draw_limiters(limiters, &pmt, values, &sysinfo, (unsigned long long)now.tv_sec * 1000000000ULL + now.tv_nsec);
+        if (access_stats) {
+            clock_gettime(CLOCK_MONOTONIC_RAW, &decoded);
+            draw_smu_stats(&obj, (decoded.tv_sec - decode_start.tv_sec) * 1000000000ULL + decoded.tv_nsec - decode_start.tv_nsec);
+        }
+        screen_present();
 
-void disabled_cores_0x400005(pm_table *pmt, system_info *sysinfo) {
-    int i, mask;
-    float power, voltage, fit, iddmax, freq, freqeff, c0, cc1, irm;
-    for (i = 0; i < 8; i++) {
-        power = pmta(CORE_POWER[i]);
-        voltage = pmta(CORE_VOLTAGE[i]);
-        fit = pmta(CORE_FIT[i]);
-        iddmax = pmta(CORE_IDDMAX[i]);
-        freq = pmta(CORE_FREQ[i]);
-        freqeff = pmta(CORE_FREQEFF[i]);
-        c0 = pmta(CORE_C0[i]);
-        cc1 = pmta(CORE_CC1[i]);
-        irm = pmta(CORE_IRM[i]);
-        
-        if (power == 0 && voltage == 0 && fit == 0 && iddmax == 0 && freq == 0 && freqeff == 0 && c0 == 0 && cc1 == 0 && irm == 0 ) {
-            mask = 1 << i;
-        } else {
-            mask = 0 << i;
+        //After the frame, so the decode and draw time leaves out the disk
+        if (record_file) {
+            if (recorder_append(&rec, (unsigned long long)now.tv_sec * 1000000000ULL + now.tv_nsec, pm_buf)) {
+                fprintf(stderr, "Could not write to the recording \"%s\".\n", record_file);
+                exit(0);
+            }
         }
-        sysinfo->core_disable_map_pmt = sysinfo->core_disable_map_pmt | mask;
+
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL);
     }
 }
 
-void start_pm_monitor(unsigned int force) {
+static void watch_event(void *user, const rule_set *rules, const rule_cond *cond,
+                        float value, unsigned long long timestamp_ns) {
+    char when[32], index[16] = "", text[16];
+    char *argv[] = { "sh", "-c", (char*)hook, NULL };
+    const char *state = cond->active ? "alert" : "clear";
+    struct timespec now;
+    struct tm tm;
+    pid_t pid;
+
+    //Events are rare, so wall clock and formatting stay out of the sample path
+    clock_gettime(CLOCK_REALTIME, &now);
+    gmtime_r(&now.tv_sec, &tm);
+    strftime(when, sizeof(when), "%Y-%m-%dT%H:%M:%S", &tm);
+    if (cond->element >= 0) snprintf(index, sizeof(index), " [%d]", cond->element);
+    fprintf(stdout, "%s.%03ldZ %s %s%s = %g\n", when, now.tv_nsec / 1000000, state,
+            rules->text[cond->rule], index, value);
+    fflush(stdout);
+
+    if (!hook) return;
+    setenv("RYZEN_RULE", rules->text[cond->rule], 1);
+    setenv("RYZEN_STATE", state, 1);
+    snprintf(text, sizeof(text), "%d", cond->element);
+    setenv("RYZEN_INDEX", text, 1);
+    snprintf(text, sizeof(text), "%g", value);
+    setenv("RYZEN_VALUE", text, 1);
+    //Not waited for; SIGCHLD is ignored so the children are reaped
+    if (posix_spawn(&pid, "/bin/sh", NULL, NULL, argv, environ))
+        fprintf(stderr, "Could not run the hook \"%s\".\n", hook);
+}
+
+//Headless: no screen, only the metrics the rules read are gathered and every
+//sample is a handful of float comparisons
+void start_watch_monitor(unsigned int force) {
+    static rule_set rules;
     unsigned char *pm_buf;
+    const unsigned char *table;
     pm_table pmt;
-    system_info sysinfo;
+    pm_layout layout, watched;
+    float values[PMT_METRIC_COUNT];
+    system_info sysinfo = {0};
+    struct timespec deadline, now;
+    struct sigaction sa;
+    char err[160];
+    int i;
+
+    pm_buf = setup_pm_table(force, &pmt, &layout, &sysinfo);
+    pm_values_reset(values);
+
+    rules_init(&rules);
+    for (i = 0; i < num_rule_texts; i++) {
+        if (rules_add(&rules, rule_texts[i], &pmt, sysinfo.core_disable_map, err, sizeof(err))) {
+            fprintf(stderr, "Rule \"%s\": %s.\n", rule_texts[i], err);
+            exit(-1);
+        }
+    }
+    if (!pm_layout_filter(&watched, &layout, rules.keep)) watched = layout;
 
-    if (!smu_pm_tables_supported(&obj)) {
-        fprintf(stderr, "PM Tables are not supported on this platform.\n");
-        exit(0);
+    if (hook) {
+        memset(&sa, 0, sizeof(sa));
+        sa.sa_handler = SIG_IGN;
+        sa.sa_flags = SA_NOCLDWAIT;
+        sigaction(SIGCHLD, &sa, NULL);
     }
 
-    pm_buf = calloc(obj.pm_table_size, sizeof(unsigned char));
-    if (!pm_buf) {
-        fprintf(stderr, "Could not allocate memory for the PM Table.\n");
-        exit(0);
+    fprintf(stderr, "Watching %d rules (%d comparisons) every %g s.\n", rules.num_rules,
+            rules.num_conds, update_time_s);
+
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    while(1) {
+        next_deadline(&deadline);
+
+        if (smu_read_pm_table_snapshot(&obj, pm_buf, obj.pm_table_size, &table, NULL) == SMU_Return_OK) {
+            pm_layout_gather(&watched, table, values);
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            rules_eval(&rules, values, (unsigned long long)now.tv_sec * 1000000000ULL + now.tv_nsec,
+                       watch_event, NULL);
+        }
+
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL);
     }
+}
 
-    if (force) {
-        fprintf(stderr, "Forcing to use PM Table version 0x%x. System reports version 0x%x.\n", force, obj.pm_table_version);
+//Reads one rule per line, # starts a comment
+static void load_rules(const char *file) {
+    char line[256], *p, *end;
+    FILE *f = fopen(file, "r");
+
+    if (!f) {
+        fprintf(stderr, "Could not read the rules (\"%s\").\n", file);
+        exit(-1);
+    }
+    while (fgets(line, sizeof(line), f)) {
+        if ((p = strchr(line, '#'))) *p = 0;
+        for (p = line; *p == ' ' || *p == '\t'; p++);
+        for (end = p + strlen(p); end > p && strchr(" \t\r\n", end[-1]); end--);
+        *end = 0;
+        if (!*p) continue;
+        if (num_rule_texts >= RULES_MAX_RULES || !(rule_texts[num_rule_texts++] = strdup(p))) {
+            fprintf(stderr, "Too many rules in \"%s\".\n", file);
+            exit(-1);
+        }
     }
+    fclose(f);
+}
 
-    //Select matching PM Table
-    if(!select_pm_table_version(force?force:obj.pm_table_version, &pmt, pm_buf)) {
-        fprintf(stderr, "This PM Table version (0x%x) is currently not supported.\n", force?force:obj.pm_table_version);
-        fprintf(stderr, "Processor name: %s\n", get_processor_name());
-        fprintf(stderr, "SMU FW version: %s\n", smu_get_fw_version(&obj));
-        exit(0);
+//Binds the PM Table of a freshly attached segment. Returns the table buffer.
+static unsigned char* attach_shm(ryzen_shm_t *shm, pm_table *pmt, pm_layout *layout,
+                                 system_info *sysinfo, system_data_t *sysdata) {
+    const ryzen_shm_header *hdr = shm->hdr;
+    unsigned char *table;
+
+    table = calloc(hdr->pm_table_size, sizeof(unsigned char));
+    if (!table) {
+        fprintf(stderr, "Could not allocate memory for the PM Table.\n");
+        exit(-1);
     }
-    //Prevent illegal memory access
-    if (obj.pm_table_size < pmt.min_size) {
-        fprintf(stderr, "Selected PM Table is larger than the PM Table returned by the SMU.\n");
+    if (!select_pm_table_version(hdr->pm_table_version, pmt, table) || hdr->pm_table_size < pmt->min_size) {
+        fprintf(stderr, "This PM Table version (0x%x) is currently not supported.\n", hdr->pm_table_version);
         exit(0);
     }
-    //Maximum core count. Just to be safe. Will be overwritten by get_processor_topology(...).
-    sysinfo.enabled_cores_count = pmt.max_cores;
+    pm_layout_compile(layout, pmt, table);
+
+    //Keep a copy, the segment may go away while we are showing it
+    *sysdata = hdr->sysdata;
+    sysinfo->available = 1;
+    sysinfo->cpu_name = sysdata->cpu_name;
+    sysinfo->codename = sysdata->codename;
+    sysinfo->smu_fw_ver = sysdata->smu_fw_ver;
+    sysinfo->if_ver = sysdata->if_ver;
+    sysinfo->cores = sysdata->cores;
+    sysinfo->ccds = sysdata->ccds;
+    sysinfo->ccxs = sysdata->ccxs;
+    sysinfo->cores_per_ccx = sysdata->cores_per_ccx;
+    sysinfo->core_disable_map = hdr->core_disable_map;
+    sysinfo->enabled_cores_count = sysdata->enabled_cores_count;
+
+    return table;
+}
+
+//Shows what a publisher (ryzen_monitor_exporter -s) shares. Needs neither
+//root nor the driver; reattaches when the publisher is restarted.
+void start_shm_monitor(const char *name) {
+    ryzen_shm_t *shm = NULL;
+    ryzen_shm_snapshot snap;
+    unsigned char *table = NULL;
+    unsigned long long shown = 0;
+    pm_table pmt;
+    pm_layout layout;
+    float values[PMT_METRIC_COUNT];
+    system_info sysinfo = {0};
+    system_data_t sysdata;
+    struct timespec deadline;
+    int waiting = 0;
 
-    sysinfo.cpu_name    = get_processor_name();
-    sysinfo.codename    = smu_codename_to_str(&obj);
-    sysinfo.smu_fw_ver  = smu_get_fw_version(&obj);
+    if (!name) name = RYZEN_SHM_DEFAULT_NAME;
 
-    //PMT hack for Cezanne's core_disabled_map 
-    if (obj.pm_table_version == 0x400005) {
-        if (smu_read_pm_table(&obj, pm_buf, obj.pm_table_size) == SMU_Return_OK) {
-            disabled_cores_0x400005(&pmt, &sysinfo);
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    while(1) {
+        next_deadline(&deadline);
+
+        if (!shm && (shm = ryzen_shm_open(name))) {
+            free(table);
+            table = attach_shm(shm, &pmt, &layout, &sysinfo, &sysdata);
+            pm_values_reset(values);
+            shown = 0;
+            waiting = 0;
+            screen_invalidate();
         }
-    }
-    
-    get_processor_topology(&sysinfo, pmt.zen_version);
 
-    switch (obj.smu_if_version) {
-        case IF_VERSION_9:  sysinfo.if_ver =  9; break;
-        case IF_VERSION_10: sysinfo.if_ver = 10; break;
-        case IF_VERSION_11: sysinfo.if_ver = 11; break;
-        case IF_VERSION_12: sysinfo.if_ver = 12; break;
-        case IF_VERSION_13: sysinfo.if_ver = 13; break;
-        default:            sysinfo.if_ver =  0; break;
+        if (shm && ryzen_shm_read_raw(shm, &snap, table, shm->hdr->pm_table_size) == 0) {
+            //Publishers may run slower than we poll
+            if (snap.sample_seq != shown) {
+                shown = snap.sample_seq;
+                pm_layout_gather(&layout, table, values);
+                screen_begin();
+                draw_screen(&pmt, values, &sysinfo);
+                if (limiters) draw_limiters(limiters, &pmt, values, &sysinfo, snap.timestamp_ns);
+                screen_present();
+            }
+        }
+        else {
+            //Stopped, died or has not sampled yet; look for it again
+            ryzen_shm_close(shm);
+            shm = NULL;
+            if (!waiting) {
+                waiting = 1;
+                fprintf(stderr, "Waiting for a publisher on \"%s\"...\n", name);
+            }
+        }
+
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL);
     }
+}
 
-    while(1) {
-        if (smu_read_pm_table(&obj, pm_buf, obj.pm_table_size) != SMU_Return_OK)
-            continue;
+//Shows the last frame of a recording made with -r or -b/-o.
+static void read_from_recording(char *file, unsigned int version) {
+    unsigned long long ts, first_ts = 0, last_ts = 0, frames = 0;
+    const unsigned char *table, *last = NULL;
+    unsigned char *base;
+    struct stat st;
+    pm_table pmt;
+    pm_layout layout;
+    float values[PMT_METRIC_COUNT];
+    system_info sysinfo = {0};
+    rec_reader rd;
+    int fd, ret;
+
+    fd = open(file, O_RDONLY);
+    if (fd < 0 || fstat(fd, &st)) {
+        fprintf(stderr, "Could not read the recording (\"%s\").\n", file);
+        exit(0);
+    }
+    base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED || rec_reader_init(&rd, base, st.st_size)) {
+        fprintf(stderr, "\"%s\" is not a valid recording.\n", file);
+        exit(0);
+    }
 
-        fprintf(stdout, "\e[1;1H\e[2J"); //Move cursor to (1,1); Clear entire screen
-        draw_screen(&pmt, &sysinfo);
-        fprintf(stdout, "\e[?25l"); // Hide Cursor
-        fflush(stdout);
+    while ((ret = rec_reader_next(&rd, &ts, &table)) == 1) {
+        if (!frames++) first_ts = ts;
+        last_ts = ts;
+        last = table;
+    }
+    if (ret < 0)
+        fprintf(stderr, "Recording is corrupt after frame %llu.\n", frames);
+    if (!last) {
+        fprintf(stderr, "Recording holds no frames.\n");
+        exit(0);
+    }
 
-        sleep(update_time_s);
+    if (!version) version = rd.hdr.pm_table_version;
+    if (!select_pm_table_version(version, &pmt, (unsigned char*)last) || rd.hdr.pm_table_size < pmt.min_size) {
+        fprintf(stderr, "This PM Table version (0x%x) is currently not supported.\n", version);
+        exit(0);
     }
+    fprintf(stderr, "Recording of PM Table version 0x%x: %llu frames over %.3f s, showing the last one.\n",
+            version, frames, (last_ts - first_ts) / 1e9);
+
+    sysinfo.available = 1;
+    sysinfo.cpu_name = rd.hdr.cpu_name;
+    sysinfo.codename = rd.hdr.codename;
+    sysinfo.smu_fw_ver = rd.hdr.smu_fw_ver;
+    sysinfo.if_ver = rd.hdr.if_ver;
+    sysinfo.cores = rd.hdr.cores;
+    sysinfo.ccds = rd.hdr.ccds;
+    sysinfo.ccxs = rd.hdr.ccxs;
+    sysinfo.cores_per_ccx = rd.hdr.cores_per_ccx;
+    sysinfo.core_disable_map = rd.hdr.core_disable_map;
+    sysinfo.enabled_cores_count = rd.hdr.enabled_cores_count;
+
+    pm_layout_compile(&layout, &pmt, (unsigned char*)last);
+    pm_values_reset(values);
+    pm_layout_gather(&layout, last, values);
+
+    screen_begin();
+    draw_screen(&pmt, values, &sysinfo);
+    screen_print();
+
+    rec_reader_free(&rd);
+    munmap(base, st.st_size);
 }
 
 void read_from_dumpfile(char *dumpfile, unsigned int version) {
-    unsigned char readbuf[10240];
-    unsigned int bytes_read;
+    unsigned char *readbuf;
+    size_t bytes_read;
     pm_table pmt;
+    pm_layout layout;
+    float values[PMT_METRIC_COUNT];
     system_info sysinfo;
+    struct stat st;
     FILE *fd;
 
-    if (!version) {
-        fprintf(stderr, "You need to specify a PM Table version with -f.\n");
-        exit(0);
-    }
-
-    //Read file
+    //Read file, whatever its size
     fd = fopen(dumpfile, "rb");
-    if(!fd) {
+    if(!fd || fstat(fileno(fd), &st)) {
         fprintf(stderr, "Could not read the dumpfile (\"%s\").\n", dumpfile);
         exit(0);
     }
-    bytes_read=fread(readbuf,sizeof(char),sizeof(readbuf),fd);
+    readbuf = calloc(st.st_size ? st.st_size : 1, sizeof(unsigned char));
+    if (!readbuf) {
+        fprintf(stderr, "Could not allocate memory for the dumpfile.\n");
+        exit(0);
+    }
+    bytes_read=fread(readbuf,sizeof(char),st.st_size,fd);
     fclose(fd);
 
+    if (bytes_read >= sizeof(REC_MAGIC) - 1 && !memcmp(readbuf, REC_MAGIC, sizeof(REC_MAGIC) - 1)) {
+        free(readbuf);
+        read_from_recording(dumpfile, version);
+        return;
+    }
+
+    if (!version) {
+        fprintf(stderr, "You need to specify a PM Table version with -f.\n");
+        exit(0);
+    }
+
     //Select matching PM Table
     if(!select_pm_table_version(version, &pmt, readbuf)) {
         fprintf(stderr, "This PM Table version (0x%x) is currently not supported.\n", version);
@@ -461,7 +509,7 @@ void read_from_dumpfile(char *dumpfile, unsigned int version) {
 
     //Prevent illegal memory access
     if (bytes_read < pmt.min_size) {
-        fprintf(stderr, "Read %d bytes from \"%s\", but the selected PM Table is %d bytes long.\n", bytes_read, dumpfile, pmt.min_size);
+        fprintf(stderr, "Read %zu bytes from \"%s\", but the selected PM Table is %d bytes long.\n", bytes_read, dumpfile, pmt.min_size);
         exit(0);
     }
     
@@ -470,7 +518,14 @@ void read_from_dumpfile(char *dumpfile, unsigned int version) {
     sysinfo.core_disable_map=0;
     sysinfo.cores=sysinfo.enabled_cores_count;
 
-    draw_screen(&pmt, &sysinfo);
+    pm_layout_compile(&layout, &pmt, readbuf);
+    pm_values_reset(values);
+    pm_layout_gather(&layout, readbuf, values);
+
+    screen_begin();
+    draw_screen(&pmt, values, &sysinfo);
+    screen_print();
+    free(readbuf);
 }
 
 void print_version() {
@@ -489,21 +544,64 @@ void show_help(char* program) {
             "\t-v            - Show program version.\n"
             "\t-m            - Print DRAM Timings and exit.\n"
             "\t-d            - Show disabled cores.\n"
-            "\t-u<seconds>   - Update the monitoring only after this number of second(s) have passed. Defaults to 1.\n"
+            "\t-u<seconds>   - Update the monitoring only after this number of second(s) have passed. Defaults to 1. Fractions are allowed.\n"
             "\t-f<hex-value> - Force to use a specific PM table version.\n"
-            "\t-t<filename>  - Test mode. Read PM Table from raw-dumfile. Use in conjunction with -f\n",
+            "\t-t<filename>  - Test mode. Read PM Table from raw-dumfile. Use in conjunction with -f. Recordings need no -f.\n"
+            "\t-z            - Copy the PM Table from a mapping of the driver instead of reading it, if supported.\n"
+            "\t-b<count>     - Burst mode. Read the PM Table count times, then report rate, jitter and duplicate reads.\n"
+            "\t-i<usecs>     - Interval between burst reads in microseconds. Defaults to 0 (back to back).\n"
+            "\t-o<filename>  - Write the burst to this file as a recording.\n"
+            "\t-r<filename>  - Record every PM Table read while monitoring to this file.\n"
+            "\t-x            - XOR-compress recorded frames against the previous frame.\n"
+            "\t-a<filename>  - Print min/mean/max and percentiles of every metric over a recording.\n"
+            "\t-s<name>      - Show the samples shared by a publisher instead of reading the SMU. Needs no root.\n"
+            "\t                Defaults to " RYZEN_SHM_DEFAULT_NAME ".\n"
+            "\t-n<index>     - Use this ryzen_smu instance, e.g. the second socket. Defaults to 0. -n? lists them.\n"
+            "\t-l<percent>   - Show which limit holds the clocks back and for how long every limit was binding.\n"
+            "\t                A limit counts as reached at this share of it. Defaults to 95.\n"
+            "\t-c            - Show SMU access counters: calls, errors, lock wait and driver latency.\n"
+            "\t-p            - Probe the CPU topology again instead of using the profile cached in " PROFILE_DIR ".\n"
+            "\t-w<rule>      - Headless: check the rule on every update instead of drawing, e.g. \"THM_VALUE > 90\",\n"
+            "\t                \"PPT_VALUE/PPT_LIMIT > 0.98 for 5s\" or \"CORE_CC6[*] > 99 for 30s\". Prints a line when it\n"
+            "\t                starts and stops matching. Repeatable; -w@<filename> reads one rule per line.\n"
+            "\t-e<command>   - Also run this shell command on every line of -w, with RYZEN_RULE, RYZEN_STATE,\n"
+            "\t                RYZEN_INDEX and RYZEN_VALUE set.\n",
         program
     );
 }
 
+//Initializes obj for the ryzen_smu instance with this index, see smu_enumerate()
+static int init_node(const char *node) {
+    char paths[16][SMU_MAX_PATH_LEN];
+    int i, n, index;
+
+    n = smu_enumerate(paths, 16);
+    if (n > 16) n = 16;
+
+    if (sscanf(node, "%d", &index) != 1) {
+        for (i = 0; i < n; i++)
+            fprintf(stdout, "%d: %s\n", i, paths[i]);
+        exit(0);
+    }
+    if (index < 0 || index >= n) {
+        fprintf(stderr, "There is no ryzen_smu instance %d; %d found.\n", index, n);
+        exit(-2);
+    }
+
+    return smu_init_path(&obj, paths[index]);
+}
+
 void signal_interrupt(int sig) {
     switch (sig) {
         case SIGINT:
         case SIGABRT:
         case SIGTERM:
             // Re-enable the cursor.
-            fprintf(stdout, "\e[?25h");
+            if (!headless) fprintf(stdout, "\e[?25h");
             exit(0);
+        case SIGWINCH:
+            screen_invalidate();
+            break;
         default:
             break;
     }
@@ -512,18 +610,21 @@ void signal_interrupt(int sig) {
 int main(int argc, char** argv) {
     smu_return_val ret;
     int c=0, force=0, core=0, printtimings=0;
-    char *dumpfile=0;
+    char *dumpfile=0, *analyzefile=0, *shm_name=0, *node=0;
+    int shm_reader=0;
+    burst_options burst = {0};
 
     //Set up signal handlers
     if ((signal(SIGABRT, signal_interrupt) == SIG_ERR) ||
         (signal(SIGTERM, signal_interrupt) == SIG_ERR) ||
-        (signal(SIGINT, signal_interrupt) == SIG_ERR)) {
+        (signal(SIGINT, signal_interrupt) == SIG_ERR) ||
+        (signal(SIGWINCH, signal_interrupt) == SIG_ERR)) {
         fprintf(stderr, "Can't set up signal hooks.\n");
         exit(-1);
     }
 
     //Parse arguments
-    while ((c = getopt(argc, argv, "vmd::f:t:u:h")) != -1) {
+    while ((c = getopt(argc, argv, "vmd::f:t:u:zb:i:o:r:xa:s::l::cpn:w:e:h")) != -1) {
         switch (c) {
             case 'v':
                 print_version();
@@ -551,7 +652,61 @@ int main(int argc, char** argv) {
                 dumpfile=optarg;
                 break;
             case 'u':
-                update_time_s = atoi(optarg);
+                update_time_s = atof(optarg);
+                if (update_time_s < 0.001) update_time_s = 0.001;
+                break;
+            case 'z':
+                mapped_reads = 1;
+                break;
+            case 'b':
+                burst.count = strtoul(optarg, NULL, 10);
+                break;
+            case 'i':
+                burst.interval_us = strtoul(optarg, NULL, 10);
+                break;
+            case 'o':
+                burst.outfile = optarg;
+                break;
+            case 'r':
+                record_file = optarg;
+                break;
+            case 'x':
+                record_xor = 1;
+                break;
+            case 'a':
+                analyzefile = optarg;
+                break;
+            case 's':
+                shm_reader = 1;
+                shm_name = optarg;
+                break;
+            case 'l':
+                if (!limiters && !(limiters = malloc(sizeof(*limiters)))) {
+                    fprintf(stderr, "Could not allocate memory for the limiter statistics.\n");
+                    exit(-1);
+                }
+                throttle_init(limiters, optarg ? atof(optarg) / 100.f : 0);
+                break;
+            case 'c':
+                access_stats = 1;
+                break;
+            case 'p':
+                probe = 1;
+                break;
+            case 'n':
+                node = optarg;
+                break;
+            case 'w':
+                if (optarg[0] == '@') load_rules(optarg + 1);
+                else if (num_rule_texts < RULES_MAX_RULES) rule_texts[num_rule_texts++] = optarg;
+                else {
+                    fprintf(stderr, "Too many rules, at most %d.\n", RULES_MAX_RULES);
+                    exit(-1);
+                }
+                headless = 1;
+                break;
+            case 'e':
+                hook = optarg;
                 break;
             case 'h':
                 show_help(argv[0]);
@@ -563,8 +718,22 @@ int main(int argc, char** argv) {
         }
     }
 
-    if(dumpfile && !printtimings)
+    if(analyzefile) {
+        replay_result *res = malloc(sizeof(*res));
+
+        if (!res || replay_analyze(analyzefile, force, 0, res)) {
+            fprintf(stderr, "Could not analyze the recording (\"%s\").\n", analyzefile);
+            exit(0);
+        }
+        if (res->corrupt)
+            fprintf(stderr, "Recording is corrupt; statistics cover the frames before the damage.\n");
+        replay_print(res);
+        free(res);
+    }
+    else if(dumpfile && !printtimings)
         read_from_dumpfile(dumpfile, force);
+    else if(shm_reader && !printtimings)
+        start_shm_monitor(shm_name);
     else
     {
         if (getuid() != 0 && geteuid() != 0) {
@@ -572,13 +741,27 @@ int main(int argc, char** argv) {
             exit(-2);
         }
 
-        ret = smu_init(&obj);
+        ret = node ? init_node(node) : smu_init(&obj);
         if (ret != SMU_Return_OK) {
             fprintf(stderr, "%s\n", smu_return_to_str(ret));
             exit(-2);
         }
 
-        if(printtimings) print_memory_timings();
+        if (mapped_reads && smu_map_pm_table(&obj) != SMU_Return_OK)
+            fprintf(stderr, "Driver does not support mapping the PM Table. Falling back to reading it.\n");
+
+        if(printtimings) print_memory_timings(&obj);
+        else if(burst.count) {
+            pm_table pmt;
+            pm_layout layout;
+            system_info sysinfo = {0};
+
+            free(setup_pm_table(force, &pmt, &layout, &sysinfo));
+            burst.sysinfo = &sysinfo;
+            burst.compress = record_xor;
+            return run_burst(&obj, &burst) ? -1 : 0;
+        }
+        else if (headless) start_watch_monitor(force);
         else start_pm_monitor(force);
     }
 
@@ -0,0 +1,726 @@
+/**
+ * Ryzen SMU Userspace Sensor Monitor
+ * Prometheus/OpenMetrics exporter
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#define _GNU_SOURCE
+
+#include <math.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "ryzen_monitor_lib.h"
+
+#define PROGRAM_VERSION "1.0.6"
+#define MAX_CORES 32
+
+static unsigned int interval_ms = 1000;
+static unsigned short port = 9837;
+static const char *bind_addr = "0.0.0.0";
+static unsigned int export_ms = 0;
+static int publish = 0;
+static const char *publish_name = NULL;
+static int windows = 0;
+static int limits = 0;
+static int adaptive = 0;
+static const char *push_addr = NULL;
+static unsigned int push_batch = RYZEN_PUSH_DEFAULT_BATCH;
+static int perf = 0;
+static ryzen_schedule_t schedule;
+static volatile sig_atomic_t running = 1;
+
+//Metric tables. Every entry exports one float field of a library struct.
+typedef struct {
+    const char *name;
+    const char *help;
+    size_t offset;
+} metric_field;
+
+#define FIELD(type, field, name, help) { name, help, offsetof(type, field) }
+
+static const metric_field core_fields[] = {
+    FIELD(core_data_t, frequency, "ryzen_core_frequency_mhz", "Effective core frequency"),
+    FIELD(core_data_t, power, "ryzen_core_power_watts", "Core power"),
+    FIELD(core_data_t, voltage, "ryzen_core_voltage_volts", "Core voltage"),
+    FIELD(core_data_t, temp, "ryzen_core_temperature_celsius", "Core temperature"),
+    FIELD(core_data_t, c0, "ryzen_core_c0_percent", "Core C0 residency"),
+    FIELD(core_data_t, cc1, "ryzen_core_cc1_percent", "Core CC1 residency"),
+    FIELD(core_data_t, cc6, "ryzen_core_cc6_percent", "Core CC6 residency"),
+};
+
+//Perf stage, sampled together with the PM table (-c)
+static const metric_field perf_fields[] = {
+    FIELD(ryzen_core_perf_t, utilization, "ryzen_core_utilization_percent", "Busy time of the core's CPUs from /proc/stat"),
+    FIELD(ryzen_core_perf_t, ipc, "ryzen_core_ipc", "Instructions per cycle"),
+    FIELD(ryzen_core_perf_t, instructions, "ryzen_core_instructions_per_second", "Retired instructions per second"),
+    FIELD(ryzen_core_perf_t, instructions_per_joule, "ryzen_core_instructions_per_joule", "Retired instructions per joule of core power"),
+};
+
+static const metric_field constraint_fields[] = {
+    FIELD(constraints_data_t, peak_temp, "ryzen_peak_temperature_celsius", "Peak temperature"),
+    FIELD(constraints_data_t, soc_temp, "ryzen_soc_temperature_celsius", "SoC temperature"),
+    FIELD(constraints_data_t, gfx_temp, "ryzen_gfx_temperature_celsius", "Graphics temperature"),
+    FIELD(constraints_data_t, vid_value, "ryzen_vid_volts", "Voltage ID"),
+    FIELD(constraints_data_t, vid_limit, "ryzen_vid_limit_volts", "Voltage ID limit"),
+    FIELD(constraints_data_t, ppt_value, "ryzen_ppt_watts", "Package power tracking"),
+    FIELD(constraints_data_t, ppt_limit, "ryzen_ppt_limit_watts", "Package power tracking limit"),
+    FIELD(constraints_data_t, ppt_apu_value, "ryzen_ppt_apu_watts", "APU package power tracking"),
+    FIELD(constraints_data_t, ppt_apu_limit, "ryzen_ppt_apu_limit_watts", "APU package power tracking limit"),
+    FIELD(constraints_data_t, tdc_value, "ryzen_tdc_amperes", "Thermal design current"),
+    FIELD(constraints_data_t, tdc_limit, "ryzen_tdc_limit_amperes", "Thermal design current limit"),
+    FIELD(constraints_data_t, tdc_actual, "ryzen_tdc_actual_amperes", "Thermal design current, actual"),
+    FIELD(constraints_data_t, tdc_soc_value, "ryzen_tdc_soc_amperes", "SoC thermal design current"),
+    FIELD(constraints_data_t, tdc_soc_limit, "ryzen_tdc_soc_limit_amperes", "SoC thermal design current limit"),
+    FIELD(constraints_data_t, edc_value, "ryzen_edc_amperes", "Electrical design current"),
+    FIELD(constraints_data_t, edc_limit, "ryzen_edc_limit_amperes", "Electrical design current limit"),
+    FIELD(constraints_data_t, edc_soc_value, "ryzen_edc_soc_amperes", "SoC electrical design current"),
+    FIELD(constraints_data_t, edc_soc_limit, "ryzen_edc_soc_limit_amperes", "SoC electrical design current limit"),
+    FIELD(constraints_data_t, thm_value, "ryzen_thm_celsius", "Thermal value"),
+    FIELD(constraints_data_t, thm_limit, "ryzen_thm_limit_celsius", "Thermal limit"),
+    FIELD(constraints_data_t, thm_soc_value, "ryzen_thm_soc_celsius", "SoC thermal value"),
+    FIELD(constraints_data_t, thm_soc_limit, "ryzen_thm_soc_limit_celsius", "SoC thermal limit"),
+    FIELD(constraints_data_t, thm_gfx_value, "ryzen_thm_gfx_celsius", "Graphics thermal value"),
+    FIELD(constraints_data_t, thm_gfx_limit, "ryzen_thm_gfx_limit_celsius", "Graphics thermal limit"),
+    FIELD(constraints_data_t, fit_value, "ryzen_fit_value", "Frequency integrated throttling"),
+    FIELD(constraints_data_t, fit_limit, "ryzen_fit_limit", "Frequency integrated throttling limit"),
+};
+
+static const metric_field power_fields[] = {
+    FIELD(power_data_t, total_core_power, "ryzen_total_core_power_watts", "Sum of all core power"),
+    FIELD(power_data_t, vddcr_soc_power, "ryzen_vddcr_soc_power_watts", "VDDCR_SOC power"),
+    FIELD(power_data_t, io_vddcr_soc_power, "ryzen_io_vddcr_soc_power_watts", "IO VDDCR_SOC power"),
+    FIELD(power_data_t, gmi2_vddg_power, "ryzen_gmi2_vddg_power_watts", "GMI2 VDDG power"),
+    FIELD(power_data_t, roc_power, "ryzen_roc_power_watts", "Rest of chip power"),
+    FIELD(power_data_t, l3_logic_power, "ryzen_l3_logic_power_watts", "L3 logic power"),
+    FIELD(power_data_t, l3_vddm_power, "ryzen_l3_vddm_power_watts", "L3 VDDM power"),
+    FIELD(power_data_t, vddio_mem_power, "ryzen_vddio_mem_power_watts", "VDDIO_MEM power"),
+    FIELD(power_data_t, iod_vddio_mem_power, "ryzen_iod_vddio_mem_power_watts", "IOD VDDIO_MEM power"),
+    FIELD(power_data_t, ddr_vddp_power, "ryzen_ddr_vddp_power_watts", "DDR VDDP power"),
+    FIELD(power_data_t, ddr_phy_power, "ryzen_ddr_phy_power_watts", "DDR PHY power"),
+    FIELD(power_data_t, vdd18_power, "ryzen_vdd18_power_watts", "VDD18 power"),
+    FIELD(power_data_t, io_display_power, "ryzen_io_display_power_watts", "Display IO power"),
+    FIELD(power_data_t, io_usb_power, "ryzen_io_usb_power_watts", "USB IO power"),
+    FIELD(power_data_t, socket_power, "ryzen_socket_power_watts", "Socket power"),
+    FIELD(power_data_t, package_power, "ryzen_package_power_watts", "Package power"),
+    FIELD(power_data_t, vddcr_cpu_power, "ryzen_vddcr_cpu_power_watts", "VDDCR_CPU power"),
+    FIELD(power_data_t, soc_telemetry_voltage, "ryzen_soc_telemetry_volts", "SoC SVI2 voltage"),
+    FIELD(power_data_t, soc_telemetry_current, "ryzen_soc_telemetry_amperes", "SoC SVI2 current"),
+    FIELD(power_data_t, soc_telemetry_power, "ryzen_soc_telemetry_watts", "SoC SVI2 power"),
+    FIELD(power_data_t, cpu_telemetry_voltage, "ryzen_cpu_telemetry_volts", "Core SVI2 voltage"),
+    FIELD(power_data_t, cpu_telemetry_current, "ryzen_cpu_telemetry_amperes", "Core SVI2 current"),
+    FIELD(power_data_t, cpu_telemetry_power, "ryzen_cpu_telemetry_watts", "Core SVI2 power"),
+};
+
+static const metric_field memory_fields[] = {
+    FIELD(memory_data_t, fclk_freq, "ryzen_fclk_mhz", "Infinity Fabric clock"),
+    FIELD(memory_data_t, fclk_freq_eff, "ryzen_fclk_effective_mhz", "Effective Infinity Fabric clock"),
+    FIELD(memory_data_t, uclk_freq, "ryzen_uclk_mhz", "Memory controller clock"),
+    FIELD(memory_data_t, memclk_freq, "ryzen_memclk_mhz", "Memory clock"),
+    FIELD(memory_data_t, v_vddm, "ryzen_vddm_volts", "VDDM voltage"),
+    FIELD(memory_data_t, v_vddp, "ryzen_vddp_volts", "VDDP voltage"),
+    FIELD(memory_data_t, v_vddg, "ryzen_vddg_volts", "VDDG voltage"),
+    FIELD(memory_data_t, v_vddg_iod, "ryzen_vddg_iod_volts", "IOD VDDG voltage"),
+    FIELD(memory_data_t, v_vddg_ccd, "ryzen_vddg_ccd_volts", "CCD VDDG voltage"),
+};
+
+//Rolling window summaries, see ryzen_agg_stat()
+typedef struct {
+    int series;
+    const char *name;
+    const char *help;
+} window_series;
+
+static const window_series window_fields[] = {
+    { RYZEN_SERIES_CORE_FREQUENCY, "ryzen_core_frequency_mhz_window", "Effective core frequency over a rolling window" },
+    { RYZEN_SERIES_CORE_TEMP, "ryzen_core_temperature_celsius_window", "Core temperature over a rolling window" },
+    { RYZEN_SERIES_PPT, "ryzen_ppt_watts_window", "Package power tracking over a rolling window" },
+    { RYZEN_SERIES_EDC, "ryzen_edc_amperes_window", "Electrical design current over a rolling window" },
+    { RYZEN_SERIES_SOCKET_POWER, "ryzen_socket_power_watts_window", "Socket power over a rolling window" },
+};
+
+static const char *window_names[RYZEN_WINDOW_COUNT] = { "1s", "10s", "60s" };
+
+#define NUM(a) (sizeof(a) / sizeof((a)[0]))
+#define FIELD_VALUE(base, f) (*(const float*)((const char*)(base) + (f)->offset))
+
+//Pre-serialized response body. Shared between the builder and the server,
+//freed by whoever drops the last reference.
+typedef struct {
+    atomic_int refs;
+    size_t len;
+    size_t cap;
+    char data[];
+} metrics_body;
+
+static pthread_mutex_t body_lock = PTHREAD_MUTEX_INITIALIZER;
+static metrics_body *current_body = NULL;
+
+static void body_put(metrics_body *b) {
+    if (b && atomic_fetch_sub(&b->refs, 1) == 1)
+        free(b);
+}
+
+static metrics_body *body_get(void) {
+    metrics_body *b;
+
+    pthread_mutex_lock(&body_lock);
+    b = current_body;
+    if (b) atomic_fetch_add(&b->refs, 1);
+    pthread_mutex_unlock(&body_lock);
+    return b;
+}
+
+static void body_publish(metrics_body *b) {
+    metrics_body *old;
+
+    pthread_mutex_lock(&body_lock);
+    old = current_body;
+    current_body = b;
+    pthread_mutex_unlock(&body_lock);
+    body_put(old);
+}
+
+static void body_printf(metrics_body **bp, const char *format, ...) {
+    metrics_body *b = *bp;
+    va_list list;
+    int len;
+
+    for (;;) {
+        va_start(list, format);
+        len = vsnprintf(b->data + b->len, b->cap - b->len, format, list);
+        va_end(list);
+        if (len < 0) return;
+        if (b->len + len < b->cap) break;
+
+        b = realloc(b, sizeof(*b) + b->cap * 2);
+        if (!b) {
+            fprintf(stderr, "Could not allocate memory for the metrics.\n");
+            exit(-1);
+        }
+        b->cap *= 2;
+        *bp = b;
+    }
+    b->len += len;
+}
+
+//Label values escape backslash, double quote and newline
+static const char *label_escape(char *dst, size_t len, const char *src) {
+    size_t n = 0;
+
+    for (; src && *src && n + 2 < len; src++) {
+        if (*src == '\\' || *src == '"' || *src == '\n') dst[n++] = '\\';
+        dst[n++] = *src == '\n' ? 'n' : *src;
+    }
+    dst[n] = 0;
+    return dst;
+}
+
+//NAN marks fields the PM table of this CPU does not have
+static void emit_value(metrics_body **b, float value) {
+    if (isnan(value)) body_printf(b, " NaN\n");
+    else body_printf(b, " %g\n", value);
+}
+
+static void emit_family(metrics_body **b, const metric_field *f) {
+    body_printf(b, "# HELP %s %s\n# TYPE %s gauge\n", f->name, f->help, f->name);
+}
+
+static void emit_fields(metrics_body **b, const metric_field *fields, size_t num, const void *data) {
+    for (size_t i = 0; i < num; i++) {
+        emit_family(b, &fields[i]);
+        body_printf(b, "%s", fields[i].name);
+        emit_value(b, FIELD_VALUE(data, &fields[i]));
+    }
+}
+
+static void emit_window(metrics_body **b, const char *name, const char *labels, const ryzen_window_stat_t *st) {
+    static const char *stat_names[] = { "min", "max", "mean", "stddev", "p50", "p90", "p99" };
+    const float values[] = { st->min, st->max, st->mean, st->stddev, st->p50, st->p90, st->p99 };
+
+    for (size_t i = 0; i < NUM(stat_names); i++) {
+        body_printf(b, "%s{%sstat=\"%s\"}", name, labels, stat_names[i]);
+        emit_value(b, values[i]);
+    }
+}
+
+static void emit_windows(metrics_body **b, ryzen_agg_t *agg, const core_data_t *cores, int num_cores, int per_ccd) {
+    ryzen_window_stat_t st;
+    char labels[64];
+
+    for (size_t f = 0; f < NUM(window_fields); f++) {
+        int per_core = window_fields[f].series == RYZEN_SERIES_CORE_FREQUENCY ||
+                       window_fields[f].series == RYZEN_SERIES_CORE_TEMP;
+
+        body_printf(b, "# HELP %s %s\n# TYPE %s gauge\n", window_fields[f].name, window_fields[f].help, window_fields[f].name);
+        for (int w = 0; w < RYZEN_WINDOW_COUNT; w++) {
+            for (int i = 0; i < (per_core ? num_cores : 1); i++) {
+                if (per_core && cores[i].disabled) continue;
+                if (ryzen_agg_stat(agg, w, window_fields[f].series, per_core ? i : 0, &st) || !st.count) continue;
+
+                if (per_core)
+                    snprintf(labels, sizeof(labels), "core=\"%d\",ccd=\"%d\",window=\"%s\",", i, i / per_ccd, window_names[w]);
+                else
+                    snprintf(labels, sizeof(labels), "window=\"%s\",", window_names[w]);
+                emit_window(b, window_fields[f].name, labels, &st);
+            }
+        }
+    }
+}
+
+//Time attribution of ryzen_throttle_update(), exported as counters so rates
+//over any range give the share of time a limit held the clocks back
+static void emit_limits(metrics_body **b, ryzen_throttle_t *throttle) {
+    ryzen_throttle_stats_t st;
+
+    if (ryzen_throttle_stats(throttle, &st)) return;
+
+    body_printf(b, "# HELP ryzen_limit_binding Limit binding in the newest sample\n# TYPE ryzen_limit_binding gauge\n");
+    for (int i = 0; i < RYZEN_LIMIT_COUNT; i++)
+        body_printf(b, "ryzen_limit_binding{limit=\"%s\"} %d\n", ryzen_limit_name(i), st.binding == i);
+
+    body_printf(b, "# HELP ryzen_limit_binding_seconds Time the limit was the binding one\n"
+                   "# TYPE ryzen_limit_binding_seconds counter\n");
+    for (int i = 0; i < RYZEN_LIMIT_COUNT; i++)
+        body_printf(b, "ryzen_limit_binding_seconds_total{limit=\"%s\"} %.9f\n", ryzen_limit_name(i), st.binding_ns[i] / 1e9);
+
+    body_printf(b, "# HELP ryzen_limit_reached_seconds Time the limit was reached, binding or not\n"
+                   "# TYPE ryzen_limit_reached_seconds counter\n");
+    for (int i = RYZEN_LIMIT_NONE + 1; i < RYZEN_LIMIT_COUNT; i++)
+        body_printf(b, "ryzen_limit_reached_seconds_total{limit=\"%s\"} %.9f\n", ryzen_limit_name(i), st.active_ns[i] / 1e9);
+
+    body_printf(b, "# HELP ryzen_limit_episodes Times the limit became the binding one\n"
+                   "# TYPE ryzen_limit_episodes counter\n");
+    for (int i = RYZEN_LIMIT_NONE + 1; i < RYZEN_LIMIT_COUNT; i++)
+        body_printf(b, "ryzen_limit_episodes_total{limit=\"%s\"} %llu\n", ryzen_limit_name(i), st.episodes[i]);
+
+    //Only bins that were ever hit, the rest would be hundreds of zeros
+    body_printf(b, "# HELP ryzen_limit_core_seconds Core time per effective frequency bin while the limit was binding\n"
+                   "# TYPE ryzen_limit_core_seconds counter\n");
+    for (int i = 0; i < RYZEN_LIMIT_COUNT; i++) {
+        for (int j = 0; j < RYZEN_FREQ_BINS; j++) {
+            if (!st.freq_ns[i][j]) continue;
+            body_printf(b, "ryzen_limit_core_seconds_total{limit=\"%s\",mhz=\"%d\"} %.9f\n",
+                        ryzen_limit_name(i), j * RYZEN_FREQ_BIN_MHZ, st.freq_ns[i][j] / 1e9);
+        }
+    }
+}
+
+static metrics_body *build_body(const system_data_t *sys, const core_data_t *cores, int num_cores,
+                                const constraints_data_t *constraints, const memory_data_t *memory,
+                                const power_data_t *power, const calculated_stats_t *stats,
+                                const ryzen_sample_info_t *info, const ryzen_core_perf_t *core_perf,
+                                int num_perf, ryzen_agg_t *agg, ryzen_throttle_t *throttle,
+                                unsigned int sample_ms, size_t cap) {
+    metrics_body *b = malloc(sizeof(*b) + cap);
+    char cpu[256], codename[64], smu_fw[64];
+    int per_ccd = sys->ccds > 0 && num_cores >= sys->ccds ? num_cores / sys->ccds : num_cores;
+
+    if (!b) return NULL;
+    atomic_init(&b->refs, 1);
+    b->len = 0;
+    b->cap = cap;
+
+    body_printf(&b, "# HELP ryzen_info CPU and SMU firmware\n# TYPE ryzen_info gauge\n");
+    body_printf(&b, "ryzen_info{cpu=\"%s\",codename=\"%s\",smu_fw=\"%s\",if_ver=\"%d\",cores=\"%d\",ccds=\"%d\"} 1\n",
+                label_escape(cpu, sizeof(cpu), sys->cpu_name),
+                label_escape(codename, sizeof(codename), sys->codename),
+                label_escape(smu_fw, sizeof(smu_fw), sys->smu_fw_ver), sys->if_ver, sys->cores, sys->ccds);
+    body_printf(&b, "# HELP ryzen_sample_seq Sequence number of the exported PM table sample\n"
+                    "# TYPE ryzen_sample_seq counter\nryzen_sample_seq_total %llu\n", info->seq);
+    if (adaptive)
+        body_printf(&b, "# HELP ryzen_sample_interval_seconds Current adaptive sampling interval\n"
+                        "# TYPE ryzen_sample_interval_seconds gauge\nryzen_sample_interval_seconds %g\n",
+                    sample_ms / 1000.0);
+
+    for (size_t f = 0; f < NUM(core_fields); f++) {
+        emit_family(&b, &core_fields[f]);
+        for (int i = 0; i < num_cores; i++) {
+            if (cores[i].disabled) continue;
+            body_printf(&b, "%s{core=\"%d\",ccd=\"%d\"}", core_fields[f].name, i, i / per_ccd);
+            emit_value(&b, FIELD_VALUE(&cores[i], &core_fields[f]));
+        }
+    }
+    body_printf(&b, "# HELP ryzen_core_sleeping Core spent less than 6%% of the time in C0\n"
+                    "# TYPE ryzen_core_sleeping gauge\n");
+    for (int i = 0; i < num_cores; i++) {
+        if (cores[i].disabled) continue;
+        body_printf(&b, "ryzen_core_sleeping{core=\"%d\",ccd=\"%d\"} %d\n", i, i / per_ccd, cores[i].sleeping);
+    }
+    for (size_t f = 0; f < NUM(perf_fields) && num_perf > 0; f++) {
+        emit_family(&b, &perf_fields[f]);
+        for (int i = 0; i < num_perf && i < num_cores; i++) {
+            if (cores[i].disabled) continue;
+            body_printf(&b, "%s{core=\"%d\",ccd=\"%d\"}", perf_fields[f].name, i, i / per_ccd);
+            emit_value(&b, FIELD_VALUE(&core_perf[i], &perf_fields[f]));
+        }
+    }
+
+    emit_fields(&b, constraint_fields, NUM(constraint_fields), constraints);
+    emit_fields(&b, power_fields, NUM(power_fields), power);
+    emit_fields(&b, memory_fields, NUM(memory_fields), memory);
+    body_printf(&b, "# HELP ryzen_memory_coupled UCLK runs at MEMCLK\n# TYPE ryzen_memory_coupled gauge\n"
+                    "ryzen_memory_coupled %d\n", memory->coupled_mode);
+
+    body_printf(&b, "# HELP ryzen_package_cc6_percent Package C6 residency\n"
+                    "# TYPE ryzen_package_cc6_percent gauge\nryzen_package_cc6_percent");
+    emit_value(&b, stats->package_cc6);
+    if (agg)
+        emit_windows(&b, agg, cores, num_cores, per_ccd);
+    if (throttle)
+        emit_limits(&b, throttle);
+    body_printf(&b, "# EOF\n");
+
+    return b;
+}
+
+static unsigned long long monotonic_ms(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+//Rebuilds the body whenever the sampler publishes a new PM table, at most
+//every export_ms. The windows still see every sample.
+static void *builder_main(void *arg) {
+    ryzen_session_t *session = arg;
+    ryzen_agg_t *agg = NULL;
+    ryzen_throttle_t *throttle = NULL;
+    unsigned long long seq = 0, built_ms = 0;
+    system_data_t sys;
+    core_data_t cores[MAX_CORES];
+    constraints_data_t constraints;
+    memory_data_t memory;
+    power_data_t power;
+    graphics_data_t graphics;
+    calculated_stats_t stats;
+    ryzen_sample_info_t info;
+    ryzen_core_perf_t core_perf[MAX_CORES];
+    size_t cap = 16384;
+
+    ryzen_session_info(session, &sys);
+    if (windows && !(agg = ryzen_agg_create(session))) {
+        fprintf(stderr, "Could not allocate the aggregation windows.\n");
+        exit(-1);
+    }
+    if (limits && !(throttle = ryzen_throttle_create(session, 0))) {
+        fprintf(stderr, "Could not allocate the limiter counters.\n");
+        exit(-1);
+    }
+
+    while (running) {
+        unsigned long long next = ryzen_sampler_wait(session, seq, 1000);
+        metrics_body *b;
+        int n, num_perf = 0;
+
+        if (!next) continue;
+        seq = next;
+        if (agg) ryzen_agg_update(agg);
+        if (throttle) ryzen_throttle_update(throttle);
+        if (export_ms && monotonic_ms() - built_ms < export_ms) continue;
+        built_ms = monotonic_ms();
+
+        n = ryzen_read_latest(session, cores, MAX_CORES, &constraints, &memory, &power, &graphics, &stats, &info);
+        if (n <= 0) continue;
+        //Same snapshot as long as the sampler has not moved on in between
+        if (perf) {
+            ryzen_sample_info_t perf_info;
+
+            num_perf = ryzen_read_perf(session, core_perf, MAX_CORES, &perf_info);
+            if (num_perf < 0 || perf_info.seq != info.seq) num_perf = 0;
+        }
+
+        b = build_body(&sys, cores, n, &constraints, &memory, &power, &stats, &info, core_perf, num_perf,
+                       agg, throttle, ryzen_sampler_interval(session), cap);
+        if (!b) continue;
+        cap = b->cap; //Start the next body at the size this one needed
+        body_publish(b);
+    }
+
+    ryzen_agg_free(agg);
+    ryzen_throttle_free(throttle);
+    return NULL;
+}
+
+static void write_all(int fd, const char *data, size_t len) {
+    while (len) {
+        ssize_t n = write(fd, data, len);
+
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return;
+        data += n;
+        len -= n;
+    }
+}
+
+static void respond(int fd, const char *status, const char *type, const char *body, size_t len) {
+    char header[256];
+    int n = snprintf(header, sizeof(header),
+                     "HTTP/1.1 %s\r\nContent-Type: %s\r\nContent-Length: %zu\r\nConnection: close\r\n\r\n",
+                     status, type, len);
+
+    write_all(fd, header, n);
+    write_all(fd, body, len);
+}
+
+static void handle_client(int fd) {
+    struct timeval tv = { 2, 0 };
+    char req[2048];
+    size_t len = 0;
+    ssize_t n;
+
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+    //Only the request line matters
+    while (len < sizeof(req) - 1 && (n = read(fd, req + len, sizeof(req) - 1 - len)) > 0) {
+        len += n;
+        req[len] = 0;
+        if (strstr(req, "\r\n\r\n") || strstr(req, "\n\n")) break;
+    }
+    req[len] = 0;
+
+    if (!strncmp(req, "GET /metrics ", 13) || !strncmp(req, "GET /metrics?", 13)) {
+        metrics_body *b = body_get();
+
+        if (b) {
+            respond(fd, "200 OK", "application/openmetrics-text; version=1.0.0; charset=utf-8", b->data, b->len);
+            body_put(b);
+        }
+        else {
+            respond(fd, "503 Service Unavailable", "text/plain", "No sample yet\n", 14);
+        }
+    }
+    else if (!strncmp(req, "GET / ", 6)) {
+        static const char page[] = "<html><body><a href=\"/metrics\">Metrics</a></body></html>\n";
+        respond(fd, "200 OK", "text/html", page, sizeof(page) - 1);
+    }
+    else {
+        respond(fd, "404 Not Found", "text/plain", "Not found\n", 10);
+    }
+}
+
+static void signal_interrupt(int sig) {
+    (void)sig;
+    running = 0;
+}
+
+static void show_help(char *program) {
+    fprintf(stdout,
+        "Ryzen Monitor Exporter " PROGRAM_VERSION "\n\n"
+
+        "Usage: %s <option(s)>\n\n"
+
+        "Options:\n"
+            "\t-h            - Show this help screen.\n"
+            "\t-p<port>      - Port to serve /metrics on. Defaults to 9837, 0 disables the HTTP server.\n"
+            "\t-l<address>   - Address to listen on. Defaults to 0.0.0.0.\n"
+            "\t-i<msecs>     - Sampling interval in milliseconds. Defaults to 1000.\n"
+            "\t-a[fast:idle] - Adaptive sampling: every fast msecs while PPT, EDC or THM exceed 80/80/90%%\n"
+            "\t                of their limit or a core is over 50%% busy, backing off toward idle msecs\n"
+            "\t                otherwise. Defaults to 100:2000.\n"
+            "\t-e<msecs>     - Rebuild the metrics at most this often. Defaults to every sample.\n"
+            "\t-w            - Export min/max/mean/stddev/p50/p90/p99 over 1, 10 and 60 second windows.\n"
+            "\t                Combine with a short -i and a longer -e to summarize fast sampling.\n"
+            "\t-t            - Export for how long every limit (PPT, TDC, EDC, THM, ...) held the clocks back.\n"
+            "\t-c            - Export per core IPC, instructions per second and per joule from perf counters,\n"
+            "\t                and OS utilization from /proc/stat, sampled together with the PM Table.\n"
+            "\t-z            - Copy the PM Table from a mapping of the driver instead of reading it, if supported.\n"
+            "\t-s<name>      - Also publish every sample to shared memory for ryzen_monitor -s and\n"
+            "\t                other readers. Defaults to " RYZEN_SHM_DEFAULT_NAME ".\n"
+            "\t-f<host:port> - Also push every sample to ryzen_monitor_collector over UDP. The port\n"
+            "\t                defaults to %u.\n"
+            "\t-b<samples>   - Samples per datagram for -f. Defaults to %u.\n",
+        program, RYZEN_PUSH_DEFAULT_PORT, RYZEN_PUSH_DEFAULT_BATCH
+    );
+}
+
+int main(int argc, char **argv) {
+    struct sockaddr_in addr;
+    struct sigaction sa;
+    sigset_t mask;
+    ryzen_session_t *session;
+    pthread_t builder;
+    int c, sock = -1, one = 1, mapped_reads = 0;
+
+    while ((c = getopt(argc, argv, "p:l:i:a::e:wtczs::f:b:h")) != -1) {
+        switch (c) {
+            case 'p':
+                port = atoi(optarg);
+                break;
+            case 'l':
+                bind_addr = optarg;
+                break;
+            case 'i':
+                interval_ms = atoi(optarg);
+                break;
+            case 'a':
+                adaptive = 1;
+                ryzen_schedule_defaults(&schedule);
+                if (optarg && sscanf(optarg, "%u:%u", &schedule.fast_ms, &schedule.idle_ms) != 2) {
+                    fprintf(stderr, "Expected -a<fast msecs>:<idle msecs>.\n");
+                    exit(-1);
+                }
+                break;
+            case 'e':
+                export_ms = atoi(optarg);
+                break;
+            case 'w':
+                windows = 1;
+                break;
+            case 't':
+                limits = 1;
+                break;
+            case 'c':
+                perf = 1;
+                break;
+            case 'z':
+                mapped_reads = 1;
+                break;
+            case 's':
+                publish = 1;
+                publish_name = optarg;
+                break;
+            case 'f':
+                push_addr = optarg;
+                break;
+            case 'b':
+                push_batch = atoi(optarg);
+                break;
+            case 'h':
+                show_help(argv[0]);
+                exit(0);
+            default:
+                exit(0);
+        }
+    }
+
+    //Let accept() return on SIGINT/SIGTERM instead of restarting
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = signal_interrupt;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    if (getuid() != 0 && geteuid() != 0) {
+        fprintf(stderr, "Program must be run as root.\n");
+        exit(-2);
+    }
+
+    session = ryzen_session_open();
+    if (!session) {
+        fprintf(stderr, "Could not open the SMU or this PM Table version is not supported.\n");
+        exit(-2);
+    }
+    if (mapped_reads && ryzen_enable_mapped_reads() != 0)
+        fprintf(stderr, "Driver does not support mapping the PM Table. Falling back to reading it.\n");
+
+    if (port) {
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        if (inet_pton(AF_INET, bind_addr, &addr.sin_addr) != 1) {
+            fprintf(stderr, "Invalid listen address \"%s\".\n", bind_addr);
+            exit(-1);
+        }
+
+        sock = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        if (sock < 0 || bind(sock, (struct sockaddr*)&addr, sizeof(addr)) || listen(sock, 16)) {
+            fprintf(stderr, "Could not listen on %s:%u: %s\n", bind_addr, port, strerror(errno));
+            exit(-1);
+        }
+    }
+    else if (!publish && !push_addr) {
+        fprintf(stderr, "Nothing to do without the HTTP server, -s or -f.\n");
+        exit(0);
+    }
+
+    if (perf) {
+        int sources = ryzen_perf_enable(session);
+
+        if (sources < 0) {
+            fprintf(stderr, "Could not read perf counters or /proc/stat.\n");
+            exit(-1);
+        }
+        if (!(sources & RYZEN_PERF_COUNTERS))
+            fprintf(stderr, "Perf counters are not available, exporting utilization only.\n");
+    }
+
+    //Signals must interrupt accept() on this thread, not land on a worker
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &mask, NULL);
+    if (ryzen_sampler_start(session, adaptive ? schedule.fast_ms : interval_ms, 0) ||
+        (adaptive && ryzen_sampler_schedule(session, &schedule)) ||
+        (port && pthread_create(&builder, NULL, builder_main, session))) {
+        fprintf(stderr, "Could not start sampling.\n");
+        exit(-1);
+    }
+    if (publish && ryzen_shm_publish(session, publish_name)) {
+        fprintf(stderr, "Could not publish to shared memory \"%s\": %s\n",
+                publish_name ? publish_name : RYZEN_SHM_DEFAULT_NAME, strerror(errno));
+        exit(-1);
+    }
+    if (push_addr && ryzen_push_start(session, push_addr, NULL, push_batch)) {
+        fprintf(stderr, "Could not push to \"%s\".\n", push_addr);
+        exit(-1);
+    }
+    pthread_sigmask(SIG_UNBLOCK, &mask, NULL);
+
+    if (push_addr)
+        fprintf(stderr, "Pushing samples to %s\n", push_addr);
+    if (publish)
+        fprintf(stderr, "Publishing samples to shared memory \"%s\"\n",
+                publish_name ? publish_name : RYZEN_SHM_DEFAULT_NAME);
+    if (port) {
+        fprintf(stderr, "Serving metrics on http://%s:%u/metrics\n", bind_addr, port);
+
+        while (running) {
+            int fd = accept4(sock, NULL, NULL, SOCK_CLOEXEC);
+
+            if (fd < 0) continue;
+            handle_client(fd);
+            close(fd);
+        }
+
+        close(sock);
+        pthread_join(builder, NULL);
+        body_publish(NULL);
+    }
+    else {
+        while (running)
+            pause();
+    }
+
+    ryzen_session_close(session);
+    ryzen_cleanup();
+    return 0;
+}
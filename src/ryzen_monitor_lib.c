@@ -5,327 +5,716 @@
 
 #define _GNU_SOURCE
 
-#include "ryzen_monitor_lib.h"
-#include "lib/libsmu.h"
-#include "pm_tables.h"
-#include "readinfo.h"
+#include "ryzen_session.h"
+#include "core_calc.h"
+#include "profile.h"
 #include <math.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
-smu_obj_t obj;
+_Static_assert(RYZEN_SOA_MAX_CORES >= PMT_MAX_NUM_CORES,
+               "ryzen_soa_t must hold every core of a PM table");
+
+// State of the classic API only. Sessions never touch it, so threads with
+// sessions of their own never wait for each other here.
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Default device, initialized by ryzen_init()
+static smu_obj_t obj;
 static int g_initialized = 0;
 
-#define pmta(elem) ((pmt.elem) ? (*(pmt.elem)) : NAN)
-#define pmta0(elem) ((pmt.elem) ? (*(pmt.elem)) : 0)
+// Session backing the classic ryzen_get_system_info()/ryzen_read_data() API
+static ryzen_session_t *g_session = NULL;
+
+static int device_init(smu_obj_t *smu, const char *path) {
+  if ((path ? smu_init_path(smu, path) : smu_init(smu)) != SMU_Return_OK)
+    return RYZEN_ERR_DRIVER;
+
+  if (!smu_pm_tables_supported(smu)) {
+    smu_free(smu);
+    return RYZEN_ERR_UNSUPPORTED;
+  }
+  return RYZEN_OK;
+}
+
+static int init_locked(void) {
+  int ret;
+
+  if (g_initialized)
+    return RYZEN_OK;
+
+  ret = device_init(&obj, NULL);
+  if (ret == RYZEN_OK)
+    g_initialized = 1;
+  return ret;
+}
 
 // Initialize the library
 int ryzen_init(void) {
+  int ret;
+
+  pthread_mutex_lock(&g_lock);
+  ret = init_locked();
+  pthread_mutex_unlock(&g_lock);
+  return ret;
+}
+
+// Cleanup
+void ryzen_cleanup(void) {
+  pthread_mutex_lock(&g_lock);
+  if (g_initialized) {
+    ryzen_session_close(g_session);
+    g_session = NULL;
+    smu_free(&obj);
+    g_initialized = 0;
+  }
+  pthread_mutex_unlock(&g_lock);
+}
+
+// Switch to mapped PM table reads if the driver supports them
+int ryzen_enable_mapped_reads(void) {
+  int ret = -1;
+
+  pthread_mutex_lock(&g_lock);
   if (g_initialized)
+    ret = smu_map_pm_table(&obj) == SMU_Return_OK ? 0 : -1;
+  pthread_mutex_unlock(&g_lock);
+  return ret;
+}
+
+const char *ryzen_strerror(int err) {
+  switch (err) {
+  case RYZEN_OK:
+    return "Success";
+  case RYZEN_ERR_DRIVER:
+    return "ryzen_smu driver missing, inaccessible or unsupported";
+  case RYZEN_ERR_UNSUPPORTED:
+    return "PM table not available or version not supported";
+  case RYZEN_ERR_NO_DEVICE:
+    return "No such ryzen_smu device";
+  case RYZEN_ERR_NO_MEMORY:
+    return "Out of memory";
+  case RYZEN_ERR_TOPOLOGY:
+    return "Could not read the CPU topology fuses";
+  case RYZEN_ERR_INVALID:
+    return "Invalid argument";
+  default:
+    return "Unknown error";
+  }
+}
+
+static int if_version_to_int(smu_if_version ver) {
+  switch (ver) {
+  case IF_VERSION_9:
+    return 9;
+  case IF_VERSION_10:
+    return 10;
+  case IF_VERSION_11:
+    return 11;
+  case IF_VERSION_12:
+    return 12;
+  case IF_VERSION_13:
+    return 13;
+  default:
     return 0;
+  }
+}
 
-  smu_return_val ret = smu_init(&obj);
-  if (ret != SMU_Return_OK) {
-    return -1;
+#define SESSION_ALIGN 64
+#define SESSION_TABLE_OFFSET                                                   \
+  ((sizeof(struct ryzen_session) + SESSION_ALIGN - 1) &                        \
+   ~(size_t)(SESSION_ALIGN - 1))
+
+// Resolve everything a session needs from an initialized device. The
+// session owns device (if not NULL) from here on, also on failure.
+static int session_open(smu_obj_t *smu, smu_obj_t *device,
+                        ryzen_session_t **out) {
+  ryzen_session_t *s;
+  system_info *sysinfo;
+  system_data_t *sysdata;
+  int ret = RYZEN_ERR_UNSUPPORTED;
+
+  // One block for the session and its table buffer, the table on a cache
+  // line of its own
+  if (posix_memalign((void **)&s, SESSION_ALIGN,
+                     SESSION_TABLE_OFFSET + smu->pm_table_size) != 0) {
+    if (device) {
+      smu_free(device);
+      free(device);
+    }
+    return RYZEN_ERR_NO_MEMORY;
+  }
+  memset(s, 0, SESSION_TABLE_OFFSET + smu->pm_table_size);
+
+  s->smu = smu;
+  s->device = device;
+  s->pm_buf = (unsigned char *)s + SESSION_TABLE_OFFSET;
+
+  if (!select_pm_table_version(smu->pm_table_version, &s->pmt, s->pm_buf))
+    goto _ERROR;
+
+  // Prevent illegal memory access
+  if (smu->pm_table_size < s->pmt.min_size)
+    goto _ERROR;
+
+  if (!pm_layout_compile(&s->layout, &s->pmt, s->pm_buf))
+    goto _ERROR;
+  ryzen_session_select_decoder(s, 1);
+
+  // Strings live in the session, nothing points to shared buffers
+  sysinfo = &s->sysinfo;
+  sysdata = &s->sysdata;
+  strncpy(sysdata->codename, smu_codename_to_str(smu),
+          sizeof(sysdata->codename) - 1);
+  strncpy(sysdata->smu_fw_ver, smu_get_fw_version(smu),
+          sizeof(sysdata->smu_fw_ver) - 1);
+  sysinfo->codename = sysdata->codename;
+  sysinfo->smu_fw_ver = sysdata->smu_fw_ver;
+  sysinfo->enabled_cores_count = s->pmt.max_cores;
+  sysinfo->if_ver = if_version_to_int(smu->smu_if_version);
+
+  // The cached profile skips CPUID, the SMN fuse reads and the PM table read
+  if (!profile_load(smu, smu->pm_table_version, sysinfo, sysdata->cpu_name,
+                    sizeof(sysdata->cpu_name))) {
+    sysinfo->cpu_name = get_processor_name_r(sysdata->cpu_name,
+                                             sizeof(sysdata->cpu_name));
+
+    // PMT hack for Cezanne's core_disabled_map
+    if (smu->pm_table_version == 0x400005 &&
+        smu_read_pm_table(smu, s->pm_buf, smu->pm_table_size) == SMU_Return_OK)
+      sysinfo->core_disable_map_pmt = disabled_cores_0x400005(&s->pmt);
+
+    if (get_processor_topology(smu, sysinfo, s->pmt.zen_version)) {
+      ret = RYZEN_ERR_TOPOLOGY;
+      goto _ERROR;
+    }
+    profile_save(smu, smu->pm_table_version, sysinfo);
   }
 
-  if (!smu_pm_tables_supported(&obj)) {
-    return -2;
+  sysdata->cores = sysinfo->cores;
+  sysdata->ccds = sysinfo->ccds;
+  sysdata->ccxs = sysinfo->ccxs;
+  sysdata->cores_per_ccx = sysinfo->cores_per_ccx;
+  sysdata->if_ver = sysinfo->if_ver;
+  sysdata->enabled_cores_count = sysinfo->enabled_cores_count;
+
+  *out = s;
+  return RYZEN_OK;
+
+_ERROR:
+  ryzen_session_close(s);
+  return ret;
+}
+
+int ryzen_session_open_r(int device, ryzen_session_t **session) {
+  char(*paths)[SMU_MAX_PATH_LEN];
+  smu_obj_t *smu;
+  int n, ret;
+
+  if (!session)
+    return RYZEN_ERR_INVALID;
+  *session = NULL;
+
+  if (device == RYZEN_DEFAULT_DEVICE) {
+    ret = ryzen_init();
+    return ret == RYZEN_OK ? session_open(&obj, NULL, session) : ret;
+  }
+  if (device < 0)
+    return RYZEN_ERR_INVALID;
+
+  paths = malloc((size_t)(device + 1) * sizeof(*paths));
+  smu = calloc(1, sizeof(*smu));
+  if (!paths || !smu) {
+    free(paths);
+    free(smu);
+    return RYZEN_ERR_NO_MEMORY;
   }
 
-  g_initialized = 1;
-  return 0;
+  n = smu_enumerate(paths, device + 1);
+  ret = n > device ? device_init(smu, paths[device]) : RYZEN_ERR_NO_DEVICE;
+  free(paths);
+  if (ret != RYZEN_OK) {
+    free(smu);
+    return ret;
+  }
+
+  return session_open(smu, smu, session);
 }
 
-// Cleanup
-void ryzen_cleanup(void) { g_initialized = 0; }
+// Open a sampling session on the default device
+ryzen_session_t *ryzen_session_open(void) {
+  ryzen_session_t *s;
 
-// Get system information
-int ryzen_get_system_info(system_data_t *sysdata) {
-  if (!g_initialized)
-    return -1;
+  ryzen_session_open_r(RYZEN_DEFAULT_DEVICE, &s);
+  return s;
+}
+
+int ryzen_device_count(void) { return smu_enumerate(NULL, 0); }
+
+ryzen_session_t *ryzen_session_open_device(int index) {
+  ryzen_session_t *s;
 
-  system_info sysinfo;
-  pm_table pmt;
-  unsigned char *pm_buf;
+  if (index < 0)
+    return NULL;
 
-  pm_buf = calloc(obj.pm_table_size, sizeof(unsigned char));
-  if (!pm_buf)
+  ryzen_session_open_r(index, &s);
+  return s;
+}
+
+const char *ryzen_session_device(ryzen_session_t *s) {
+  return s ? s->smu->path : NULL;
+}
+
+int ryzen_session_mapped_reads(ryzen_session_t *s) {
+  if (!s)
     return -1;
 
-  memset(&pmt, 0, sizeof(pm_table));
-
-  // Select PM table version
-  switch (obj.pm_table_version) {
-  case 0x380904:
-    pm_table_0x380904(&pmt, pm_buf);
-    break;
-  case 0x380905:
-    pm_table_0x380905(&pmt, pm_buf);
-    break;
-  case 0x380804:
-    pm_table_0x380804(&pmt, pm_buf);
-    break;
-  case 0x380805:
-    pm_table_0x380805(&pmt, pm_buf);
-    break;
-  case 0x400005:
-    pm_table_0x400005(&pmt, pm_buf);
-    break;
-  case 0x240903:
-    pm_table_0x240903(&pmt, pm_buf);
-    break;
-  case 0x240803:
-    pm_table_0x240803(&pmt, pm_buf);
-    break;
-  default:
-    free(pm_buf);
+  return smu_map_pm_table(s->smu) == SMU_Return_OK ? 0 : -1;
+}
+
+static const enum SMU_MUTEX_LOCK access_lock[RYZEN_SMU_ACCESS_COUNT] = {
+    [RYZEN_SMU_PM_TABLE] = SMU_MUTEX_PM,
+    [RYZEN_SMU_SMN] = SMU_MUTEX_SMN,
+    [RYZEN_SMU_CMD] = SMU_MUTEX_CMD,
+};
+
+_Static_assert(RYZEN_SMU_BUCKETS == SMU_STAT_BUCKETS &&
+                   RYZEN_SMU_ERROR_CODES == SMU_STAT_ERROR_CODES,
+               "ryzen_smu_stats_t must mirror smu_stats_t");
+
+int ryzen_session_smu_stats(ryzen_session_t *s, int access,
+                            ryzen_smu_stats_t *stats, int reset) {
+  smu_stats_t st;
+
+  if (!s || !stats || access < 0 || access >= RYZEN_SMU_ACCESS_COUNT)
+    return -1;
+  if (smu_get_stats(s->smu, access_lock[access], &st, reset) != SMU_Return_OK)
     return -1;
-  }
 
-  sysinfo.cpu_name = get_processor_name();
-  sysinfo.codename = smu_codename_to_str(&obj);
-  sysinfo.smu_fw_ver = smu_get_fw_version(&obj);
-  sysinfo.enabled_cores_count = pmt.max_cores;
+  stats->calls = st.calls;
+  stats->errors = st.errors;
+  memcpy(stats->error_codes, st.error_codes, sizeof(stats->error_codes));
+  stats->lock_wait_ns = st.lock_wait_ns;
+  stats->io_ns = st.io_ns;
+  stats->max_io_ns = st.max_io_ns;
+  memcpy(stats->io_hist, st.io_hist, sizeof(stats->io_hist));
+  memcpy(stats->lock_hist, st.lock_hist, sizeof(stats->lock_hist));
+  return 0;
+}
 
-  get_processor_topology(&sysinfo, pmt.zen_version);
+const char *ryzen_smu_access_name(int access) {
+  static const char *names[RYZEN_SMU_ACCESS_COUNT] = {
+      [RYZEN_SMU_PM_TABLE] = "PM Table",
+      [RYZEN_SMU_SMN] = "SMN",
+      [RYZEN_SMU_CMD] = "Command",
+  };
 
-  strncpy(sysdata->cpu_name, sysinfo.cpu_name, 255);
-  strncpy(sysdata->codename, sysinfo.codename, 63);
-  strncpy(sysdata->smu_fw_ver, sysinfo.smu_fw_ver, 31);
-  sysdata->cores = sysinfo.cores;
-  sysdata->ccds = sysinfo.ccds;
-  sysdata->ccxs = sysinfo.ccxs;
-  sysdata->cores_per_ccx = sysinfo.cores_per_ccx;
-  sysdata->enabled_cores_count = sysinfo.enabled_cores_count;
+  return access < 0 || access >= RYZEN_SMU_ACCESS_COUNT ? NULL : names[access];
+}
 
-  switch (obj.smu_if_version) {
-  case IF_VERSION_9:
-    sysdata->if_ver = 9;
-    break;
-  case IF_VERSION_10:
-    sysdata->if_ver = 10;
-    break;
-  case IF_VERSION_11:
-    sysdata->if_ver = 11;
-    break;
-  case IF_VERSION_12:
-    sysdata->if_ver = 12;
-    break;
-  case IF_VERSION_13:
-    sysdata->if_ver = 13;
-    break;
-  default:
-    sysdata->if_ver = 0;
-    break;
+const char *ryzen_smu_error_name(int code) {
+  if (code < 0 || code >= RYZEN_SMU_ERROR_CODES)
+    return NULL;
+
+  return smu_return_to_str(SMU_Return_Failed - code);
+}
+
+void ryzen_session_close(ryzen_session_t *s) {
+  if (!s)
+    return;
+
+  ryzen_sampler_stop(s);
+  ryzen_cmd_stop(s);
+  ryzen_perf_free(s->perf);
+  if (s->device) {
+    smu_free(s->device);
+    free(s->device);
   }
+  free(s);
+}
+
+int ryzen_session_info(ryzen_session_t *s, system_data_t *sysdata) {
+  if (!s)
+    return -1;
 
-  free(pm_buf);
+  *sysdata = s->sysdata;
   return 0;
 }
 
-// Read all data at once
+// Lazily open the session used by the classic API. Called with g_lock held.
+static ryzen_session_t *default_session(void) {
+  if (!g_initialized)
+    return NULL;
+
+  if (!g_session)
+    session_open(&obj, NULL, &g_session);
+
+  return g_session;
+}
+
+// Get system information
+int ryzen_get_system_info(system_data_t *sysdata) {
+  int ret;
+
+  pthread_mutex_lock(&g_lock);
+  ret = ryzen_session_info(default_session(), sysdata);
+  pthread_mutex_unlock(&g_lock);
+  return ret;
+}
+
+// Read all data at once. Callers share the default session and its buffer.
 int ryzen_read_data(core_data_t *cores, int max_cores,
                     constraints_data_t *constraints, memory_data_t *memory,
                     power_data_t *power, graphics_data_t *graphics,
                     calculated_stats_t *stats) {
-  if (!g_initialized)
+  int ret;
+
+  pthread_mutex_lock(&g_lock);
+  ret = ryzen_session_sample(default_session(), cores, max_cores, constraints,
+                             memory, power, graphics, stats);
+  pthread_mutex_unlock(&g_lock);
+  return ret;
+}
+
+// Read one sample. Costs a single PM table read plus the derivation below.
+int ryzen_session_sample(ryzen_session_t *s, core_data_t *cores, int max_cores,
+                         constraints_data_t *constraints, memory_data_t *memory,
+                         power_data_t *power, graphics_data_t *graphics,
+                         calculated_stats_t *stats) {
+  if (!s)
     return -1;
 
-  unsigned char *pm_buf;
-  pm_table pmt;
-  system_info sysinfo;
+  return ryzen_session_sample_r(s, s->pm_buf, s->smu->pm_table_size, cores,
+                                max_cores, constraints, memory, power,
+                                graphics, stats);
+}
+
+int ryzen_session_sample_r(ryzen_session_t *s, unsigned char *buf,
+                           size_t buf_len, core_data_t *cores, int max_cores,
+                           constraints_data_t *constraints,
+                           memory_data_t *memory, power_data_t *power,
+                           graphics_data_t *graphics,
+                           calculated_stats_t *stats) {
+  const unsigned char *table;
 
-  pm_buf = calloc(obj.pm_table_size, sizeof(unsigned char));
-  if (!pm_buf)
+  if (!s || !buf || buf_len < (size_t)s->smu->pm_table_size)
     return -1;
 
-  memset(&pmt, 0, sizeof(pm_table));
-
-  // Select PM table
-  switch (obj.pm_table_version) {
-  case 0x380904:
-    pm_table_0x380904(&pmt, pm_buf);
-    break;
-  case 0x380905:
-    pm_table_0x380905(&pmt, pm_buf);
-    break;
-  case 0x380804:
-    pm_table_0x380804(&pmt, pm_buf);
-    break;
-  case 0x380805:
-    pm_table_0x380805(&pmt, pm_buf);
-    break;
-  case 0x400005:
-    pm_table_0x400005(&pmt, pm_buf);
-    break;
-  case 0x240903:
-    pm_table_0x240903(&pmt, pm_buf);
-    break;
-  case 0x240803:
-    pm_table_0x240803(&pmt, pm_buf);
-    break;
-  default:
-    free(pm_buf);
+  // Read PM table, copied from the driver mapping with mapped reads
+  if (smu_read_pm_table_snapshot(s->smu, buf, s->smu->pm_table_size, &table,
+                                 NULL) != SMU_Return_OK)
     return -1;
-  }
 
-  get_processor_topology(&sysinfo, pmt.zen_version);
+  return ryzen_session_decode(s, table, cores, max_cores, constraints, memory,
+                              power, graphics, stats);
+}
+
+// Decode a raw PM table, e.g. one returned by ryzen_latest()
+int ryzen_session_decode(ryzen_session_t *s, const unsigned char *table,
+                         core_data_t *cores, int max_cores,
+                         constraints_data_t *constraints, memory_data_t *memory,
+                         power_data_t *power, graphics_data_t *graphics,
+                         calculated_stats_t *stats) {
+  float v[PMT_METRIC_COUNT];
 
-  // Read PM table
-  if (smu_read_pm_table(&obj, pm_buf, obj.pm_table_size) != SMU_Return_OK) {
-    free(pm_buf);
+  if (!s || !table)
     return -1;
-  }
 
-  // Calculated values
-  float peak_core_frequency = 0, peak_core_temp = 0, peak_core_voltage = 0;
-  float total_core_voltage = 0, total_core_power = 0, total_usage = 0, total_core_CC6 = 0;
+  pm_values_reset(v);
+  pm_layout_gather(&s->decode_layout, table, v);
+  return s->derive(s, v, cores, max_cores, constraints, memory, power,
+                   graphics, stats);
+}
 
-  // Fill core data
-  float package_sleep_time, average_voltage;
-  if (pmt.PC6) {
-    package_sleep_time = pmta(PC6) / 100.f;
-    average_voltage =
-        (pmta(CPU_TELEMETRY_VOLTAGE) - (0.2 * package_sleep_time)) /
-        (1.0 - package_sleep_time);
+// Decode the newest sampler snapshot without touching the hardware
+int ryzen_read_latest(ryzen_session_t *s, core_data_t *cores, int max_cores,
+                      constraints_data_t *constraints, memory_data_t *memory,
+                      power_data_t *power, graphics_data_t *graphics,
+                      calculated_stats_t *stats, ryzen_sample_info_t *info) {
+  float v[PMT_METRIC_COUNT];
+  ryzen_sample_info_t tmp;
+
+  pm_values_reset(v);
+  if (ryzen_sampler_latest_values(s, v, info ? info : &tmp) != 0)
+    return -1;
+
+  return s->derive(s, v, cores, max_cores, constraints, memory, power,
+                   graphics, stats);
+}
+
+void ryzen_soa_init(ryzen_soa_t *soa) {
+  memset(soa, 0, sizeof(*soa));
+  soa->version = RYZEN_SOA_VERSION;
+  soa->size = sizeof(*soa);
+}
+
+int ryzen_soa_read(ryzen_session_t *s, ryzen_soa_t *soa) {
+  core_data_t cores[RYZEN_SOA_MAX_CORES];
+  ryzen_sample_info_t info;
+  unsigned long long head;
+  struct timespec ts;
+  int n;
+
+  if (!s || !soa || soa->version != RYZEN_SOA_VERSION ||
+      soa->size != sizeof(*soa))
+    return -1;
+
+  if (s->sampler) {
+    // Cheap enough to poll far faster than the sampler runs
+    if (ryzen_sampler_stats(s, &head, NULL, NULL) == 0 && head &&
+        head == soa->seq)
+      return 0;
+
+    n = ryzen_read_latest(s, cores, RYZEN_SOA_MAX_CORES, &soa->constraints,
+                          &soa->memory, &soa->power_data, &soa->graphics,
+                          &soa->stats, &info);
   } else {
-    average_voltage = pmta(CPU_TELEMETRY_VOLTAGE);
+    n = ryzen_session_sample(s, cores, RYZEN_SOA_MAX_CORES, &soa->constraints,
+                             &soa->memory, &soa->power_data, &soa->graphics,
+                             &soa->stats);
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    info.seq = soa->seq + 1;
+    info.timestamp_ns = (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+  }
+  if (n < 0)
+    return -1;
+
+  for (int i = 0; i < n; i++) {
+    soa->frequency[i] = cores[i].frequency;
+    soa->power[i] = cores[i].power;
+    soa->voltage[i] = cores[i].voltage;
+    soa->temp[i] = cores[i].temp;
+    soa->c0[i] = cores[i].c0;
+    soa->cc1[i] = cores[i].cc1;
+    soa->cc6[i] = cores[i].cc6;
+    soa->disabled[i] = cores[i].disabled;
+    soa->sleeping[i] = cores[i].sleeping;
   }
+  soa->core_count = n;
+  soa->seq = info.seq;
+  soa->timestamp_ns = info.timestamp_ns;
 
-  int core_count = (pmt.max_cores < max_cores) ? pmt.max_cores : max_cores;
+  return n;
+}
 
-  for (int i = 0; i < core_count; i++) {
-    int core_disabled = (sysinfo.core_disable_map >> i) & 0x01;
-    float core_frequency = pmta(CORE_FREQEFF[i]) * 1000.f;
-    float core_sleep_time = pmta(CORE_CC6[i]) / 100.f;
-    float core_voltage =
-        ((1.0 - core_sleep_time) * average_voltage) + (0.2 * core_sleep_time);
+// Fields copied as they are from the dense metric array
+#define DERIVE_CONSTRAINTS(X)                                                  \
+  X(peak_temp, PEAK_TEMP) X(soc_temp, SOC_TEMP) X(gfx_temp, GFX_TEMP)          \
+  X(vid_value, VID_VALUE) X(vid_limit, VID_LIMIT) X(ppt_value, PPT_VALUE)      \
+  X(ppt_limit, PPT_LIMIT) X(ppt_apu_value, PPT_VALUE_APU)                      \
+  X(ppt_apu_limit, PPT_LIMIT_APU) X(tdc_value, TDC_VALUE)                      \
+  X(tdc_limit, TDC_LIMIT) X(tdc_actual, TDC_ACTUAL)                            \
+  X(tdc_soc_value, TDC_VALUE_SOC) X(tdc_soc_limit, TDC_LIMIT_SOC)              \
+  X(edc_limit, EDC_LIMIT) X(edc_soc_value, EDC_VALUE_SOC)                      \
+  X(edc_soc_limit, EDC_LIMIT_SOC) X(thm_value, THM_VALUE)                      \
+  X(thm_limit, THM_LIMIT) X(thm_soc_value, THM_VALUE_SOC)                      \
+  X(thm_soc_limit, THM_LIMIT_SOC) X(thm_gfx_value, THM_VALUE_GFX)              \
+  X(thm_gfx_limit, THM_LIMIT_GFX) X(fit_value, FIT_VALUE)                      \
+  X(fit_limit, FIT_LIMIT)
+
+#define DERIVE_MEMORY(X)                                                       \
+  X(fclk_freq, FCLK_FREQ) X(fclk_freq_eff, FCLK_FREQ_EFF)                      \
+  X(uclk_freq, UCLK_FREQ) X(memclk_freq, MEMCLK_FREQ) X(v_vddm, V_VDDM)        \
+  X(v_vddp, V_VDDP) X(v_vddg, V_VDDG) X(v_vddg_iod, V_VDDG_IOD)                \
+  X(v_vddg_ccd, V_VDDG_CCD)
+
+#define DERIVE_POWER(X)                                                        \
+  X(vddcr_soc_power, VDDCR_SOC_POWER)                                          \
+  X(io_vddcr_soc_power, IO_VDDCR_SOC_POWER)                                    \
+  X(gmi2_vddg_power, GMI2_VDDG_POWER) X(roc_power, ROC_POWER)                  \
+  X(vddio_mem_power, VDDIO_MEM_POWER)                                          \
+  X(iod_vddio_mem_power, IOD_VDDIO_MEM_POWER)                                  \
+  X(ddr_vddp_power, DDR_VDDP_POWER) X(ddr_phy_power, DDR_PHY_POWER)            \
+  X(vdd18_power, VDD18_POWER) X(io_display_power, IO_DISPLAY_POWER)            \
+  X(io_usb_power, IO_USB_POWER) X(socket_power, SOCKET_POWER)                  \
+  X(package_power, PACKAGE_POWER) X(vddcr_cpu_power, VDDCR_CPU_POWER)          \
+  X(soc_telemetry_voltage, SOC_TELEMETRY_VOLTAGE)                              \
+  X(soc_telemetry_current, SOC_TELEMETRY_CURRENT)                              \
+  X(soc_telemetry_power, SOC_TELEMETRY_POWER)                                  \
+  X(cpu_telemetry_voltage, CPU_TELEMETRY_VOLTAGE)                              \
+  X(cpu_telemetry_current, CPU_TELEMETRY_CURRENT)                              \
+  X(cpu_telemetry_power, CPU_TELEMETRY_POWER)
+
+#define DERIVE_GRAPHICS(X)                                                     \
+  X(gfx_voltage, GFX_VOLTAGE) X(roc_power, ROC_POWER) X(gfx_temp, GFX_TEMP)    \
+  X(gfx_freq, GFX_FREQ) X(gfx_freq_eff, GFX_FREQEFF) X(gfx_busy, GFX_BUSY)     \
+  X(gfx_edc_lim, GFX_EDC_LIM) X(gfx_edc_residency, GFX_EDC_RESIDENCY)          \
+  X(display_count, DISPLAY_COUNT) X(fps, FPS) X(dgpu_power, DGPU_POWER)        \
+  X(dgpu_freq_target, DGPU_FREQ_TARGET) X(dgpu_gfx_busy, DGPU_GFX_BUSY)
+
+// Everything else derive_shape() and core_calc() read
+#define DERIVE_INPUTS(S, A)                                                    \
+  S(EDC_VALUE) S(PC6) A(CORE_POWER, PMT_MAX_NUM_CORES)                         \
+  A(CORE_TEMP, PMT_MAX_NUM_CORES) A(CORE_FREQEFF, PMT_MAX_NUM_CORES)           \
+  A(CORE_C0, PMT_MAX_NUM_CORES) A(CORE_CC1, PMT_MAX_NUM_CORES)                 \
+  A(CORE_CC6, PMT_MAX_NUM_CORES) A(L3_LOGIC_POWER, PMT_MAX_NUM_L3)             \
+  A(L3_VDDM_POWER, PMT_MAX_NUM_L3)
+
+// Derive the exported structs from a dense metric array. Always inlined into
+// the decoders below, which pass the shape of the table as constants so the
+// core and L3 loops get fixed trip counts and the PC6 and graphics branches
+// fold away.
+static inline __attribute__((always_inline)) int
+derive_shape(ryzen_session_t *s, const float *v, core_data_t *cores,
+             int max_cores, constraints_data_t *constraints,
+             memory_data_t *memory, power_data_t *power,
+             graphics_data_t *graphics, calculated_stats_t *stats,
+             int shape_cores, int shape_l3, int has_pc6, int has_graphics) {
+  system_info *sysinfo = &s->sysinfo;
+
+  int core_count = (shape_cores < max_cores) ? shape_cores : max_cores;
+  core_calc_result cr;
+
+  core_calc(v, core_count, sysinfo->core_disable_map, has_pc6, &cr);
 
+  // Fill core data
+  for (int i = 0; i < core_count; i++) {
     cores[i].core_num = i;
-    cores[i].frequency = core_frequency;
-    cores[i].power = pmta(CORE_POWER[i]);
-    cores[i].voltage = core_voltage;
-    cores[i].temp = pmta(CORE_TEMP[i]);
-    cores[i].c0 = pmta(CORE_C0[i]);
-    cores[i].cc1 = pmta(CORE_CC1[i]);
-    cores[i].cc6 = pmta(CORE_CC6[i]);
-    cores[i].disabled = core_disabled;
-    cores[i].sleeping = (pmta(CORE_C0[i]) < 6.f);
-
-    if (!core_disabled) {
-      if (peak_core_frequency < core_frequency) peak_core_frequency = core_frequency;
-      if (peak_core_temp < pmta(CORE_TEMP[i])) peak_core_temp = pmta(CORE_TEMP[i]);
-      if (peak_core_voltage < core_voltage) peak_core_voltage = core_voltage;
-      total_core_voltage += core_voltage;
-      total_core_power += pmta(CORE_POWER[i]);
-      total_usage += pmta(CORE_C0[i]);
-      total_core_CC6 += pmta(CORE_CC6[i]);
-    }
+    cores[i].frequency = cr.frequency[i];
+    cores[i].power = pmvi(v, CORE_POWER, i);
+    cores[i].voltage = cr.voltage[i];
+    cores[i].temp = pmvi(v, CORE_TEMP, i);
+    cores[i].c0 = pmvi(v, CORE_C0, i);
+    cores[i].cc1 = pmvi(v, CORE_CC1, i);
+    cores[i].cc6 = pmvi(v, CORE_CC6, i);
+    cores[i].disabled = (sysinfo->core_disable_map >> i) & 0x01;
+    cores[i].sleeping = (pmvi(v, CORE_C0, i) < 6.f);
   }
-  
-  // Fill calculated stats
-  stats->peak_core_frequency = peak_core_frequency;
-  stats->peak_core_temp = peak_core_temp;
-  stats->peak_core_voltage = peak_core_voltage;
-  stats->avg_core_voltage = total_core_voltage / sysinfo.enabled_cores_count;
-  stats->avg_core_cc6 = total_core_CC6 / sysinfo.enabled_cores_count;
-  stats->total_core_power = total_core_power;
-  stats->peak_core_voltage_smu = pmta(CPU_TELEMETRY_VOLTAGE);
-  stats->package_cc6 = pmt.PC6 ? pmta(PC6) : NAN;
 
+  // Fill calculated stats
+  stats->peak_core_frequency = cr.peak_frequency;
+  stats->peak_core_temp = cr.peak_temp;
+  stats->peak_core_voltage = cr.peak_voltage;
+  stats->avg_core_voltage = cr.total_voltage / sysinfo->enabled_cores_count;
+  stats->avg_core_cc6 = cr.total_cc6 / sysinfo->enabled_cores_count;
+  stats->total_core_power = cr.total_power;
+  stats->peak_core_voltage_smu = pmv(v, CPU_TELEMETRY_VOLTAGE);
+  stats->package_cc6 = has_pc6 ? pmv(v, PC6) : NAN;
+
+#define DERIVE_COPY(field, elem) out->field = pmv(v, elem);
   // Fill constraints
-  float edc = pmta(EDC_VALUE) * (total_usage / sysinfo.cores / 100);
-  if (edc < pmta(TDC_VALUE))
-    edc = pmta(TDC_VALUE);
-
-  constraints->peak_temp = pmta(PEAK_TEMP);
-  constraints->soc_temp = pmta(SOC_TEMP);
-  constraints->gfx_temp = pmta(GFX_TEMP);
-  constraints->vid_value = pmta(VID_VALUE);
-  constraints->vid_limit = pmta(VID_LIMIT);
-  constraints->ppt_value = pmta(PPT_VALUE);
-  constraints->ppt_limit = pmta(PPT_LIMIT);
-  constraints->ppt_apu_value = pmta(PPT_VALUE_APU);
-  constraints->ppt_apu_limit = pmta(PPT_LIMIT_APU);
-  constraints->tdc_value = pmta(TDC_VALUE);
-  constraints->tdc_limit = pmta(TDC_LIMIT);
-  constraints->tdc_actual = pmta(TDC_ACTUAL);
-  constraints->tdc_soc_value = pmta(TDC_VALUE_SOC);
-  constraints->tdc_soc_limit = pmta(TDC_LIMIT_SOC);
+  float edc = pmv(v, EDC_VALUE) * (cr.total_c0 / sysinfo->cores / 100);
+  if (edc < pmv(v, TDC_VALUE))
+    edc = pmv(v, TDC_VALUE);
+
+  {
+    constraints_data_t *out = constraints;
+    DERIVE_CONSTRAINTS(DERIVE_COPY)
+  }
   constraints->edc_value = edc;
-  constraints->edc_limit = pmta(EDC_LIMIT);
-  constraints->edc_soc_value = pmta(EDC_VALUE_SOC);
-  constraints->edc_soc_limit = pmta(EDC_LIMIT_SOC);
-  constraints->thm_value = pmta(THM_VALUE);
-  constraints->thm_limit = pmta(THM_LIMIT);
-  constraints->thm_soc_value = pmta(THM_VALUE_SOC);
-  constraints->thm_soc_limit = pmta(THM_LIMIT_SOC);
-  constraints->thm_gfx_value = pmta(THM_VALUE_GFX);
-  constraints->thm_gfx_limit = pmta(THM_LIMIT_GFX);
-  constraints->fit_value = pmta(FIT_VALUE);
-  constraints->fit_limit = pmta(FIT_LIMIT);
 
   // Fill memory
-  memory->fclk_freq = pmta(FCLK_FREQ);
-  memory->fclk_freq_eff = pmta(FCLK_FREQ_EFF);
-  memory->uclk_freq = pmta(UCLK_FREQ);
-  memory->memclk_freq = pmta(MEMCLK_FREQ);
-  memory->v_vddm = pmta(V_VDDM);
-  memory->v_vddp = pmta(V_VDDP);
-  memory->v_vddg = pmta(V_VDDG);
-  memory->v_vddg_iod = pmta(V_VDDG_IOD);
-  memory->v_vddg_ccd = pmta(V_VDDG_CCD);
-  memory->coupled_mode = (pmta(UCLK_FREQ) == pmta(MEMCLK_FREQ));
+  {
+    memory_data_t *out = memory;
+    DERIVE_MEMORY(DERIVE_COPY)
+  }
+  memory->coupled_mode = (pmv(v, UCLK_FREQ) == pmv(v, MEMCLK_FREQ));
 
   // Fill power
-  power->total_core_power = total_core_power;
-  power->vddcr_soc_power = pmta(VDDCR_SOC_POWER);
-  power->io_vddcr_soc_power = pmta(IO_VDDCR_SOC_POWER);
-  power->gmi2_vddg_power = pmta(GMI2_VDDG_POWER);
-  power->roc_power = pmta(ROC_POWER);
+  {
+    power_data_t *out = power;
+    DERIVE_POWER(DERIVE_COPY)
+  }
+  power->total_core_power = cr.total_power;
   power->l3_logic_power = 0;
   power->l3_vddm_power = 0;
-  for (int i=0; i<pmt.max_l3; i++) {
-    power->l3_logic_power += pmta0(L3_LOGIC_POWER[i]);
-    power->l3_vddm_power += pmta0(L3_VDDM_POWER[i]);
+  for (int i=0; i<shape_l3; i++) {
+    power->l3_logic_power += pmvi0(v, L3_LOGIC_POWER, i);
+    power->l3_vddm_power += pmvi0(v, L3_VDDM_POWER, i);
   }
-  power->vddio_mem_power = pmta(VDDIO_MEM_POWER);
-  power->iod_vddio_mem_power = pmta(IOD_VDDIO_MEM_POWER);
-  power->ddr_vddp_power = pmta(DDR_VDDP_POWER);
-  power->ddr_phy_power = pmta(DDR_PHY_POWER);
-  power->vdd18_power = pmta(VDD18_POWER);
-  power->io_display_power = pmta(IO_DISPLAY_POWER);
-  power->io_usb_power = pmta(IO_USB_POWER);
-  power->socket_power = pmta(SOCKET_POWER);
-  power->package_power = pmta(PACKAGE_POWER);
-  power->vddcr_cpu_power = pmta(VDDCR_CPU_POWER);
-  power->soc_telemetry_voltage = pmta(SOC_TELEMETRY_VOLTAGE);
-  power->soc_telemetry_current = pmta(SOC_TELEMETRY_CURRENT);
-  power->soc_telemetry_power = pmta(SOC_TELEMETRY_POWER);
-  power->cpu_telemetry_voltage = pmta(CPU_TELEMETRY_VOLTAGE);
-  power->cpu_telemetry_current = pmta(CPU_TELEMETRY_CURRENT);
-  power->cpu_telemetry_power = pmta(CPU_TELEMETRY_POWER);
-  
+
   // Fill graphics
-  if(pmt.has_graphics) {
-    graphics->gfx_voltage = pmta(GFX_VOLTAGE);
-    graphics->roc_power = pmta(ROC_POWER);
-    graphics->gfx_temp = pmta(GFX_TEMP);
-    graphics->gfx_freq = pmta(GFX_FREQ);
-    graphics->gfx_freq_eff = pmta(GFX_FREQEFF);
-    graphics->gfx_busy = pmta(GFX_BUSY);
-    graphics->gfx_edc_lim = pmta(GFX_EDC_LIM);
-    graphics->gfx_edc_residency = pmta(GFX_EDC_RESIDENCY);
-    graphics->display_count = pmta(DISPLAY_COUNT);
-    graphics->fps = pmta(FPS);
-    graphics->dgpu_power = pmta(DGPU_POWER);
-    graphics->dgpu_freq_target = pmta(DGPU_FREQ_TARGET);
-    graphics->dgpu_gfx_busy = pmta(DGPU_GFX_BUSY);
+  if(has_graphics) {
+    graphics_data_t *out = graphics;
+    DERIVE_GRAPHICS(DERIVE_COPY)
   }
+#undef DERIVE_COPY
 
-
-  free(pm_buf);
   return core_count;
+}
+
+// Any table, shape read from the mapping on every sample
+static int derive_generic(ryzen_session_t *s, const float *v,
+                          core_data_t *cores, int max_cores,
+                          constraints_data_t *constraints,
+                          memory_data_t *memory, power_data_t *power,
+                          graphics_data_t *graphics,
+                          calculated_stats_t *stats) {
+  return derive_shape(s, v, cores, max_cores, constraints, memory, power,
+                      graphics, stats, s->pmt.max_cores, s->pmt.max_l3,
+                      s->pmt.PC6 != NULL, s->pmt.has_graphics);
+}
+
+// Shapes of the known tables: cores, L3 caches, PC6, graphics. A new table
+// with one of these shapes gets its decoder without further changes.
+#define DERIVE_SHAPES(X)                                                       \
+  X(16, 2, 1, 0) /* 0x380804, 0x380805 */                                      \
+  X(8, 1, 1, 0)  /* 0x380904, 0x380905 */                                      \
+  X(8, 1, 0, 1)  /* 0x400005 */                                                \
+  X(16, 4, 1, 0) /* 0x240803 */                                                \
+  X(8, 0, 1, 0)  /* 0x240903 */
+
+#define DERIVE_DEFINE(cores_, l3_, pc6_, gfx_)                                 \
+  static int derive_##cores_##_##l3_##_##pc6_##_##gfx_(                        \
+      ryzen_session_t *s, const float *v, core_data_t *cores, int max_cores,   \
+      constraints_data_t *constraints, memory_data_t *memory,                  \
+      power_data_t *power, graphics_data_t *graphics,                          \
+      calculated_stats_t *stats) {                                             \
+    return derive_shape(s, v, cores, max_cores, constraints, memory, power,    \
+                        graphics, stats, cores_, l3_, pc6_, gfx_);             \
+  }
+DERIVE_SHAPES(DERIVE_DEFINE)
+#undef DERIVE_DEFINE
+
+#define DERIVE_ENTRY(cores_, l3_, pc6_, gfx_)                                  \
+  {cores_, l3_, pc6_, gfx_, derive_##cores_##_##l3_##_##pc6_##_##gfx_},
+static const struct {
+  int cores, l3, pc6, graphics;
+  ryzen_derive_fn fn;
+} derive_decoders[] = {DERIVE_SHAPES(DERIVE_ENTRY)};
+#undef DERIVE_ENTRY
+
+// Marks the metrics the decoders read, so they gather only those
+static void derive_inputs(unsigned char *keep) {
+#define DERIVE_KEEP(field, elem) keep[PMT_ID_##elem] = 1;
+#define DERIVE_KEEP_S(elem) keep[PMT_ID_##elem] = 1;
+#define DERIVE_KEEP_A(elem, n) memset(keep + PMT_ID_##elem, 1, n);
+  memset(keep, 0, PMT_METRIC_COUNT);
+  DERIVE_CONSTRAINTS(DERIVE_KEEP)
+  DERIVE_MEMORY(DERIVE_KEEP)
+  DERIVE_POWER(DERIVE_KEEP)
+  DERIVE_GRAPHICS(DERIVE_KEEP)
+  DERIVE_INPUTS(DERIVE_KEEP_S, DERIVE_KEEP_A)
+#undef DERIVE_KEEP
+#undef DERIVE_KEEP_S
+#undef DERIVE_KEEP_A
+}
+
+int ryzen_session_select_decoder(ryzen_session_t *s, int specialized) {
+  const pm_table *pmt = &s->pmt;
+  unsigned char keep[PMT_METRIC_COUNT];
+
+  s->derive = derive_generic;
+  s->decode_layout = s->layout;
+  if (!specialized)
+    return 0;
+
+  derive_inputs(keep);
+  if (!pm_layout_filter(&s->decode_layout, &s->layout, keep))
+    s->decode_layout = s->layout;
+
+  for (size_t i = 0; i < sizeof(derive_decoders) / sizeof(*derive_decoders);
+       i++) {
+    if (derive_decoders[i].cores == pmt->max_cores &&
+        derive_decoders[i].l3 == pmt->max_l3 &&
+        derive_decoders[i].pc6 == (pmt->PC6 != NULL) &&
+        derive_decoders[i].graphics == pmt->has_graphics) {
+      s->derive = derive_decoders[i].fn;
+      return 1;
+    }
+  }
+  return 0;
 }
\ No newline at end of file
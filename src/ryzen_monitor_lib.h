@@ -6,6 +6,8 @@
 #ifndef RYZEN_MONITOR_LIB_H
 #define RYZEN_MONITOR_LIB_H
 
+#include <stddef.h>
+
 // Data structures for exporting
 typedef struct {
   int core_num;
@@ -128,7 +130,64 @@ typedef struct {
 } calculated_stats_t;
 
 
-// Library functions
+// Sampling session. Resolves the PM table layout, topology and core disable
+// map once; every sample afterwards is a single PM table read.
+typedef struct ryzen_session ryzen_session_t;
+
+// Identifies a sampler snapshot. seq counts samples from 1, timestamp_ns is
+// CLOCK_MONOTONIC (time.monotonic_ns() in Python).
+typedef struct {
+  unsigned long long seq;
+  unsigned long long timestamp_ns;
+} ryzen_sample_info_t;
+
+// Structure-of-arrays export. The caller owns the buffer and reuses it for
+// every update, so bindings can wrap the per-core arrays once (memoryview,
+// numpy.ctypeslib.as_array) and never allocate per sample. The layout only
+// changes together with RYZEN_SOA_VERSION.
+#define RYZEN_SOA_VERSION 1
+#define RYZEN_SOA_MAX_CORES 32
+
+typedef struct {
+  unsigned int version;            // RYZEN_SOA_VERSION, set by ryzen_soa_init()
+  unsigned int size;               // sizeof(ryzen_soa_t)
+  int core_count;                  // Valid entries of the per-core arrays
+  int reserved;
+  unsigned long long seq;          // Sample held by the buffer, 0 if none
+  unsigned long long timestamp_ns; // CLOCK_MONOTONIC
+
+  float frequency[RYZEN_SOA_MAX_CORES];
+  float power[RYZEN_SOA_MAX_CORES];
+  float voltage[RYZEN_SOA_MAX_CORES];
+  float temp[RYZEN_SOA_MAX_CORES];
+  float c0[RYZEN_SOA_MAX_CORES];
+  float cc1[RYZEN_SOA_MAX_CORES];
+  float cc6[RYZEN_SOA_MAX_CORES];
+  int disabled[RYZEN_SOA_MAX_CORES];
+  int sleeping[RYZEN_SOA_MAX_CORES];
+
+  constraints_data_t constraints;
+  memory_data_t memory;
+  power_data_t power_data;
+  graphics_data_t graphics;
+  calculated_stats_t stats;
+} ryzen_soa_t;
+
+// Error codes of ryzen_init() and ryzen_session_open_r()
+enum {
+  RYZEN_OK = 0,
+  RYZEN_ERR_DRIVER = -1,      // ryzen_smu missing, inaccessible or too old
+  RYZEN_ERR_UNSUPPORTED = -2, // No PM table, or a version we cannot decode
+  RYZEN_ERR_NO_DEVICE = -3,
+  RYZEN_ERR_NO_MEMORY = -4,
+  RYZEN_ERR_TOPOLOGY = -5, // SMN reads of the core fuses failed
+  RYZEN_ERR_INVALID = -6
+};
+
+const char *ryzen_strerror(int err);
+
+// Library functions. They share one default session behind a lock; threads
+// that need to sample in parallel should use sessions of their own.
 int ryzen_init(void);
 void ryzen_cleanup(void);
 int ryzen_get_system_info(system_data_t *sysdata);
@@ -139,4 +198,467 @@ int ryzen_read_data(core_data_t *cores, int max_cores,
                     graphics_data_t *graphics,
                     calculated_stats_t *stats);
 
+// Copy the PM table from a mapping of the driver instead of reading it through
+// sysfs on every sample. Every copy is checked for a concurrent update. Returns
+// 0 if the driver supports it; otherwise the read path stays active.
+int ryzen_enable_mapped_reads(void);
+
+// Session API. ryzen_session_open() initializes the library if needed.
+// Sessions must be closed before ryzen_cleanup().
+ryzen_session_t *ryzen_session_open(void);
+void ryzen_session_close(ryzen_session_t *session);
+int ryzen_session_info(ryzen_session_t *session, system_data_t *sysdata);
+int ryzen_session_sample(ryzen_session_t *session,
+                         core_data_t *cores, int max_cores,
+                         constraints_data_t *constraints,
+                         memory_data_t *memory,
+                         power_data_t *power,
+                         graphics_data_t *graphics,
+                         calculated_stats_t *stats);
+int ryzen_session_decode(ryzen_session_t *session, const unsigned char *table,
+                         core_data_t *cores, int max_cores,
+                         constraints_data_t *constraints,
+                         memory_data_t *memory,
+                         power_data_t *power,
+                         graphics_data_t *graphics,
+                         calculated_stats_t *stats);
+
+// Reentrant variants. ryzen_session_open_r() reports why a session could not
+// be opened instead of returning NULL; device is an index as below or
+// RYZEN_DEFAULT_DEVICE. Sessions keep all of their state to themselves, so
+// threads with sessions of their own only meet in the driver. Calls on one
+// session are safe from any number of threads as long as they go through the
+// sampler or bring their own buffer: ryzen_session_sample_r() reads into buf
+// (at least ryzen_table_size() bytes) instead of the session's buffer.
+#define RYZEN_DEFAULT_DEVICE (-1)
+
+int ryzen_session_open_r(int device, ryzen_session_t **session);
+int ryzen_session_sample_r(ryzen_session_t *session, unsigned char *buf,
+                           size_t buf_len, core_data_t *cores, int max_cores,
+                           constraints_data_t *constraints,
+                           memory_data_t *memory, power_data_t *power,
+                           graphics_data_t *graphics,
+                           calculated_stats_t *stats);
+
+// Multiple devices. Every ryzen_smu instance (one per socket or node on
+// multi-socket systems) is a device with its own SMU handle, PM table layout
+// and topology. Sessions of different devices are independent: each runs its
+// own sampler thread, so all devices are sampled concurrently. Index 0 is the
+// device ryzen_session_open() uses; opening it by index as well gives a second
+// handle to it. Device sessions do not depend on ryzen_init().
+int ryzen_device_count(void);
+ryzen_session_t *ryzen_session_open_device(int index);
+const char *ryzen_session_device(ryzen_session_t *session); // sysfs directory
+int ryzen_session_mapped_reads(ryzen_session_t *session); // Per device
+
+// SMU access statistics of the device of a session, collected by libsmu for
+// every PM table read, SMN access and SMU command that reached the driver.
+// Lock wait versus I/O time tells contention from a slow driver or firmware;
+// compare both with the sampling interval to see what decode costs.
+// Histogram bucket 0 counts calls under 1 us, bucket i those under 2^i us.
+enum {
+  RYZEN_SMU_PM_TABLE,
+  RYZEN_SMU_SMN,
+  RYZEN_SMU_CMD,
+  RYZEN_SMU_ACCESS_COUNT
+};
+
+#define RYZEN_SMU_BUCKETS 24
+#define RYZEN_SMU_ERROR_CODES 12
+
+typedef struct {
+  unsigned long long calls;
+  unsigned long long errors;
+  unsigned long long error_codes[RYZEN_SMU_ERROR_CODES]; // See name below
+  unsigned long long lock_wait_ns;
+  unsigned long long io_ns;
+  unsigned long long max_io_ns;
+  unsigned long long io_hist[RYZEN_SMU_BUCKETS];
+  unsigned long long lock_hist[RYZEN_SMU_BUCKETS];
+} ryzen_smu_stats_t;
+
+// reset clears the counters after copying them
+int ryzen_session_smu_stats(ryzen_session_t *session, int access,
+                            ryzen_smu_stats_t *stats, int reset);
+const char *ryzen_smu_access_name(int access);
+const char *ryzen_smu_error_name(int code); // Index into error_codes
+
+// Background sampler. A thread reads the PM table every interval_ms into a
+// ring of depth raw snapshots (0 picks a default depth). Readers never block
+// the sampler nor each other, so any number of consumers can share one
+// hardware read. Stopped automatically by ryzen_session_close().
+int ryzen_sampler_start(ryzen_session_t *session, unsigned int interval_ms,
+                        unsigned int depth);
+void ryzen_sampler_stop(ryzen_session_t *session);
+
+// Block until a sample newer than seq is published. Returns the sequence
+// number of the newest sample, or 0 on timeout.
+unsigned long long ryzen_sampler_wait(ryzen_session_t *session,
+                                      unsigned long long seq,
+                                      unsigned int timeout_ms);
+int ryzen_sampler_stats(ryzen_session_t *session, unsigned long long *samples,
+                        unsigned long long *errors,
+                        unsigned long long *overruns);
+
+// Adaptive sampling. While the package is close to a limit or busy, the
+// sampler reads every fast_ms; once every watermark is clear the interval
+// grows by backoff per sample up to idle_ms. Watermarks are fractions of the
+// limit (EDC derived like constraints_data_t) or, for c0, the C0 residency in
+// percent of the busiest core; 0 disables one. Sample timestamps stay exact,
+// so consumers see the real spacing through ryzen_sample_info_t.
+typedef struct {
+  unsigned int fast_ms;
+  unsigned int idle_ms;
+  float backoff; // Interval growth per calm sample, >= 1
+  float ppt;     // PPT_VALUE / PPT_LIMIT
+  float edc;
+  float thm;
+  float c0;
+} ryzen_schedule_t;
+
+void ryzen_schedule_defaults(ryzen_schedule_t *schedule);
+
+// Takes effect from the next sample. NULL returns to the interval_ms of
+// ryzen_sampler_start(). Returns -1 without a sampler or for an invalid one.
+int ryzen_sampler_schedule(ryzen_session_t *session,
+                           const ryzen_schedule_t *schedule);
+
+// Current sampling interval in milliseconds, 0 without a sampler
+unsigned int ryzen_sampler_interval(ryzen_session_t *session);
+
+// Size of one raw snapshot in bytes
+size_t ryzen_table_size(ryzen_session_t *session);
+
+// Copy the newest raw snapshot. Returns 0, or -1 if none is available yet.
+int ryzen_latest(ryzen_session_t *session, unsigned char *dst, size_t dst_len,
+                 ryzen_sample_info_t *info);
+
+// Copy up to max_samples raw snapshots newer than since_ns, oldest first,
+// back to back into dst. Returns the number of snapshots copied.
+int ryzen_read_range(ryzen_session_t *session, unsigned long long since_ns,
+                     unsigned char *dst, size_t dst_len,
+                     ryzen_sample_info_t *infos, int max_samples);
+
+// ryzen_session_sample() on the newest snapshot, without a hardware read
+int ryzen_read_latest(ryzen_session_t *session,
+                      core_data_t *cores, int max_cores,
+                      constraints_data_t *constraints,
+                      memory_data_t *memory,
+                      power_data_t *power,
+                      graphics_data_t *graphics,
+                      calculated_stats_t *stats,
+                      ryzen_sample_info_t *info);
+
+// Topology rollups. Summaries of the enabled cores of every CCD or CCX, each
+// CCX being the cores sharing one L3 (a CCX is a whole CCD on Zen3). Folded
+// from partial reductions of the per-core pass, so they cost next to nothing
+// on top of a sample. Groups without enabled cores are left out.
+enum {
+  RYZEN_GROUP_CCD,
+  RYZEN_GROUP_CCX
+};
+
+#define RYZEN_MAX_GROUPS 8
+
+typedef struct {
+  int index; // CCD or CCX number, counting disabled ones
+  int ccd;   // CCD of the group
+  int cores; // Enabled cores
+  float avg_frequency;
+  float peak_frequency;
+  float avg_temp;
+  float peak_temp;
+  float power;      // Sum of the core power
+  float c0;         // Average residency in percent, like core_data_t
+  float cc1;
+  float cc6;
+  float l3_logic_power; // L3 caches of the group, NAN if the table has none
+  float l3_vddm_power;
+} ryzen_group_t;
+
+// Rollups of level for the newest sampler snapshot, or a fresh read without
+// the sampler (info->seq is 0 then). Returns the number of groups written.
+int ryzen_read_groups(ryzen_session_t *session, int level,
+                      ryzen_group_t *groups, int max_groups,
+                      ryzen_sample_info_t *info);
+
+// Same for a raw PM table, e.g. one from ryzen_latest()
+int ryzen_decode_groups(ryzen_session_t *session, const unsigned char *table,
+                        int level, ryzen_group_t *groups, int max_groups);
+
+// Perf stage of the sampler. With it, every snapshot also holds per core
+// cycles and instructions from perf_event_open() and busy time from
+// /proc/stat, read right after the PM table under the same timestamp, so IPC,
+// OS load and CORE_POWER line up exactly. Counters need root or
+// CAP_PERFMON; /proc/stat is always read. CPUs map to PM table cores by
+// core_id, with SMT siblings summed; only the first package is covered.
+#define RYZEN_PERF_COUNTERS 1
+#define RYZEN_PERF_PROC_STAT 2
+
+typedef struct {
+  int core_num;
+  float utilization;  // Busy time of the core's CPUs in percent
+  float ipc;          // Instructions per cycle, SMT siblings together
+  float instructions; // Per second
+  float power;        // CORE_POWER of the same snapshot
+  float instructions_per_joule;
+} ryzen_core_perf_t;
+
+// Enable before ryzen_sampler_start(). Returns the RYZEN_PERF_* sources that
+// are available, or -1 if there are none, the sampler already runs or the
+// session is not on the first device, whose cores are those of package 0.
+// Disabled by ryzen_session_close(). Fields without a source are NAN;
+// utilization changes in steps of USER_HZ ticks, so sample every 100 ms or
+// slower to read it per sample.
+int ryzen_perf_enable(ryzen_session_t *session);
+
+// Per core values of the newest snapshot, over the interval since the
+// sample before it. Returns the core count, or -1.
+int ryzen_read_perf(ryzen_session_t *session, ryzen_core_perf_t *perf,
+                    int max_cores, ryzen_sample_info_t *info);
+
+// Prepare a buffer for ryzen_soa_read()
+void ryzen_soa_init(ryzen_soa_t *soa);
+
+// Update soa with the newest sample: the newest sampler snapshot if the
+// sampler runs, a fresh read otherwise. Returns the core count, 0 if soa
+// already holds the newest sample (nothing was written), or -1.
+int ryzen_soa_read(ryzen_session_t *session, ryzen_soa_t *soa);
+
+// Metric ids name the raw PM table fields. Array fields occupy consecutive
+// ids, e.g. ryzen_metric_lookup("CORE_TEMP[3]"). Valid ids are 0 up to
+// ryzen_metric_count() - 1; ryzen_metric_name() returns NULL for others.
+int ryzen_metric_count(void);
+const char *ryzen_metric_name(int metric, int *index);
+int ryzen_metric_lookup(const char *name);
+
+// Change events. A watch compares every sample against the value it last
+// reported for each metric, not against the previous sample, so slow drift
+// is reported once it adds up and a consumer applying the changes is never
+// off by more than the threshold. The first call reports every metric.
+typedef struct ryzen_watch ryzen_watch_t;
+
+typedef struct {
+  int metric;
+  float value; // NAN if the metric stopped being reported
+} ryzen_change_t;
+
+// A change is reported once it exceeds abs_threshold, or rel_threshold times
+// the last reported magnitude; a threshold of 0 is not used. With both 0,
+// every change is reported.
+ryzen_watch_t *ryzen_watch_create(ryzen_session_t *session, float abs_threshold,
+                                  float rel_threshold);
+void ryzen_watch_free(ryzen_watch_t *watch);
+
+// Override the thresholds of one metric, or of all with metric -1
+int ryzen_watch_threshold(ryzen_watch_t *watch, int metric, float abs_threshold,
+                          float rel_threshold);
+
+// Report everything again with the next call, e.g. for a new consumer
+void ryzen_watch_reset(ryzen_watch_t *watch);
+
+// Compare the newest sample (sampler snapshot, or a fresh read without the
+// sampler) and write up to max_changes changes. Returns their number; changes
+// beyond max_changes stay pending for the next call.
+int ryzen_watch_poll(ryzen_watch_t *watch, ryzen_change_t *changes,
+                     int max_changes, ryzen_sample_info_t *info);
+
+// Same for a raw PM table, e.g. one from ryzen_latest()
+int ryzen_watch_feed(ryzen_watch_t *watch, const unsigned char *table,
+                     ryzen_change_t *changes, int max_changes);
+
+// Rolling aggregation windows. Summaries of the decoded samples over the
+// last 1, 10 and 60 seconds in constant memory: every window is a ring of
+// ten buckets holding count, Welford mean/variance, min/max and a fixed-bin
+// histogram, and slides in steps of a tenth of its length. Windows end at the
+// newest sample added, not at the current time.
+enum {
+  RYZEN_WINDOW_1S,
+  RYZEN_WINDOW_10S,
+  RYZEN_WINDOW_60S,
+  RYZEN_WINDOW_COUNT
+};
+
+enum {
+  RYZEN_SERIES_CORE_FREQUENCY, // Per core, MHz
+  RYZEN_SERIES_CORE_TEMP,      // Per core, Celsius
+  RYZEN_SERIES_PPT,            // constraints_data_t.ppt_value
+  RYZEN_SERIES_EDC,            // constraints_data_t.edc_value
+  RYZEN_SERIES_SOCKET_POWER,   // power_data_t.socket_power
+  RYZEN_SERIES_COUNT
+};
+
+// Percentiles are exact to one histogram bin: 32 MHz, 0.5 C, 2 W or 2 A.
+// Empty windows have count 0 and NAN everywhere else.
+typedef struct {
+  unsigned long long count;
+  float min;
+  float max;
+  float mean;
+  float stddev;
+  float p50;
+  float p90;
+  float p99;
+} ryzen_window_stat_t;
+
+typedef struct ryzen_agg ryzen_agg_t;
+
+ryzen_agg_t *ryzen_agg_create(ryzen_session_t *session);
+void ryzen_agg_free(ryzen_agg_t *agg);
+
+// Windows without a session, for samples decoded elsewhere and fed through
+// ryzen_agg_add(), e.g. from many hosts. The per-core series pool all cores
+// as core 0, which keeps one window set under 200 KB.
+ryzen_agg_t *ryzen_agg_create_merged(void);
+
+// Add every sampler snapshot since the last call (a fresh read without the
+// sampler). Returns the number of samples added; call it at least once per
+// sampler depth worth of samples to see every one.
+int ryzen_agg_update(ryzen_agg_t *agg);
+
+// Add one decoded sample, for callers that sample on their own
+int ryzen_agg_add(ryzen_agg_t *agg, unsigned long long timestamp_ns,
+                  const core_data_t *cores, int num_cores,
+                  const constraints_data_t *constraints,
+                  const power_data_t *power);
+
+// core selects the core of per-core series and must be 0 for the others
+int ryzen_agg_stat(ryzen_agg_t *agg, int window, int series, int core,
+                   ryzen_window_stat_t *stat);
+
+// Limiter residency. Every sample decides which constraint is binding: the
+// limiter closest to its limit among those at or above the threshold share
+// of it (0.95 by default). The time to the previous sample is attributed to
+// the binding limiter, to every active one and to the frequency bin of every
+// enabled core under the binding limiter. The residency fields reported by
+// the SMU (PSI0, GFX EDC) are fractions of time already and count weighted.
+enum {
+  RYZEN_LIMIT_NONE, // Nothing at its limit: clocks are not held back
+  RYZEN_LIMIT_PPT,
+  RYZEN_LIMIT_PPT_FAST,
+  RYZEN_LIMIT_TDC,
+  RYZEN_LIMIT_TDC_SOC,
+  RYZEN_LIMIT_EDC, // constraints_data_t.edc_value against EDC_LIMIT
+  RYZEN_LIMIT_EDC_SOC,
+  RYZEN_LIMIT_THM,
+  RYZEN_LIMIT_FIT,
+  RYZEN_LIMIT_PSI0_VDD, // PSI0_RESIDENCY_VDD
+  RYZEN_LIMIT_PSI0_SOC, // PSI0_RESIDENCY_SOC
+  RYZEN_LIMIT_GFX_EDC,  // GFX_EDC_RESIDENCY
+  RYZEN_LIMIT_COUNT
+};
+
+#define RYZEN_FREQ_BIN_MHZ 250
+#define RYZEN_FREQ_BINS 32 // The last bin takes everything above 7750 MHz
+
+typedef struct {
+  unsigned long long samples;
+  unsigned long long total_ns; // Time covered by the counters
+  int binding;                 // Binding limiter of the newest sample
+  float utilization[RYZEN_LIMIT_COUNT]; // Newest sample, value / limit
+  unsigned long long binding_ns[RYZEN_LIMIT_COUNT];
+  unsigned long long active_ns[RYZEN_LIMIT_COUNT];
+  unsigned long long episodes[RYZEN_LIMIT_COUNT]; // Times it became binding
+  // Core time per frequency bin while the limiter was binding, summed over
+  // the enabled cores
+  unsigned long long freq_ns[RYZEN_LIMIT_COUNT][RYZEN_FREQ_BINS];
+} ryzen_throttle_stats_t;
+
+typedef struct ryzen_throttle ryzen_throttle_t;
+
+// threshold <= 0 selects the default
+ryzen_throttle_t *ryzen_throttle_create(ryzen_session_t *session,
+                                        float threshold);
+void ryzen_throttle_free(ryzen_throttle_t *throttle);
+
+// Account every sampler snapshot since the last call (a fresh read without
+// the sampler). Returns the number of samples added.
+int ryzen_throttle_update(ryzen_throttle_t *throttle);
+
+int ryzen_throttle_stats(ryzen_throttle_t *throttle,
+                         ryzen_throttle_stats_t *stats);
+void ryzen_throttle_reset(ryzen_throttle_t *throttle);
+
+// "PPT", "EDC", ... or NULL for invalid ids
+const char *ryzen_limit_name(int limit);
+
+// Shared memory publication. A publisher writes every sample of its session's
+// sampler, decoded and raw, into a POSIX shared memory segment under a
+// seqlock. Readers map it read-only: they need neither root nor the driver,
+// and any number of them share the publisher's single hardware read.
+#define RYZEN_SHM_DEFAULT_NAME "/ryzen_monitor"
+
+typedef struct ryzen_shm ryzen_shm_t;
+
+// Start publishing under name (NULL: RYZEN_SHM_DEFAULT_NAME). Needs a running
+// sampler and fails if another live publisher owns the name. Stopped
+// automatically by ryzen_sampler_stop().
+int ryzen_shm_publish(ryzen_session_t *session, const char *name);
+void ryzen_shm_unpublish(ryzen_session_t *session);
+
+// Reader side. ryzen_shm_open() needs no ryzen_init(). Reads fail once the
+// publisher has stopped or died; reopen to attach to its successor.
+ryzen_shm_t *ryzen_shm_open(const char *name);
+void ryzen_shm_close(ryzen_shm_t *shm);
+int ryzen_shm_info(ryzen_shm_t *shm, system_data_t *sysdata);
+int ryzen_shm_read(ryzen_shm_t *shm, core_data_t *cores, int max_cores,
+                   constraints_data_t *constraints,
+                   memory_data_t *memory,
+                   power_data_t *power,
+                   graphics_data_t *graphics,
+                   calculated_stats_t *stats,
+                   ryzen_sample_info_t *info);
+size_t ryzen_shm_table_size(ryzen_shm_t *shm);
+int ryzen_shm_read_table(ryzen_shm_t *shm, unsigned char *dst, size_t dst_len,
+                         ryzen_sample_info_t *info);
+
+// Fleet push. Sends every sample of the session's sampler as raw PM tables
+// over UDP to ryzen_monitor_collector at addr ("host:port", port defaults to
+// RYZEN_PUSH_DEFAULT_PORT), batch samples per datagram in the recorder's
+// frame format. name identifies this host to the collector (NULL: the host
+// name). Needs a running sampler; stopped automatically by
+// ryzen_sampler_stop().
+#define RYZEN_PUSH_DEFAULT_PORT 9838
+#define RYZEN_PUSH_DEFAULT_BATCH 10
+
+int ryzen_push_start(ryzen_session_t *session, const char *addr,
+                     const char *name, unsigned int batch);
+void ryzen_push_stop(ryzen_session_t *session);
+int ryzen_push_stats(ryzen_session_t *session, unsigned long long *datagrams,
+                     unsigned long long *samples, unsigned long long *errors);
+
+// Asynchronous SMU commands. A worker thread sends queued mailbox commands in
+// batches, so callers never wait for the SMU. PM table reads take a lock of
+// their own, hence neither the sampler nor the queue stalls the other. When
+// ryzen_cmd_fd() becomes readable, ryzen_cmd_dispatch() runs the callbacks of
+// all completed commands on the calling thread, in submission order; call it
+// from one thread at a time. Stopped automatically by ryzen_session_close(),
+// after sending what is queued; callbacks not dispatched by then are dropped.
+#define RYZEN_CMD_DEFAULT_DEPTH 64
+#define RYZEN_MAILBOX_RSMU 0
+#define RYZEN_MAILBOX_MP1 1
+#define RYZEN_CMD_OK 1 // status of a successful command
+
+// status is the SMU's reply, args the 6 arguments it returned (only valid
+// with RYZEN_CMD_OK)
+typedef void (*ryzen_cmd_cb)(void *user, unsigned long long ticket,
+                             int status, const unsigned int *args);
+
+// A queue of depth commands (0 picks a default), counting completed ones not
+// dispatched yet
+int ryzen_cmd_start(ryzen_session_t *session, unsigned int depth);
+void ryzen_cmd_stop(ryzen_session_t *session);
+
+// eventfd for poll() and friends, -1 without a queue
+int ryzen_cmd_fd(ryzen_session_t *session);
+
+// Queue op with 6 arguments (NULL: all 0) for a mailbox. Returns the ticket
+// passed to cb, counting from 1, or 0 if the queue is full or not started.
+unsigned long long ryzen_cmd_submit(ryzen_session_t *session, int mailbox,
+                                    unsigned int op, const unsigned int *args,
+                                    ryzen_cmd_cb cb, void *user);
+
+// Run the callbacks of completed commands. Returns their number, or -1.
+int ryzen_cmd_dispatch(ryzen_session_t *session);
+
 #endif // RYZEN_MONITOR_LIB_H
\ No newline at end of file
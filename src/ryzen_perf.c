@@ -0,0 +1,317 @@
+/**
+ * Ryzen Monitor Library
+ * OS view of the cores: cycles and instructions from perf_event_open() and
+ * busy time from /proc/stat, read by the sampler right after each PM table.
+ */
+
+#define _GNU_SOURCE
+
+#include "ryzen_session.h"
+#include <fcntl.h>
+#include <linux/perf_event.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#define PERF_MAX_CPUS 1024
+#define PERF_CPU_PATH "/sys/devices/system/cpu/cpu%d/topology/%s"
+#define PERF_STAT_PATH "/proc/stat"
+
+// Layout of a group read with PERF_FORMAT_GROUP and both times
+typedef struct {
+  unsigned long long nr;
+  unsigned long long time_enabled;
+  unsigned long long time_running;
+  unsigned long long values[2]; // Cycles, instructions
+} perf_group_read;
+
+typedef struct {
+  int core; // PM table core slot, -1 if the CPU is not one of the session's
+  int fd;   // Group leader counting cycles, -1 without counters
+  int ins_fd;
+  perf_group_read prev;
+  unsigned long long busy, total; // /proc/stat ticks of the last sample
+} perf_cpu;
+
+struct ryzen_perf {
+  int cpus;
+  int stat_fd;
+  unsigned int sources;
+  unsigned long long prev_ns;
+  char *stat_buf;
+  size_t stat_size;
+  perf_cpu cpu[];
+};
+
+static int read_topology(int cpu, const char *name) {
+  char path[128];
+  FILE *f;
+  int value = -1;
+
+  snprintf(path, sizeof(path), PERF_CPU_PATH, cpu, name);
+  f = fopen(path, "r");
+  if (!f)
+    return -1;
+  if (fscanf(f, "%d", &value) != 1)
+    value = -1;
+  fclose(f);
+  return value;
+}
+
+static int open_counter(int cpu, unsigned long long config, int group) {
+  struct perf_event_attr attr;
+
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.config = config;
+  attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                     PERF_FORMAT_TOTAL_TIME_RUNNING;
+  attr.exclude_guest = 1;
+  attr.disabled = group < 0;
+
+  return syscall(SYS_perf_event_open, &attr, -1, cpu, group,
+                 PERF_FLAG_FD_CLOEXEC);
+}
+
+// Cycles and instructions of one CPU as a group, so both always count over
+// the same time even when the PMU is multiplexed
+static int open_counters(perf_cpu *c, int cpu) {
+  c->fd = open_counter(cpu, PERF_COUNT_HW_CPU_CYCLES, -1);
+  if (c->fd < 0)
+    return -1;
+  c->ins_fd = open_counter(cpu, PERF_COUNT_HW_INSTRUCTIONS, c->fd);
+  if (c->ins_fd < 0 || ioctl(c->fd, PERF_EVENT_IOC_ENABLE,
+                             PERF_IOC_FLAG_GROUP) != 0) {
+    if (c->ins_fd >= 0)
+      close(c->ins_fd);
+    close(c->fd);
+    c->fd = c->ins_fd = -1;
+    return -1;
+  }
+  if (read(c->fd, &c->prev, sizeof(c->prev)) != sizeof(c->prev))
+    memset(&c->prev, 0, sizeof(c->prev));
+  return 0;
+}
+
+// Reads /proc/stat whole; it does not fit a fixed buffer on large systems
+static int read_stat(ryzen_perf *p) {
+  size_t len = 0;
+  ssize_t n;
+
+  for (;;) {
+    n = pread(p->stat_fd, p->stat_buf + len, p->stat_size - len - 1, len);
+    if (n < 0)
+      return -1;
+    if (n == 0)
+      break;
+    len += n;
+    if (len + 1 == p->stat_size) {
+      char *buf = realloc(p->stat_buf, p->stat_size * 2);
+
+      // Grows only until it fits once, then steady
+      if (!buf)
+        return -1;
+      p->stat_buf = buf;
+      p->stat_size *= 2;
+    }
+  }
+  p->stat_buf[len] = '\0';
+  return 0;
+}
+
+// Per CPU "cpuN user nice system idle iowait irq softirq steal ..."
+static void parse_stat(ryzen_perf *p, ryzen_perf_block *b) {
+  char *line = p->stat_buf;
+
+  while ((line = strstr(line, "\ncpu"))) {
+    unsigned long long t[8] = {0}, busy, total;
+    perf_cpu *c;
+    int cpu;
+    char *end;
+
+    line += 4;
+    cpu = strtol(line, &end, 10);
+    if (end == line || cpu < 0 || cpu >= p->cpus || p->cpu[cpu].core < 0)
+      continue;
+
+    for (int i = 0; i < 8; i++)
+      t[i] = strtoull(end, &end, 10);
+    total = t[0] + t[1] + t[2] + t[3] + t[4] + t[5] + t[6] + t[7];
+    busy = total - t[3] - t[4]; // Minus idle and iowait
+
+    c = &p->cpu[cpu];
+    if (c->total && total >= c->total && busy >= c->busy) {
+      b->busy_ticks[c->core] += busy - c->busy;
+      b->total_ticks[c->core] += total - c->total;
+    }
+    c->busy = busy;
+    c->total = total;
+  }
+}
+
+// Scales the group deltas to the whole interval if the PMU was multiplexed
+static void read_counters(perf_cpu *c, ryzen_perf_block *b) {
+  perf_group_read cur;
+  unsigned long long enabled, running;
+
+  if (read(c->fd, &cur, sizeof(cur)) != sizeof(cur) || cur.nr != 2)
+    return;
+
+  enabled = cur.time_enabled - c->prev.time_enabled;
+  running = cur.time_running - c->prev.time_running;
+  for (int i = 0; i < 2; i++) {
+    double delta = cur.values[i] - c->prev.values[i];
+
+    if (running && running < enabled)
+      delta = delta * enabled / running;
+    if (i == 0)
+      b->cycles[c->core] += delta;
+    else
+      b->instructions[c->core] += delta;
+  }
+  c->prev = cur;
+}
+
+static unsigned long long monotonic_ns(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+void ryzen_perf_sample(ryzen_perf *p, ryzen_perf_block *b) {
+  unsigned long long now;
+
+  memset(b, 0, sizeof(*b));
+  b->sources = p->sources;
+
+  for (int i = 0; i < p->cpus; i++)
+    if (p->cpu[i].core >= 0 && p->cpu[i].fd >= 0)
+      read_counters(&p->cpu[i], b);
+  if (p->stat_fd >= 0 && read_stat(p) == 0)
+    parse_stat(p, b);
+
+  now = monotonic_ns();
+  b->interval_ns = now - p->prev_ns;
+  p->prev_ns = now;
+}
+
+void ryzen_perf_free(ryzen_perf *p) {
+  if (!p)
+    return;
+
+  for (int i = 0; i < p->cpus; i++) {
+    if (p->cpu[i].ins_fd >= 0)
+      close(p->cpu[i].ins_fd);
+    if (p->cpu[i].fd >= 0)
+      close(p->cpu[i].fd);
+  }
+  if (p->stat_fd >= 0)
+    close(p->stat_fd);
+  free(p->stat_buf);
+  free(p);
+}
+
+// The CPUs of package 0 belong to the first driver instance. Nothing maps
+// the others to a package, so their sessions would get those same CPUs.
+static int on_first_device(const ryzen_session_t *s) {
+  char paths[1][SMU_MAX_PATH_LEN];
+
+  return smu_enumerate(paths, 1) < 1 || !strcmp(paths[0], s->smu->path);
+}
+
+int ryzen_perf_enable(ryzen_session_t *s) {
+  ryzen_perf_block scratch;
+  ryzen_perf *p;
+  long cpus;
+
+  if (!s || s->sampler || s->perf || !on_first_device(s))
+    return -1;
+
+  cpus = sysconf(_SC_NPROCESSORS_CONF);
+  if (cpus < 1)
+    return -1;
+  if (cpus > PERF_MAX_CPUS)
+    cpus = PERF_MAX_CPUS;
+
+  p = calloc(1, sizeof(*p) + cpus * sizeof(p->cpu[0]));
+  if (!p)
+    return -1;
+  p->cpus = cpus;
+  p->stat_size = 4096;
+  p->stat_buf = malloc(p->stat_size);
+  p->stat_fd = open(PERF_STAT_PATH, O_RDONLY | O_CLOEXEC);
+  if (p->stat_fd >= 0 && p->stat_buf)
+    p->sources |= RYZEN_PERF_PROC_STAT;
+
+  // core_id follows the APIC id, which numbers the core slots like the PM
+  // table does, gaps of disabled cores included. SMT siblings share a slot.
+  for (int i = 0; i < p->cpus; i++) {
+    perf_cpu *c = &p->cpu[i];
+    int core = read_topology(i, "core_id");
+
+    c->fd = c->ins_fd = -1;
+    c->core = -1;
+    if (read_topology(i, "physical_package_id") != 0 || core < 0 ||
+        core >= s->pmt.max_cores)
+      continue;
+    c->core = core;
+    if (open_counters(c, i) == 0)
+      p->sources |= RYZEN_PERF_COUNTERS;
+  }
+
+  if (!p->sources) {
+    ryzen_perf_free(p);
+    return -1;
+  }
+
+  // Baseline, so the first sample already covers one interval
+  p->prev_ns = monotonic_ns();
+  memset(&scratch, 0, sizeof(scratch));
+  if (p->sources & RYZEN_PERF_PROC_STAT && read_stat(p) == 0)
+    parse_stat(p, &scratch);
+
+  s->perf = p;
+  return p->sources;
+}
+
+int ryzen_read_perf(ryzen_session_t *s, ryzen_core_perf_t *perf,
+                    int max_cores, ryzen_sample_info_t *info) {
+  float v[PMT_METRIC_COUNT];
+  ryzen_perf_block b;
+  ryzen_sample_info_t tmp;
+  double seconds;
+  int n;
+
+  if (!s || !s->perf || !perf)
+    return -1;
+
+  pm_values_reset(v);
+  if (ryzen_sampler_latest_perf(s, v, &b, info ? info : &tmp) != 0)
+    return -1;
+
+  n = s->pmt.max_cores < max_cores ? s->pmt.max_cores : max_cores;
+  seconds = b.interval_ns / 1e9;
+  for (int i = 0; i < n; i++) {
+    ryzen_core_perf_t *out = &perf[i];
+    int counted = (b.sources & RYZEN_PERF_COUNTERS) && b.cycles[i] > 0;
+
+    out->core_num = i;
+    out->power = pmvi(v, CORE_POWER, i);
+    out->utilization = b.total_ticks[i]
+                           ? 100.f * b.busy_ticks[i] / b.total_ticks[i]
+                           : NAN;
+    out->ipc = counted ? b.instructions[i] / b.cycles[i] : NAN;
+    out->instructions =
+        counted && seconds > 0 ? b.instructions[i] / seconds : NAN;
+    out->instructions_per_joule =
+        out->power > 0 ? out->instructions / out->power : NAN;
+  }
+  return n;
+}
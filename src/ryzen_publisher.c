@@ -0,0 +1,120 @@
+/**
+ * Ryzen Monitor Library
+ * Shared memory publisher: decodes every sampler snapshot once and writes it
+ * to the segment, so readers in other processes never touch the SMU.
+ */
+
+#define _GNU_SOURCE
+
+#include "ryzen_session.h"
+#include "ryzen_shm.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Upper bound for noticing ryzen_shm_unpublish(), and the heartbeat period
+#define PUBLISHER_WAKEUP_MS 100
+
+struct ryzen_publisher {
+  pthread_t thread;
+  _Atomic int stop;
+  ryzen_session_t *session;
+  ryzen_shm_t *shm;
+  char *name;
+  unsigned char *table;
+  core_data_t *cores;
+};
+
+static void *publisher_main(void *arg) {
+  ryzen_publisher *p = arg;
+  ryzen_session_t *s = p->session;
+  unsigned int max_cores = p->shm->hdr->max_cores;
+  unsigned long long seq = 0;
+  ryzen_shm_snapshot snap;
+  ryzen_sample_info_t info;
+
+  memset(&snap, 0, sizeof(snap));
+  while (!atomic_load_explicit(&p->stop, memory_order_relaxed)) {
+    unsigned long long n = ryzen_sampler_wait(s, seq, PUBLISHER_WAKEUP_MS);
+
+    ryzen_shm_heartbeat(p->shm);
+    if (!n)
+      continue;
+
+    // The raw table and the decoded structs describe the same sample
+    if (ryzen_latest(s, p->table, s->smu->pm_table_size, &info) != 0)
+      continue;
+    seq = info.seq;
+
+    snap.core_count = ryzen_session_decode(
+        s, p->table, p->cores, max_cores, &snap.constraints, &snap.memory,
+        &snap.power, &snap.graphics, &snap.stats);
+    if (snap.core_count < 0)
+      continue;
+    snap.sample_seq = info.seq;
+    snap.timestamp_ns = info.timestamp_ns;
+
+    ryzen_shm_write(p->shm, &snap, p->cores, p->table);
+  }
+
+  return NULL;
+}
+
+static void publisher_free(ryzen_publisher *p) {
+  ryzen_shm_destroy(p->shm, p->name);
+  free(p->cores);
+  free(p->table);
+  free(p->name);
+  free(p);
+}
+
+int ryzen_shm_publish(ryzen_session_t *s, const char *name) {
+  ryzen_publisher *p;
+  unsigned int max_cores;
+
+  if (!s || !s->sampler || s->publisher)
+    return -1;
+
+  p = calloc(1, sizeof(*p));
+  if (!p)
+    return -1;
+
+  max_cores = s->pmt.max_cores;
+  p->session = s;
+  p->name = strdup(name ? name : RYZEN_SHM_DEFAULT_NAME);
+  p->table = calloc(s->smu->pm_table_size, 1);
+  p->cores = calloc(max_cores ? max_cores : 1, sizeof(core_data_t));
+  if (!p->name || !p->table || !p->cores)
+    goto _ERROR;
+
+  p->shm = ryzen_shm_create(p->name, &s->sysdata, s->smu->pm_table_version,
+                            s->smu->pm_table_size, max_cores,
+                            s->sysinfo.core_disable_map);
+  if (!p->shm)
+    goto _ERROR;
+
+  if (pthread_create(&p->thread, NULL, publisher_main, p) != 0)
+    goto _ERROR;
+
+  s->publisher = p;
+  return 0;
+
+_ERROR:
+  publisher_free(p);
+  return -1;
+}
+
+void ryzen_shm_unpublish(ryzen_session_t *s) {
+  ryzen_publisher *p;
+
+  if (!s || !s->publisher)
+    return;
+
+  p = s->publisher;
+  atomic_store_explicit(&p->stop, 1, memory_order_relaxed);
+  pthread_join(p->thread, NULL);
+
+  s->publisher = NULL;
+  publisher_free(p);
+}
@@ -0,0 +1,266 @@
+/**
+ * Ryzen Monitor Library
+ * Fleet push: batches every sampler snapshot into UDP datagrams in the
+ * recorder's frame format, for ryzen_monitor_collector.
+ */
+
+#define _GNU_SOURCE
+
+#include "recorder.h"
+#include "ryzen_push.h"
+#include "ryzen_session.h"
+#include <netdb.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+// Upper bound for noticing ryzen_push_stop()
+#define PUSHER_WAKEUP_MS 100
+
+struct ryzen_pusher {
+  pthread_t thread;
+  _Atomic int stop;
+  ryzen_session_t *session;
+  int fd;
+  unsigned int batch;
+  unsigned long long since_ns; // Newest sampler snapshot consumed
+  _Atomic unsigned long long datagrams;
+  _Atomic unsigned long long samples;
+  _Atomic unsigned long long errors;
+
+  // Datagram under construction: push header, trace header, frames
+  unsigned char *packet;
+  size_t len;
+  unsigned int frames;
+  const unsigned char *prev; // XOR reference, the previous table of packet
+
+  unsigned char *tables; // One batch of sampler snapshots
+  ryzen_sample_info_t *infos;
+};
+
+static unsigned long long clock_ns(clockid_t clock) {
+  struct timespec ts;
+
+  clock_gettime(clock, &ts);
+  return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void pusher_send(ryzen_pusher *p) {
+  ryzen_push_header *ph = (ryzen_push_header *)p->packet;
+  rec_header *hdr = (rec_header *)(p->packet + sizeof(*ph));
+
+  if (!p->frames)
+    return;
+
+  ph->seq = atomic_load_explicit(&p->datagrams, memory_order_relaxed) + 1;
+  ph->frames = p->frames;
+  hdr->start_realtime_ns = clock_ns(CLOCK_REALTIME);
+  hdr->start_timestamp_ns = clock_ns(CLOCK_MONOTONIC);
+
+  // Nobody listening shows up as ECONNREFUSED on a later send
+  if (send(p->fd, p->packet, p->len, 0) < 0)
+    atomic_fetch_add_explicit(&p->errors, 1, memory_order_relaxed);
+  else
+    atomic_fetch_add_explicit(&p->samples, p->frames, memory_order_relaxed);
+  atomic_fetch_add_explicit(&p->datagrams, 1, memory_order_relaxed);
+
+  p->len = sizeof(*ph) + sizeof(*hdr);
+  p->frames = 0;
+  p->prev = NULL;
+}
+
+static void pusher_add(ryzen_pusher *p, const unsigned char *table,
+                       unsigned long long timestamp_ns) {
+  unsigned int size = p->session->smu->pm_table_size;
+  int n;
+
+  n = rec_frame_encode(timestamp_ns, table, p->prev, size, p->packet + p->len,
+                       RYZEN_PUSH_MAX_PACKET - p->len);
+  if (n < 0) {
+    // The datagram is full; every one starts with a raw frame
+    pusher_send(p);
+    n = rec_frame_encode(timestamp_ns, table, NULL, size, p->packet + p->len,
+                         RYZEN_PUSH_MAX_PACKET - p->len);
+  }
+  p->len += n;
+  p->frames++;
+  p->prev = table;
+
+  if (p->frames >= p->batch)
+    pusher_send(p);
+}
+
+static void *pusher_main(void *arg) {
+  ryzen_pusher *p = arg;
+  ryzen_session_t *s = p->session;
+  size_t size = s->smu->pm_table_size;
+  unsigned char *reserve = p->tables + p->batch * size;
+  unsigned long long seq = 0;
+  int n;
+
+  while (!atomic_load_explicit(&p->stop, memory_order_relaxed)) {
+    unsigned long long next = ryzen_sampler_wait(s, seq, PUSHER_WAKEUP_MS);
+
+    if (!next)
+      continue;
+    seq = next;
+
+    do {
+      n = ryzen_read_range(s, p->since_ns, p->tables, p->batch * size,
+                           p->infos, p->batch);
+      for (int i = 0; i < n; i++) {
+        pusher_add(p, p->tables + i * size, p->infos[i].timestamp_ns);
+        p->since_ns = p->infos[i].timestamp_ns;
+      }
+
+      // The next read overwrites the XOR reference of a pending datagram
+      if (p->frames && p->prev != reserve) {
+        memcpy(reserve, p->prev, size);
+        p->prev = reserve;
+      }
+    } while (n == (int)p->batch);
+  }
+
+  pusher_send(p);
+  return NULL;
+}
+
+static void pusher_free(ryzen_pusher *p) {
+  if (p->fd >= 0)
+    close(p->fd);
+  free(p->packet);
+  free(p->tables);
+  free(p->infos);
+  free(p);
+}
+
+// "host:port", "host", "[v6]:port" or "[v6]"
+static int pusher_connect(const char *addr) {
+  char host[256], port[16];
+  const char *sep;
+  struct addrinfo hints, *res, *ai;
+  int fd = -1;
+
+  snprintf(port, sizeof(port), "%u", RYZEN_PUSH_DEFAULT_PORT);
+  if (addr[0] == '[' && (sep = strchr(addr, ']'))) {
+    snprintf(host, sizeof(host), "%.*s", (int)(sep - addr - 1), addr + 1);
+    if (sep[1] == ':')
+      snprintf(port, sizeof(port), "%s", sep + 2);
+  } else if ((sep = strrchr(addr, ':')) && !strchr(sep + 1, ']')) {
+    snprintf(host, sizeof(host), "%.*s", (int)(sep - addr), addr);
+    snprintf(port, sizeof(port), "%s", sep + 1);
+  } else {
+    snprintf(host, sizeof(host), "%s", addr);
+  }
+
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_DGRAM;
+  if (getaddrinfo(host, port, &hints, &res) != 0)
+    return -1;
+
+  for (ai = res; ai; ai = ai->ai_next) {
+    fd = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+      continue;
+    if (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0)
+      break;
+    close(fd);
+    fd = -1;
+  }
+
+  freeaddrinfo(res);
+  return fd;
+}
+
+int ryzen_push_start(ryzen_session_t *s, const char *addr, const char *name,
+                     unsigned int batch) {
+  ryzen_pusher *p;
+  ryzen_push_header *ph;
+  size_t size;
+
+  if (!s || !s->sampler || s->pusher || !addr)
+    return -1;
+
+  size = s->smu->pm_table_size;
+  if (sizeof(*ph) + sizeof(rec_header) + sizeof(rec_frame) + size >
+      RYZEN_PUSH_MAX_PACKET)
+    return -1;
+
+  p = calloc(1, sizeof(*p));
+  if (!p)
+    return -1;
+
+  p->session = s;
+  p->batch = batch ? batch : RYZEN_PUSH_DEFAULT_BATCH;
+  p->fd = pusher_connect(addr);
+  p->packet = calloc(RYZEN_PUSH_MAX_PACKET, 1);
+  // One extra table holds the XOR reference across batches
+  p->tables = malloc((p->batch + 1) * size);
+  p->infos = calloc(p->batch, sizeof(*p->infos));
+  if (p->fd < 0 || !p->packet || !p->tables || !p->infos)
+    goto _ERROR;
+
+  // Everything but the sequence number, frame count and clocks is fixed
+  ph = (ryzen_push_header *)p->packet;
+  memcpy(ph->magic, RYZEN_PUSH_MAGIC, sizeof(ph->magic));
+  ph->abi = RYZEN_PUSH_ABI;
+  ph->header_size = sizeof(*ph);
+  if (name)
+    snprintf(ph->host, sizeof(ph->host), "%s", name);
+  else if (gethostname(ph->host, sizeof(ph->host) - 1) != 0)
+    snprintf(ph->host, sizeof(ph->host), "unknown");
+
+  rec_header_fill((rec_header *)(p->packet + sizeof(*ph)), s->smu,
+                  &s->sysinfo);
+  p->len = sizeof(*ph) + sizeof(rec_header);
+
+  // Only samples taken from now on
+  p->since_ns = clock_ns(CLOCK_MONOTONIC);
+
+  if (pthread_create(&p->thread, NULL, pusher_main, p) != 0)
+    goto _ERROR;
+
+  s->pusher = p;
+  return 0;
+
+_ERROR:
+  pusher_free(p);
+  return -1;
+}
+
+void ryzen_push_stop(ryzen_session_t *s) {
+  ryzen_pusher *p;
+
+  if (!s || !s->pusher)
+    return;
+
+  p = s->pusher;
+  atomic_store_explicit(&p->stop, 1, memory_order_relaxed);
+  pthread_join(p->thread, NULL);
+
+  s->pusher = NULL;
+  pusher_free(p);
+}
+
+int ryzen_push_stats(ryzen_session_t *s, unsigned long long *datagrams,
+                     unsigned long long *samples, unsigned long long *errors) {
+  ryzen_pusher *p;
+
+  if (!s || !s->pusher)
+    return -1;
+
+  p = s->pusher;
+  if (datagrams)
+    *datagrams = atomic_load_explicit(&p->datagrams, memory_order_relaxed);
+  if (samples)
+    *samples = atomic_load_explicit(&p->samples, memory_order_relaxed);
+  if (errors)
+    *errors = atomic_load_explicit(&p->errors, memory_order_relaxed);
+  return 0;
+}
@@ -0,0 +1,32 @@
+/**
+ * Ryzen Monitor Library
+ * Datagram format of ryzen_push_start(), read by ryzen_monitor_collector
+ */
+
+#ifndef RYZEN_PUSH_H
+#define RYZEN_PUSH_H
+
+#include <stdint.h>
+
+#define RYZEN_PUSH_MAGIC "RZMPUSH\0"
+#define RYZEN_PUSH_ABI 1
+
+// Largest UDP payload over IPv4
+#define RYZEN_PUSH_MAX_PACKET 65507
+
+// Every datagram is self-contained: this header, then a short trace in the
+// recorder format (recorder.h), starting with a raw frame. A lost datagram
+// only loses its own samples. In the trace header, start_timestamp_ns and
+// start_realtime_ns are taken when the datagram is sent, and the frame
+// timestamps are the sampler's CLOCK_MONOTONIC.
+typedef struct {
+  char magic[8];
+  uint32_t abi;         // RYZEN_PUSH_ABI, bumped on any layout change
+  uint32_t header_size; // Offset of the trace
+  uint64_t seq;         // Datagram number, starts at 1; gaps are losses
+  uint32_t frames;
+  uint32_t reserved;
+  char host[64];        // Sender name, NUL terminated
+} ryzen_push_header;
+
+#endif // RYZEN_PUSH_H
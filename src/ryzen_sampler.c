@@ -0,0 +1,505 @@
+/**
+ * Ryzen Monitor Library
+ * Background sampler: one thread per session reads the PM table into a
+ * lock-free ring of timestamped raw snapshots, at a fixed cadence or at one
+ * that follows load and limit proximity.
+ */
+
+#define _GNU_SOURCE
+
+#include "ryzen_session.h"
+#include <errno.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define SAMPLER_DEFAULT_DEPTH 64
+#define SAMPLER_MIN_INTERVAL_MS 1
+#define SAMPLER_READ_RETRIES 16
+
+// Slot header; the raw table follows it in the same cache-line aligned block.
+// seq is 2n-1 while sample n is being written and 2n once it is published,
+// so a reader knows which sample it copied and whether it was torn.
+typedef struct {
+  _Atomic unsigned long long seq;
+  unsigned long long timestamp_ns;
+} sampler_slot;
+
+struct ryzen_sampler {
+  pthread_t thread;
+  pthread_mutex_t lock; // Guards stop, the schedule and ryzen_sampler_wait()
+  pthread_cond_t cond;
+  pthread_cond_t published;
+  int stop;
+  int adaptive;
+  ryzen_schedule_t schedule;
+
+  ryzen_session_t *session;
+  smu_obj_t *smu; // Device of the session; one sampler thread per device
+  unsigned long long fixed_ns; // Interval of ryzen_sampler_start()
+  _Atomic unsigned long long interval_ns; // Interval until the next read
+  unsigned int depth;
+  size_t table_size;
+  size_t perf_offset; // Of the perf block from the slot data, 0 without one
+  size_t stride;
+  ryzen_perf *perf;
+  unsigned char *slots;
+
+  _Atomic unsigned long long head; // Last published sample, 0 if none yet
+  _Atomic unsigned long long errors;
+  _Atomic unsigned long long overruns;
+
+  float values[PMT_METRIC_COUNT]; // Scratch of the sampler thread
+};
+
+static inline sampler_slot *slot_at(ryzen_sampler *r, unsigned long long n) {
+  return (sampler_slot *)(r->slots + (n % r->depth) * r->stride);
+}
+
+static inline unsigned char *slot_data(sampler_slot *slot) {
+  return (unsigned char *)(slot + 1);
+}
+
+static inline ryzen_perf_block *slot_perf(ryzen_sampler *r,
+                                          sampler_slot *slot) {
+  return (ryzen_perf_block *)(slot_data(slot) + r->perf_offset);
+}
+
+static unsigned long long timespec_ns(const struct timespec *ts) {
+  return (unsigned long long)ts->tv_sec * 1000000000ULL + ts->tv_nsec;
+}
+
+static void ns_timespec(unsigned long long ns, struct timespec *ts) {
+  ts->tv_sec = ns / 1000000000ULL;
+  ts->tv_nsec = ns % 1000000000ULL;
+}
+
+static unsigned long long monotonic_ns(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return timespec_ns(&ts);
+}
+
+// Single producer: write sample n into its slot and publish it
+static void sampler_publish(ryzen_sampler *r) {
+  unsigned long long n = atomic_load_explicit(&r->head, memory_order_relaxed) + 1;
+  sampler_slot *slot = slot_at(r, n);
+
+  atomic_store_explicit(&slot->seq, 2 * n - 1, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+
+  // Read straight into the slot; readers of older slots are unaffected
+  if (smu_read_pm_table(r->smu, slot_data(slot), r->table_size) !=
+      SMU_Return_OK) {
+    // The old contents may be clobbered; keep the slot invalid until reused
+    atomic_store_explicit(&slot->seq, 0, memory_order_release);
+    atomic_fetch_add_explicit(&r->errors, 1, memory_order_relaxed);
+    return;
+  }
+  slot->timestamp_ns = monotonic_ns();
+  // Right after the table, under the same timestamp
+  if (r->perf)
+    ryzen_perf_sample(r->perf, slot_perf(r, slot));
+
+  atomic_store_explicit(&slot->seq, 2 * n, memory_order_release);
+  atomic_store_explicit(&r->head, n, memory_order_release);
+}
+
+static int above(float value, float limit, float watermark) {
+  return watermark > 0 && limit > 0 && value / limit >= watermark;
+}
+
+// Whether sample n is close to a limit or busy enough to sample fast. Missing
+// fields read as NAN and never cross a watermark.
+static int sampler_hot(ryzen_sampler *r, unsigned long long n,
+                       const ryzen_schedule_t *sc) {
+  ryzen_session_t *s = r->session;
+  float *v = r->values;
+  float c0, total_c0 = 0, max_c0 = 0, edc = NAN;
+
+  // The sampler is the only writer, so its own newest slot is stable
+  pm_layout_gather(&s->layout, slot_data(slot_at(r, n)), v);
+
+  for (int i = 0; i < s->pmt.max_cores; i++) {
+    if ((s->sysinfo.core_disable_map >> i) & 1)
+      continue;
+    c0 = pmvi0(v, CORE_C0, i);
+    total_c0 += c0;
+    if (c0 > max_c0)
+      max_c0 = c0;
+  }
+  // Derived like the decoded constraints
+  if (s->sysinfo.cores > 0) {
+    edc = pmv(v, EDC_VALUE) * (total_c0 / s->sysinfo.cores / 100);
+    if (edc < pmv(v, TDC_VALUE))
+      edc = pmv(v, TDC_VALUE);
+  }
+
+  return above(pmv(v, PPT_VALUE), pmv(v, PPT_LIMIT), sc->ppt) ||
+         above(edc, pmv(v, EDC_LIMIT), sc->edc) ||
+         above(pmv(v, THM_VALUE), pmv(v, THM_LIMIT), sc->thm) ||
+         (sc->c0 > 0 && max_c0 >= sc->c0);
+}
+
+// Interval until the next read: fast as soon as a watermark is crossed,
+// otherwise backing off geometrically toward the idle rate, so short lulls
+// under load do not drop the rate at once.
+static unsigned long long sampler_next_interval(ryzen_sampler *r,
+                                                unsigned long long n,
+                                                unsigned long long cur) {
+  ryzen_schedule_t sc;
+  unsigned long long fast, idle, next;
+  int adaptive;
+
+  pthread_mutex_lock(&r->lock);
+  adaptive = r->adaptive;
+  sc = r->schedule;
+  pthread_mutex_unlock(&r->lock);
+
+  if (!adaptive)
+    return r->fixed_ns;
+
+  fast = (unsigned long long)sc.fast_ms * 1000000ULL;
+  idle = (unsigned long long)sc.idle_ms * 1000000ULL;
+  // A failed read keeps the pace; there is nothing to judge it by
+  if (!n)
+    next = cur;
+  else if (sampler_hot(r, n, &sc))
+    return fast;
+  else
+    next = (unsigned long long)(cur * sc.backoff);
+
+  return next < fast ? fast : next > idle ? idle : next;
+}
+
+static void *sampler_main(void *arg) {
+  ryzen_sampler *r = arg;
+  unsigned long long next = monotonic_ns();
+  unsigned long long prev = 0, head, interval, now;
+  struct timespec deadline;
+  int stop;
+
+  for (;;) {
+    sampler_publish(r);
+    head = atomic_load_explicit(&r->head, memory_order_relaxed);
+
+    pthread_mutex_lock(&r->lock);
+    pthread_cond_broadcast(&r->published);
+    pthread_mutex_unlock(&r->lock);
+
+    // Absolute deadlines keep the cadence free of drift. If a read stalled
+    // for longer than an interval, skip the missed ticks instead of bursting.
+    interval = atomic_load_explicit(&r->interval_ns, memory_order_relaxed);
+    interval = sampler_next_interval(r, head != prev ? head : 0, interval);
+    atomic_store_explicit(&r->interval_ns, interval, memory_order_relaxed);
+    prev = head;
+
+    next += interval;
+    now = monotonic_ns();
+    if (next <= now) {
+      atomic_fetch_add_explicit(&r->overruns, (now - next) / interval + 1,
+                                memory_order_relaxed);
+      next += ((now - next) / interval + 1) * interval;
+    }
+    ns_timespec(next, &deadline);
+
+    pthread_mutex_lock(&r->lock);
+    while (!r->stop &&
+           pthread_cond_timedwait(&r->cond, &r->lock, &deadline) != ETIMEDOUT)
+      ;
+    stop = r->stop;
+    pthread_mutex_unlock(&r->lock);
+
+    if (stop)
+      break;
+  }
+
+  return NULL;
+}
+
+static void sampler_free(ryzen_sampler *r) {
+  pthread_cond_destroy(&r->published);
+  pthread_cond_destroy(&r->cond);
+  pthread_mutex_destroy(&r->lock);
+  free(r->slots);
+  free(r);
+}
+
+int ryzen_sampler_start(ryzen_session_t *s, unsigned int interval_ms,
+                        unsigned int depth) {
+  ryzen_sampler *r;
+  pthread_condattr_t attr;
+
+  if (!s || s->sampler)
+    return -1;
+
+  if (interval_ms < SAMPLER_MIN_INTERVAL_MS)
+    interval_ms = SAMPLER_MIN_INTERVAL_MS;
+  if (depth < 2)
+    depth = SAMPLER_DEFAULT_DEPTH;
+
+  r = calloc(1, sizeof(*r));
+  if (!r)
+    return -1;
+
+  r->session = s;
+  r->smu = s->smu;
+  r->fixed_ns = (unsigned long long)interval_ms * 1000000ULL;
+  atomic_init(&r->interval_ns, r->fixed_ns);
+  r->depth = depth;
+  r->table_size = s->smu->pm_table_size;
+  r->stride = sizeof(sampler_slot) + r->table_size;
+  if (s->perf) {
+    r->perf = s->perf;
+    r->perf_offset = (r->table_size + 7) & ~(size_t)7;
+    r->stride = sizeof(sampler_slot) + r->perf_offset + sizeof(ryzen_perf_block);
+  }
+  r->stride = (r->stride + 63) & ~(size_t)63;
+
+  r->slots = aligned_alloc(64, r->stride * depth);
+  if (!r->slots) {
+    free(r);
+    return -1;
+  }
+  memset(r->slots, 0, r->stride * depth);
+
+  pthread_mutex_init(&r->lock, NULL);
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_cond_init(&r->cond, &attr);
+  pthread_cond_init(&r->published, &attr);
+  pthread_condattr_destroy(&attr);
+
+  if (pthread_create(&r->thread, NULL, sampler_main, r) != 0) {
+    sampler_free(r);
+    return -1;
+  }
+
+  s->sampler = r;
+  return 0;
+}
+
+void ryzen_sampler_stop(ryzen_session_t *s) {
+  ryzen_sampler *r;
+
+  if (!s || !s->sampler)
+    return;
+
+  // The publisher and the pusher wait on this sampler
+  ryzen_shm_unpublish(s);
+  ryzen_push_stop(s);
+
+  r = s->sampler;
+  pthread_mutex_lock(&r->lock);
+  r->stop = 1;
+  pthread_cond_signal(&r->cond);
+  pthread_cond_broadcast(&r->published);
+  pthread_mutex_unlock(&r->lock);
+  pthread_join(r->thread, NULL);
+
+  s->sampler = NULL;
+  sampler_free(r);
+}
+
+unsigned long long ryzen_sampler_wait(ryzen_session_t *s, unsigned long long seq,
+                                      unsigned int timeout_ms) {
+  ryzen_sampler *r;
+  struct timespec deadline;
+  unsigned long long head;
+
+  if (!s || !s->sampler)
+    return 0;
+
+  r = s->sampler;
+  head = atomic_load_explicit(&r->head, memory_order_acquire);
+  if (head != seq)
+    return head;
+
+  ns_timespec(monotonic_ns() + (unsigned long long)timeout_ms * 1000000ULL,
+              &deadline);
+  pthread_mutex_lock(&r->lock);
+  while ((head = atomic_load_explicit(&r->head, memory_order_acquire)) == seq &&
+         !r->stop &&
+         pthread_cond_timedwait(&r->published, &r->lock, &deadline) != ETIMEDOUT)
+    ;
+  pthread_mutex_unlock(&r->lock);
+
+  return head != seq ? head : 0;
+}
+
+int ryzen_sampler_stats(ryzen_session_t *s, unsigned long long *samples,
+                        unsigned long long *errors,
+                        unsigned long long *overruns) {
+  if (!s || !s->sampler)
+    return -1;
+
+  if (samples)
+    *samples = atomic_load_explicit(&s->sampler->head, memory_order_acquire);
+  if (errors)
+    *errors = atomic_load_explicit(&s->sampler->errors, memory_order_relaxed);
+  if (overruns)
+    *overruns = atomic_load_explicit(&s->sampler->overruns, memory_order_relaxed);
+  return 0;
+}
+
+void ryzen_schedule_defaults(ryzen_schedule_t *sc) {
+  if (!sc)
+    return;
+
+  sc->fast_ms = 100;
+  sc->idle_ms = 2000;
+  sc->backoff = 2.f;
+  sc->ppt = 0.8f;
+  sc->edc = 0.8f;
+  sc->thm = 0.9f;
+  sc->c0 = 50.f;
+}
+
+int ryzen_sampler_schedule(ryzen_session_t *s, const ryzen_schedule_t *sc) {
+  ryzen_sampler *r;
+
+  if (!s || !s->sampler)
+    return -1;
+  if (sc && (sc->fast_ms < SAMPLER_MIN_INTERVAL_MS ||
+             sc->idle_ms < sc->fast_ms || !(sc->backoff >= 1.f)))
+    return -1;
+
+  r = s->sampler;
+  pthread_mutex_lock(&r->lock);
+  r->adaptive = sc != NULL;
+  if (sc)
+    r->schedule = *sc;
+  pthread_mutex_unlock(&r->lock);
+  return 0;
+}
+
+unsigned int ryzen_sampler_interval(ryzen_session_t *s) {
+  if (!s || !s->sampler)
+    return 0;
+
+  return atomic_load_explicit(&s->sampler->interval_ns, memory_order_relaxed) /
+         1000000ULL;
+}
+
+size_t ryzen_table_size(ryzen_session_t *s) {
+  return s ? s->smu->pm_table_size : 0;
+}
+
+// Copy sample n out of the ring. Fails if it was overwritten meanwhile.
+static int sampler_copy(ryzen_sampler *r, unsigned long long n,
+                        unsigned char *dst, ryzen_sample_info_t *info) {
+  sampler_slot *slot = slot_at(r, n);
+  unsigned long long seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+
+  if (seq != 2 * n)
+    return -1;
+
+  memcpy(dst, slot_data(slot), r->table_size);
+  info->seq = n;
+  info->timestamp_ns = slot->timestamp_ns;
+
+  atomic_thread_fence(memory_order_acquire);
+  return atomic_load_explicit(&slot->seq, memory_order_relaxed) == seq ? 0 : -1;
+}
+
+int ryzen_latest(ryzen_session_t *s, unsigned char *dst, size_t dst_len,
+                 ryzen_sample_info_t *info) {
+  ryzen_sample_info_t tmp;
+  ryzen_sampler *r;
+
+  if (!s || !s->sampler || dst_len < s->sampler->table_size)
+    return -1;
+
+  r = s->sampler;
+  for (int i = 0; i < SAMPLER_READ_RETRIES; i++) {
+    unsigned long long n = atomic_load_explicit(&r->head, memory_order_acquire);
+
+    if (!n)
+      return -1;
+    if (sampler_copy(r, n, dst, info ? info : &tmp) == 0)
+      return 0;
+  }
+
+  return -1;
+}
+
+int ryzen_read_range(ryzen_session_t *s, unsigned long long since_ns,
+                     unsigned char *dst, size_t dst_len,
+                     ryzen_sample_info_t *infos, int max_samples) {
+  ryzen_sampler *r;
+  unsigned long long n, head;
+  int count = 0;
+
+  if (!s || !s->sampler || !infos)
+    return -1;
+
+  r = s->sampler;
+  head = atomic_load_explicit(&r->head, memory_order_acquire);
+  n = head > r->depth ? head - r->depth + 1 : 1;
+
+  // Oldest first; a caller that fills max_samples continues from the
+  // timestamp of the last entry it got
+  for (; n <= head && count < max_samples; n++) {
+    if ((size_t)(count + 1) * r->table_size > dst_len)
+      break;
+
+    // Slots the producer has already lapped are simply skipped
+    if (sampler_copy(r, n, dst + count * r->table_size, &infos[count]) != 0)
+      continue;
+    if (infos[count].timestamp_ns <= since_ns)
+      continue;
+    count++;
+  }
+
+  return count;
+}
+
+static int sampler_latest(ryzen_session_t *s, float *values,
+                          ryzen_perf_block *block, ryzen_sample_info_t *info) {
+  ryzen_sampler *r;
+
+  if (!s || !s->sampler || (block && !s->sampler->perf))
+    return -1;
+
+  r = s->sampler;
+  for (int i = 0; i < SAMPLER_READ_RETRIES; i++) {
+    unsigned long long n = atomic_load_explicit(&r->head, memory_order_acquire);
+    sampler_slot *slot = slot_at(r, n);
+    unsigned long long seq;
+
+    if (!n)
+      return -1;
+
+    seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+    if (seq != 2 * n)
+      continue;
+
+    // Only the metrics of the layout are copied, not the whole table
+    pm_layout_gather(&s->layout, slot_data(slot), values);
+    if (block)
+      memcpy(block, slot_perf(r, slot), sizeof(*block));
+    info->seq = n;
+    info->timestamp_ns = slot->timestamp_ns;
+
+    atomic_thread_fence(memory_order_acquire);
+    if (atomic_load_explicit(&slot->seq, memory_order_relaxed) == seq)
+      return 0;
+  }
+
+  return -1;
+}
+
+int ryzen_sampler_latest_values(ryzen_session_t *s, float *values,
+                                ryzen_sample_info_t *info) {
+  return sampler_latest(s, values, NULL, info);
+}
+
+int ryzen_sampler_latest_perf(ryzen_session_t *s, float *values,
+                              ryzen_perf_block *block,
+                              ryzen_sample_info_t *info) {
+  return sampler_latest(s, values, block, info);
+}
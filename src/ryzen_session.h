@@ -0,0 +1,80 @@
+/**
+ * Ryzen Monitor Library
+ * Internal session state, shared between the library translation units
+ */
+
+#ifndef RYZEN_SESSION_H
+#define RYZEN_SESSION_H
+
+#include "ryzen_monitor_lib.h"
+#include "lib/libsmu.h"
+#include "pm_tables.h"
+#include "pm_layout.h"
+#include "readinfo.h"
+
+typedef struct ryzen_sampler ryzen_sampler;
+typedef struct ryzen_publisher ryzen_publisher;
+typedef struct ryzen_pusher ryzen_pusher;
+typedef struct ryzen_cmdq ryzen_cmdq;
+typedef struct ryzen_perf ryzen_perf;
+
+// What the perf stage adds to a sampler slot: counter and /proc/stat deltas
+// per PM table core slot since the previous sample, SMT siblings summed
+typedef struct {
+  unsigned int sources; // RYZEN_PERF_* that were read
+  unsigned long long interval_ns;
+  double cycles[PMT_MAX_NUM_CORES];
+  double instructions[PMT_MAX_NUM_CORES];
+  unsigned long long busy_ticks[PMT_MAX_NUM_CORES];
+  unsigned long long total_ticks[PMT_MAX_NUM_CORES];
+} ryzen_perf_block;
+
+// Turns a dense metric array into the exported structs
+typedef int (*ryzen_derive_fn)(ryzen_session_t *s, const float *v,
+                               core_data_t *cores, int max_cores,
+                               constraints_data_t *constraints,
+                               memory_data_t *memory, power_data_t *power,
+                               graphics_data_t *graphics,
+                               calculated_stats_t *stats);
+
+// Everything that is fixed for the lifetime of the driver: PM table layout,
+// topology and the core disable map. Resolved once by ryzen_session_open().
+struct ryzen_session {
+  smu_obj_t *smu;       // Device the session reads
+  smu_obj_t *device;    // Owned by the session if opened by index, else NULL
+  unsigned char *pm_buf; // Follows the session in the same allocation
+  pm_table pmt;         // Pointer mapping, used for presence checks only
+  pm_layout layout;     // Compiled form of pmt, drives the per-sample gather
+  pm_layout decode_layout; // Only the metrics derive reads
+  ryzen_derive_fn derive; // Decoder for the shape of pmt
+  system_info sysinfo;
+  system_data_t sysdata;
+  ryzen_sampler *sampler; // Background sampler, NULL unless started
+  ryzen_publisher *publisher; // Shared memory publisher, needs the sampler
+  ryzen_pusher *pusher; // Fleet push, needs the sampler
+  ryzen_cmdq *cmdq; // Asynchronous SMU commands, NULL unless started
+  ryzen_perf *perf; // Perf stage of the sampler, NULL unless enabled
+};
+
+// Gather the newest sampler snapshot into a dense metric array. Never blocks
+// the sampler thread; returns -1 if no snapshot has been published yet.
+int ryzen_sampler_latest_values(ryzen_session_t *s, float *values,
+                                ryzen_sample_info_t *info);
+
+// Same, plus the perf block of the snapshot. Fails without the perf stage.
+int ryzen_sampler_latest_perf(ryzen_session_t *s, float *values,
+                              ryzen_perf_block *block,
+                              ryzen_sample_info_t *info);
+
+// Sampler thread only: read the counters into block
+void ryzen_perf_sample(ryzen_perf *p, ryzen_perf_block *block);
+void ryzen_perf_free(ryzen_perf *p);
+
+// Picks the decoder used by ryzen_session_decode() and ryzen_read_latest().
+// With specialized set, it gathers only the metrics it reads and, if the shape
+// of s->pmt is a known one, is specialized for it at compile time. Otherwise
+// it gathers the whole layout and reads the shape from s->pmt. Returns 1 if a
+// specialized decoder was picked.
+int ryzen_session_select_decoder(ryzen_session_t *s, int specialized);
+
+#endif // RYZEN_SESSION_H
@@ -0,0 +1,303 @@
+/**
+ * Ryzen Monitor Library
+ * Shared memory segment: one publisher writes every sample under a seqlock,
+ * any number of unprivileged readers map it read-only.
+ */
+
+#define _GNU_SOURCE
+
+#include "ryzen_shm.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define SHM_READ_RETRIES 64
+
+static unsigned long long monotonic_ns(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static size_t align64(size_t n) { return (n + 63) & ~(size_t)63; }
+
+static const char *shm_name(const char *name) {
+  return name ? name : RYZEN_SHM_DEFAULT_NAME;
+}
+
+static int header_valid(const ryzen_shm_header *hdr, size_t size) {
+  return size >= sizeof(*hdr) && !memcmp(hdr->magic, RYZEN_SHM_MAGIC, 8) &&
+         hdr->abi == RYZEN_SHM_ABI && hdr->header_size == sizeof(*hdr) &&
+         hdr->segment_size <= size &&
+         hdr->table_offset + (size_t)hdr->pm_table_size <= hdr->segment_size &&
+         hdr->cores_offset + (size_t)hdr->max_cores * sizeof(core_data_t) <=
+             hdr->segment_size &&
+         hdr->snapshot_offset + sizeof(ryzen_shm_snapshot) <= hdr->segment_size;
+}
+
+static int header_live(const ryzen_shm_header *hdr) {
+  unsigned long long beat;
+
+  if (!atomic_load_explicit(&hdr->alive, memory_order_acquire))
+    return 0;
+
+  beat = atomic_load_explicit(&hdr->heartbeat_ns, memory_order_relaxed);
+  return monotonic_ns() - beat < RYZEN_SHM_STALE_NS;
+}
+
+ryzen_shm_t *ryzen_shm_open(const char *name) {
+  ryzen_shm_t *shm;
+  struct stat st;
+  void *base;
+  int fd;
+
+  fd = shm_open(shm_name(name), O_RDONLY | O_CLOEXEC, 0);
+  if (fd < 0)
+    return NULL;
+
+  if (fstat(fd, &st) || (size_t)st.st_size < sizeof(ryzen_shm_header)) {
+    close(fd);
+    return NULL;
+  }
+
+  base = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (base == MAP_FAILED)
+    return NULL;
+
+  shm = calloc(1, sizeof(*shm));
+  if (!shm || !header_valid(base, st.st_size)) {
+    free(shm);
+    munmap(base, st.st_size);
+    return NULL;
+  }
+
+  shm->base = base;
+  shm->size = st.st_size;
+  shm->hdr = base;
+  return shm;
+}
+
+void ryzen_shm_close(ryzen_shm_t *shm) {
+  if (!shm)
+    return;
+
+  munmap(shm->base, shm->size);
+  free(shm);
+}
+
+int ryzen_shm_info(ryzen_shm_t *shm, system_data_t *sysdata) {
+  if (!shm)
+    return -1;
+
+  *sysdata = shm->hdr->sysdata;
+  return 0;
+}
+
+size_t ryzen_shm_table_size(ryzen_shm_t *shm) {
+  return shm ? shm->hdr->pm_table_size : 0;
+}
+
+// Seqlock read of the parts a caller asked for. Retries while the publisher
+// is writing; gives up if it never finishes, e.g. it died mid-write.
+static int shm_read(ryzen_shm_t *shm, ryzen_shm_snapshot *snap,
+                    core_data_t *cores, int max_cores, unsigned char *table) {
+  ryzen_shm_header *hdr = shm->hdr;
+  int core_count = max_cores < (int)hdr->max_cores ? max_cores : (int)hdr->max_cores;
+
+  if (!header_live(hdr))
+    return -1;
+
+  for (int i = 0; i < SHM_READ_RETRIES; i++) {
+    unsigned long long seq = atomic_load_explicit(&hdr->seq, memory_order_acquire);
+
+    if (!seq)
+      return -1;
+    if (seq & 1) {
+      sched_yield();
+      continue;
+    }
+
+    memcpy(snap, shm->base + hdr->snapshot_offset, sizeof(*snap));
+    if (cores && core_count > 0)
+      memcpy(cores, shm->base + hdr->cores_offset, core_count * sizeof(*cores));
+    if (table)
+      memcpy(table, shm->base + hdr->table_offset, hdr->pm_table_size);
+
+    atomic_thread_fence(memory_order_acquire);
+    if (atomic_load_explicit(&hdr->seq, memory_order_relaxed) == seq)
+      return 0;
+  }
+
+  return -1;
+}
+
+int ryzen_shm_read(ryzen_shm_t *shm, core_data_t *cores, int max_cores,
+                   constraints_data_t *constraints, memory_data_t *memory,
+                   power_data_t *power, graphics_data_t *graphics,
+                   calculated_stats_t *stats, ryzen_sample_info_t *info) {
+  ryzen_shm_snapshot snap;
+
+  if (!shm || shm_read(shm, &snap, cores, max_cores, NULL))
+    return -1;
+
+  *constraints = snap.constraints;
+  *memory = snap.memory;
+  *power = snap.power;
+  *graphics = snap.graphics;
+  *stats = snap.stats;
+  if (info) {
+    info->seq = snap.sample_seq;
+    info->timestamp_ns = snap.timestamp_ns;
+  }
+
+  return snap.core_count < max_cores ? snap.core_count : max_cores;
+}
+
+int ryzen_shm_read_table(ryzen_shm_t *shm, unsigned char *dst, size_t dst_len,
+                         ryzen_sample_info_t *info) {
+  ryzen_shm_snapshot snap;
+
+  if (ryzen_shm_read_raw(shm, &snap, dst, dst_len))
+    return -1;
+
+  if (info) {
+    info->seq = snap.sample_seq;
+    info->timestamp_ns = snap.timestamp_ns;
+  }
+  return 0;
+}
+
+int ryzen_shm_read_raw(ryzen_shm_t *shm, ryzen_shm_snapshot *snap,
+                       unsigned char *table, size_t table_len) {
+  if (!shm || table_len < shm->hdr->pm_table_size)
+    return -1;
+
+  return shm_read(shm, snap, NULL, 0, table);
+}
+
+// A segment still owned by a running publisher must not be replaced
+static int segment_in_use(const char *name) {
+  ryzen_shm_t *old = ryzen_shm_open(name);
+  int live;
+
+  if (!old)
+    return 0;
+
+  live = header_live(old->hdr);
+  ryzen_shm_close(old);
+  return live;
+}
+
+ryzen_shm_t *ryzen_shm_create(const char *name, const system_data_t *sysdata,
+                              unsigned int pm_table_version,
+                              size_t pm_table_size, unsigned int max_cores,
+                              unsigned int core_disable_map) {
+  ryzen_shm_header *hdr;
+  ryzen_shm_t *shm;
+  size_t snapshot_offset, cores_offset, table_offset, size;
+  void *base;
+  int fd;
+
+  name = shm_name(name);
+  if (segment_in_use(name)) {
+    errno = EBUSY;
+    return NULL;
+  }
+
+  snapshot_offset = align64(sizeof(ryzen_shm_header));
+  cores_offset = align64(snapshot_offset + sizeof(ryzen_shm_snapshot));
+  table_offset = align64(cores_offset + max_cores * sizeof(core_data_t));
+  size = align64(table_offset + pm_table_size);
+
+  // Readers of an abandoned segment keep their mapping of the old object
+  // and notice it is dead; resizing it in place would fault them instead
+  shm_unlink(name);
+  fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+  if (fd < 0)
+    return NULL;
+
+  // Readable by unprivileged dashboards regardless of the umask
+  if (fchmod(fd, 0644) || ftruncate(fd, size)) {
+    close(fd);
+    shm_unlink(name);
+    return NULL;
+  }
+
+  base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  shm = calloc(1, sizeof(*shm));
+  if (base == MAP_FAILED || !shm) {
+    if (base != MAP_FAILED)
+      munmap(base, size);
+    free(shm);
+    shm_unlink(name);
+    return NULL;
+  }
+
+  hdr = base;
+  hdr->abi = RYZEN_SHM_ABI;
+  hdr->header_size = sizeof(*hdr);
+  hdr->segment_size = size;
+  hdr->pm_table_version = pm_table_version;
+  hdr->pm_table_size = pm_table_size;
+  hdr->max_cores = max_cores;
+  hdr->core_disable_map = core_disable_map;
+  hdr->publisher_pid = getpid();
+  hdr->snapshot_offset = snapshot_offset;
+  hdr->cores_offset = cores_offset;
+  hdr->table_offset = table_offset;
+  hdr->sysdata = *sysdata;
+  atomic_store_explicit(&hdr->heartbeat_ns, monotonic_ns(), memory_order_relaxed);
+  atomic_store_explicit(&hdr->alive, 1, memory_order_relaxed);
+
+  // Readers check the magic last, so it goes in after everything else
+  atomic_thread_fence(memory_order_release);
+  memcpy(hdr->magic, RYZEN_SHM_MAGIC, 8);
+
+  shm->base = base;
+  shm->size = size;
+  shm->hdr = hdr;
+  return shm;
+}
+
+// Single writer
+void ryzen_shm_write(ryzen_shm_t *shm, const ryzen_shm_snapshot *snap,
+                     const core_data_t *cores, const unsigned char *table) {
+  ryzen_shm_header *hdr = shm->hdr;
+  unsigned long long seq = atomic_load_explicit(&hdr->seq, memory_order_relaxed);
+
+  atomic_store_explicit(&hdr->seq, seq + 1, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+
+  memcpy(shm->base + hdr->snapshot_offset, snap, sizeof(*snap));
+  memcpy(shm->base + hdr->cores_offset, cores,
+         hdr->max_cores * sizeof(*cores));
+  memcpy(shm->base + hdr->table_offset, table, hdr->pm_table_size);
+
+  atomic_store_explicit(&hdr->seq, seq + 2, memory_order_release);
+  ryzen_shm_heartbeat(shm);
+}
+
+void ryzen_shm_heartbeat(ryzen_shm_t *shm) {
+  atomic_store_explicit(&shm->hdr->heartbeat_ns, monotonic_ns(),
+                        memory_order_relaxed);
+}
+
+void ryzen_shm_destroy(ryzen_shm_t *shm, const char *name) {
+  if (!shm)
+    return;
+
+  atomic_store_explicit(&shm->hdr->alive, 0, memory_order_release);
+  // Only remove the name if it still refers to our segment
+  if (!segment_in_use(name))
+    shm_unlink(shm_name(name));
+  ryzen_shm_close(shm);
+}
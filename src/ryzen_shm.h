@@ -0,0 +1,79 @@
+/**
+ * Ryzen Monitor Library
+ * Layout of the shared memory segment written by ryzen_shm_publish()
+ */
+
+#ifndef RYZEN_SHM_H
+#define RYZEN_SHM_H
+
+#include "ryzen_monitor_lib.h"
+#include <stdatomic.h>
+#include <stdint.h>
+
+#define RYZEN_SHM_MAGIC "RZMSHM\0\0"
+#define RYZEN_SHM_ABI 1
+
+// A reader treats the segment as abandoned if the publisher has not touched
+// the heartbeat for this long, e.g. because it was killed.
+#define RYZEN_SHM_STALE_NS 3000000000ULL
+
+// Fixed part of the segment. Everything up to seq is written once before
+// the segment becomes visible under its name.
+typedef struct {
+  char magic[8];
+  uint32_t abi;              // RYZEN_SHM_ABI, bumped on any layout change
+  uint32_t header_size;
+  uint32_t segment_size;
+  uint32_t pm_table_version;
+  uint32_t pm_table_size;
+  uint32_t max_cores;        // Entries of the cores array
+  uint32_t core_disable_map;
+  uint32_t publisher_pid;
+  uint32_t snapshot_offset;  // ryzen_shm_snapshot
+  uint32_t cores_offset;     // core_data_t[max_cores]
+  uint32_t table_offset;     // Raw PM table
+  system_data_t sysdata;
+
+  _Atomic uint32_t alive;    // Cleared when the publisher stops
+  _Atomic unsigned long long heartbeat_ns; // CLOCK_MONOTONIC
+
+  // Seqlock over the snapshot, cores and table: odd while the publisher
+  // writes, 0 until the first sample
+  _Atomic unsigned long long seq __attribute__((aligned(64)));
+} ryzen_shm_header;
+
+typedef struct {
+  unsigned long long sample_seq;   // Sampler sequence number
+  unsigned long long timestamp_ns; // Sampler timestamp, CLOCK_MONOTONIC
+  int32_t core_count;
+  int32_t reserved;
+  constraints_data_t constraints;
+  memory_data_t memory;
+  power_data_t power;
+  graphics_data_t graphics;
+  calculated_stats_t stats;
+} ryzen_shm_snapshot;
+
+struct ryzen_shm {
+  unsigned char *base;
+  size_t size;
+  ryzen_shm_header *hdr;
+};
+
+// Publisher side. ryzen_shm_create() replaces an abandoned segment of the
+// same name but fails if a live publisher owns it.
+ryzen_shm_t *ryzen_shm_create(const char *name, const system_data_t *sysdata,
+                              unsigned int pm_table_version,
+                              size_t pm_table_size, unsigned int max_cores,
+                              unsigned int core_disable_map);
+void ryzen_shm_write(ryzen_shm_t *shm, const ryzen_shm_snapshot *snap,
+                     const core_data_t *cores, const unsigned char *table);
+void ryzen_shm_heartbeat(ryzen_shm_t *shm);
+void ryzen_shm_destroy(ryzen_shm_t *shm, const char *name);
+
+// Newest snapshot header and raw table in one consistent copy. The cores are
+// skipped, which is all the terminal monitor needs.
+int ryzen_shm_read_raw(ryzen_shm_t *shm, ryzen_shm_snapshot *snap,
+                       unsigned char *table, size_t table_len);
+
+#endif // RYZEN_SHM_H
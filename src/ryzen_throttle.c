@@ -0,0 +1,122 @@
+/**
+ * Ryzen Monitor Library
+ * Limiter residency: feeds every sample to the throttle engine shared with
+ * the CLI, which attributes time to the binding constraint.
+ */
+
+#define _GNU_SOURCE
+
+#include "ryzen_session.h"
+#include "throttle.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define THROTTLE_BATCH 64
+
+struct ryzen_throttle {
+  ryzen_session_t *session;
+  unsigned long long since_ns; // Newest sampler snapshot consumed
+  float threshold;
+  throttle_state state;
+  float values[PMT_METRIC_COUNT];
+  unsigned char *tables;
+  ryzen_sample_info_t infos[THROTTLE_BATCH];
+};
+
+const char *ryzen_limit_name(int limit) { return throttle_name(limit); }
+
+ryzen_throttle_t *ryzen_throttle_create(ryzen_session_t *s, float threshold) {
+  ryzen_throttle_t *t;
+
+  if (!s)
+    return NULL;
+
+  t = calloc(1, sizeof(*t));
+  if (!t)
+    return NULL;
+
+  t->tables = malloc((size_t)THROTTLE_BATCH * s->smu->pm_table_size);
+  if (!t->tables) {
+    free(t);
+    return NULL;
+  }
+
+  t->session = s;
+  t->threshold = threshold;
+  pm_values_reset(t->values);
+  throttle_init(&t->state, threshold);
+  return t;
+}
+
+void ryzen_throttle_free(ryzen_throttle_t *t) {
+  if (!t)
+    return;
+
+  free(t->tables);
+  free(t);
+}
+
+void ryzen_throttle_reset(ryzen_throttle_t *t) {
+  if (!t)
+    return;
+
+  // Keeps since_ns, so samples already accounted are not counted again
+  throttle_init(&t->state, t->threshold);
+}
+
+static void throttle_add_table(ryzen_throttle_t *t, const unsigned char *table,
+                               unsigned long long timestamp_ns) {
+  ryzen_session_t *s = t->session;
+  core_calc_result cr;
+
+  pm_layout_gather(&s->layout, table, t->values);
+  core_calc(t->values, s->pmt.max_cores, s->sysinfo.core_disable_map,
+            s->pmt.PC6 != NULL, &cr);
+  throttle_update(&t->state, t->values, &cr, s->pmt.max_cores,
+                  s->sysinfo.core_disable_map, s->sysinfo.cores, timestamp_ns);
+}
+
+int ryzen_throttle_update(ryzen_throttle_t *t) {
+  ryzen_session_t *s;
+  struct timespec ts;
+  int total = 0, n;
+
+  if (!t)
+    return -1;
+
+  s = t->session;
+  if (!s->sampler) {
+    if (smu_read_pm_table(s->smu, s->pm_buf, s->smu->pm_table_size) !=
+        SMU_Return_OK)
+      return -1;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    throttle_add_table(t, s->pm_buf,
+                       (unsigned long long)ts.tv_sec * 1000000000ULL +
+                           ts.tv_nsec);
+    return 1;
+  }
+
+  // Residency needs every interval, not just the newest sample
+  do {
+    n = ryzen_read_range(s, t->since_ns, t->tables,
+                         (size_t)THROTTLE_BATCH * s->smu->pm_table_size,
+                         t->infos, THROTTLE_BATCH);
+    for (int i = 0; i < n; i++) {
+      throttle_add_table(t, t->tables + (size_t)i * s->smu->pm_table_size,
+                         t->infos[i].timestamp_ns);
+      t->since_ns = t->infos[i].timestamp_ns;
+    }
+    total += n > 0 ? n : 0;
+  } while (n == THROTTLE_BATCH);
+
+  return total;
+}
+
+int ryzen_throttle_stats(ryzen_throttle_t *t, ryzen_throttle_stats_t *stats) {
+  if (!t || !stats)
+    return -1;
+
+  *stats = t->state.stats;
+  return 0;
+}
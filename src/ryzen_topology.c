@@ -0,0 +1,142 @@
+/**
+ * Ryzen Monitor Library
+ * Topology rollups: per CCD and CCX summaries folded from the per quad
+ * reductions core_calc() computes in its per-core pass.
+ */
+
+#define _GNU_SOURCE
+
+#include "core_calc.h"
+#include "ryzen_session.h"
+#include <math.h>
+#include <time.h>
+
+// Core slots per CCD in the PM table and the core disable map
+#define TOPOLOGY_CCD_SLOTS 8
+
+// Core slots per group of level, a whole number of quads
+static int group_slots(const ryzen_session_t *s, int level) {
+  const pm_table *pmt = &s->pmt;
+  int slots;
+
+  if (level == RYZEN_GROUP_CCD)
+    slots = TOPOLOGY_CCD_SLOTS;
+  else if (pmt->max_l3 > 0) // One L3 per CCX
+    slots = pmt->max_cores / pmt->max_l3;
+  else
+    slots = s->sysinfo.ccxs > s->sysinfo.ccds ? 4 : TOPOLOGY_CCD_SLOTS;
+
+  if (slots < CORE_CALC_QUAD || slots % CORE_CALC_QUAD)
+    slots = TOPOLOGY_CCD_SLOTS;
+  return slots;
+}
+
+static int rollup(ryzen_session_t *s, const float *v, int level,
+                  ryzen_group_t *groups, int max_groups) {
+  const pm_table *pmt = &s->pmt;
+  int slots = group_slots(s, level);
+  int l3_slots = pmt->max_l3 ? pmt->max_cores / pmt->max_l3 : 0;
+  core_calc_result cr;
+  int n = 0;
+
+  core_calc(v, pmt->max_cores, s->sysinfo.core_disable_map, pmt->PC6 != NULL,
+            &cr);
+
+  for (int first = 0; first < pmt->max_cores && n < max_groups;
+       first += slots) {
+    ryzen_group_t *g = &groups[n];
+    float total_frequency = 0, total_temp = 0, c0 = 0, cc1 = 0, cc6 = 0;
+
+    g->index = first / slots;
+    g->ccd = first / TOPOLOGY_CCD_SLOTS;
+    g->cores = 0;
+    g->peak_frequency = 0;
+    g->peak_temp = 0;
+    g->power = 0;
+    for (int i = first / CORE_CALC_QUAD;
+         i < (first + slots) / CORE_CALC_QUAD && i < CORE_CALC_QUADS; i++) {
+      const core_calc_quad *q = &cr.quad[i];
+
+      if (g->peak_frequency < q->peak_frequency)
+        g->peak_frequency = q->peak_frequency;
+      if (g->peak_temp < q->peak_temp)
+        g->peak_temp = q->peak_temp;
+      g->cores += q->cores;
+      total_frequency += q->total_frequency;
+      total_temp += q->total_temp;
+      g->power += q->total_power;
+      c0 += q->total_c0;
+      cc1 += q->total_cc1;
+      cc6 += q->total_cc6;
+    }
+    if (!g->cores)
+      continue;
+
+    g->avg_frequency = total_frequency / g->cores;
+    g->avg_temp = total_temp / g->cores;
+    g->c0 = c0 / g->cores;
+    g->cc1 = cc1 / g->cores;
+    g->cc6 = cc6 / g->cores;
+
+    // Every L3 counts towards the group holding its first core slot
+    g->l3_logic_power = l3_slots ? 0 : NAN;
+    g->l3_vddm_power = l3_slots ? 0 : NAN;
+    for (int j = 0; j < pmt->max_l3; j++) {
+      if (j * l3_slots < first || j * l3_slots >= first + slots)
+        continue;
+      g->l3_logic_power += pmvi0(v, L3_LOGIC_POWER, j);
+      g->l3_vddm_power += pmvi0(v, L3_VDDM_POWER, j);
+    }
+    n++;
+  }
+
+  return n;
+}
+
+static int valid_request(ryzen_session_t *s, int level, ryzen_group_t *groups,
+                         int max_groups) {
+  return s && groups && max_groups > 0 &&
+         (level == RYZEN_GROUP_CCD || level == RYZEN_GROUP_CCX);
+}
+
+int ryzen_decode_groups(ryzen_session_t *s, const unsigned char *table,
+                        int level, ryzen_group_t *groups, int max_groups) {
+  float v[PMT_METRIC_COUNT];
+
+  if (!valid_request(s, level, groups, max_groups) || !table)
+    return -1;
+
+  pm_values_reset(v);
+  pm_layout_gather(&s->decode_layout, table, v);
+  return rollup(s, v, level, groups, max_groups);
+}
+
+int ryzen_read_groups(ryzen_session_t *s, int level, ryzen_group_t *groups,
+                      int max_groups, ryzen_sample_info_t *info) {
+  float v[PMT_METRIC_COUNT];
+  const unsigned char *table;
+  ryzen_sample_info_t tmp;
+  struct timespec ts;
+
+  if (!valid_request(s, level, groups, max_groups))
+    return -1;
+  if (!info)
+    info = &tmp;
+
+  pm_values_reset(v);
+  if (s->sampler) {
+    if (ryzen_sampler_latest_values(s, v, info) != 0)
+      return -1;
+  } else {
+    if (smu_read_pm_table_snapshot(s->smu, s->pm_buf, s->smu->pm_table_size,
+                                   &table, NULL) != SMU_Return_OK)
+      return -1;
+    pm_layout_gather(&s->decode_layout, table, v);
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    info->seq = 0;
+    info->timestamp_ns =
+        (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+  }
+
+  return rollup(s, v, level, groups, max_groups);
+}
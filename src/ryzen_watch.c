@@ -0,0 +1,168 @@
+/**
+ * Ryzen Monitor Library
+ * Change events: compares every sample against the values last reported and
+ * only hands out the metrics that moved by more than their threshold.
+ */
+
+#define _GNU_SOURCE
+
+#include "ryzen_session.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+struct ryzen_watch {
+  ryzen_session_t *session;
+  unsigned long long seq; // Last sample looked at
+  unsigned long long timestamp_ns;
+  float values[PMT_METRIC_COUNT];
+  float reported[PMT_METRIC_COUNT]; // What the consumer has been told
+  unsigned char known[PMT_METRIC_COUNT]; // reported[] is valid
+  float abs_threshold[PMT_METRIC_COUNT];
+  float rel_threshold[PMT_METRIC_COUNT];
+};
+
+int ryzen_metric_count(void) { return PMT_METRIC_COUNT; }
+
+const char *ryzen_metric_name(int metric, int *index) {
+  int tmp;
+
+  return pm_metric_name(metric, index ? index : &tmp);
+}
+
+int ryzen_metric_lookup(const char *name) { return pm_metric_lookup(name); }
+
+ryzen_watch_t *ryzen_watch_create(ryzen_session_t *s, float abs_threshold,
+                                  float rel_threshold) {
+  ryzen_watch_t *w;
+
+  if (!s)
+    return NULL;
+
+  w = calloc(1, sizeof(*w));
+  if (!w)
+    return NULL;
+
+  w->session = s;
+  pm_values_reset(w->values);
+  ryzen_watch_threshold(w, -1, abs_threshold, rel_threshold);
+  ryzen_watch_reset(w);
+  return w;
+}
+
+void ryzen_watch_free(ryzen_watch_t *w) { free(w); }
+
+int ryzen_watch_threshold(ryzen_watch_t *w, int metric, float abs_threshold,
+                          float rel_threshold) {
+  if (!w || metric < -1 || metric >= PMT_METRIC_COUNT)
+    return -1;
+
+  for (int i = metric < 0 ? 0 : metric;
+       i < (metric < 0 ? PMT_METRIC_COUNT : metric + 1); i++) {
+    w->abs_threshold[i] = abs_threshold;
+    w->rel_threshold[i] = rel_threshold;
+  }
+  return 0;
+}
+
+void ryzen_watch_reset(ryzen_watch_t *w) {
+  if (!w)
+    return;
+
+  memset(w->known, 0, sizeof(w->known));
+  w->seq = 0;
+}
+
+// Both thresholds 0: any change. Otherwise a change has to exceed one of the
+// thresholds that are set.
+static int exceeds(const ryzen_watch_t *w, int i, float v) {
+  float last = w->reported[i], d;
+
+  if (!w->known[i])
+    return !isnan(v);
+  if (isnan(v) || isnan(last))
+    return isnan(v) != isnan(last);
+
+  d = fabsf(v - last);
+  if (w->abs_threshold[i] <= 0 && w->rel_threshold[i] <= 0)
+    return d > 0;
+  return (w->abs_threshold[i] > 0 && d > w->abs_threshold[i]) ||
+         (w->rel_threshold[i] > 0 && d > w->rel_threshold[i] * fabsf(last));
+}
+
+// Only the metrics of the session's layout can ever change
+static int collect(ryzen_watch_t *w, ryzen_change_t *changes, int max_changes) {
+  const pm_layout *layout = &w->session->layout;
+  int count = 0;
+
+  for (unsigned int d = 0; d < layout->num_desc; d++) {
+    int first = layout->desc[d].metric;
+    int last = first + layout->desc[d].count;
+
+    for (int i = first; i < last; i++) {
+      if (!exceeds(w, i, w->values[i]))
+        continue;
+      // Changes that do not fit are kept pending for the next call
+      if (count == max_changes)
+        return count;
+
+      changes[count].metric = i;
+      changes[count].value = w->values[i];
+      w->reported[i] = w->values[i];
+      w->known[i] = 1;
+      count++;
+    }
+  }
+
+  return count;
+}
+
+int ryzen_watch_feed(ryzen_watch_t *w, const unsigned char *table,
+                     ryzen_change_t *changes, int max_changes) {
+  if (!w || !table || (!changes && max_changes))
+    return -1;
+
+  pm_layout_gather(&w->session->layout, table, w->values);
+  return collect(w, changes, max_changes);
+}
+
+int ryzen_watch_poll(ryzen_watch_t *w, ryzen_change_t *changes,
+                     int max_changes, ryzen_sample_info_t *info) {
+  ryzen_session_t *s;
+  ryzen_sample_info_t tmp;
+  const unsigned char *table;
+  unsigned long long head;
+  struct timespec ts;
+
+  if (!w || (!changes && max_changes))
+    return -1;
+
+  s = w->session;
+  if (!info)
+    info = &tmp;
+
+  if (s->sampler) {
+    // Nothing new since the last poll, but changes may still be pending
+    if (ryzen_sampler_stats(s, &head, NULL, NULL) == 0 && head &&
+        head == w->seq) {
+      info->seq = w->seq;
+      info->timestamp_ns = w->timestamp_ns;
+      return collect(w, changes, max_changes);
+    }
+    if (ryzen_sampler_latest_values(s, w->values, info) != 0)
+      return -1;
+  } else {
+    if (smu_read_pm_table_snapshot(s->smu, s->pm_buf, s->smu->pm_table_size,
+                                   &table, NULL) != SMU_Return_OK)
+      return -1;
+    pm_layout_gather(&s->layout, table, w->values);
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    info->seq = w->seq + 1;
+    info->timestamp_ns = (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+  }
+  w->seq = info->seq;
+  w->timestamp_ns = info->timestamp_ns;
+
+  return collect(w, changes, max_changes);
+}
@@ -0,0 +1,251 @@
+/**
+ * Ryzen SMU Userspace Sensor Monitor
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include "screen.h"
+
+#define SCREEN_MAX_LINES    512
+
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+} screen_buf;
+
+typedef struct {
+    screen_buf text;
+    unsigned int num_lines;
+    size_t line[SCREEN_MAX_LINES + 1];  //Start of each line, plus end of text
+} screen_frame;
+
+static screen_frame frames[2];
+static int current;
+static screen_buf out;
+static size_t last_write;
+static volatile sig_atomic_t invalid = 1;
+
+static void buf_reserve(screen_buf *b, size_t extra) {
+    size_t cap = b->cap ? b->cap : 4096;
+    char *tmp;
+
+    if (b->len + extra <= b->cap)
+        return;
+    while (cap < b->len + extra)
+        cap *= 2;
+
+    tmp = realloc(b->data, cap);
+    if (!tmp) {
+        fprintf(stderr, "Could not allocate memory for the screen buffer.\n");
+        exit(-1);
+    }
+    b->data = tmp;
+    b->cap = cap;
+}
+
+static void buf_append(screen_buf *b, const char *data, size_t len) {
+    if (!len)
+        return;
+    buf_reserve(b, len);
+    memcpy(b->data + b->len, data, len);
+    b->len += len;
+}
+
+static void buf_vprintf(screen_buf *b, const char *format, va_list list) {
+    va_list copy;
+    int len;
+
+    va_copy(copy, list);
+    len = vsnprintf(b->data ? b->data + b->len : NULL, b->data ? b->cap - b->len : 0, format, copy);
+    va_end(copy);
+    if (len < 0)
+        return;
+
+    if (!b->data || b->len + len + 1 > b->cap) {
+        buf_reserve(b, len + 1);
+        vsnprintf(b->data + b->len, b->cap - b->len, format, list);
+    }
+    b->len += len;
+}
+
+static void buf_printf(screen_buf *b, const char *format, ...) {
+    va_list list;
+
+    va_start(list, format);
+    buf_vprintf(b, format, list);
+    va_end(list);
+}
+
+static void write_all(const char *data, size_t len) {
+    //Keep the order of anything still buffered in stdout
+    fflush(stdout);
+    while (len) {
+        ssize_t n = write(STDOUT_FILENO, data, len);
+
+        if (n <= 0)
+            return;
+        data += n;
+        len -= n;
+    }
+}
+
+void screen_begin(void) {
+    frames[current].text.len = 0;
+}
+
+void screen_printf(const char *format, ...) {
+    va_list list;
+
+    va_start(list, format);
+    buf_vprintf(&frames[current].text, format, list);
+    va_end(list);
+}
+
+static void split_lines(screen_frame *f) {
+    const char *p = f->text.data, *end = f->text.data + f->text.len, *nl;
+
+    f->num_lines = 0;
+    f->line[0] = 0;
+    while (p < end && f->num_lines < SCREEN_MAX_LINES && (nl = memchr(p, '\n', end - p))) {
+        f->line[++f->num_lines] = nl + 1 - f->text.data;
+        p = nl + 1;
+    }
+    //Unterminated last line
+    if (f->line[f->num_lines] < f->text.len && f->num_lines < SCREEN_MAX_LINES)
+        f->line[++f->num_lines] = f->text.len + 1;
+}
+
+static const char *line_at(const screen_frame *f, unsigned int i, size_t *len) {
+    if (i >= f->num_lines) {
+        *len = 0;
+        return "";
+    }
+    *len = f->line[i + 1] - f->line[i] - 1;
+    return f->text.data + f->line[i];
+}
+
+#define IS_CONT(c) (((c) & 0xC0) == 0x80)
+
+static unsigned int columns(const char *s, size_t len) {
+    unsigned int cols = 0;
+    size_t i;
+
+    for (i = 0; i < len; i++)
+        cols += !IS_CONT((unsigned char)s[i]);
+    return cols;
+}
+
+//Appends the decimal digits of v
+static void buf_append_uint(screen_buf *b, unsigned int v) {
+    char digits[10];
+    int i = sizeof(digits);
+
+    do {
+        digits[--i] = '0' + v % 10;
+        v /= 10;
+    } while (v);
+    buf_append(b, digits + i, sizeof(digits) - i);
+}
+
+//Emits the changed span of one line
+static void diff_line(unsigned int row, const char *o, size_t olen, const char *n, size_t nlen) {
+    size_t p = 0, s = 0, max_s;
+    unsigned int old_cols, new_cols;
+
+    //Most lines of a frame are unchanged
+    if (olen == nlen && !memcmp(o, n, nlen))
+        return;
+    while (p < olen && p < nlen && o[p] == n[p])
+        p++;
+    //Start at a character boundary; identical bytes before p mean the
+    //boundary is the same in both lines
+    while (p > 0 && p < nlen && IS_CONT((unsigned char)n[p]))
+        p--;
+
+    max_s = (olen < nlen ? olen : nlen) - p;
+    while (s < max_s && o[olen - 1 - s] == n[nlen - 1 - s])
+        s++;
+    while (s > 0 && IS_CONT((unsigned char)n[nlen - s]))
+        s--;
+
+    old_cols = columns(o + p, olen - s - p);
+    new_cols = columns(n + p, nlen - s - p);
+
+    buf_append(&out, "\e[", 2);
+    buf_append_uint(&out, row + 1);
+    buf_append(&out, ";", 1);
+    buf_append_uint(&out, columns(n, p) + 1);
+    buf_append(&out, "H", 1);
+    if (old_cols == new_cols) {
+        buf_append(&out, n + p, nlen - s - p);
+    }
+    else {
+        //The tail moves; rewrite it and erase what is left of the old line
+        buf_append(&out, n + p, nlen - p);
+        if (columns(n + p, nlen - p) < columns(o + p, olen - p))
+            buf_append(&out, "\e[K", 3);
+    }
+}
+
+void screen_present(void) {
+    screen_frame *f = &frames[current], *prev = &frames[!current];
+    unsigned int i;
+
+    split_lines(f);
+    out.len = 0;
+
+    if (invalid) {
+        invalid = 0;
+        buf_append(&out, "\e[?25l\e[1;1H\e[2J", 16);
+        buf_append(&out, f->text.data, f->text.len);
+    }
+    else {
+        for (i = 0; i < f->num_lines; i++) {
+            size_t olen, nlen;
+            const char *o = line_at(prev, i, &olen);
+            const char *n = line_at(f, i, &nlen);
+
+            diff_line(i, o, olen, n, nlen);
+        }
+        if (prev->num_lines > f->num_lines)
+            buf_printf(&out, "\e[%u;1H\e[J", f->num_lines + 1);
+    }
+
+    write_all(out.data, out.len);
+    last_write = out.len;
+    current = !current;
+}
+
+void screen_print(void) {
+    screen_frame *f = &frames[current];
+
+    write_all(f->text.data, f->text.len);
+    last_write = f->text.len;
+}
+
+void screen_invalidate(void) {
+    invalid = 1;
+}
+
+size_t screen_last_write_size(void) {
+    return last_write;
+}
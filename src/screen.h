@@ -0,0 +1,52 @@
+/**
+ * Ryzen SMU Userspace Sensor Monitor
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef screen_h
+#define screen_h
+
+#include <stddef.h>
+
+//Frame renderer for the monitor. A frame is collected with screen_printf()
+//and kept after it was shown; the next frame is compared line by line and
+//only the changed spans are sent, cursor-addressed, in a single write().
+//Unchanged lines are skipped after one memcmp(). Diffing the rest takes more
+//CPU than sending the whole frame would; what it saves is bytes the terminal
+//has to parse and repaint.
+//Columns are counted in UTF-8 code points, which matches the box drawing
+//characters the monitor uses.
+
+//Starts collecting a new frame.
+void screen_begin(void);
+
+//Appends formatted text to the current frame.
+void screen_printf(const char *format, ...) __attribute__((format(printf, 1, 2)));
+
+//Shows the current frame on the terminal. The first frame, and the first
+//after screen_invalidate(), clears the screen and is drawn in full.
+void screen_present(void);
+
+//Writes the current frame as plain text, without any escape sequences.
+void screen_print(void);
+
+//Forces the next screen_present() to redraw everything, e.g. after the
+//terminal was resized. Async-signal-safe.
+void screen_invalidate(void);
+
+//Returns the number of bytes screen_present() wrote for the last frame.
+size_t screen_last_write_size(void);
+
+#endif
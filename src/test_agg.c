@@ -0,0 +1,78 @@
+/**
+ * Ryzen SMU Userspace Sensor Monitor
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "pm_tables.h"
+#include "ryzen_monitor_lib.h"
+
+#define TEST_SAMPLES        10000   //Of 16 cores each, all in one 100 ms bucket
+#define TEST_BIN_MHZ        32      //Histogram resolution of the frequency
+
+static int failures;
+
+static void check(const char *what, float got, float want, float tolerance) {
+    if (fabsf(got - want) <= tolerance) return;
+    fprintf(stderr, "FAIL %s: %.1f, expected %.1f\n", what, got, want);
+    failures++;
+}
+
+//A merged window pools every core of every host into one lane, so a 1 s
+//bucket of 1000 hosts at 10 Hz with 16 cores sees 160k samples. The bins
+//must not saturate: 90k cores at 1000 MHz put p50 there, and a bin clipped
+//at 65535 would move it to the 35k at 3000 MHz.
+static void test_merged_bucket_overflow(void) {
+    core_data_t cores[PMT_MAX_NUM_CORES];
+    constraints_data_t constraints;
+    power_data_t power;
+    ryzen_window_stat_t stat;
+    ryzen_agg_t *agg = ryzen_agg_create_merged();
+    unsigned long long ts = 1000000000000ULL;
+    int i, k, n = 0;
+
+    if (!agg) {
+        fprintf(stderr, "FAIL could not create the window\n");
+        failures++;
+        return;
+    }
+    memset(cores, 0, sizeof(cores));
+    memset(&constraints, 0, sizeof(constraints));
+    memset(&power, 0, sizeof(power));
+
+    for (i = 0; i < TEST_SAMPLES; i++) {
+        for (k = 0; k < PMT_MAX_NUM_CORES; k++, n++)
+            cores[k].frequency = n < 90000 ? 1000 : n < 125000 ? 3000 : n < 158000 ? 4000 : 6000;
+        ryzen_agg_add(agg, ts + i, cores, PMT_MAX_NUM_CORES, &constraints, &power);
+    }
+
+    ryzen_agg_stat(agg, RYZEN_WINDOW_1S, RYZEN_SERIES_CORE_FREQUENCY, 0, &stat);
+    check("count", stat.count, TEST_SAMPLES * PMT_MAX_NUM_CORES, 0);
+    check("p50", stat.p50, 1000, TEST_BIN_MHZ);
+    check("p99", stat.p99, 6000, TEST_BIN_MHZ);
+    check("max", stat.max, 6000, 0);
+    ryzen_agg_free(agg);
+}
+
+int main(void) {
+    test_merged_bucket_overflow();
+
+    if (failures) return 1;
+    fprintf(stdout, "All tests passed.\n");
+    return 0;
+}
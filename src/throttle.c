@@ -0,0 +1,135 @@
+/**
+ * Ryzen SMU Userspace Sensor Monitor
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <math.h>
+#include <string.h>
+#include "pm_layout.h"
+#include "throttle.h"
+
+static const char *limit_names[RYZEN_LIMIT_COUNT] = {
+    [RYZEN_LIMIT_NONE]     = "None",
+    [RYZEN_LIMIT_PPT]      = "PPT",
+    [RYZEN_LIMIT_PPT_FAST] = "PPT Fast",
+    [RYZEN_LIMIT_TDC]      = "TDC",
+    [RYZEN_LIMIT_TDC_SOC]  = "TDC SoC",
+    [RYZEN_LIMIT_EDC]      = "EDC",
+    [RYZEN_LIMIT_EDC_SOC]  = "EDC SoC",
+    [RYZEN_LIMIT_THM]      = "THM",
+    [RYZEN_LIMIT_FIT]      = "FIT",
+    [RYZEN_LIMIT_PSI0_VDD] = "PSI0 VDD",
+    [RYZEN_LIMIT_PSI0_SOC] = "PSI0 SoC",
+    [RYZEN_LIMIT_GFX_EDC]  = "GFX EDC",
+};
+
+const char* throttle_name(int limit) {
+    if (limit < 0 || limit >= RYZEN_LIMIT_COUNT) return NULL;
+    return limit_names[limit];
+}
+
+void throttle_init(throttle_state *t, float threshold) {
+    memset(t, 0, sizeof(*t));
+    t->threshold = threshold > 0 ? threshold : THROTTLE_DEFAULT_THRESHOLD;
+    t->stats.binding = RYZEN_LIMIT_NONE;
+}
+
+//NAN if the field is missing in this PM table version or has no limit
+static float ratio(float value, float limit) {
+    if (isnan(value) || isnan(limit) || limit <= 0) return NAN;
+    return value / limit;
+}
+
+static void utilization(const float *values, const core_calc_result *cr, int total_cores,
+                        float *u) {
+    float edc = NAN;
+
+    if (total_cores > 0) {
+        edc = pmv(values, EDC_VALUE) * (cr->total_c0 / total_cores / 100);
+        if (edc < pmv(values, TDC_VALUE)) edc = pmv(values, TDC_VALUE);
+    }
+
+    u[RYZEN_LIMIT_NONE]     = NAN;
+    u[RYZEN_LIMIT_PPT]      = ratio(pmv(values, PPT_VALUE), pmv(values, PPT_LIMIT));
+    u[RYZEN_LIMIT_PPT_FAST] = ratio(pmv(values, PPT_VALUE_FAST), pmv(values, PPT_LIMIT_FAST));
+    u[RYZEN_LIMIT_TDC]      = ratio(pmv(values, TDC_VALUE), pmv(values, TDC_LIMIT));
+    u[RYZEN_LIMIT_TDC_SOC]  = ratio(pmv(values, TDC_VALUE_SOC), pmv(values, TDC_LIMIT_SOC));
+    u[RYZEN_LIMIT_EDC]      = ratio(edc, pmv(values, EDC_LIMIT));
+    u[RYZEN_LIMIT_EDC_SOC]  = ratio(pmv(values, EDC_VALUE_SOC), pmv(values, EDC_LIMIT_SOC));
+    u[RYZEN_LIMIT_THM]      = ratio(pmv(values, THM_VALUE), pmv(values, THM_LIMIT));
+    u[RYZEN_LIMIT_FIT]      = ratio(pmv(values, FIT_VALUE), pmv(values, FIT_LIMIT));
+    //Residencies are the share of the interval the SMU held the limit
+    u[RYZEN_LIMIT_PSI0_VDD] = pmv(values, PSI0_RESIDENCY_VDD);
+    u[RYZEN_LIMIT_PSI0_SOC] = pmv(values, PSI0_RESIDENCY_SOC);
+    u[RYZEN_LIMIT_GFX_EDC]  = pmv(values, GFX_EDC_RESIDENCY);
+}
+
+static int is_residency(int limit) {
+    return limit == RYZEN_LIMIT_PSI0_VDD || limit == RYZEN_LIMIT_PSI0_SOC ||
+           limit == RYZEN_LIMIT_GFX_EDC;
+}
+
+int throttle_update(throttle_state *t, const float *values, const core_calc_result *cr,
+                    int num_cores, unsigned int disable_map, int total_cores,
+                    unsigned long long timestamp_ns) {
+    ryzen_throttle_stats_t *st = &t->stats;
+    unsigned long long dt = 0;
+    int i, bin, binding = RYZEN_LIMIT_NONE;
+    float best = 0, u;
+
+    utilization(values, cr, total_cores, st->utilization);
+
+    for (i = RYZEN_LIMIT_NONE + 1; i < RYZEN_LIMIT_COUNT; i++) {
+        u = st->utilization[i];
+        if (!(u >= t->threshold)) continue; //Also skips NAN
+        if (u > best) {
+            best = u;
+            binding = i;
+        }
+    }
+
+    //The sample describes the interval since the previous one. The first
+    //sample and samples after long gaps only set the starting point.
+    if (t->last_ns && timestamp_ns > t->last_ns && timestamp_ns - t->last_ns <= THROTTLE_MAX_GAP_NS)
+        dt = timestamp_ns - t->last_ns;
+    if (timestamp_ns > t->last_ns) t->last_ns = timestamp_ns;
+
+    if (binding != RYZEN_LIMIT_NONE && binding != st->binding) st->episodes[binding]++;
+    st->binding = binding;
+    st->samples++;
+    if (!dt) return binding;
+
+    st->total_ns += dt;
+    st->binding_ns[binding] += dt;
+
+    for (i = RYZEN_LIMIT_NONE + 1; i < RYZEN_LIMIT_COUNT; i++) {
+        u = st->utilization[i];
+        if (isnan(u) || u <= 0) continue;
+        if (is_residency(i))
+            st->active_ns[i] += (unsigned long long)(dt * (u > 1.f ? 1.f : u));
+        else if (u >= t->threshold)
+            st->active_ns[i] += dt;
+    }
+
+    if (num_cores > PMT_MAX_NUM_CORES) num_cores = PMT_MAX_NUM_CORES;
+    for (i = 0; i < num_cores; i++) {
+        if ((disable_map >> i) & 1 || isnan(cr->frequency[i])) continue;
+        bin = (int)(cr->frequency[i] / RYZEN_FREQ_BIN_MHZ);
+        bin = bin < 0 ? 0 : bin >= RYZEN_FREQ_BINS ? RYZEN_FREQ_BINS - 1 : bin;
+        st->freq_ns[binding][bin] += dt;
+    }
+
+    return binding;
+}
@@ -0,0 +1,54 @@
+/**
+ * Ryzen SMU Userspace Sensor Monitor
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef throttle_h
+#define throttle_h
+
+#include "pm_tables.h"
+#include "core_calc.h"
+#include "ryzen_monitor_lib.h"
+
+//Share of a limit at which a limiter counts as reached
+#define THROTTLE_DEFAULT_THRESHOLD  0.95f
+
+//Gaps between samples longer than this are not attributed to any limiter,
+//e.g. after the sampler was paused
+#define THROTTLE_MAX_GAP_NS         5000000000ULL
+
+//Incremental limiter engine. Every sample decides which constraint binds
+//and attributes the time since the previous sample to it. The counters are
+//the public ryzen_throttle_stats_t, so the CLI and the library agree.
+typedef struct {
+    float threshold;
+    unsigned long long last_ns;     //Timestamp of the previous sample, 0 if none
+    ryzen_throttle_stats_t stats;
+} throttle_state;
+
+void throttle_init(throttle_state *t, float threshold);
+
+//Feeds one sample: values is the dense metric array, cr the per-core
+//derivation of the same sample and total_cores the core count of the
+//package, which scales EDC like the monitor does. Returns the binding
+//limiter (RYZEN_LIMIT_*).
+int throttle_update(throttle_state *t, const float *values, const core_calc_result *cr,
+                    int num_cores, unsigned int disable_map, int total_cores,
+                    unsigned long long timestamp_ns);
+
+//Short name of a limiter, e.g. "PPT", or NULL for invalid ids
+const char* throttle_name(int limit);
+
+#endif